@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON files, like the nurbs_benchmarks.json
+written by the nurbs_benchmarks_json target.
+
+    compare_benchmarks.py baseline.json current.json [--threshold 0.10]
+
+With repetitions the median is compared, otherwise the single run. Exits
+with 1 when a benchmark got slower than the baseline by more than threshold,
+so CI can fail on it. Benchmarks only in one file are listed, but they do
+not fail the run.
+"""
+
+import argparse
+import json
+import sys
+
+# Google Benchmark time units in nanoseconds
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as file:
+        runs = json.load(file)["benchmarks"]
+    times = {}
+    for run in runs:
+        if run.get("error_occurred"):
+            continue
+        if run.get("run_type") == "aggregate":
+            if run.get("aggregate_name") != "median":
+                continue
+            name = run["run_name"]
+        else:
+            name = run["name"]
+            # A median from repetitions wins over the single runs
+            if name in times:
+                continue
+        times[name] = run["cpu_time"] * UNITS[run.get("time_unit", "ns")]
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed slowdown, 0.10 is 10%%")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = 0
+    width = max((len(name) for name in baseline.keys() | current.keys()),
+                default=0)
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Current':>12}  Change")
+    for name in sorted(baseline.keys() & current.keys()):
+        change = current[name] / baseline[name] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:<{width}}  {baseline[name]:>10.0f}ns"
+              f"  {current[name]:>10.0f}ns  {change:+7.1%}{flag}")
+    for name in sorted(baseline.keys() - current.keys()):
+        print(f"{name:<{width}}  missing from {args.current}")
+    for name in sorted(current.keys() - baseline.keys()):
+        print(f"{name:<{width}}  new, not in {args.baseline}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) slower than the baseline by more "
+              f"than {args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
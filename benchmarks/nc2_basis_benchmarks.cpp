@@ -0,0 +1,260 @@
+#include <benchmark/benchmark.h>
+
+// NURBS_CPP
+#include "include/b_spline_curve.hpp"
+#include "include/basis_table.hpp"
+#include "include/b_spline_surface.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/knot_utility_functions.hpp"
+#include "include/span_locator.hpp"
+
+// STD
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace nurbs {
+namespace {
+constexpr double kTolerance = std::numeric_limits<double>::epsilon();
+constexpr uint32_t kSpans = 16;
+constexpr int32_t kSamples = 1024;
+
+// Clamped uniform knot vector over [0, 1]
+std::vector<double> UniformKnots(uint32_t degree, uint32_t spans) {
+  std::vector<double> knots(degree, 0.0);
+  for (uint32_t i = 0; i <= spans; ++i) {
+    knots.push_back(static_cast<double>(i) / static_cast<double>(spans));
+  }
+  knots.insert(knots.end(), degree, 1.0);
+  return knots;
+}
+
+std::vector<Point3D> CurvePoints(size_t count) {
+  std::vector<Point3D> points;
+  for (size_t i = 0; i < count; ++i) {
+    double x = static_cast<double>(i);
+    points.push_back({x, std::sin(x), std::cos(x)});
+  }
+  return points;
+}
+
+double Sample(int32_t i) {
+  return static_cast<double>(i) / static_cast<double>(kSamples - 1);
+}
+
+// Span search over range(0) spans. range(1) = 1 carries the last span over
+// like the batched evaluators, 0 is the plain binary search.
+void BM_FindSpanParam(benchmark::State &state) {
+  constexpr uint32_t kDegree = 3;
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const bool hinted = state.range(1) != 0;
+  std::vector<double> knots = UniformKnots(kDegree, spans);
+  for (auto _ : state) {
+    uint32_t span = kDegree;
+    for (int32_t i = 0; i < kSamples; ++i) {
+      double u = Sample(i);
+      span = hinted ? knots::FindSpanParam(kDegree, knots, u, kTolerance, span)
+                    : knots::FindSpanParam(kDegree, knots, u, kTolerance);
+      benchmark::DoNotOptimize(span);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_FindSpanParam)->ArgsProduct({{16, 1024, 16384}, {0, 1}});
+
+// Span lookup over range(0) spans in a scattered order, on uniform knots when
+// range(1) is 0 and on knots clustered towards 0 when 1. range(2) = 1 uses
+// the SpanLocator, 0 the binary search.
+void BM_SpanLocator(benchmark::State &state) {
+  constexpr uint32_t kDegree = 3;
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const bool located = state.range(2) != 0;
+  std::vector<double> knots = UniformKnots(kDegree, spans);
+  if (state.range(1) != 0) {
+    for (double &knot : knots) {
+      knot = knot * knot * knot;
+    }
+  }
+  const knots::SpanLocator locator(kDegree, knots, kTolerance);
+  std::vector<double> params(kSamples);
+  for (int32_t i = 0; i < kSamples; ++i) {
+    params[i] = std::fmod(i * 0.6180339887498949, 1.0);
+  }
+  for (auto _ : state) {
+    for (double u : params) {
+      uint32_t span = located
+                          ? locator.Find(u)
+                          : knots::FindSpanParam(kDegree, knots, u, kTolerance);
+      benchmark::DoNotOptimize(span);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_SpanLocator)->ArgsProduct({{16, 1024, 16384}, {0, 1}, {0, 1}});
+
+// Generic basis kernel, degree given at runtime
+void BM_BasisFunsRuntime(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  knots::BasisScratch scratch;
+  scratch.Reserve(degree);
+  std::vector<double> bases(degree + 1);
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kSamples; ++i) {
+      double u = Sample(i);
+      uint32_t span = knots::FindSpanParam(degree, knots, u, kTolerance);
+      knots::BasisFuns(span, u, degree, knots, kTolerance, bases.data(),
+                       scratch);
+      benchmark::DoNotOptimize(bases.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_BasisFunsRuntime)->DenseRange(1, 5);
+
+template <uint32_t P> void BM_BasisFunsFixed(benchmark::State &state) {
+  std::vector<double> knots = UniformKnots(P, kSpans);
+  std::array<double, P + 1> bases;
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kSamples; ++i) {
+      double u = Sample(i);
+      uint32_t span = knots::FindSpanParam(P, knots, u, kTolerance);
+      knots::BasisFuns<P>(span, u, knots, kTolerance, bases);
+      benchmark::DoNotOptimize(bases.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK_TEMPLATE(BM_BasisFunsFixed, 1);
+BENCHMARK_TEMPLATE(BM_BasisFunsFixed, 2);
+BENCHMARK_TEMPLATE(BM_BasisFunsFixed, 3);
+BENCHMARK_TEMPLATE(BM_BasisFunsFixed, 4);
+BENCHMARK_TEMPLATE(BM_BasisFunsFixed, 5);
+
+// range(1) derivatives of the degree range(0) basis functions
+void BM_DersBasisFuns(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  const uint32_t n = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  knots::BasisScratch scratch;
+  scratch.Reserve(degree, n);
+  std::vector<double> ders((n + 1) * (degree + 1));
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kSamples; ++i) {
+      double u = Sample(i);
+      uint32_t span = knots::FindSpanParam(degree, knots, u, kTolerance);
+      knots::DersBasisFuns(span, u, degree, n, knots, ders.data(), scratch);
+      benchmark::DoNotOptimize(ders.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_DersBasisFuns)
+    ->ArgsProduct({benchmark::CreateDenseRange(1, 7, 1), {1, 2}});
+
+std::vector<double> SampleParams() {
+  std::vector<double> params(kSamples);
+  for (int32_t i = 0; i < kSamples; ++i) {
+    params[i] = Sample(i);
+  }
+  return params;
+}
+
+// Basis table of degree range(0) with range(1) derivatives, built every time
+void BM_BasisTableBuild(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  const uint32_t derivatives = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  std::vector<double> params = SampleParams();
+  knots::BasisTable table;
+  for (auto _ : state) {
+    table.Build(degree, knots, params.data(), params.size(), kTolerance,
+                derivatives);
+    benchmark::DoNotOptimize(table.values(0));
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_BasisTableBuild)->ArgsProduct({{1, 3, 5}, {0, 2}});
+
+// The same table from the cache, the cost of a hit
+void BM_BasisTableCacheHit(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  const uint32_t derivatives = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  std::vector<double> params = SampleParams();
+  knots::BasisTableCache cache;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache.Get(degree, knots, params.data(),
+                                       params.size(), kTolerance,
+                                       derivatives));
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_BasisTableCacheHit)->ArgsProduct({{1, 3, 5}, {0, 2}});
+
+// Curve point through the generic kernel, the path used before dispatch
+void BM_CurvePointRuntime(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  std::vector<Point3D> points = CurvePoints(knots.size() - degree - 1);
+  knots::BasisScratch scratch;
+  scratch.Reserve(degree);
+  double *bases = scratch.bases.data();
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kSamples; ++i) {
+      double u = Sample(i);
+      uint32_t span = knots::FindSpanParam(degree, knots, u, kTolerance);
+      knots::BasisFuns(span, u, degree, knots, kTolerance, bases, scratch);
+      Point3D point{0.0, 0.0, 0.0};
+      for (uint32_t j = 0; j <= degree; ++j) {
+        point += bases[j] * points[span - degree + j];
+      }
+      benchmark::DoNotOptimize(point);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_CurvePointRuntime)->DenseRange(1, 7);
+
+// BSplineCurve3D::EvaluateCurve, fixed degree for 1-5 and generic above
+void BM_BSplineCurve3DEvaluate(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  BSplineCurve3D curve(degree, CurvePoints(knots.size() - degree - 1), knots);
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kSamples; ++i) {
+      benchmark::DoNotOptimize(curve.EvaluateCurve(Sample(i)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_BSplineCurve3DEvaluate)->DenseRange(1, 7);
+
+// BSplineSurface::EvaluatePoint with equal degrees in u and v
+void BM_BSplineSurfaceEvaluate(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = UniformKnots(degree, kSpans);
+  const size_t count = knots.size() - degree - 1;
+  std::vector<std::vector<Point3D>> control_points(count);
+  for (size_t i = 0; i < count; ++i) {
+    control_points[i] = CurvePoints(count);
+    for (Point3D &point : control_points[i]) {
+      point.x += static_cast<double>(i);
+    }
+  }
+  BSplineSurface surface(degree, degree, knots, knots, control_points);
+  constexpr int32_t kGrid = 32;
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kGrid; ++i) {
+      for (int32_t j = 0; j < kGrid; ++j) {
+        Point2D uv = {static_cast<double>(i) / (kGrid - 1),
+                      static_cast<double>(j) / (kGrid - 1)};
+        benchmark::DoNotOptimize(surface.EvaluatePoint(uv));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kGrid * kGrid);
+}
+BENCHMARK(BM_BSplineSurfaceEvaluate)->DenseRange(1, 7);
+} // namespace
+} // namespace nurbs
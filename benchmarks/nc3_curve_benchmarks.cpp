@@ -0,0 +1,386 @@
+#include <benchmark/benchmark.h>
+
+// NURBS_CPP
+#include "include/b_spline_curve.hpp"
+#include "include/basis_table.hpp"
+#include "include/bezier_curve.hpp"
+#include "include/bezier_set.hpp"
+#include "include/curve_flattener.hpp"
+#include "include/nurbs_curve.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cmath>
+#include <vector>
+
+namespace nurbs {
+namespace {
+constexpr uint32_t kDegree = 3;
+
+// Clamped uniform cubic with spans spans over [0, 1]
+std::vector<double> CubicKnots(uint32_t spans) {
+  std::vector<double> knots(kDegree, 0.0);
+  for (uint32_t i = 0; i <= spans; ++i) {
+    knots.push_back(static_cast<double>(i) / static_cast<double>(spans));
+  }
+  knots.insert(knots.end(), kDegree, 1.0);
+  return knots;
+}
+
+// One knot in the middle of each span of CubicKnots
+std::vector<double> MidKnots(uint32_t spans) {
+  std::vector<double> knots;
+  for (uint32_t i = 0; i < spans; ++i) {
+    knots.push_back((static_cast<double>(i) + 0.5) /
+                    static_cast<double>(spans));
+  }
+  return knots;
+}
+
+std::vector<Point4D> WeightedPoints(size_t count) {
+  std::vector<Point4D> points;
+  for (size_t i = 0; i < count; ++i) {
+    double x = static_cast<double>(i);
+    double w = 1.0 + (0.5 * std::sin(x));
+    points.push_back({x * w, std::sin(x) * w, std::cos(x) * w, w});
+  }
+  return points;
+}
+
+// One EvaluateCurve call, and so one span lookup, per sample
+void BM_NURBSCurve3DEvaluateCurve(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  std::vector<Point3D> points(samples);
+  const double div = 1.0 / static_cast<double>(samples - 1);
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < samples; ++i) {
+      points[i] = curve.EvaluateCurve(static_cast<double>(i) * div);
+    }
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_NURBSCurve3DEvaluateCurve)
+    ->ArgsProduct({{16, 1024, 16384}, {1024, 16384}});
+
+// 16384 samples of a 1024 span cubic, one at a time when range(0) is 0 and
+// batched without the table cache when 1, as with parameters that change
+// every frame. range(1) = 1 keeps the knots uniform so the interior spans
+// take the basis matrix, 0 moves each interior knot by a relative 1e-9 so
+// every span goes through BasisFuns.
+void BM_NURBSCurve3DUniformCubic(benchmark::State &state) {
+  constexpr uint32_t kSamples = 16384;
+  const bool batched = state.range(0) != 0;
+  std::vector<double> knots = CubicKnots(1024);
+  if (state.range(1) == 0) {
+    for (size_t i = kDegree + 1; i + kDegree + 1 < knots.size(); ++i) {
+      knots[i] *= 1.0 + (1e-9 * static_cast<double>(i % 3));
+    }
+  }
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  std::vector<double> params(kSamples);
+  for (uint32_t i = 0; i < kSamples; ++i) {
+    params[i] = static_cast<double>(i) / static_cast<double>(kSamples - 1);
+  }
+  std::vector<Point3D> points(kSamples);
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  const size_t capacity = cache.capacity();
+  cache.capacity(0);
+  for (auto _ : state) {
+    if (batched) {
+      curve.EvaluateCurveBatch(params.data(), kSamples, points.data());
+    } else {
+      for (uint32_t i = 0; i < kSamples; ++i) {
+        points[i] = curve.EvaluateCurve(params[i]);
+      }
+    }
+    benchmark::DoNotOptimize(points.data());
+  }
+  cache.capacity(capacity);
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_NURBSCurve3DUniformCubic)->ArgsProduct({{0, 1}, {0, 1}});
+
+// BM_NURBSCurve3DEvaluateCurve on the compiled power basis form, one span
+// search and one Horner pass per sample
+void BM_NURBSCurve3DPowerBasisEvaluateCurve(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  const PiecewisePowerBasisCurve3D compiled = curve.ToPowerBasis();
+  std::vector<Point3D> points(samples);
+  const double div = 1.0 / static_cast<double>(samples - 1);
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < samples; ++i) {
+      points[i] = compiled.EvaluateCurve(static_cast<double>(i) * div);
+    }
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_NURBSCurve3DPowerBasisEvaluateCurve)
+    ->ArgsProduct({{16, 1024, 16384}, {1024, 16384}});
+
+// EvaluateDerivative up to order range(0) at 1024 samples over 16 spans
+void BM_NURBSCurve3DEvaluateDerivative(benchmark::State &state) {
+  const uint32_t order = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(16);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  constexpr uint32_t kSamples = 1024;
+  const double div = 1.0 / static_cast<double>(kSamples - 1);
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < kSamples; ++i) {
+      benchmark::DoNotOptimize(
+          curve.EvaluateDerivative(static_cast<double>(i) * div, order));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_NURBSCurve3DEvaluateDerivative)->DenseRange(1, 3);
+
+// EvaluateCurvePoints goes through EvaluateCurveBatch and walks the spans
+void BM_NURBSCurve3DEvaluateCurvePoints(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.EvaluateCurvePoints(samples));
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_NURBSCurve3DEvaluateCurvePoints)
+    ->ArgsProduct({{16, 1024, 16384}, {1024, 16384}});
+
+// The same samples as EvaluateCurvePoints by forward differencing, degree
+// additions per coordinate and a division per point
+void BM_NURBSCurve3DStepCurvePoints(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.StepCurvePoints(samples));
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_NURBSCurve3DStepCurvePoints)
+    ->ArgsProduct({{16, 1024, 16384}, {1024, 16384}});
+
+// Inserts a new knot range(1) times into a range(0) span curve
+void BM_NURBSCurve3DKnotInsertion(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t times = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  const double knot = 0.5 / static_cast<double>(spans);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.KnotInsertion(knot, times));
+  }
+}
+BENCHMARK(BM_NURBSCurve3DKnotInsertion)
+    ->ArgsProduct({{16, 1024, 16384}, {1, 3}});
+
+// Refines a range(0) span curve with one new knot in the middle of each span
+void BM_NURBSCurve3DMergeKnotVect(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  std::vector<double> mid_knots;
+  for (uint32_t i = 0; i < spans; ++i) {
+    mid_knots.push_back((static_cast<double>(i) + 0.5) /
+                        static_cast<double>(spans));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.MergeKnotVect(mid_knots));
+  }
+}
+BENCHMARK(BM_NURBSCurve3DMergeKnotVect)->Arg(16)->Arg(1024)->Arg(16384);
+
+// BM_NURBSCurve3DKnotInsertion into one destination curve reused every call
+void BM_NURBSCurve3DInsertKnotsInto(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t times = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  NURBSCurve3D out = curve;
+  const double knot = 0.5 / static_cast<double>(spans);
+  for (auto _ : state) {
+    curve.InsertKnotsInto(knot, times, out);
+    benchmark::DoNotOptimize(out.control_points().data());
+  }
+}
+BENCHMARK(BM_NURBSCurve3DInsertKnotsInto)
+    ->ArgsProduct({{16, 1024, 16384}, {1, 3}});
+
+// BM_NURBSCurve3DMergeKnotVect into one destination curve reused every call
+void BM_NURBSCurve3DRefineInto(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  std::vector<double> mid_knots;
+  for (uint32_t i = 0; i < spans; ++i) {
+    mid_knots.push_back((static_cast<double>(i) + 0.5) /
+                        static_cast<double>(spans));
+  }
+  NURBSCurve3D out = curve;
+  for (auto _ : state) {
+    curve.RefineInto(mid_knots, out);
+    benchmark::DoNotOptimize(out.control_points().data());
+  }
+}
+BENCHMARK(BM_NURBSCurve3DRefineInto)->Arg(16)->Arg(1024)->Arg(16384);
+
+void BM_NURBSCurve3DDecompose(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.Decompose());
+  }
+}
+BENCHMARK(BM_NURBSCurve3DDecompose)->Arg(16)->Arg(1024)->Arg(16384);
+
+// Decompose into one reused segment arena
+void BM_NURBSCurve3DDecomposeSegmentSet(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  BezierSegmentSet segments;
+  for (auto _ : state) {
+    curve.Decompose(segments);
+    benchmark::DoNotOptimize(segments.points().data());
+  }
+}
+BENCHMARK(BM_NURBSCurve3DDecomposeSegmentSet)
+    ->Arg(16)
+    ->Arg(1024)
+    ->Arg(16384);
+
+// Simplify of a range(0) span curve with every span split in two, which
+// takes all the split knots back out
+void BM_NURBSCurve3DSimplify(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  curve.Refine(MidKnots(spans));
+  for (auto _ : state) {
+    NURBSCurve3D simplified = curve;
+    benchmark::DoNotOptimize(simplified.Simplify(1e-9));
+  }
+}
+BENCHMARK(BM_NURBSCurve3DSimplify)->Arg(16)->Arg(1024);
+
+// DegreeElevation by one of a range(0) span curve
+void BM_NURBSCurve3DDegreeElevate(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(curve.DegreeElevation(1));
+  }
+}
+BENCHMARK(BM_NURBSCurve3DDegreeElevate)->Arg(16)->Arg(1024);
+
+// MakeCompatible of range(0) curves of about 64 spans, every other one
+// quadratic and each with its own span count, on a pool of range(1) workers
+void BM_MakeCompatible(benchmark::State &state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  std::vector<NURBSCurve3D> curves;
+  for (size_t c = 0; c < count; ++c) {
+    const uint32_t degree = c % 2 == 0 ? 2 : kDegree;
+    const uint32_t spans = 64 + static_cast<uint32_t>(c);
+    std::vector<double> knots(degree, 0.0);
+    for (uint32_t i = 0; i <= spans; ++i) {
+      knots.push_back(static_cast<double>(i) / static_cast<double>(spans));
+    }
+    knots.insert(knots.end(), degree, 1.0);
+    curves.emplace_back(degree, WeightedPoints(knots.size() - degree - 1),
+                        knots);
+  }
+  ThreadPool pool(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    std::vector<NURBSCurve3D> compatible = curves;
+    MakeCompatible(compatible.data(), compatible.size(), &pool);
+    benchmark::DoNotOptimize(compatible.data());
+  }
+}
+BENCHMARK(BM_MakeCompatible)
+    ->ArgsProduct({{8, 32}, {0, 3, 7}})
+    ->UseRealTime();
+
+// range(1) samples of every segment of a decomposed range(0) span curve, one
+// de Casteljau per sample when range(2) is 0, one Bernstein matrix shared by
+// all segments when it is 1
+void BM_BezierSegmentsEvaluate(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  const std::vector<BezierCurve3D> segments = curve.Decompose();
+  std::vector<double> params(samples);
+  for (uint32_t i = 0; i < samples; ++i) {
+    params[i] = static_cast<double>(i) / static_cast<double>(samples - 1);
+  }
+  std::vector<Point3D> points(segments.size() * samples);
+  if (state.range(2) == 0) {
+    for (auto _ : state) {
+      for (size_t k = 0; k < segments.size(); ++k) {
+        for (uint32_t i = 0; i < samples; ++i) {
+          points[(k * samples) + i] = segments[k].EvaluateCurve(params[i]);
+        }
+      }
+      benchmark::DoNotOptimize(points.data());
+    }
+  } else {
+    const BernsteinMatrix matrix(kDegree, params);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(matrix.Evaluate(segments));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * segments.size() * samples);
+}
+BENCHMARK(BM_BezierSegmentsEvaluate)
+    ->ArgsProduct({{16, 1024}, {8, 64}, {0, 1}});
+
+// Adaptive flattening of a range(0) span curve at a chordal tolerance of
+// 10^-range(1), vertices is the polyline size
+void BM_NURBSCurve3DFlatten(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots = CubicKnots(spans);
+  NURBSCurve3D curve(kDegree, WeightedPoints(knots.size() - kDegree - 1),
+                     knots);
+  CurveFlattener::Options options;
+  options.chordal_tolerance = std::pow(10.0, -state.range(1));
+  const CurveFlattener flattener(options);
+  size_t vertices = 0;
+  for (auto _ : state) {
+    std::vector<Point3D> points = flattener.Flatten(curve);
+    vertices = points.size();
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.counters["vertices"] = static_cast<double>(vertices);
+  state.SetItemsProcessed(state.iterations() * vertices);
+}
+BENCHMARK(BM_NURBSCurve3DFlatten)->ArgsProduct({{16, 1024}, {2, 3, 4}});
+} // namespace
+} // namespace nurbs
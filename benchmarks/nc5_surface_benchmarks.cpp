@@ -0,0 +1,357 @@
+#include <benchmark/benchmark.h>
+
+// NURBS_CPP
+#include "include/b_spline_surface.hpp"
+#include "include/bezier_set.hpp"
+#include "include/bezier_surface.hpp"
+#include "include/grid_kernels.hpp"
+#include "include/nurbs_surface.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cmath>
+#include <vector>
+
+namespace nurbs {
+namespace {
+constexpr uint32_t kDegree = 3;
+
+// Clamped uniform cubic with spans spans over [0, 1]
+std::vector<double> CubicKnots(uint32_t spans) {
+  std::vector<double> knots(kDegree, 0.0);
+  for (uint32_t i = 0; i <= spans; ++i) {
+    knots.push_back(static_cast<double>(i) / static_cast<double>(spans));
+  }
+  knots.insert(knots.end(), kDegree, 1.0);
+  return knots;
+}
+
+// Interior knots that are not in CubicKnots, for refinement
+std::vector<double> MidKnots(uint32_t spans) {
+  std::vector<double> knots;
+  for (uint32_t i = 0; i < spans; ++i) {
+    knots.push_back((static_cast<double>(i) + 0.5) /
+                    static_cast<double>(spans));
+  }
+  return knots;
+}
+
+template <typename PointT> PointT GridPoint(size_t u, size_t v);
+template <> Point3D GridPoint<Point3D>(size_t u, size_t v) {
+  double x = static_cast<double>(u);
+  double y = static_cast<double>(v);
+  return {x, y, std::sin(x) * std::cos(y)};
+}
+template <> Point4D GridPoint<Point4D>(size_t u, size_t v) {
+  Point3D point = GridPoint<Point3D>(u, v);
+  double w = 1.0 + (0.25 * std::sin(static_cast<double>(u + v)));
+  return {point.x * w, point.y * w, point.z * w, w};
+}
+
+template <typename PointT>
+std::vector<std::vector<PointT>> Grid(size_t rows, size_t cols) {
+  std::vector<std::vector<PointT>> points(rows, std::vector<PointT>(cols));
+  for (size_t u = 0; u < rows; ++u) {
+    for (size_t v = 0; v < cols; ++v) {
+      points[u][v] = GridPoint<PointT>(u, v);
+    }
+  }
+  return points;
+}
+
+BSplineSurface MakeBSplineSurface(uint32_t spans) {
+  std::vector<double> knots = CubicKnots(spans);
+  size_t count = knots.size() - kDegree - 1;
+  return BSplineSurface(kDegree, kDegree, knots, knots,
+                        Grid<Point3D>(count, count));
+}
+
+NURBSSurface MakeNURBSSurface(uint32_t spans) {
+  std::vector<double> knots = CubicKnots(spans);
+  size_t count = knots.size() - kDegree - 1;
+  return NURBSSurface(kDegree, kDegree, knots, knots,
+                      Grid<Point4D>(count, count));
+}
+
+void BM_BSplineSurfaceEvaluatePoints(benchmark::State &state) {
+  BSplineSurface surface =
+      MakeBSplineSurface(static_cast<uint32_t>(state.range(0)));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.EvaluatePoints(samples, samples));
+  }
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_BSplineSurfaceEvaluatePoints)
+    ->ArgsProduct({{8, 64, 512}, {100, 1000}});
+
+// BSplineSurface::EvaluatePoints with the grid kernels forced to one level,
+// levels the CPU does not support are skipped
+void BM_BSplineSurfaceEvaluatePointsLevel(benchmark::State &state) {
+  const auto level = static_cast<simd::Level>(state.range(2));
+  if (level > simd::Supported()) {
+    state.SkipWithError("level not supported");
+    return;
+  }
+  BSplineSurface surface =
+      MakeBSplineSurface(static_cast<uint32_t>(state.range(0)));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  simd::SetActive(level);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.EvaluatePoints(samples, samples));
+  }
+  simd::SetActive(simd::Supported());
+  state.SetLabel(simd::Name(level));
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_BSplineSurfaceEvaluatePointsLevel)
+    ->ArgsProduct({{8, 512}, {100, 1000}, {0, 1, 2}});
+
+// Allocating and writing the same number of points, the floor for any grid
+// evaluator that returns a std::vector<Point3D>
+void BM_Point3DFill(benchmark::State &state) {
+  const uint32_t samples = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<Point3D> points(samples * samples, {1.0, 2.0, 3.0});
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_Point3DFill)->Arg(100)->Arg(1000);
+
+void BM_NURBSSurfaceEvaluatePoints(benchmark::State &state) {
+  NURBSSurface surface =
+      MakeNURBSSurface(static_cast<uint32_t>(state.range(0)));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.EvaluatePoints(samples, samples));
+  }
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_NURBSSurfaceEvaluatePoints)
+    ->ArgsProduct({{8, 64, 512}, {100, 1000}});
+
+// EvaluatePoints with the v direction forward differenced
+void BM_NURBSSurfaceStepPoints(benchmark::State &state) {
+  NURBSSurface surface =
+      MakeNURBSSurface(static_cast<uint32_t>(state.range(0)));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.StepPoints(samples, samples));
+  }
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_NURBSSurfaceStepPoints)
+    ->ArgsProduct({{8, 64, 512}, {100, 1000}});
+
+// Float positions straight from the rational grid, as for a vertex buffer
+void BM_NURBSSurfaceEvaluateGridFloat(benchmark::State &state) {
+  NURBSSurface surface =
+      MakeNURBSSurface(static_cast<uint32_t>(state.range(0)));
+  const uint32_t samples = static_cast<uint32_t>(state.range(1));
+  std::vector<double> params(samples);
+  for (uint32_t i = 0; i < samples; ++i) {
+    params[i] = static_cast<double>(i) / static_cast<double>(samples - 1);
+  }
+  std::vector<float> positions(3 * samples * samples);
+  for (auto _ : state) {
+    surface.EvaluateGridFloat(params.data(), samples, params.data(), samples,
+                              positions.data());
+    benchmark::DoNotOptimize(positions.data());
+  }
+  state.SetItemsProcessed(state.iterations() * samples * samples);
+}
+BENCHMARK(BM_NURBSSurfaceEvaluateGridFloat)
+    ->ArgsProduct({{8, 64, 512}, {100, 1000}});
+
+// NURBSSurface::EvaluatePoint on a 32 x 32 grid, equal degrees range(0) in
+// u and v over 16 spans
+void BM_NURBSSurfaceEvaluatePoint(benchmark::State &state) {
+  const uint32_t degree = static_cast<uint32_t>(state.range(0));
+  std::vector<double> knots(degree, 0.0);
+  for (uint32_t i = 0; i <= 16; ++i) {
+    knots.push_back(static_cast<double>(i) / 16.0);
+  }
+  knots.insert(knots.end(), degree, 1.0);
+  const size_t count = knots.size() - degree - 1;
+  NURBSSurface surface(degree, degree, knots, knots,
+                       Grid<Point4D>(count, count));
+  constexpr int32_t kGrid = 32;
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kGrid; ++i) {
+      for (int32_t j = 0; j < kGrid; ++j) {
+        Point2D uv = {static_cast<double>(i) / (kGrid - 1),
+                      static_cast<double>(j) / (kGrid - 1)};
+        benchmark::DoNotOptimize(surface.EvaluatePoint(uv));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kGrid * kGrid);
+}
+BENCHMARK(BM_NURBSSurfaceEvaluatePoint)->DenseRange(1, 5);
+
+// NURBSSurface::Derivatives up to order range(0) on a 32 x 32 grid of a
+// 16 x 16 span weighted cubic
+void BM_NURBSSurfaceDerivatives(benchmark::State &state) {
+  const uint32_t order = static_cast<uint32_t>(state.range(0));
+  NURBSSurface surface = MakeNURBSSurface(16);
+  constexpr int32_t kGrid = 32;
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kGrid; ++i) {
+      for (int32_t j = 0; j < kGrid; ++j) {
+        Point2D uv = {static_cast<double>(i) / (kGrid - 1),
+                      static_cast<double>(j) / (kGrid - 1)};
+        benchmark::DoNotOptimize(surface.Derivatives(uv, order));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kGrid * kGrid);
+}
+BENCHMARK(BM_NURBSSurfaceDerivatives)->DenseRange(1, 3);
+
+void BM_NURBSSurfaceKnotInsert(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  NURBSSurface surface = MakeNURBSSurface(spans);
+  const auto dir = state.range(1) == 0 ? NURBSSurface::kUDir
+                                       : NURBSSurface::kVDir;
+  const double knot = 0.5 / static_cast<double>(spans);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.KnotInsert(dir, knot, kDegree));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceKnotInsert)->ArgsProduct({{64, 512}, {0, 1}});
+
+void BM_NURBSSurfaceRefineKnotVect(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  NURBSSurface surface = MakeNURBSSurface(spans);
+  const auto dir = state.range(1) == 0 ? NURBSSurface::kUDir
+                                       : NURBSSurface::kVDir;
+  const std::vector<double> knots = MidKnots(spans);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.RefineKnotVect(knots, dir));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceRefineKnotVect)->ArgsProduct({{64, 512}, {0, 1}});
+
+void BM_NURBSSurfaceDecompose(benchmark::State &state) {
+  NURBSSurface surface =
+      MakeNURBSSurface(static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.Decompose());
+  }
+}
+BENCHMARK(BM_NURBSSurfaceDecompose)->Arg(16)->Arg(64);
+
+// Decompose into one reused patch arena
+void BM_NURBSSurfaceDecomposePatchSet(benchmark::State &state) {
+  NURBSSurface surface =
+      MakeNURBSSurface(static_cast<uint32_t>(state.range(0)));
+  BezierPatchSet patches;
+  for (auto _ : state) {
+    surface.Decompose(patches);
+    benchmark::DoNotOptimize(patches.net().plane(0));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceDecomposePatchSet)->Arg(16)->Arg(64);
+
+// Simplify of a range(0) span surface refined at every mid span in u
+void BM_NURBSSurfaceSimplify(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  NURBSSurface surface =
+      MakeNURBSSurface(spans).RefineKnotVect(MidKnots(spans),
+                                             NURBSSurface::kUDir);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.Simplify(1e-9));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceSimplify)->Arg(8)->Arg(32);
+
+// Knot refinement of a 200 x 200 net in direction range(0), on a pool of
+// range(1) workers
+void BM_NURBSSurfaceRefineKnotVectPool(benchmark::State &state) {
+  constexpr uint32_t kSpans = 200 - kDegree;
+  NURBSSurface surface = MakeNURBSSurface(kSpans);
+  const auto dir = state.range(0) == 0 ? NURBSSurface::kUDir
+                                       : NURBSSurface::kVDir;
+  const std::vector<double> knots = MidKnots(kSpans);
+  ThreadPool pool(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.RefineKnotVect(knots, dir, &pool));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceRefineKnotVectPool)
+    ->ArgsProduct({{0, 1}, {0, 1, 3, 7}})
+    ->UseRealTime();
+
+void BM_NURBSSurfaceDecomposePool(benchmark::State &state) {
+  NURBSSurface surface = MakeNURBSSurface(64);
+  ThreadPool pool(static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.Decompose(&pool));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceDecomposePool)->Arg(0)->Arg(3)->Arg(7)->UseRealTime();
+
+// Degree elevation by one of a 200 x 200 net in direction range(0), on a pool
+// of range(1) workers
+void BM_NURBSSurfaceDegreeElevatePool(benchmark::State &state) {
+  NURBSSurface surface = MakeNURBSSurface(200 - kDegree);
+  const auto dir = state.range(0) == 0 ? NURBSSurface::kUDir
+                                       : NURBSSurface::kVDir;
+  ThreadPool pool(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(surface.DegreeElevate(dir, 1, &pool));
+  }
+}
+BENCHMARK(BM_NURBSSurfaceDegreeElevatePool)
+    ->ArgsProduct({{0, 1}, {0, 3, 7}})
+    ->UseRealTime();
+
+// Bezier patch of degree range(0) in u and v from one curve per v index
+BezierSurface MakeBezierSurface(uint32_t degree) {
+  std::vector<BezierCurve3D> curves;
+  for (uint32_t v = 0; v <= degree; ++v) {
+    std::vector<Point3D> points;
+    for (uint32_t u = 0; u <= degree; ++u) {
+      points.push_back(GridPoint<Point3D>(u, v));
+    }
+    curves.emplace_back(points);
+  }
+  return BezierSurface(curves);
+}
+
+// BezierSurface::EvaluatePoint on a 32 x 32 grid
+void BM_BezierSurfaceEvaluatePoint(benchmark::State &state) {
+  BezierSurface surface =
+      MakeBezierSurface(static_cast<uint32_t>(state.range(0)));
+  constexpr int32_t kGrid = 32;
+  for (auto _ : state) {
+    for (int32_t i = 0; i < kGrid; ++i) {
+      for (int32_t j = 0; j < kGrid; ++j) {
+        Point2D uv = {static_cast<double>(i) / (kGrid - 1),
+                      static_cast<double>(j) / (kGrid - 1)};
+        benchmark::DoNotOptimize(surface.EvaluatePoint(uv));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kGrid * kGrid);
+}
+BENCHMARK(BM_BezierSurfaceEvaluatePoint)->DenseRange(1, 5, 2);
+
+// A 32 x 32 grid of a patch, as the decomposed patches are tessellated
+void BM_BezierSurfaceEvaluateGrid(benchmark::State &state) {
+  BezierSurface surface =
+      MakeBezierSurface(static_cast<uint32_t>(state.range(0)));
+  constexpr uint32_t kGrid = 32;
+  const std::vector<double> params = Surface::SampleParams({0.0, 1.0}, kGrid);
+  std::vector<Point3D> points(kGrid * kGrid);
+  for (auto _ : state) {
+    surface.EvaluateGrid(params.data(), kGrid, params.data(), kGrid,
+                         points.data());
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kGrid * kGrid);
+}
+BENCHMARK(BM_BezierSurfaceEvaluateGrid)->DenseRange(1, 5, 2);
+} // namespace
+} // namespace nurbs
@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+
+// NURBS_CPP
+#include "include/nurbs_curve.hpp"
+#include "include/nurbs_surface.hpp"
+#include "include/point_projection.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cmath>
+#include <vector>
+
+namespace nurbs {
+namespace {
+constexpr uint32_t kDegree = 3;
+constexpr size_t kQueries = 4096;
+
+// Clamped uniform cubic with spans spans over [0, 1]
+std::vector<double> CubicKnots(uint32_t spans) {
+  std::vector<double> knots(kDegree, 0.0);
+  for (uint32_t i = 0; i <= spans; ++i) {
+    knots.push_back(static_cast<double>(i) / static_cast<double>(spans));
+  }
+  knots.insert(knots.end(), kDegree, 1.0);
+  return knots;
+}
+
+// Rational helix like curve with spans spans
+NURBSCurve3D MakeCurve(uint32_t spans) {
+  std::vector<double> knots = CubicKnots(spans);
+  std::vector<Point4D> points;
+  for (size_t i = 0; i < knots.size() - kDegree - 1; ++i) {
+    double x = static_cast<double>(i) * 0.25;
+    double w = 1.0 + (0.25 * std::sin(x));
+    points.push_back({std::cos(x) * w, std::sin(x) * w, x * w, w});
+  }
+  return NURBSCurve3D(kDegree, points, knots);
+}
+
+// Rational wavy sheet with spans spans each way
+NURBSSurface MakeSurface(uint32_t spans) {
+  std::vector<double> knots = CubicKnots(spans);
+  const size_t count = knots.size() - kDegree - 1;
+  std::vector<std::vector<Point4D>> points(count);
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < count; ++j) {
+      double x = static_cast<double>(i) * 0.25;
+      double y = static_cast<double>(j) * 0.25;
+      double w = 1.0 + (0.25 * std::sin(x + y));
+      points[i].push_back(
+          {x * w, y * w, std::sin(x) * std::cos(y) * w, w});
+    }
+  }
+  return NURBSSurface(kDegree, kDegree, knots, knots, points);
+}
+
+// Scan like points scattered around box, a fixed pseudo random sequence
+std::vector<Point3D> ScatterPoints(const Point3D &low, const Point3D &high) {
+  std::vector<Point3D> points;
+  for (size_t i = 0; i < kQueries; ++i) {
+    double t = static_cast<double>(i);
+    double a = 0.5 + (0.5 * std::sin(t * 12.9898));
+    double b = 0.5 + (0.5 * std::sin(t * 78.233));
+    double c = 0.5 + (0.5 * std::sin(t * 37.719));
+    points.push_back({low.x + (a * (high.x - low.x)),
+                      low.y + (b * (high.y - low.y)),
+                      low.z + (c * (high.z - low.z))});
+  }
+  return points;
+}
+} // namespace
+
+// kQueries closest points on a range(0) span curve, on a pool of range(1)
+// workers
+void BM_CurveProjectorBatch(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  NURBSCurve3D curve = MakeCurve(spans);
+  CurveProjector projector(curve);
+  const double height = static_cast<double>(spans + kDegree) * 0.25;
+  std::vector<Point3D> points =
+      ScatterPoints({-1.5, -1.5, 0.0}, {1.5, 1.5, height});
+  std::vector<CurveProjection> results(points.size());
+  ThreadPool pool(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    projector.Project(points.data(), points.size(), results.data(), &pool);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_CurveProjectorBatch)
+    ->ArgsProduct({{16, 256}, {0, 3}})
+    ->UseRealTime();
+
+// kQueries closest points on a range(0) x range(0) span surface, on a pool of
+// range(1) workers
+void BM_SurfaceProjectorBatch(benchmark::State &state) {
+  const uint32_t spans = static_cast<uint32_t>(state.range(0));
+  NURBSSurface surface = MakeSurface(spans);
+  SurfaceProjector projector(surface);
+  const double side = static_cast<double>(spans + kDegree - 1) * 0.25;
+  std::vector<Point3D> points =
+      ScatterPoints({0.0, 0.0, -1.5}, {side, side, 1.5});
+  std::vector<SurfaceProjection> results(points.size());
+  ThreadPool pool(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    projector.Project(points.data(), points.size(), results.data(), &pool);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_SurfaceProjectorBatch)
+    ->ArgsProduct({{8, 32}, {0, 3}})
+    ->UseRealTime();
+} // namespace nurbs
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+// NURBS_CPP
+#include "include/adaptive_tessellator.hpp"
+#include "include/nurbs_surface.hpp"
+#include "include/tessellation_engine.hpp"
+
+// STD
+#include <cmath>
+#include <vector>
+
+namespace nurbs {
+namespace {
+// Bicubic Bezier patch with a bump that depends on the patch index
+NURBSSurface MakePatch(uint32_t index) {
+  std::vector<double> knots = {0, 0, 0, 0, 1, 1, 1, 1};
+  std::vector<std::vector<Point4D>> points(4);
+  for (size_t u = 0; u < 4; ++u) {
+    for (size_t v = 0; v < 4; ++v) {
+      double z = std::sin(static_cast<double>(index + u)) *
+                 std::cos(static_cast<double>(v));
+      double w = (u == 1 || u == 2) ? 0.8 : 1.0;
+      points[u].push_back({static_cast<double>(u) * w,
+                           static_cast<double>(v) * w, z * w, w});
+    }
+  }
+  return NURBSSurface(3, 3, knots, knots, points);
+}
+
+// A scene of range(0) patches at 100 x 100 samples on range(1) workers
+void BM_TessellateScene(benchmark::State &state) {
+  std::vector<NURBSSurface> patches;
+  for (uint32_t i = 0; i < static_cast<uint32_t>(state.range(0)); ++i) {
+    patches.push_back(MakePatch(i));
+  }
+  std::vector<const Surface *> surfaces;
+  for (const NURBSSurface &patch : patches) {
+    surfaces.push_back(&patch);
+  }
+  TessellationEngine engine(static_cast<uint32_t>(state.range(1)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.Tessellate(surfaces, 100, 100));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TessellateScene)
+    ->ArgsProduct({{16, 256}, {0, 1, 3, 7}})
+    ->UseRealTime();
+
+// Positions, partials and normals of a 100 x 100 grid on one patch, from
+// EvaluateGridDerivatives when range(0) is 1 and from a Derivatives call per
+// sample when it is 0
+void BM_GridNormals(benchmark::State &state) {
+  NURBSSurface patch = MakePatch(3);
+  std::vector<double> params = Surface::SampleParams({0.0, 1.0}, 100);
+  GridDerivatives grid;
+  for (auto _ : state) {
+    if (state.range(0) == 1) {
+      patch.EvaluateGridDerivatives(params.data(), params.size(),
+                                    params.data(), params.size(), false, grid);
+      benchmark::DoNotOptimize(grid.normals.data());
+      continue;
+    }
+    for (double u : params) {
+      for (double v : params) {
+        benchmark::DoNotOptimize(patch.Normal({u, v}));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * params.size() * params.size());
+}
+BENCHMARK(BM_GridNormals)->Arg(0)->Arg(1);
+
+// One patch, chordal tolerance 10^-range(0). The triangles counter is the
+// number to hold against the 19602 of the 100 x 100 grid.
+void BM_AdaptiveTessellate(benchmark::State &state) {
+  NURBSSurface patch = MakePatch(3);
+  AdaptiveTessellator::Options options;
+  options.chordal_tolerance =
+      std::pow(10.0, -static_cast<double>(state.range(0)));
+  AdaptiveTessellator tessellator(options);
+  size_t triangles = 0;
+  for (auto _ : state) {
+    SurfaceMesh mesh = tessellator.Tessellate(patch);
+    triangles = mesh.indices.size() / 3;
+    benchmark::DoNotOptimize(mesh);
+  }
+  state.counters["triangles"] = static_cast<double>(triangles);
+}
+BENCHMARK(BM_AdaptiveTessellate)->DenseRange(2, 4);
+} // namespace
+} // namespace nurbs
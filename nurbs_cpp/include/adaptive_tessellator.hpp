@@ -0,0 +1,47 @@
+#pragma once
+
+// NURBS
+#include "include/surface.hpp"
+#include "include/surface_mesh.hpp"
+
+// STD
+#include <cstdint>
+
+namespace nurbs {
+// Tessellates a surface with a quadtree over (u, v). Starting from a
+// base_cells x base_cells grid, a cell is split in four until it is flat
+// enough: the surface at its center and edge midpoints is within
+// chordal_tolerance of the bilinear cell, and the normals at its corners are
+// within angle_tolerance of the normal at its center. Samples come from
+// Surface::Derivatives, so the analytic partials are used where a surface
+// has them.
+//
+// Cells next to finer cells pick up the finer vertices on their shared edges
+// and are fanned from their center, so there are no T-junctions and no
+// cracks between cells of different depth. Other cells are two triangles.
+class AdaptiveTessellator {
+public:
+  struct Options {
+    // Distance in model units
+    double chordal_tolerance = 1e-3;
+    // Radians
+    double angle_tolerance = 0.2;
+    uint32_t base_cells = 4;
+    // Cells are always split to min_depth and never past max_depth
+    uint32_t min_depth = 0;
+    uint32_t max_depth = 8;
+  };
+  static constexpr uint32_t kMaxDepth = 16;
+
+  AdaptiveTessellator() = default;
+  explicit AdaptiveTessellator(const Options &options);
+
+  // A mesh with one patch, its u_count and v_count are zero
+  SurfaceMesh Tessellate(const Surface &surface) const;
+
+  const Options &options() const { return options_; }
+
+private:
+  Options options_;
+};
+} // namespace nurbs
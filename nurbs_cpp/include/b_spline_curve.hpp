@@ -2,6 +2,9 @@
 
 #include "curve_2d.hpp"
 #include "curve_3d.hpp"
+#include "power_basis_curve.hpp"
+#include "span_locator.hpp"
+#include "uniform_cubic.hpp"
 
 namespace nurbs {
 // Nonrational B-Spline Curves
@@ -15,6 +18,19 @@ public:
 
   Point2D EvaluateCurve(double parameter) const override;
 
+  void EvaluateCurveBatch(const double *params, size_t count,
+                          Point2D *points) const override;
+
+  // Forward differences over each knot span, or EvaluateCurvePoints when the
+  // spans get too few samples, see forward::SplineStepPlan::Pays
+  std::vector<Point2D> StepCurvePoints(uint32_t point_count) const override;
+
+  std::vector<double> Breakpoints() const override;
+
+  // The curve as one power basis polynomial per knot span, for curves
+  // evaluated many more times than they change
+  PiecewisePowerBasisCurve2D ToPowerBasis() const;
+
   std::vector<Point2D> Derivatives(double parameter,
                                       uint32_t max_derivative) const;
 
@@ -30,6 +46,8 @@ public:
   uint32_t degree_;
   std::vector<double> knots_;
   std::vector<Point2D> control_points_;
+  knots::SpanLocator span_locator_;
+  knots::UniformCubicSpans uniform_spans_;
   double interval_div_ = 1.0;
 };
 
@@ -43,6 +61,19 @@ public:
 
   Point3D EvaluateCurve(double parameter) const override;
 
+  void EvaluateCurveBatch(const double *params, size_t count,
+                          Point3D *points) const override;
+
+  // Forward differences over each knot span, or EvaluateCurvePoints when the
+  // spans get too few samples, see forward::SplineStepPlan::Pays
+  std::vector<Point3D> StepCurvePoints(uint32_t point_count) const override;
+
+  std::vector<double> Breakpoints() const override;
+
+  // The curve as one power basis polynomial per knot span, for curves
+  // evaluated many more times than they change
+  PiecewisePowerBasisCurve3D ToPowerBasis() const;
+
   std::vector<Point3D> Derivatives(double parameter,
                                       uint32_t max_derivative) const;
 
@@ -57,6 +88,8 @@ public:
   uint32_t degree_;
    std::vector<double> knots_;
   std::vector<Point3D> control_points_;
+  knots::SpanLocator span_locator_;
+  knots::UniformCubicSpans uniform_spans_;
   double interval_div_ = 1.0;
 };
 }  // namespace nurbs
\ No newline at end of file
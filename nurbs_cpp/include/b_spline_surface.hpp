@@ -1,5 +1,8 @@
 #pragma once
 
+#include "include/control_net.hpp"
+#include "include/span_locator.hpp"
+#include "include/uniform_cubic.hpp"
 #include "include/surface.hpp"
 
 namespace nurbs {
@@ -14,14 +17,34 @@ public:
                  const std::vector<std::vector<Point3D>> &control_polygon,
                  Point2D u_interval = {0.0, 1.0},
                  Point2D v_interval = {0.0, 1.0});
+  BSplineSurface(uint32_t u_degree, uint32_t v_degree,
+                 const std::vector<double> &u_knots,
+                 const std::vector<double> &v_knots,
+                 const ControlNet<Point3D> &control_polygon,
+                 Point2D u_interval = {0.0, 1.0},
+                 Point2D v_interval = {0.0, 1.0});
 
   Point3D EvaluatePoint(Point2D uv) const override;
 
-  std::vector<Point3D> EvaluatePoints(
-      uint32_t u_sample_count, uint32_t v_sample_count) const override;
+  void EvaluateGrid(const double *u_params, size_t u_count,
+                    const double *v_params, size_t v_count,
+                    Point3D *points) const override;
+  void EvaluateGridDerivatives(const double *u_params, size_t u_count,
+                               const double *v_params, size_t v_count,
+                               bool second_partials,
+                               GridDerivatives &grid) const override;
+
+  // Rows of constant u stepped along v over each v knot span, or
+  // EvaluatePoints when the v spans get too few samples
+  std::vector<Point3D> StepPoints(uint32_t u_sample_count,
+                                  uint32_t v_sample_count) const override;
 
   std::vector<std::vector<Point3D>> Derivative(Point2D uv,
                                                 uint32_t max_derivative) const;
+  std::vector<std::vector<Point3D>>
+  Derivatives(Point2D uv, uint32_t max_derivative) const override {
+    return Derivative(uv, max_derivative);
+  }
 
   // Used for Derivatives2
   std::vector<std::vector<std::vector<std::vector<Point3D>>>>
@@ -30,12 +53,22 @@ public:
   std::vector<std::vector<Point3D>> Derivatives2(Point2D uv,
                                                  uint32_t max_derivative) const;
 
+  const std::vector<double> &u_knots() const { return u_knots_; }
+  const std::vector<double> &v_knots() const { return v_knots_; }
+  const ControlNet<Point3D> &control_polygon() const {
+    return control_polygon_;
+  }
+
  private:
   uint32_t u_degree_;
   uint32_t v_degree_;
   std::vector<double> u_knots_;
   std::vector<double> v_knots_;
   // [u][v]
-  std::vector<std::vector<Point3D>> control_polygon_;
+  ControlNet<Point3D> control_polygon_;
+  knots::SpanLocator u_span_locator_;
+  knots::SpanLocator v_span_locator_;
+  knots::UniformCubicSpans u_uniform_spans_;
+  knots::UniformCubicSpans v_uniform_spans_;
 };
 }  // namespace nurbs
\ No newline at end of file
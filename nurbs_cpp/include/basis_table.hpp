@@ -0,0 +1,122 @@
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nurbs {
+namespace knots {
+// Spans and non-zero basis values for a list of parameters on one knot vector.
+// Values are stored basis major: value(i, s) is basis i of sample s, so the
+// samples of one basis function are contiguous and can be loaded as a vector.
+// A table can also hold the derivatives of the basis functions up to some
+// order, laid out the same way one order after the other.
+class BasisTable {
+public:
+  BasisTable() = default;
+  BasisTable(uint32_t degree, const std::vector<double> &knots,
+             const double *params, size_t count, double tolerance,
+             uint32_t derivatives = 0);
+
+  // Recomputes the table, reusing the current storage. Derivatives above the
+  // degree are zero and are not stored, see derivatives().
+  void Build(uint32_t degree, const std::vector<double> &knots,
+             const double *params, size_t count, double tolerance,
+             uint32_t derivatives = 0);
+
+  uint32_t degree() const { return degree_; }
+  size_t size() const { return count_; }
+  // Highest derivative order in the table
+  uint32_t derivatives() const { return derivatives_; }
+
+  uint32_t span(size_t sample) const { return spans_[sample]; }
+  const uint32_t *spans() const { return spans_.data(); }
+
+  double value(uint32_t i, size_t sample) const {
+    return values_[(i * count_) + sample];
+  }
+  // The count values of basis i
+  const double *values(uint32_t i) const {
+    return values_.data() + (i * count_);
+  }
+
+  // kth derivative of basis i, derivative(0, i, s) is value(i, s)
+  double derivative(uint32_t k, uint32_t i, size_t sample) const {
+    return values_[(((k * (degree_ + 1)) + i) * count_) + sample];
+  }
+  const double *derivatives(uint32_t k, uint32_t i) const {
+    return values_.data() + (((k * (degree_ + 1)) + i) * count_);
+  }
+
+private:
+  uint32_t degree_ = 0;
+  uint32_t derivatives_ = 0;
+  size_t count_ = 0;
+  std::vector<uint32_t> spans_;
+  std::vector<double> values_;
+};
+
+// ALGORITHM A3.1 CurvePoint at one sample of the table, summed in the same
+// order as the point evaluators. Works for homogeneous control points too.
+template <typename PointT>
+PointT CurvePoint(const BasisTable &table, size_t sample,
+                  const std::vector<PointT> &control_points) {
+  const uint32_t degree = table.degree();
+  const uint32_t first = table.span(sample) - degree;
+  PointT point;
+  for (uint32_t i = 0; i <= degree; ++i) {
+    point += table.value(i, sample) * control_points[first + i];
+  }
+  return point;
+}
+
+// Small least recently used cache of basis tables. Entries are found by a
+// hash of the knot vector and parameters and then compared in full, so a
+// table is only shared when it would be built the same. Tables are handed
+// out as shared pointers and stay valid after they are evicted. Safe to use
+// from several threads, tables are built outside the lock.
+class BasisTableCache {
+public:
+  static constexpr size_t kCapacity = 64;
+
+  explicit BasisTableCache(size_t capacity = kCapacity);
+
+  // Cache used by the curve and surface evaluators
+  static BasisTableCache &Shared();
+
+  std::shared_ptr<const BasisTable>
+  Get(uint32_t degree, const std::vector<double> &knots, const double *params,
+      size_t count, double tolerance, uint32_t derivatives = 0);
+
+  void Clear();
+  // Also evicts the oldest tables down to capacity
+  void capacity(size_t capacity);
+  size_t capacity() const;
+  size_t size() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+
+private:
+  struct Entry {
+    uint64_t hash;
+    uint32_t degree;
+    uint32_t derivatives;
+    double tolerance;
+    std::vector<double> knots;
+    std::vector<double> params;
+    std::shared_ptr<const BasisTable> table;
+  };
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+} // namespace knots
+} // namespace nurbs
@@ -2,8 +2,16 @@
 
 #include "curve_2d.hpp"
 #include "curve_3d.hpp"
+#include "knot_utility_functions.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace nurbs {
+class BezierSegmentSet;
+
 class BezierCurveUtil {
 public:
   // Returns:
@@ -20,6 +28,30 @@ public:
   // fixed value of u B(0,n - 1) (u) to B(n - 1,n - 1)(u) Parameters: n - degree
   // of berstein polynomial + 1 u - input value to berstain polynomial
   static std::vector<double> AllBernstein(size_t n, double u);
+
+  // Returns:
+  // The power basis coefficients a_0 to a_n of the Bezier curve with the
+  // n + 1 control points, so that C(u) = sum of a_k u^k, from the Bezier to
+  // power basis matrix a_k = C(n, k) sum over i <= k of
+  // (-1)^(k - i) C(k, i) P_i
+  template <typename PointT>
+  static std::vector<PointT>
+  PowerBasis(const std::vector<PointT> &control_points) {
+    std::vector<PointT> coefficients(control_points.size());
+    if (control_points.empty()) {
+      return coefficients;
+    }
+    const uint32_t n = static_cast<uint32_t>(control_points.size()) - 1;
+    for (uint32_t k = 0; k <= n; ++k) {
+      PointT sum;
+      for (uint32_t i = 0; i <= k; ++i) {
+        const double sign = ((k - i) % 2 == 0) ? 1.0 : -1.0;
+        sum += (sign * knots::Binomial(k, i)) * control_points[i];
+      }
+      coefficients[k] = knots::Binomial(n, k) * sum;
+    }
+    return coefficients;
+  }
 };
 
 class BezierCurve2D : public Curve2D {
@@ -29,11 +61,18 @@ public:
 
   Point2D EvaluateCurve(double u) const override;
 
+  // Forward differences of the power basis form of the curve
+  std::vector<Point2D> StepCurvePoints(uint32_t point_count) const override;
+
   Point2D Derivative(double u) const;
 
   Point2D PointOnBezierCurve(double u) const;
   Point2D DeCasteljau(double u) const;
 
+  const std::vector<Point2D> &control_points() const {
+    return control_points_;
+  }
+
 private:
   // Variables
   std::vector<Point2D> control_points_;
@@ -46,12 +85,64 @@ public:
 
   Point3D EvaluateCurve(double u) const override;
 
+  // Forward differences of the power basis form of the curve
+  std::vector<Point3D> StepCurvePoints(uint32_t point_count) const override;
+
   Point3D Derivative(double u) const;
 
   Point3D PointOnBezierCurve(double u) const;
   Point3D DeCasteljau(double u) const;
 
+  const std::vector<Point3D> &control_points() const {
+    return control_points_;
+  }
+
 private:
   std::vector<Point3D> control_points_;
 };
+
+// The Bernstein polynomials of one degree at a fixed list of local
+// parameters in [0, 1], for evaluating many Bezier segments at the same
+// parameters, like every segment of a decomposed curve. Values are stored
+// basis major as in knots::BasisTable, so a segment is a weighted sum of
+// degree + 1 contiguous rows and runs on the SIMD row kernels.
+class BernsteinMatrix {
+public:
+  BernsteinMatrix(uint32_t degree, const double *params, size_t count);
+  BernsteinMatrix(uint32_t degree, const std::vector<double> &params);
+
+  uint32_t degree() const { return degree_; }
+  size_t size() const { return count_; }
+  // B(i, degree) at sample s, from ALGORITHM A1.3
+  double value(uint32_t i, size_t sample) const {
+    return values_[(i * count_) + sample];
+  }
+  const double *values(uint32_t i) const {
+    return values_.data() + (i * count_);
+  }
+
+  // The control points of segment k start at control_points[k * (degree() +
+  // 1)], and its samples go to points[(k * size()) + s]
+  void Evaluate(const Point2D *control_points, size_t segment_count,
+                Point2D *points) const;
+  void Evaluate(const Point3D *control_points, size_t segment_count,
+                Point3D *points) const;
+  // Rational segments from homogeneous (wx, wy, wz, w) control points
+  void Evaluate(const Point4D *control_points, size_t segment_count,
+                Point3D *points) const;
+
+  // Every segment has to be of degree(), throws otherwise. The parameters are
+  // local to each segment, their intervals are not applied.
+  std::vector<Point2D>
+  Evaluate(const std::vector<BezierCurve2D> &segments) const;
+  std::vector<Point3D>
+  Evaluate(const std::vector<BezierCurve3D> &segments) const;
+  // Rational segments straight from the arena of a decomposed curve
+  std::vector<Point3D> Evaluate(const BezierSegmentSet &segments) const;
+
+private:
+  uint32_t degree_;
+  size_t count_;
+  std::vector<double> values_;
+};
 } // namespace nurbs
\ No newline at end of file
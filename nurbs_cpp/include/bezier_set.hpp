@@ -0,0 +1,119 @@
+#pragma once
+
+#include "include/bezier_curve.hpp"
+#include "include/bezier_surface.hpp"
+#include "include/control_net.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+// Axis aligned box around the projected control points of a segment or
+// patch, which also holds the segment or patch when all weights are positive
+struct ControlHullBounds {
+  Point3D min;
+  Point3D max;
+};
+
+// The Bezier segments of a decomposed curve, all of one degree, in one
+// arena. Segment k holds the homogeneous (wx, wy, wz, w) points
+// points()[Offset(k)] to points()[Offset(k) + degree()], the layout
+// BernsteinMatrix::Evaluate takes, and covers [breaks()[k], breaks()[k + 1]]
+// of the curve it came from. Reset keeps the storage, so a set reused for
+// many decompositions stops allocating.
+class BezierSegmentSet {
+public:
+  // Drops the current segments and makes room for breaks.size() - 1 of them,
+  // their points all zero
+  void Reset(uint32_t degree, std::vector<double> breaks);
+
+  uint32_t degree() const { return degree_; }
+  size_t size() const { return breaks_.empty() ? 0 : breaks_.size() - 1; }
+  bool empty() const { return size() == 0; }
+
+  size_t Offset(size_t k) const { return k * (degree_ + 1); }
+  const Point4D *control_points(size_t k) const {
+    return points_.data() + Offset(k);
+  }
+  Point4D *control_points(size_t k) { return points_.data() + Offset(k); }
+  const std::vector<Point4D> &points() const { return points_; }
+  const std::vector<double> &breaks() const { return breaks_; }
+  Point2D interval(size_t k) const { return {breaks_[k], breaks_[k + 1]}; }
+
+  // The segment whose interval holds param, clamped to the first and last
+  size_t Find(double param) const;
+  // ALGORITHM A1.5 DeCasteljau1 on the homogeneous points of segment k, at
+  // the local parameter t in [0, 1]
+  Point3D EvaluateSegment(size_t k, double t) const;
+  // The curve at param, through the segment that holds it
+  Point3D EvaluatePoint(double param) const;
+  ControlHullBounds Bounds(size_t k) const;
+
+  // Segment k with its points projected, as NURBSCurve3D::Decompose returns
+  // them
+  BezierCurve3D Segment(size_t k) const;
+
+private:
+  uint32_t degree_ = 0;
+  std::vector<Point4D> points_;
+  std::vector<double> breaks_;
+};
+
+// The Bezier patches of a decomposed surface, all of one degree, in one
+// control net laid out as a grid of patches. Patch (i, j) is the block of
+// rows i * (u_degree() + 1) and columns j * (v_degree() + 1) on, so it starts
+// at net().Index at those and its rows are net().stride() apart. It covers
+// u_interval(i) x v_interval(j) of the surface it came from.
+class BezierPatchSet {
+public:
+  // Drops the current patches and makes room for (u_breaks.size() - 1) x
+  // (v_breaks.size() - 1) of them, their points all zero
+  void Reset(uint32_t u_degree, uint32_t v_degree,
+             std::vector<double> u_breaks, std::vector<double> v_breaks);
+
+  uint32_t u_degree() const { return u_degree_; }
+  uint32_t v_degree() const { return v_degree_; }
+  size_t u_count() const {
+    return u_breaks_.empty() ? 0 : u_breaks_.size() - 1;
+  }
+  size_t v_count() const {
+    return v_breaks_.empty() ? 0 : v_breaks_.size() - 1;
+  }
+  size_t size() const { return u_count() * v_count(); }
+  bool empty() const { return size() == 0; }
+
+  // Index of the first point of patch (i, j) in every plane of net()
+  size_t Offset(size_t i, size_t j) const {
+    return net_.Index(i * (u_degree_ + 1), j * (v_degree_ + 1));
+  }
+  const ControlNet<Point4D> &net() const { return net_; }
+  ControlNet<Point4D> &net() { return net_; }
+  const std::vector<double> &u_breaks() const { return u_breaks_; }
+  const std::vector<double> &v_breaks() const { return v_breaks_; }
+  Point2D u_interval(size_t i) const {
+    return {u_breaks_[i], u_breaks_[i + 1]};
+  }
+  Point2D v_interval(size_t j) const {
+    return {v_breaks_[j], v_breaks_[j + 1]};
+  }
+
+  // ALGORITHM A1.7 DeCasteljau2 on patch (i, j) at the local parameters in
+  // [0, 1], with the same operations as BezierSurface::EvaluatePoint
+  Point3D EvaluatePatch(size_t i, size_t j, Point2D uv) const;
+  // The surface at uv, through the patch that holds it
+  Point3D EvaluatePoint(Point2D uv) const;
+  ControlHullBounds Bounds(size_t i, size_t j) const;
+
+  // Patch (i, j) on the unit square, as NURBSSurface::Decompose returns it
+  BezierSurface Patch(size_t i, size_t j) const;
+
+private:
+  uint32_t u_degree_ = 0;
+  uint32_t v_degree_ = 0;
+  ControlNet<Point4D> net_;
+  std::vector<double> u_breaks_;
+  std::vector<double> v_breaks_;
+};
+} // namespace nurbs
@@ -1,25 +1,83 @@
 #pragma once
 
 #include "include/bezier_curve.hpp"
+#include "include/control_net.hpp"
 #include "include/surface.hpp"
 
 // STD
-#include <array>
 #include <functional>
+#include <limits>
 
 namespace nurbs {
-    class BezierSurface : public Surface {
-    public:
-        BezierSurface(std::vector<BezierCurve3D> curves, Point2D u_interval = { 0.0, 1.0 },
-            Point2D v_interval = { 0.0, 1.0 });
+// Tensor product Bezier patch of degree rows() - 1 in u and cols() - 1 in v.
+// The control net is one flat homogeneous net indexed [u][v], rational when
+// any weight is not one. Nonrational patches never read or divide by the
+// weights, so they evaluate exactly like their control points say.
+class BezierSurface : public Surface {
+public:
+  static constexpr double kTolerance = std::numeric_limits<double>::epsilon();
 
-        Point3D EvaluatePoint(Point2D uv) const override;
+  // One curve per v index, every curve runs along u. Only the control points
+  // of the curves are used, the surface intervals map the parameters.
+  BezierSurface(const std::vector<BezierCurve3D> &curves,
+                Point2D u_interval = {0.0, 1.0},
+                Point2D v_interval = {0.0, 1.0});
+  BezierSurface(const std::vector<std::vector<Point3D>> &control_points,
+                Point2D u_interval = {0.0, 1.0},
+                Point2D v_interval = {0.0, 1.0});
+  // Homogeneous points, (wx, wy, wz, w)
+  BezierSurface(ControlNet<Point4D> control_net,
+                Point2D u_interval = {0.0, 1.0},
+                Point2D v_interval = {0.0, 1.0});
 
-        std::vector<Point3D> EvaluatePoints(
-            uint32_t u_sample_count, uint32_t v_sample_count) const override;
+  // ALGORITHM A1.7 DeCasteljau2, on the planes of the net with per thread
+  // scratch, so it does not allocate
+  Point3D EvaluatePoint(Point2D uv) const override;
+  // Same points as EvaluatePoint, the columns are reduced once per u sample
+  std::vector<Point3D> EvaluatePoints(uint32_t u_sample_count,
+                                      uint32_t v_sample_count) const override;
 
-    private:
-        std::vector<BezierCurve3D> curves_;
-    };
+  // Grids go through the Bernstein values of the u and v samples, which are
+  // the basis functions of the Bezier knot vectors, tabled and cached like
+  // the NURBS grids and summed with the SIMD row kernels
+  void EvaluateGrid(const double *u_params, size_t u_count,
+                    const double *v_params, size_t v_count,
+                    Point3D *points) const override;
+  void EvaluateGridFloat(const double *u_params, size_t u_count,
+                         const double *v_params, size_t v_count,
+                         float *positions) const override;
+  void EvaluateGridDerivatives(const double *u_params, size_t u_count,
+                               const double *v_params, size_t v_count,
+                               bool second_partials,
+                               GridDerivatives &grid) const override;
 
-}
\ No newline at end of file
+  uint32_t u_degree() const { return u_degree_; }
+  uint32_t v_degree() const { return v_degree_; }
+  bool rational() const { return rational_; }
+  const ControlNet<Point4D> &control_net() const { return control_net_; }
+
+private:
+  // Emits the x, y and z rows of the grid, see tensor::EvaluateRows
+  void EvaluateGridRows(
+      const double *u_params, size_t u_count, const double *v_params,
+      size_t v_count,
+      const std::function<void(size_t, const double *const *)> &emit_row)
+      const;
+  // De Casteljau of every column at local u into reduced[(c * cols()) + j],
+  // scratch needs rows() doubles
+  void ReduceColumns(double u, double *scratch, double *reduced) const;
+  // De Casteljau of the reduced columns at local v, scratch needs cols()
+  Point3D ReduceRow(double v, const double *reduced, double *scratch) const;
+  // The parameters clamped to the intervals and mapped to [0, 1]
+  std::vector<double> LocalParams(const double *params, size_t count,
+                                  Point2D interval) const;
+
+  uint32_t u_degree_ = 0;
+  uint32_t v_degree_ = 0;
+  bool rational_ = false;
+  ControlNet<Point4D> control_net_;
+  // 0 and 1 degree + 1 times each, for the basis tables
+  std::vector<double> u_knots_;
+  std::vector<double> v_knots_;
+};
+} // namespace nurbs
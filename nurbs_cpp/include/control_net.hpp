@@ -0,0 +1,251 @@
+#pragma once
+
+// NURBS
+#include "include/point_types.hpp"
+
+// STD
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace nurbs {
+// Member pointers for the components of each point type, in x, y, z, w order
+template <typename PointT> struct PointComponents;
+
+template <> struct PointComponents<Point2D> {
+  static constexpr uint32_t kCount = 2;
+  static constexpr double Point2D::*kMembers[kCount] = {&Point2D::x,
+                                                        &Point2D::y};
+};
+
+template <> struct PointComponents<Point3D> {
+  static constexpr uint32_t kCount = 3;
+  static constexpr double Point3D::*kMembers[kCount] = {
+      &Point3D::x, &Point3D::y, &Point3D::z};
+};
+
+template <> struct PointComponents<Point4D> {
+  static constexpr uint32_t kCount = 4;
+  static constexpr double Point4D::*kMembers[kCount] = {
+      &Point4D::x, &Point4D::y, &Point4D::z, &Point4D::w};
+};
+
+// std::allocator only promises alignof(std::max_align_t)
+template <typename T, size_t Alignment> struct AlignedAllocator {
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+  T *allocate(size_t count) {
+    return static_cast<T *>(
+        ::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T *ptr, size_t) {
+    ::operator delete(ptr, std::align_val_t(Alignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+    return false;
+  }
+};
+
+// Contiguous control net, indexed [u][v] like the nested vectors it replaces.
+// Rows run along u and row u holds the cols() points along v.
+//
+// Points are stored as a structure of arrays: every component has its own
+// plane of rows() x stride() doubles, so plane(c)[Index(u, v)] is component c
+// of point [u][v]. Rows are padded to a multiple of kRowAlignment doubles and
+// every plane starts on a cache line, so each row starts 32 byte aligned and
+// the points of a row are contiguous per component.
+template <typename PointT> class ControlNet {
+public:
+  using Components = PointComponents<PointT>;
+  static constexpr uint32_t kDimension = Components::kCount;
+  static constexpr size_t kRowAlignment = 4;
+  static constexpr size_t kPlaneAlignment = 8;
+
+  // Writable handle to one point of the net
+  class PointRef {
+  public:
+    PointRef(ControlNet *net, size_t u, size_t v) : net_(net), u_(u), v_(v) {}
+
+    operator PointT() const { return net_->Get(u_, v_); }
+    PointRef &operator=(const PointT &point) {
+      net_->Set(u_, v_, point);
+      return *this;
+    }
+    PointRef &operator=(const PointRef &other) {
+      return *this = static_cast<PointT>(other);
+    }
+
+  private:
+    ControlNet *net_;
+    size_t u_;
+    size_t v_;
+  };
+
+  // Row u, indexed by v. NetT is const for a read only view.
+  template <typename NetT> class RowView {
+  public:
+    RowView(NetT *net, size_t u) : net_(net), u_(u) {}
+    auto operator[](size_t v) const { return net_->at(u_, v); }
+    size_t size() const { return net_->cols(); }
+
+  private:
+    NetT *net_;
+    size_t u_;
+  };
+
+  // Column v, indexed by u
+  template <typename NetT> class ColumnView {
+  public:
+    ColumnView(NetT *net, size_t v) : net_(net), v_(v) {}
+    auto operator[](size_t u) const { return net_->at(u, v_); }
+    size_t size() const { return net_->rows(); }
+
+  private:
+    NetT *net_;
+    size_t v_;
+  };
+
+  ControlNet() = default;
+  ControlNet(size_t rows, size_t cols) { Resize(rows, cols); }
+  ControlNet(const std::vector<std::vector<PointT>> &points) {
+    Resize(points.size(), points.empty() ? 0 : points[0].size());
+    for (size_t u = 0; u < rows_; ++u) {
+      for (size_t v = 0; v < cols_; ++v) {
+        Set(u, v, points[u][v]);
+      }
+    }
+  }
+
+  // Drops the current points, the new net is all zeros
+  void Resize(size_t rows, size_t cols) {
+    rows_ = rows;
+    cols_ = cols;
+    stride_ = RoundUp(cols, kRowAlignment);
+    plane_size_ = RoundUp(rows * stride_, kPlaneAlignment);
+    data_.assign(plane_size_ * kDimension, 0.0);
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  // Distance in doubles between [u][v] and [u + 1][v]
+  size_t stride() const { return stride_; }
+  bool empty() const { return rows_ == 0; }
+  // Matches the outer size of the nested vectors
+  size_t size() const { return rows_; }
+
+  size_t Index(size_t u, size_t v) const { return (u * stride_) + v; }
+  double *plane(uint32_t component) {
+    return data_.data() + (component * plane_size_);
+  }
+  const double *plane(uint32_t component) const {
+    return data_.data() + (component * plane_size_);
+  }
+
+  PointT Get(size_t u, size_t v) const {
+    PointT point;
+    const size_t index = Index(u, v);
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      point.*Components::kMembers[c] = plane(c)[index];
+    }
+    return point;
+  }
+  void Set(size_t u, size_t v, const PointT &point) {
+    const size_t index = Index(u, v);
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      plane(c)[index] = point.*Components::kMembers[c];
+    }
+  }
+
+  PointT at(size_t u, size_t v) const { return Get(u, v); }
+  PointRef at(size_t u, size_t v) { return PointRef(this, u, v); }
+  PointT operator()(size_t u, size_t v) const { return Get(u, v); }
+
+  RowView<const ControlNet> operator[](size_t u) const { return row(u); }
+  RowView<ControlNet> operator[](size_t u) { return row(u); }
+  RowView<const ControlNet> row(size_t u) const { return {this, u}; }
+  RowView<ControlNet> row(size_t u) { return {this, u}; }
+  ColumnView<const ControlNet> column(size_t v) const { return {this, v}; }
+  ColumnView<ControlNet> column(size_t v) { return {this, v}; }
+
+  // Row dst = row src_row of src, both nets need the same cols()
+  void CopyRow(size_t dst, const ControlNet &src, size_t src_row) {
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      const double *in = src.plane(c) + src.Index(src_row, 0);
+      std::copy(in, in + cols_, plane(c) + Index(dst, 0));
+    }
+  }
+  // Column dst = column src_col of src, both nets need the same rows()
+  void CopyColumn(size_t dst, const ControlNet &src, size_t src_col) {
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      const double *in = src.plane(c) + src_col;
+      double *out = plane(c) + dst;
+      for (size_t u = 0; u < rows_; ++u) {
+        out[u * stride_] = in[u * src.stride_];
+      }
+    }
+  }
+
+  // Row dst = (alpha * row a) + ((1.0 - alpha) * row b), per component and in
+  // that order so the results match the PointT operators
+  void BlendRows(size_t dst, double alpha, size_t a, size_t b) {
+    const double beta = 1.0 - alpha;
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      double *values = plane(c);
+      const double *a_values = values + Index(a, 0);
+      const double *b_values = values + Index(b, 0);
+      double *out = values + Index(dst, 0);
+      for (size_t v = 0; v < cols_; ++v) {
+        out[v] = (alpha * a_values[v]) + (beta * b_values[v]);
+      }
+    }
+  }
+  // Column version of BlendRows
+  void BlendColumns(size_t dst, double alpha, size_t a, size_t b) {
+    const double beta = 1.0 - alpha;
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      double *values = plane(c);
+      for (size_t u = 0; u < rows_; ++u) {
+        const size_t offset = u * stride_;
+        values[offset + dst] =
+            (alpha * values[offset + a]) + (beta * values[offset + b]);
+      }
+    }
+  }
+
+  std::vector<std::vector<PointT>> ToVector() const {
+    std::vector<std::vector<PointT>> points(rows_, std::vector<PointT>(cols_));
+    for (size_t u = 0; u < rows_; ++u) {
+      for (size_t v = 0; v < cols_; ++v) {
+        points[u][v] = Get(u, v);
+      }
+    }
+    return points;
+  }
+
+private:
+  static size_t RoundUp(size_t value, size_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+  }
+
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  size_t stride_ = 0;
+  size_t plane_size_ = 0;
+  std::vector<double, AlignedAllocator<double, 64>> data_;
+};
+} // namespace nurbs
@@ -15,18 +15,44 @@ public:
 
   virtual Point2D EvaluateCurve(double u) const { return {0, 0}; }
 
+  // Evaluates count parameters into points. Parameters can be in any order,
+  // but implementations may walk the knot spans when they are ascending, so
+  // sorted input is the fast path.
+  virtual void EvaluateCurveBatch(const double *params, size_t count,
+                                  Point2D *points) const {
+    for (size_t i = 0; i < count; ++i) {
+      points[i] = EvaluateCurve(params[i]);
+    }
+  }
+
+  // Ascending parameters from interval.x to interval.y between which the
+  // curve is smooth, like the distinct knots of a spline. Flattening starts
+  // from these so it never steps over a kink.
+  virtual std::vector<double> Breakpoints() const {
+    return {interval_.x, interval_.y};
+  }
+
   virtual std::vector<Point2D>
   EvaluateCurvePoints(uint32_t point_count) const {
-    std::vector<Point2D> points(point_count);
+    std::vector<double> params(point_count);
     const double div =
         (interval_.y - interval_.x) / static_cast<double>(point_count - 1);
     for (uint32_t i = 0; i < point_count; ++i) {
-      double u = interval_.x + (static_cast<double>(i) * div);
-      points[i] = EvaluateCurve(u);
+      params[i] = interval_.x + (static_cast<double>(i) * div);
     }
+    std::vector<Point2D> points(point_count);
+    EvaluateCurveBatch(params.data(), params.size(), points.data());
     return points;
   }
 
+  // The points of EvaluateCurvePoints by forward differencing, a few
+  // additions per point, for curves that are polynomial between their
+  // breakpoints. They differ from EvaluateCurve by rounding that stays
+  // bounded, see forward::kAnchorInterval. The default just evaluates.
+  virtual std::vector<Point2D> StepCurvePoints(uint32_t point_count) const {
+    return EvaluateCurvePoints(point_count);
+  }
+
   void interval(Point2D interval) {
     interval_ = interval;
     interval_div_ = 1.0 / (interval_.y - interval_.x);
@@ -0,0 +1,48 @@
+#pragma once
+
+// NURBS
+#include "include/curve_2d.hpp"
+#include "include/curve_3d.hpp"
+
+// STD
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+// Turns a curve into a polyline whose vertex count follows the shape of the
+// curve. Each span between the curve's Breakpoints is bisected in parameter
+// until the curve at the middle of a piece is within chordal_tolerance of its
+// chord and the chords of the two halves turn by at most angle_tolerance.
+// Straight spans end up with a handful of vertices and tight bends get as
+// many as the tolerances ask for.
+class CurveFlattener {
+public:
+  struct Options {
+    // Distance in model units
+    double chordal_tolerance = 1e-3;
+    // Radians
+    double angle_tolerance = 0.1;
+    // Pieces are always bisected min_depth times and never past max_depth.
+    // One bisection keeps a piece with an inflection in the middle, whose
+    // midpoint is on its chord, from passing as flat.
+    uint32_t min_depth = 1;
+    uint32_t max_depth = 16;
+  };
+  static constexpr uint32_t kMaxDepth = 30;
+
+  CurveFlattener() = default;
+  explicit CurveFlattener(const Options &options);
+
+  // Polyline from interval.x to interval.y, the parameter of every vertex is
+  // written to params when it is not null
+  std::vector<Point2D> Flatten(const Curve2D &curve,
+                               std::vector<double> *params = nullptr) const;
+  std::vector<Point3D> Flatten(const Curve3D &curve,
+                               std::vector<double> *params = nullptr) const;
+
+  const Options &options() const { return options_; }
+
+private:
+  Options options_;
+};
+} // namespace nurbs
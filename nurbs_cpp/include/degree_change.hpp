@@ -0,0 +1,388 @@
+#pragma once
+
+// NURBS
+#include "include/knot_utility_functions.hpp"
+#include "include/point_types.hpp"
+
+// STD
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+namespace degree {
+// Whether a degree reduction went through, and a bound on how far it moved
+// the geometry
+struct ReductionReport {
+  bool reduced = false;
+  // Largest error A5.11 summed over a knot span, scaled to model space. No
+  // point of the reduced geometry is further than this from the old one.
+  double error_bound = 0.0;
+};
+
+// Distinct values of a knot vector, each one a break of the curve
+inline size_t DistinctKnots(const std::vector<double> &U) {
+  size_t count = U.empty() ? 0 : 1;
+  for (size_t i = 1; i < U.size(); ++i) {
+    if (U[i] != U[i - 1]) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// ALGORITHM A5.9 DegreeElevateCurve(n, p, U, Pw, t, nh, Uh, Qw) p.206, on the
+// knots and homogeneous control points of a curve of degree p. Writes the
+// same curve at degree p + t into Uh and Qw, which keep their storage between
+// calls. Every distinct knot gets t more copies.
+template <typename PointT>
+void ElevateDegree(uint32_t degree, uint32_t t, const std::vector<double> &U,
+                   const std::vector<PointT> &Pw, std::vector<double> &Uh,
+                   std::vector<PointT> &Qw) {
+  const int p = static_cast<int>(degree);
+  const int ti = static_cast<int>(t);
+  const int n = static_cast<int>(Pw.size()) - 1;
+  const int m = n + p + 1;
+  const int ph = p + ti;
+  const int ph2 = ph / 2;
+  const size_t distinct = DistinctKnots(U);
+  Uh.resize(U.size() + (t * distinct));
+  Qw.resize(Pw.size() + (t * distinct));
+
+  // Bezier degree elevation coefficients, bezalfs[(i * (p + 1)) + j]
+  thread_local std::vector<double> bezalfs;
+  thread_local std::vector<PointT> bpts;
+  thread_local std::vector<PointT> ebpts;
+  thread_local std::vector<PointT> next_bpts;
+  thread_local std::vector<double> alfs;
+  const int order = p + 1;
+  bezalfs.assign(static_cast<size_t>((ph + 1) * order), 0.0);
+  bpts.resize(order);
+  ebpts.resize(ph + 1);
+  next_bpts.resize(std::max(p - 1, 1));
+  alfs.resize(std::max(p - 1, 1));
+
+  bezalfs[0] = 1.0;
+  bezalfs[(ph * order) + p] = 1.0;
+  for (int i = 1; i <= ph2; ++i) {
+    const double inv = 1.0 / knots::Binomial(ph, i);
+    const int mpi = std::min(p, i);
+    for (int j = std::max(0, i - ti); j <= mpi; ++j) {
+      bezalfs[(i * order) + j] =
+          inv * knots::Binomial(p, j) * knots::Binomial(t, i - j);
+    }
+  }
+  for (int i = ph2 + 1; i <= ph - 1; ++i) {
+    const int mpi = std::min(p, i);
+    for (int j = std::max(0, i - ti); j <= mpi; ++j) {
+      bezalfs[(i * order) + j] = bezalfs[((ph - i) * order) + p - j];
+    }
+  }
+
+  int kind = ph + 1;
+  int r = -1;
+  int a = p;
+  int b = p + 1;
+  int cind = 1;
+  double ua = U[0];
+  Qw[0] = Pw[0];
+  for (int i = 0; i <= ph; ++i) {
+    Uh[i] = ua;
+  }
+  // Initialize first Bezier seg
+  for (int i = 0; i <= p; ++i) {
+    bpts[i] = Pw[i];
+  }
+  // Big loop thru knot vector
+  while (b < m) {
+    int i = b;
+    while (b < m && U[b] == U[b + 1]) {
+      ++b;
+    }
+    const int mul = b - i + 1;
+    const double ub = U[b];
+    const int oldr = r;
+    r = p - mul;
+    // Insert knot u(b) r times
+    const int lbz = oldr > 0 ? (oldr + 2) / 2 : 1;
+    const int rbz = r > 0 ? ph - ((r + 1) / 2) : ph;
+    if (r > 0) {
+      // Insert knot to get Bezier segment
+      const double numer = ub - ua;
+      for (int k = p; k > mul; --k) {
+        alfs[k - mul - 1] = numer / (U[a + k] - ua);
+      }
+      for (int j = 1; j <= r; ++j) {
+        const int save = r - j;
+        const int s = mul + j;
+        for (int k = p; k >= s; --k) {
+          bpts[k] =
+              (alfs[k - s] * bpts[k]) + ((1.0 - alfs[k - s]) * bpts[k - 1]);
+        }
+        next_bpts[save] = bpts[p];
+      }
+    }
+    // Degree elevate Bezier, only points lbz,...,ph are used below
+    for (i = lbz; i <= ph; ++i) {
+      ebpts[i] = PointT();
+      const int mpi = std::min(p, i);
+      for (int j = std::max(0, i - ti); j <= mpi; ++j) {
+        ebpts[i] = ebpts[i] + (bezalfs[(i * order) + j] * bpts[j]);
+      }
+    }
+    if (oldr > 1) {
+      // Must remove knot u = U[a] oldr times
+      int first = kind - 2;
+      int last = kind;
+      const double den = ub - ua;
+      const double bet = (ub - Uh[kind - 1]) / den;
+      // Knot removal loop
+      for (int tr = 1; tr < oldr; ++tr) {
+        i = first;
+        int j = last;
+        int kj = j - kind + 1;
+        // Loop and compute the new control points for one removal step
+        while (j - i > tr) {
+          if (i < cind) {
+            const double alf = (ub - Uh[i]) / (ua - Uh[i]);
+            Qw[i] = (alf * Qw[i]) + ((1.0 - alf) * Qw[i - 1]);
+          }
+          if (j >= lbz) {
+            if (j - tr <= kind - ph + oldr) {
+              const double gam = (ub - Uh[j - tr]) / den;
+              ebpts[kj] = (gam * ebpts[kj]) + ((1.0 - gam) * ebpts[kj + 1]);
+            } else {
+              ebpts[kj] = (bet * ebpts[kj]) + ((1.0 - bet) * ebpts[kj + 1]);
+            }
+          }
+          ++i;
+          --j;
+          --kj;
+        }
+        --first;
+        ++last;
+      }
+    }
+    // Load the knot ua
+    if (a != p) {
+      for (i = 0; i < ph - oldr; ++i) {
+        Uh[kind] = ua;
+        ++kind;
+      }
+    }
+    // Load ctrl pts into Qw
+    for (int j = lbz; j <= rbz; ++j) {
+      Qw[cind] = ebpts[j];
+      ++cind;
+    }
+    if (b < m) {
+      // Set up for next pass thru loop
+      for (int j = 0; j < r; ++j) {
+        bpts[j] = next_bpts[j];
+      }
+      for (int j = r; j <= p; ++j) {
+        bpts[j] = Pw[b - p + j];
+      }
+      a = b;
+      ++b;
+      ua = ub;
+    } else {
+      // End knot
+      for (i = 0; i <= ph; ++i) {
+        Uh[kind + i] = ub;
+      }
+    }
+  }
+  Uh.resize(kind + ph + 1);
+  Qw.resize(cind);
+}
+
+// Degree reduction of one Bezier segment of degree p, Eqs. (5.41) to (5.46)
+// p.220: bpts[0..p] to rbpts[0..p - 1], keeping both ends. Returns a bound on
+// the distance between the two segments.
+template <typename PointT>
+double ReduceBezier(int p, const PointT *bpts, PointT *rbpts) {
+  const int r = (p - 1) / 2;
+  rbpts[0] = bpts[0];
+  rbpts[p - 1] = bpts[p];
+  for (int i = 1; i < r; ++i) {
+    const double alfa = static_cast<double>(i) / p;
+    rbpts[i] = (bpts[i] - (alfa * rbpts[i - 1])) / (1.0 - alfa);
+  }
+  for (int i = p - 2; i > r; --i) {
+    const double alfa = static_cast<double>(i + 1) / p;
+    rbpts[i] = (bpts[i + 1] - ((1.0 - alfa) * rbpts[i + 1])) / alfa;
+  }
+  const double alfa_r = static_cast<double>(r) / p;
+  const PointT left =
+      r == 0 ? bpts[0]
+             : (bpts[r] - (alfa_r * rbpts[r - 1])) / (1.0 - alfa_r);
+  if (p % 2 == 0) {
+    // Re-elevating misses P[r + 1] only, by the distance below times the
+    // basis function at 1/2, which is under one
+    rbpts[r] = left;
+    return Length(bpts[r + 1] - (0.5 * (rbpts[r] + rbpts[r + 1])));
+  }
+  // Odd: both ends meet at Q[r], P[r] and P[r + 1] move by the same amount
+  // in opposite directions
+  const double alfa_r1 = static_cast<double>(r + 1) / p;
+  const PointT right =
+      (bpts[r + 1] - ((1.0 - alfa_r1) * rbpts[r + 1])) / alfa_r1;
+  rbpts[r] = 0.5 * (left + right);
+  return 0.5 * (1.0 - alfa_r) * Length(left - right);
+}
+
+// ALGORITHM A5.11 DegreeReduceCurve(n, p, U, Qw, nh, Uh, Pw) p.223, on the
+// knots and homogeneous control points of a curve of degree p >= 2. Writes
+// the curve at degree p - 1 into Uh and Pw when the error summed over every
+// knot span stays within tolerance, which is in homogeneous space, and sets
+// error to the largest of those sums. Returns false, with Uh and Pw
+// undefined, when some span goes over.
+template <typename PointT>
+bool ReduceDegree(uint32_t degree, double tolerance,
+                  const std::vector<double> &U, const std::vector<PointT> &Qw,
+                  std::vector<double> &Uh, std::vector<PointT> &Pw,
+                  double &error) {
+  const int p = static_cast<int>(degree);
+  if (p < 2 || Qw.size() <= degree) {
+    return false;
+  }
+  const int ph = p - 1;
+  const int n = static_cast<int>(Qw.size()) - 1;
+  const int m = n + p + 1;
+  Uh.resize(U.size());
+  Pw.resize(Qw.size());
+
+  thread_local std::vector<PointT> bpts;
+  thread_local std::vector<PointT> rbpts;
+  thread_local std::vector<PointT> next_bpts;
+  thread_local std::vector<double> alphas;
+  thread_local std::vector<double> e;
+  bpts.resize(p + 1);
+  rbpts.resize(p + 1);
+  next_bpts.resize(p);
+  alphas.resize(p);
+  // Error vector, one sum per knot span
+  e.assign(m + 1, 0.0);
+
+  int kind = ph + 1;
+  int r = -1;
+  int a = p;
+  int b = p + 1;
+  int cind = 1;
+  Pw[0] = Qw[0];
+  // Compute left end of knot vector
+  for (int i = 0; i <= ph; ++i) {
+    Uh[i] = U[0];
+  }
+  // Initialize first Bezier segment
+  for (int i = 0; i <= p; ++i) {
+    bpts[i] = Qw[i];
+  }
+  // Loop through the knot vector
+  while (b < m) {
+    // First compute knot multiplicity
+    int i = b;
+    while (b < m && U[b] == U[b + 1]) {
+      ++b;
+    }
+    const int mult = b - i + 1;
+    const int oldr = r;
+    r = p - mult;
+    const int lbz = oldr > 0 ? (oldr + 2) / 2 : 1;
+    // Insert knot U[b] r times
+    if (r > 0) {
+      const double numer = U[b] - U[a];
+      for (int k = p; k > mult; --k) {
+        alphas[k - mult - 1] = numer / (U[a + k] - U[a]);
+      }
+      for (int j = 1; j <= r; ++j) {
+        const int save = r - j;
+        const int s = mult + j;
+        for (int k = p; k >= s; --k) {
+          bpts[k] = (alphas[k - s] * bpts[k]) +
+                    ((1.0 - alphas[k - s]) * bpts[k - 1]);
+        }
+        next_bpts[save] = bpts[p];
+      }
+    }
+    // Degree reduce Bezier segment
+    e[a] += ReduceBezier(p, bpts.data(), rbpts.data());
+    if (e[a] > tolerance) {
+      return false;
+    }
+    // Remove knot U[a] oldr times
+    if (oldr > 0) {
+      int first = kind;
+      int last = kind;
+      for (int k = 0; k < oldr; ++k) {
+        i = first;
+        int j = last;
+        int kj = j - kind;
+        while (j - i > k) {
+          const double alfa = (U[a] - Uh[i - 1]) / (U[b] - Uh[i - 1]);
+          const double beta = (U[a] - Uh[j - k - 1]) / (U[b] - Uh[j - k - 1]);
+          Pw[i - 1] = (Pw[i - 1] - ((1.0 - alfa) * Pw[i - 2])) / alfa;
+          rbpts[kj] = (rbpts[kj] - (beta * rbpts[kj + 1])) / (1.0 - beta);
+          ++i;
+          --j;
+          --kj;
+        }
+        // Compute knot removal error bounds (Br)
+        double br = 0.0;
+        if (j - i < k) {
+          br = Length(Pw[i - 2] - rbpts[kj + 1]);
+        } else {
+          const double delta = (U[a] - Uh[i - 1]) / (U[b] - Uh[i - 1]);
+          br = Length(Pw[i - 1] - ((delta * rbpts[kj + 1]) +
+                                   ((1.0 - delta) * Pw[i - 2])));
+        }
+        // Update the error vector, these knot spans were affected
+        const int K = a + oldr - k;
+        const int q = ((2 * p) - k + 1) / 2;
+        for (int ii = std::max(K - q, 0); ii <= a; ++ii) {
+          e[ii] += br;
+          if (e[ii] > tolerance) {
+            return false;
+          }
+        }
+        --first;
+        ++last;
+      }
+      cind = i - 1;
+    }
+    // Load knot vector and control points
+    if (a != p) {
+      for (i = 0; i < ph - oldr; ++i) {
+        Uh[kind] = U[a];
+        ++kind;
+      }
+    }
+    for (i = lbz; i <= ph; ++i) {
+      Pw[cind] = rbpts[i];
+      ++cind;
+    }
+    // Set up for next pass through
+    if (b < m) {
+      for (i = 0; i < r; ++i) {
+        bpts[i] = next_bpts[i];
+      }
+      for (i = r; i <= p; ++i) {
+        bpts[i] = Qw[b - p + i];
+      }
+      a = b;
+      ++b;
+    } else {
+      for (i = 0; i <= ph; ++i) {
+        Uh[kind + i] = U[b];
+      }
+    }
+  }
+  Uh.resize(kind + ph + 1);
+  Pw.resize(cind);
+  error = *std::max_element(e.begin(), e.end());
+  return true;
+}
+} // namespace degree
+} // namespace nurbs
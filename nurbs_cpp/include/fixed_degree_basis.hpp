@@ -0,0 +1,223 @@
+#pragma once
+
+#include "include/control_net.hpp"
+#include "include/knot_utility_functions.hpp"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nurbs {
+namespace knots {
+// Highest degree with a compile time specialisation. Anything above this goes
+// through the runtime kernels in knot_utility_functions.hpp
+constexpr uint32_t kMaxFixedDegree = 5;
+
+template <uint32_t Value>
+using DegreeConstant = std::integral_constant<uint32_t, Value>;
+
+namespace detail {
+template <typename Func, uint32_t... Is>
+inline void UnrollImpl(Func &&func, std::integer_sequence<uint32_t, Is...>) {
+  (func(DegreeConstant<Is>{}), ...);
+}
+} // namespace detail
+
+// Calls func(DegreeConstant<I>{}) for I in [0, N) without a runtime loop
+template <uint32_t N, typename Func> inline void Unroll(Func &&func) {
+  detail::UnrollImpl(std::forward<Func>(func),
+                     std::make_integer_sequence<uint32_t, N>{});
+}
+
+// Calls func(DegreeConstant<P>{}) when degree has a compile time
+// specialisation. Returns false when it does not, so the caller can fall back
+// to the generic path.
+template <typename Func>
+inline bool DispatchDegree(uint32_t degree, Func &&func) {
+  switch (degree) {
+  case 1:
+    func(DegreeConstant<1>{});
+    return true;
+  case 2:
+    func(DegreeConstant<2>{});
+    return true;
+  case 3:
+    func(DegreeConstant<3>{});
+    return true;
+  case 4:
+    func(DegreeConstant<4>{});
+    return true;
+  case 5:
+    func(DegreeConstant<5>{});
+    return true;
+  default:
+    return false;
+  }
+}
+
+// ALGORITHM A2.2  BasisFuns(i,u,p,U,N) with p fixed at compile time
+// Performs the same operations in the same order as the runtime version so
+// the results match bit for bit.
+template <uint32_t P>
+inline void BasisFuns(uint32_t span, double u, const std::vector<double> &knots,
+                      double tolerance, std::array<double, P + 1> &bases) {
+  u = std::min(u, knots[knots.size() - 1]);
+  if (span >= static_cast<uint32_t>(knots.size()) - P - 2 ||
+      (u >= knots[span] - tolerance && u < knots[span + 1] - tolerance)) {
+    bases[0] = 1.0;
+  } else {
+    bases[0] = 0.0;
+  }
+  std::array<double, P + 1> left;
+  std::array<double, P + 1> right;
+  Unroll<P>([&](auto j_minus_one) {
+    constexpr uint32_t j = decltype(j_minus_one)::value + 1;
+    left[j] = u - knots[span + 1 - j];
+    right[j] = knots[span + j] - u;
+    double saved = 0.0;
+    Unroll<j>([&](auto r_constant) {
+      constexpr uint32_t r = decltype(r_constant)::value;
+      double temp = bases[r] / (right[r + 1] + left[j - r]);
+      bases[r] = saved + (right[r + 1] * temp);
+      saved = left[j - r] * temp;
+    });
+    bases[j] = saved;
+  });
+}
+
+// Chaper 3, ALGORITHM A3.1: CurvePoint p82, fixed degree
+// Works for homogeneous control points too, the caller does the divide.
+template <uint32_t P, typename PointT>
+inline PointT CurvePoint(uint32_t span, double u,
+                         const std::vector<double> &knots,
+                         const std::vector<PointT> &control_points,
+                         double tolerance) {
+  std::array<double, P + 1> bases;
+  BasisFuns<P>(span, u, knots, tolerance, bases);
+  PointT point;
+  Unroll<P + 1>([&](auto i_constant) {
+    constexpr uint32_t i = decltype(i_constant)::value;
+    point += bases[i] * control_points[span - P + i];
+  });
+  return point;
+}
+
+// Chaper 3, ALGORITHM A3.1: CurvePoint p82, degree given at runtime
+// Uses the fixed degree kernel when there is one and the thread scratch
+// otherwise.
+template <typename PointT>
+inline PointT CurvePoint(uint32_t degree, uint32_t span, double u,
+                         const std::vector<double> &knots,
+                         const std::vector<PointT> &control_points,
+                         double tolerance) {
+  PointT point;
+  if (DispatchDegree(degree, [&](auto p) {
+        point = CurvePoint<decltype(p)::value>(span, u, knots, control_points,
+                                               tolerance);
+      })) {
+    return point;
+  }
+  BasisScratch &scratch = ThreadScratch();
+  scratch.Reserve(degree);
+  double *bases = scratch.bases.data();
+  BasisFuns(span, u, degree, knots, tolerance, bases, scratch);
+  for (uint32_t i = 0; i <= degree; i++) {
+    point += bases[i] * control_points[span - degree + i];
+  }
+  return point;
+}
+
+// The tensor product sum of SurfacePoint for basis values already computed.
+// Each component is summed on its own plane of the net, in the same order the
+// PointT operators would use.
+template <uint32_t P, uint32_t Q, typename PointT>
+inline PointT SurfaceSum(const std::array<double, P + 1> &u_bases,
+                         uint32_t u_span,
+                         const std::array<double, Q + 1> &v_bases,
+                         uint32_t v_span,
+                         const ControlNet<PointT> &control_net) {
+  const size_t stride = control_net.stride();
+  const size_t offset = control_net.Index(u_span - P, v_span - Q);
+  PointT point;
+  Unroll<ControlNet<PointT>::kDimension>([&](auto c_constant) {
+    constexpr uint32_t c = decltype(c_constant)::value;
+    const double *values = control_net.plane(c) + offset;
+    double sum = 0.0;
+    Unroll<Q + 1>([&](auto i_constant) {
+      constexpr uint32_t i = decltype(i_constant)::value;
+      double temp = 0.0;
+      Unroll<P + 1>([&](auto j_constant) {
+        constexpr uint32_t j = decltype(j_constant)::value;
+        temp += u_bases[j] * values[(j * stride) + i];
+      });
+      sum += v_bases[i] * temp;
+    });
+    point.*PointComponents<PointT>::kMembers[c] = sum;
+  });
+  return point;
+}
+
+// Chaper 3, ALGORITHM A3.5: SurfacePoint p103, fixed degrees
+template <uint32_t P, uint32_t Q, typename PointT>
+inline PointT SurfacePoint(uint32_t u_span, double u,
+                           const std::vector<double> &u_knots, uint32_t v_span,
+                           double v, const std::vector<double> &v_knots,
+                           const ControlNet<PointT> &control_net,
+                           double tolerance) {
+  std::array<double, P + 1> u_bases;
+  std::array<double, Q + 1> v_bases;
+  BasisFuns<P>(u_span, u, u_knots, tolerance, u_bases);
+  BasisFuns<Q>(v_span, v, v_knots, tolerance, v_bases);
+  return SurfaceSum<P, Q>(u_bases, u_span, v_bases, v_span, control_net);
+}
+
+// Chaper 3, ALGORITHM A3.5: SurfacePoint p103, degrees given at runtime
+template <typename PointT>
+inline PointT SurfacePoint(uint32_t u_degree, uint32_t u_span, double u,
+                           const std::vector<double> &u_knots,
+                           uint32_t v_degree, uint32_t v_span, double v,
+                           const std::vector<double> &v_knots,
+                           const ControlNet<PointT> &control_net,
+                           double tolerance) {
+  PointT point;
+  bool fixed = false;
+  DispatchDegree(u_degree, [&](auto p) {
+    fixed = DispatchDegree(v_degree, [&](auto q) {
+      point = SurfacePoint<decltype(p)::value, decltype(q)::value>(
+          u_span, u, u_knots, v_span, v, v_knots, control_net, tolerance);
+    });
+  });
+  if (fixed) {
+    return point;
+  }
+  BasisScratch &u_scratch = ThreadScratch(0);
+  BasisScratch &v_scratch = ThreadScratch(1);
+  u_scratch.Reserve(u_degree);
+  v_scratch.Reserve(v_degree);
+  double *u_bases = u_scratch.bases.data();
+  double *v_bases = v_scratch.bases.data();
+  BasisFuns(u_span, u, u_degree, u_knots, tolerance, u_bases, u_scratch);
+  BasisFuns(v_span, v, v_degree, v_knots, tolerance, v_bases, v_scratch);
+  const size_t stride = control_net.stride();
+  const size_t offset =
+      control_net.Index(u_span - u_degree, v_span - v_degree);
+  for (uint32_t c = 0; c < ControlNet<PointT>::kDimension; ++c) {
+    const double *values = control_net.plane(c) + offset;
+    double sum = 0.0;
+    for (uint32_t i = 0; i <= v_degree; ++i) {
+      double temp = 0.0;
+      for (uint32_t j = 0; j <= u_degree; ++j) {
+        temp += u_bases[j] * values[(j * stride) + i];
+      }
+      sum += v_bases[i] * temp;
+    }
+    point.*PointComponents<PointT>::kMembers[c] = sum;
+  }
+  return point;
+}
+} // namespace knots
+} // namespace nurbs
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+// NURBS
+#include "include/basis_table.hpp"
+#include "include/control_net.hpp"
+#include "include/point_types.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace nurbs {
+namespace forward {
+// Points stepped between two re-anchorings. Every step adds the rounding of
+// degree additions to the running differences, so the differences are
+// recomputed from the polynomial this often to keep the drift from growing
+// with the sample count.
+constexpr uint32_t kAnchorInterval = 32;
+
+// Writes count values of the polynomial sum over k of coefficients[k] * t^k
+// at t = t0 + (i * step) into values[i * stride], by forward differencing:
+// degree additions per value. Differences come from the Taylor expansion at
+// the anchor rather than from differencing evaluated values, so nothing
+// cancels when the step is small.
+void StepPolynomial(const double *coefficients, uint32_t degree, double t0,
+                    double step, size_t count, double *values,
+                    size_t stride = 1,
+                    uint32_t anchor_interval = kAnchorInterval);
+
+// Uniform samples of a spline over an interval, split into chunks of at most
+// kAnchorInterval samples in the same knot span. A chunk with more samples
+// than the order keeps the forward differences of its basis functions at its
+// first sample, so any control points on the knot vector turn into the
+// differences of the chunk with one small matrix product and then step. A
+// shorter chunk keeps the basis values of its samples and is summed
+// directly, as stepping would not pay for itself. Build one for a knot vector
+// and sample count and use it for every curve or surface row that shares
+// them.
+class SplineStepPlan {
+public:
+  // point_count parameters from interval.x to interval.y, spaced like
+  // Curve3D::EvaluateCurvePoints
+  SplineStepPlan(uint32_t degree, const std::vector<double> &knots,
+                 Point2D interval, uint32_t point_count, double tolerance);
+
+  // Whether stepping point_count samples beats evaluating them, which takes
+  // about a full chunk of samples per knot span in the interval
+  static bool Pays(uint32_t degree, const std::vector<double> &knots,
+                   Point2D interval, uint32_t point_count);
+
+  uint32_t degree() const { return degree_; }
+  size_t size() const { return count_; }
+
+  // planes[c][j] is coordinate c of control point j, for up to kMaxPlanes
+  // planes. When rational the last plane holds the weights and the others
+  // are divided by it. Calls emit(first, count, coords) once per chunk, in
+  // order, with the coordinates of points first to first + count - 1,
+  // kMaxPlanes apart.
+  void Step(const double *const *planes, uint32_t dimension, bool rational,
+            const std::function<void(size_t, uint32_t, const double *)>
+                &emit) const;
+
+  static constexpr uint32_t kMaxPlanes = 4;
+
+private:
+  struct Chunk {
+    size_t first;
+    uint32_t count;
+    uint32_t span;
+    bool stepped;
+  };
+
+  uint32_t degree_;
+  size_t count_;
+  std::vector<Chunk> chunks_;
+  // Per chunk, degree + 1 rows when stepped, where [k][i] is the kth forward
+  // difference of basis i, else a row of basis values per sample
+  std::vector<double> matrices_;
+};
+
+// count points of the polynomial curve sum over k of coefficients[k] * t^k
+// at t = t0 + (i * step)
+template <typename PointT>
+std::vector<PointT> StepPowerBasis(const std::vector<PointT> &coefficients,
+                                   double t0, double step, uint32_t count) {
+  using Components = PointComponents<PointT>;
+  constexpr uint32_t kDimension = Components::kCount;
+  std::vector<PointT> points(count);
+  if (coefficients.empty() || count == 0) {
+    return points;
+  }
+  const uint32_t degree = static_cast<uint32_t>(coefficients.size()) - 1;
+  std::vector<double> plane(coefficients.size());
+  std::vector<double> coords(kDimension * count);
+  for (uint32_t c = 0; c < kDimension; ++c) {
+    for (size_t k = 0; k < coefficients.size(); ++k) {
+      plane[k] = coefficients[k].*Components::kMembers[c];
+    }
+    StepPolynomial(plane.data(), degree, t0, step, count, coords.data() + c,
+                   kDimension);
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t c = 0; c < kDimension; ++c) {
+      points[i].*Components::kMembers[c] = coords[(i * kDimension) + c];
+    }
+  }
+  return points;
+}
+
+// The points of a spline curve at the samples of plan. When rational the
+// control points are homogeneous, with the weight as their last coordinate.
+template <typename PointT, typename ControlT>
+std::vector<PointT> StepCurve(const SplineStepPlan &plan,
+                              const std::vector<ControlT> &control_points,
+                              bool rational) {
+  constexpr uint32_t kDimension = PointComponents<ControlT>::kCount;
+  constexpr uint32_t kWritten = PointComponents<PointT>::kCount;
+  std::vector<double> planes(kDimension * control_points.size());
+  const double *plane_starts[kDimension];
+  for (uint32_t c = 0; c < kDimension; ++c) {
+    double *plane = planes.data() + (c * control_points.size());
+    for (size_t j = 0; j < control_points.size(); ++j) {
+      plane[j] = control_points[j].*PointComponents<ControlT>::kMembers[c];
+    }
+    plane_starts[c] = plane;
+  }
+  std::vector<PointT> points(plan.size());
+  plan.Step(plane_starts, kDimension, rational,
+            [&](size_t first, uint32_t count, const double *coords) {
+              for (uint32_t s = 0; s < count; ++s) {
+                PointT &point = points[first + s];
+                for (uint32_t c = 0; c < kWritten; ++c) {
+                  point.*PointComponents<PointT>::kMembers[c] =
+                      coords[(s * SplineStepPlan::kMaxPlanes) + c];
+                }
+              }
+            });
+  return points;
+}
+
+// Points of a u_table.size() x v_plan.size() grid of a tensor product
+// surface. Each u sample contracts the net into the control points of its
+// isoparametric curve in v, which is then stepped with v_plan. Point (i, j)
+// goes to points[(i * v_plan.size()) + j]. A rational net is homogeneous.
+void StepGrid(const ControlNet<Point3D> &net, const knots::BasisTable &u_table,
+              const SplineStepPlan &v_plan, Point3D *points);
+void StepGrid(const ControlNet<Point4D> &net, bool rational,
+              const knots::BasisTable &u_table, const SplineStepPlan &v_plan,
+              Point3D *points);
+} // namespace forward
+} // namespace nurbs
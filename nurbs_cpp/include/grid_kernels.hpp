@@ -0,0 +1,48 @@
+#pragma once
+
+// NURBS
+#include "include/basis_table.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+
+namespace nurbs {
+namespace simd {
+// Instruction sets the grid kernels are built for, in increasing order
+enum class Level : uint32_t { kScalar = 0, kSSE2 = 1, kAVX2 = 2 };
+
+// Best level the running CPU supports, detected once
+Level Supported();
+// Level the kernels dispatch to, defaults to Supported()
+Level Active();
+// Forces the kernels down to level, clamped to Supported(). Meant for tests
+// and benchmarks, not thread safe against kernels running on other threads.
+void SetActive(Level level);
+const char *Name(Level level);
+
+// out[v] = sum over j of weights[j] * rows[(j * stride) + v], for v < length
+// and j < row_count. The sum starts at 0.0 and adds j in ascending order, each
+// product rounded on its own, so the results match the scalar evaluators.
+void WeightedRowSum(const double *weights, uint32_t row_count,
+                    const double *rows, size_t stride, size_t length,
+                    double *out);
+
+// out[s] = sum over i of table.value(i, s) * row[table.span(s) - degree + i]
+// for every sample of table, with the same summation order as WeightedRowSum.
+// A derivative above zero uses table.derivative(derivative, i, s) instead and
+// has to be at most table.derivatives().
+void ContractSamples(const knots::BasisTable &table, const double *row,
+                     double *out, uint32_t derivative = 0);
+
+// values[i] /= divisors[i] for i < count, the perspective divide of a row of
+// homogeneous points
+void Divide(double *values, const double *divisors, size_t count);
+
+// bases[(j * stride) + s] = basis j of the uniform cubic B-spline at local
+// parameter t[s], for j < 4 and s < count. Same bits as
+// knots::UniformCubicBasis.
+void UniformCubicBasis(const double *t, size_t count, double *bases,
+                       size_t stride);
+} // namespace simd
+} // namespace nurbs
@@ -0,0 +1,211 @@
+#pragma once
+
+// NURBS
+#include "include/point_types.hpp"
+
+// STD
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+namespace knots {
+// What a simplify pass removed, and a bound on how far it moved the geometry
+struct RemovalReport {
+  uint32_t knots_removed = 0;
+  size_t control_points_before = 0;
+  size_t control_points_after = 0;
+  // Sum of the removal errors A5.8 measured, scaled to model space. No point
+  // of the new geometry is further than this from the old one.
+  double error_bound = 0.0;
+
+  // Fraction of the control points that were removed
+  double ReductionRatio() const {
+    if (control_points_before == 0) {
+      return 0.0;
+    }
+    return static_cast<double>(control_points_before - control_points_after) /
+           static_cast<double>(control_points_before);
+  }
+};
+
+// The weight of a homogeneous point, (wx, wy, w) or (wx, wy, wz, w)
+inline double Weight(const Point3D &point) { return point.z; }
+inline double Weight(const Point4D &point) { return point.w; }
+// Distance of the projected point from the origin
+inline double ProjectedLength(const Point3D &point) {
+  return Length(Point2D(point.x, point.y) / point.z);
+}
+inline double ProjectedLength(const Point4D &point) {
+  return Length(Point3D(point.x, point.y, point.z) / point.w);
+}
+
+// A5.8 measures in homogeneous space. Moving the homogeneous points by d
+// moves the projected curve by at most d * (1 + |P|max) / wmin, Eq. (5.30)
+// p.185. Nonrational points move exactly as far as they do in homogeneous
+// space, their factor is 1.
+template <typename PointT>
+double HomogeneousScale(const PointT *points, size_t count) {
+  bool rational = false;
+  double w_min = 0.0;
+  double p_max = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    const double w = Weight(points[i]);
+    rational = rational || w != 1.0;
+    w_min = i == 0 ? w : std::min(w_min, w);
+    p_max = std::max(p_max, ProjectedLength(points[i]));
+  }
+  return rational ? (1.0 + p_max) / w_min : 1.0;
+}
+
+// ALGORITHM A5.8 RemoveCurveKnot(n, p, U, Pw, u, r, s, num, t) p.185, on the
+// knots and homogeneous control points of a curve. r is the index of the last
+// copy of the knot and s its multiplicity, at most num <= s copies go. Each
+// removal pass only goes ahead while error plus the distance it measures
+// stays within tolerance, and adds that distance to error. Returns t, the
+// number removed, and shrinks U and Pw by as much.
+template <typename PointT>
+int RemoveKnotInPlace(uint32_t degree, int r, int s, int num,
+                      double tolerance, std::vector<double> &U,
+                      std::vector<PointT> &Pw, double &error) {
+  const int p = static_cast<int>(degree);
+  const int n = static_cast<int>(Pw.size()) - 1;
+  const int m = n + p + 1;
+  const int ord = p + 1;
+  // Interior knots below full multiplicity only, the book assumes both
+  if (r <= p || r > n || s < 1 || s > p) {
+    return 0;
+  }
+  num = std::min(num, s);
+  const double u = U[r];
+  const int fout = ((2 * r) - s - p) / 2;  // First control point out
+  int first = r - p;
+  int last = r - s;
+
+  thread_local std::vector<PointT> temp;
+  temp.resize((2 * p) + 3);
+  int t = 0;
+  for (; t < num; ++t) {
+    // Diff in index between temp and P
+    const int off = first - 1;
+    temp[0] = Pw[off];
+    temp[last + 1 - off] = Pw[last + 1];
+    int i = first;
+    int j = last;
+    int ii = 1;
+    int jj = last - off;
+    while (j - i > t) {
+      // Compute new control points for one removal step
+      const double alfi = (u - U[i]) / (U[i + ord + t] - U[i]);
+      const double alfj = (u - U[j - t]) / (U[j + ord] - U[j - t]);
+      temp[ii] = (Pw[i] - ((1.0 - alfi) * temp[ii - 1])) / alfi;
+      temp[jj] = (Pw[j] - (alfj * temp[jj + 1])) / (1.0 - alfj);
+      ++i;
+      ++ii;
+      --j;
+      --jj;
+    }
+    // Check if knot removable
+    double distance = 0.0;
+    if (j - i < t) {
+      distance = Length(temp[ii - 1] - temp[jj + 1]);
+    } else {
+      const double alfi = (u - U[i]) / (U[i + ord + t] - U[i]);
+      distance = Length(Pw[i] - ((alfi * temp[ii + t + 1]) +
+                                 ((1.0 - alfi) * temp[ii - 1])));
+    }
+    if (error + distance > tolerance) {
+      // Cannot remove any more knots
+      break;
+    }
+    error += distance;
+    // Successful removal. Save new control points
+    i = first;
+    j = last;
+    while (j - i > t) {
+      Pw[i] = temp[i - off];
+      Pw[j] = temp[j - off];
+      ++i;
+      --j;
+    }
+    --first;
+    ++last;
+  }
+  if (t == 0) {
+    return 0;
+  }
+
+  // Shift knots
+  for (int k = r + 1; k <= m; ++k) {
+    U[k - t] = U[k];
+  }
+  // Pj thru Pi will be overwritten
+  int j = fout;
+  int i = j;
+  for (int k = 1; k < t; ++k) {
+    if (k % 2 == 1) {
+      ++i;
+    } else {
+      --j;
+    }
+  }
+  // Shift
+  for (int k = i + 1; k <= n; ++k) {
+    Pw[j] = Pw[k];
+    ++j;
+  }
+  U.resize(U.size() - t);
+  Pw.resize(Pw.size() - t);
+  return t;
+}
+
+// Index of the last copy of the interior knot u and its multiplicity, or -1
+// when u is not an interior knot. Knots are compared exactly.
+inline int FindRemovalKnot(uint32_t degree, const std::vector<double> &U,
+                           size_t point_count, double u, int &s) {
+  s = 0;
+  int r = -1;
+  for (size_t i = degree + 1; i < point_count; ++i) {
+    if (U[i] == u) {
+      r = static_cast<int>(i);
+      ++s;
+    }
+  }
+  return r;
+}
+
+// Removes interior knots one copy at a time, sweeping the knot vector until a
+// sweep removes nothing, as long as the summed errors stay within tolerance,
+// which is in homogeneous space. Returns the knots removed and adds the
+// errors to error.
+template <typename PointT>
+uint32_t SimplifyInPlace(uint32_t degree, double tolerance,
+                         std::vector<double> &U, std::vector<PointT> &Pw,
+                         double &error) {
+  uint32_t removed = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    // Interior knots are U[p + 1] to U[n]
+    size_t start = degree + 1;
+    while (start < Pw.size()) {
+      size_t r = start;
+      while (r + 1 < Pw.size() && U[r + 1] == U[r]) {
+        ++r;
+      }
+      const int s = static_cast<int>(r - start) + 1;
+      if (RemoveKnotInPlace(degree, static_cast<int>(r), s, 1, tolerance, U,
+                            Pw, error) == 0) {
+        start = r + 1;
+      } else {
+        // The run is one shorter, try it again
+        ++removed;
+        changed = true;
+      }
+    }
+  }
+  return removed;
+}
+} // namespace knots
+} // namespace nurbs
@@ -5,11 +5,39 @@
 
 namespace nurbs {
 namespace knots {
+// Reusable workspace for the basis function kernels. The buffers only grow, so
+// once a scratch has seen the largest degree in use the kernels below stop
+// touching the heap. bases and ders are never used by the kernels themselves,
+// they are spare output storage for callers that do not have their own.
+struct BasisScratch {
+  // Grows the buffers to fit a degree and a max derivative n
+  void Reserve(uint32_t degree, uint32_t n = 0);
+
+  std::vector<double> left;
+  std::vector<double> right;
+  // (degree + 1) x (degree + 1), row major
+  std::vector<double> ndu;
+  // 2 x (degree + 1), row major
+  std::vector<double> a;
+
+  std::vector<double> bases;
+  std::vector<double> ders;
+};
+
+// Scratch owned by the calling thread. Evaluators use slot 0 for the u
+// direction and slot 1 for the v direction so both can be live at once.
+BasisScratch &ThreadScratch(uint32_t slot = 0);
+
 // Returns the max index of u
 uint32_t FindSpanKnot(uint32_t degree, const std::vector<uint32_t> &knots,
                       uint32_t knot);
 uint32_t FindSpanParam(uint32_t degree, const std::vector<double> &knots,
                        double u, double tolerance);
+// Same result as FindSpanParam, but walks forward from a previously found
+// span. Meant for ascending parameters, falls back to the binary search when u
+// is behind span.
+uint32_t FindSpanParam(uint32_t degree, const std::vector<double> &knots,
+                       double u, double tolerance, uint32_t span);
 
 // Returns the start index of the provided knot
 uint32_t FindStartKnot(uint32_t degree, const std::vector<uint32_t> &knots,
@@ -21,10 +49,21 @@ std::vector<double> BasisFuns(uint32_t i, double u, uint32_t degree,
                               const std::vector<double> &knots,
                               double tolerance);
 
+// Writes the degree + 1 non-zero basis values into bases
+void BasisFuns(uint32_t i, double u, uint32_t degree,
+               const std::vector<double> &knots, double tolerance,
+               double *bases, BasisScratch &scratch);
+
 std::vector<std::vector<double>>
 DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
               const std::vector<double> &knots);
 
+// Writes (n + 1) x (degree + 1) values into ders, row k holds the kth
+// derivative of the degree + 1 non-zero basis functions
+void DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
+                   const std::vector<double> &knots, double *ders,
+                   BasisScratch &scratch);
+
 double OneBasisFun(uint32_t degree, const std::vector<double> &knots,
                    uint32_t i, double u);
 
@@ -36,13 +75,36 @@ std::vector<std::vector<double>> AllBasisFuns(uint32_t span, double u,
                                               uint32_t degree,
                                               const std::vector<double> &knots);
 
+// Writes (degree + 1) x (degree + 1) values into bases, where
+// bases[i * (degree + 1) + j] matches AllBasisFuns(...)[i][j]
+void AllBasisFuns(uint32_t span, double u, uint32_t degree,
+                  const std::vector<double> &knots, double *bases,
+                  BasisScratch &scratch);
+
 std::vector<std::vector<double>> BinomialCoefficients(uint32_t n, uint32_t k);
 
+// Binomial coefficient n over k, zero when k > n. Read from a table built
+// once for n up to kMaxBinomial, so it never allocates.
+constexpr uint32_t kMaxBinomial = 32;
+double Binomial(uint32_t n, uint32_t k);
+
 int MultiplicityKnotI(int32_t degree, const std::vector<uint32_t> &knots,
                            int knot);
 int MultiplicityKnotU(int32_t degree, const std::vector<uint32_t> &knots,
                            uint32_t knot);
 int MultiplicityParam(int32_t degree, const std::vector<double> &knots,
                            double param, double tolerance);
+
+// Returns the distinct knot values strictly inside (low, high) with low and
+// high added at the ends, the parameters between which a curve is one
+// polynomial piece
+std::vector<double> Breakpoints(const std::vector<double> &knots, double low,
+                                double high, double tolerance);
+
+// Returns the knot values the Bezier segments of ALGORITHM A5.6 start and end
+// at, in the order it emits them, so size() - 1 is the number of segments.
+// Runs of equal knots are compared exactly, as in A5.6.
+std::vector<double> DecomposeBreaks(uint32_t degree,
+                                    const std::vector<double> &knots);
 } // namespace knots
 } // namespace nurbs
\ No newline at end of file
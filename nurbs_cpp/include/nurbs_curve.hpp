@@ -4,8 +4,16 @@
 #include "curve_3d.hpp"
 
 #include "bezier_curve.hpp"
+#include "bezier_set.hpp"
+#include "degree_change.hpp"
+#include "knot_removal.hpp"
+#include "power_basis_curve.hpp"
+#include "span_locator.hpp"
+#include "uniform_cubic.hpp"
 
 namespace nurbs {
+class ThreadPool;
+
 // Non-Uniform Rational B-Spline Curves
 class NURBSCurve2D : public Curve2D {
  public:
@@ -16,7 +24,19 @@ class NURBSCurve2D : public Curve2D {
 
   Point2D EvaluateCurve(double parameter) const override;
 
+  void EvaluateCurveBatch(const double *params, size_t count,
+                          Point2D *points) const override;
+
+  // Forward differences of the homogeneous curve over each knot span, or
+  // EvaluateCurvePoints when the spans get too few samples
+  std::vector<Point2D> StepCurvePoints(uint32_t point_count) const override;
+
+  std::vector<double> Breakpoints() const override;
+
   std::vector<Point2D> EvaluateDerivative(double parameter, uint32_t d) const;
+  // EvaluateDerivative without allocating. Writes the min(d, degree) + 1
+  // derivatives into ck and returns how many were written.
+  uint32_t EvaluateDerivative(double parameter, uint32_t d, Point2D *ck) const;
 
   // Method to insert a knot multiple times into the curve and get the resulting
   // curve
@@ -38,9 +58,45 @@ class NURBSCurve2D : public Curve2D {
   // curve Returns: A copy of the curve with the merged in knot vector
   NURBSCurve2D MergeKnotVect(std::vector<double> knots) const;
 
+  // KnotInsertion and MergeKnotVect on this curve. The knots and control
+  // points grow once and the algorithms run in them, with no copies.
+  void InsertKnots(double knot, uint32_t times);
+  void Refine(const std::vector<double> &knots);
+
+  // KnotInsertion and MergeKnotVect into out, which keeps its storage between
+  // calls, so refinement loops reuse one destination curve. knots must not be
+  // out's own knot vector.
+  void InsertKnotsInto(double knot, uint32_t times, NURBSCurve2D &out) const;
+  void RefineInto(const std::vector<double> &knots, NURBSCurve2D &out) const;
+
+  // ALGORITHM A5.8 RemoveCurveKnot: removes up to times copies of the
+  // interior knot, as long as the curve moves by no more than tolerance.
+  // Returns how many copies were removed.
+  uint32_t RemoveKnots(double knot, uint32_t times, double tolerance);
+  // A copy of the curve with the knot removed as RemoveKnots does
+  NURBSCurve2D KnotRemoval(double knot, uint32_t times,
+                           double tolerance) const;
+  // Removes every interior knot it can while the curve stays within
+  // tolerance of the one it was, for over refined imports
+  knots::RemovalReport Simplify(double tolerance);
+
+  // ALGORITHM A5.9 DegreeElevateCurve: raises the degree by t without
+  // changing the curve. Every distinct knot gets t more copies.
+  void ElevateDegree(uint32_t t);
+  // A copy of the curve with the degree raised as ElevateDegree does
+  NURBSCurve2D DegreeElevation(uint32_t t) const;
+  // ALGORITHM A5.11 DegreeReduceCurve: lowers the degree by one when the
+  // curve moves by no more than tolerance, and leaves it as it was otherwise
+  degree::ReductionReport ReduceDegree(double tolerance);
+
   // Decompose the NURBS curve into bezier segments
   std::vector<BezierCurve2D> Decompose() const;
 
+  // The curve as one homogeneous power basis polynomial per knot span, for
+  // curves evaluated many more times than they change
+  PiecewisePowerBasisCurve2D ToPowerBasis() const;
+
+  uint32_t degree() const { return degree_; }
   const std::vector<double> &knots() const { return knots_; }
   const std::vector<Point3D> &control_points() const { return control_points_; }
 
@@ -48,6 +104,11 @@ class NURBSCurve2D : public Curve2D {
   uint32_t degree_;
   std::vector<double> knots_;
   std::vector<Point3D> control_points_;
+  knots::SpanLocator span_locator_;
+  knots::UniformCubicSpans uniform_spans_;
+
+  // Rebuilds span_locator_ and uniform_spans_ after the knots change
+  void UpdateSpans();
 };
 
 class NURBSCurve3D : public Curve3D {
@@ -59,7 +120,19 @@ class NURBSCurve3D : public Curve3D {
 
   Point3D EvaluateCurve(double parameter) const override;
 
+  void EvaluateCurveBatch(const double *params, size_t count,
+                          Point3D *points) const override;
+
+  // Forward differences of the homogeneous curve over each knot span, or
+  // EvaluateCurvePoints when the spans get too few samples
+  std::vector<Point3D> StepCurvePoints(uint32_t point_count) const override;
+
+  std::vector<double> Breakpoints() const override;
+
   std::vector<Point3D> EvaluateDerivative(double parameter, uint32_t d) const;
+  // EvaluateDerivative without allocating. Writes the min(d, degree) + 1
+  // derivatives into ck and returns how many were written.
+  uint32_t EvaluateDerivative(double parameter, uint32_t d, Point3D *ck) const;
 
   // Method to insert a knot multiple times into the curve and get the resulting
   // curve
@@ -81,9 +154,48 @@ class NURBSCurve3D : public Curve3D {
   // curve Returns: A copy of the curve with the merged in knot vector
   NURBSCurve3D MergeKnotVect(std::vector<double> knots) const;
 
+  // KnotInsertion and MergeKnotVect on this curve. The knots and control
+  // points grow once and the algorithms run in them, with no copies.
+  void InsertKnots(double knot, uint32_t times);
+  void Refine(const std::vector<double> &knots);
+
+  // KnotInsertion and MergeKnotVect into out, which keeps its storage between
+  // calls, so refinement loops reuse one destination curve. knots must not be
+  // out's own knot vector.
+  void InsertKnotsInto(double knot, uint32_t times, NURBSCurve3D &out) const;
+  void RefineInto(const std::vector<double> &knots, NURBSCurve3D &out) const;
+
+  // ALGORITHM A5.8 RemoveCurveKnot: removes up to times copies of the
+  // interior knot, as long as the curve moves by no more than tolerance.
+  // Returns how many copies were removed.
+  uint32_t RemoveKnots(double knot, uint32_t times, double tolerance);
+  // A copy of the curve with the knot removed as RemoveKnots does
+  NURBSCurve3D KnotRemoval(double knot, uint32_t times,
+                           double tolerance) const;
+  // Removes every interior knot it can while the curve stays within
+  // tolerance of the one it was, for over refined imports
+  knots::RemovalReport Simplify(double tolerance);
+
+  // ALGORITHM A5.9 DegreeElevateCurve: raises the degree by t without
+  // changing the curve. Every distinct knot gets t more copies.
+  void ElevateDegree(uint32_t t);
+  // A copy of the curve with the degree raised as ElevateDegree does
+  NURBSCurve3D DegreeElevation(uint32_t t) const;
+  // ALGORITHM A5.11 DegreeReduceCurve: lowers the degree by one when the
+  // curve moves by no more than tolerance, and leaves it as it was otherwise
+  degree::ReductionReport ReduceDegree(double tolerance);
+
   // Decompose the NURBS curve into bezier segments
   std::vector<BezierCurve3D> Decompose() const;
+  // Decompose into the arena of out, keeping the weights. out keeps its
+  // storage between calls.
+  void Decompose(BezierSegmentSet &out) const;
 
+  // The curve as one homogeneous power basis polynomial per knot span, for
+  // curves evaluated many more times than they change
+  PiecewisePowerBasisCurve3D ToPowerBasis() const;
+
+  uint32_t degree() const { return degree_; }
   const std::vector<double> &knots() const { return knots_; }
   const std::vector<Point4D> &control_points() const { return control_points_; }
 
@@ -91,5 +203,18 @@ class NURBSCurve3D : public Curve3D {
   uint32_t degree_;
   std::vector<double> knots_;
   std::vector<Point4D> control_points_;
+  knots::SpanLocator span_locator_;
+  knots::UniformCubicSpans uniform_spans_;
+
+  // Rebuilds span_locator_ and uniform_spans_ after the knots change
+  void UpdateSpans();
 };
+
+// Raises every curve to the highest degree among them and merges their knot
+// vectors, each knot with the most copies any curve has, so all of them end
+// up with the same degree and knots, as skinning and lofting need. The curves
+// must share their first and last knot. Given a pool the curves are split
+// between its threads.
+void MakeCompatible(NURBSCurve3D *curves, size_t count,
+                    ThreadPool *pool = nullptr);
 }  // namespace nurbs
\ No newline at end of file
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "include/bezier_set.hpp"
 #include "include/bezier_surface.hpp"
+#include "include/control_net.hpp"
+#include "include/degree_change.hpp"
+#include "include/knot_removal.hpp"
+#include "include/span_locator.hpp"
+#include "include/uniform_cubic.hpp"
 #include "include/surface.hpp"
 
 // STD
@@ -8,6 +14,8 @@
 #include <functional>
 
 namespace nurbs {
+class ThreadPool;
+
 class NURBSSurface : public Surface {
 public:
   static constexpr double kTolerance = std::numeric_limits<double>::epsilon();
@@ -17,37 +25,106 @@ public:
                std::vector<std::vector<Point4D>> control_polygon,
                Point2D u_interval = {0.0, 1.0},
                Point2D v_interval = {0.0, 1.0});
+  NURBSSurface(uint32_t u_degree, uint32_t v_degree,
+               std::vector<double> u_knots, std::vector<double> v_knots,
+               ControlNet<Point4D> control_polygon,
+               Point2D u_interval = {0.0, 1.0},
+               Point2D v_interval = {0.0, 1.0});
 
   Point3D EvaluatePoint(Point2D uv) const override;
 
-  /* std::vector<Point3D> EvaluatePoints(
-       uint32_t u_sample_count, uint32_t v_sample_count) const override;*/
+  void EvaluateGrid(const double *u_params, size_t u_count,
+                    const double *v_params, size_t v_count,
+                    Point3D *points) const override;
+  void EvaluateGridFloat(const double *u_params, size_t u_count,
+                         const double *v_params, size_t v_count,
+                         float *positions) const override;
+  void EvaluateGridDerivatives(const double *u_params, size_t u_count,
+                               const double *v_params, size_t v_count,
+                               bool second_partials,
+                               GridDerivatives &grid) const override;
+
+  // Rows of constant u stepped along v over each v knot span, or
+  // EvaluatePoints when the v spans get too few samples
+  std::vector<Point3D> StepPoints(uint32_t u_sample_count,
+                                  uint32_t v_sample_count) const override;
+
   std::vector<std::vector<Point3D>>
-  Derivatives(Point2D uv, uint32_t max_derivative) const;
+  Derivatives(Point2D uv, uint32_t max_derivative) const override;
+  // Derivatives without allocating: skl[(k * (max_derivative + 1)) + l] is
+  // SKL[k][l], and skl needs room for (max_derivative + 1)^2 points. Entries
+  // with k + l > max_derivative are zero.
+  void Derivatives(Point2D uv, uint32_t max_derivative, Point3D *skl) const;
 
+  // The knot operations below run the same steps on every row or column of
+  // the control net. Given a pool they split the rows or columns between its
+  // threads, the results are the same bits for every thread count.
   enum SurfaceDirection { kUDir, kVDir };
-  NURBSSurface KnotInsert(SurfaceDirection dir, double knot, int times) const;
+  NURBSSurface KnotInsert(SurfaceDirection dir, double knot, int times,
+                          ThreadPool *pool = nullptr) const;
+
+  NURBSSurface RefineKnotVect(std::vector<double> knots, SurfaceDirection dir,
+                              ThreadPool *pool = nullptr) const;
 
-  NURBSSurface RefineKnotVect(std::vector<double> knots, SurfaceDirection dir) const;
+  // ALGORITHM A5.8 on every row or column of the net: removes up to times
+  // copies of the interior knot, each only when it comes out of all of them
+  // and the surface moves by no more than tolerance
+  NURBSSurface KnotRemove(SurfaceDirection dir, double knot, int times,
+                          double tolerance) const;
+  // Removes every interior knot in u and v it can while the surface stays
+  // within tolerance of this one. report, when given, gets what was removed
+  // and the error bound.
+  NURBSSurface Simplify(double tolerance,
+                        knots::RemovalReport *report = nullptr) const;
 
-  std::vector<NURBSSurface> DecomposeU() const;
-  std::vector<BezierSurface> DecomposeV() const;
+  // ALGORITHM A5.9 on every row or column of the net: raises the degree in
+  // dir by t without changing the surface
+  NURBSSurface DegreeElevate(SurfaceDirection dir, uint32_t t,
+                             ThreadPool *pool = nullptr) const;
+  // ALGORITHM A5.11 on every row or column of the net: lowers the degree in
+  // dir by one when none of them moves by more than tolerance, and returns a
+  // copy of this surface otherwise. report, when given, gets whether it went
+  // through and the error bound.
+  NURBSSurface DegreeReduce(SurfaceDirection dir, double tolerance,
+                            degree::ReductionReport *report = nullptr,
+                            ThreadPool *pool = nullptr) const;
 
-  std::vector<std::vector<BezierSurface>> Decompose() const;
+  std::vector<NURBSSurface> DecomposeU(ThreadPool *pool = nullptr) const;
+  std::vector<BezierSurface> DecomposeV(ThreadPool *pool = nullptr) const;
 
+  std::vector<std::vector<BezierSurface>>
+  Decompose(ThreadPool *pool = nullptr) const;
+  // Decompose into the patch grid of out, with no allocation per patch. out
+  // keeps its storage between calls.
+  void Decompose(BezierPatchSet &out, ThreadPool *pool = nullptr) const;
+
+  uint32_t u_degree() const { return u_degree_; }
+  uint32_t v_degree() const { return v_degree_; }
   const std::vector<double> &u_knots() const { return u_knots_; }
   const std::vector<double> &v_knots() const { return v_knots_; }
 
-  const std::vector<std::vector<Point4D>>& control_polygon() const {
+  const ControlNet<Point4D>& control_polygon() const {
     return control_polygon_;
   }
 
   private:
+    // Evaluates the grid a u sample at a time, emit_row gets the sample index
+    // and the x, y and z rows of the projected points
+    void EvaluateGridRows(
+        const double *u_params, size_t u_count, const double *v_params,
+        size_t v_count,
+        const std::function<void(size_t, const double *const *)> &emit_row)
+        const;
+
     uint32_t u_degree_;
     uint32_t v_degree_;
     std::vector<double> u_knots_;
     std::vector<double> v_knots_;
-    std::vector<std::vector<Point4D>> control_polygon_;
+    ControlNet<Point4D> control_polygon_;
+    knots::SpanLocator u_span_locator_;
+    knots::SpanLocator v_span_locator_;
+    knots::UniformCubicSpans u_uniform_spans_;
+    knots::UniformCubicSpans v_uniform_spans_;
 
     Point2D u_internal_interval_;
     Point2D v_internal_interval_;
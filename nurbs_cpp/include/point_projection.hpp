@@ -0,0 +1,133 @@
+#pragma once
+
+// NURBS
+#include "include/bezier_set.hpp"
+#include "include/nurbs_curve.hpp"
+#include "include/nurbs_surface.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+class ThreadPool;
+
+// How the Newton iteration of a projection stopped
+enum class ProjectionStatus {
+  // The point is on the geometry, within point_tolerance, the point
+  // inversion case
+  kCoincident,
+  // The zero cosine test passed, or the parameter stopped moving, Eq. (6.4)
+  // p.231. At a parameter bound this is the closest point of the boundary.
+  kConverged,
+  // Out of iterations. The result is the closest point the iteration found,
+  // which is never further than the best seed.
+  kMaxIterations
+};
+
+struct CurveProjection {
+  double parameter = 0.0;
+  Point3D point;
+  double distance = 0.0;
+  uint32_t iterations = 0;
+  ProjectionStatus status = ProjectionStatus::kMaxIterations;
+};
+
+struct SurfaceProjection {
+  Point2D uv;
+  Point3D point;
+  double distance = 0.0;
+  uint32_t iterations = 0;
+  ProjectionStatus status = ProjectionStatus::kMaxIterations;
+};
+
+// Tolerances and seeding of the projectors
+struct ProjectionOptions {
+  // Epsilon 1 of Eq. (6.4): distance in model units under which the point is
+  // on the geometry, and under which a Newton step no longer moves it
+  double point_tolerance = 1e-9;
+  // Epsilon 2: cosine between the derivatives and C - P under which they
+  // count as perpendicular
+  double cosine_tolerance = 1e-9;
+  uint32_t max_iterations = 32;
+  // Seed samples along every Bezier segment, or both ways on every patch
+  uint32_t samples_per_segment = 8;
+};
+
+// Closest points on a curve, the Newton iteration of Eq. (6.3) p.230. The
+// curve is decomposed once into Bezier segments and sampled along each of
+// them. A query scans the samples of the segments whose control hull box
+// could hold something closer than the best sample so far, then runs Newton
+// from the best one. Every step is damped until it gets closer, so the
+// result is never further than the seed. Parameters are clamped to the
+// curve's interval, a closed curve is treated as open. Queries only read the
+// projector, any number of threads can run them at once.
+class CurveProjector {
+public:
+  // Points per pool task in the batch projections
+  static constexpr size_t kPointsPerTask = 256;
+
+  explicit CurveProjector(const NURBSCurve3D &curve,
+                          const ProjectionOptions &options = {});
+
+  CurveProjection Project(const Point3D &point) const;
+  // Newton from parameter, skipping the seed search. For points known to be
+  // near a parameter, like the previous scan point of a sweep.
+  CurveProjection Project(const Point3D &point, double parameter) const;
+  // Project for every point, split between the threads of pool when given.
+  // Each result is the same as a Project call gives.
+  void Project(const Point3D *points, size_t count, CurveProjection *results,
+               ThreadPool *pool = nullptr) const;
+
+  const NURBSCurve3D &curve() const { return curve_; }
+  const ProjectionOptions &options() const { return options_; }
+
+private:
+  // Parameter of the closest sample
+  double Seed(const Point3D &point) const;
+
+  NURBSCurve3D curve_;
+  ProjectionOptions options_;
+  // Box of segment k
+  std::vector<ControlHullBounds> bounds_;
+  // Samples of segment k are k * samples_per_segment to
+  // (k + 1) * samples_per_segment, neighbours share their end sample
+  std::vector<double> sample_params_;
+  std::vector<Point3D> sample_points_;
+};
+
+// Closest points on a surface, the Newton iteration of Eqs. (6.6) and (6.7)
+// p.232, seeded the same way as CurveProjector from the Bezier patches and a
+// sample grid over each of them
+class SurfaceProjector {
+public:
+  static constexpr size_t kPointsPerTask = 256;
+
+  explicit SurfaceProjector(const NURBSSurface &surface,
+                            const ProjectionOptions &options = {});
+
+  SurfaceProjection Project(const Point3D &point) const;
+  SurfaceProjection Project(const Point3D &point, Point2D uv) const;
+  void Project(const Point3D *points, size_t count,
+               SurfaceProjection *results, ThreadPool *pool = nullptr) const;
+
+  const NURBSSurface &surface() const { return surface_; }
+  const ProjectionOptions &options() const { return options_; }
+
+private:
+  Point2D Seed(const Point3D &point) const;
+
+  NURBSSurface surface_;
+  ProjectionOptions options_;
+  // Box of patch (i, j) at (i * v_count) + j
+  std::vector<ControlHullBounds> bounds_;
+  size_t u_count_ = 0;
+  size_t v_count_ = 0;
+  // Samples of patch (i, j) are rows i * samples_per_segment to
+  // (i + 1) * samples_per_segment and the same columns in j of the grid
+  std::vector<double> u_params_;
+  std::vector<double> v_params_;
+  std::vector<Point3D> grid_;
+};
+} // namespace nurbs
@@ -122,4 +122,13 @@ static Point4D operator*(double lhs, const Point4D &rhs) {
 static Point4D operator/(double lhs, const Point4D &rhs) {
   return {lhs / rhs.x, lhs / rhs.y, lhs / rhs.z, lhs / rhs.w};
 }
+
+// Vector helpers
+double Dot(const Point2D &lhs, const Point2D &rhs);
+double Dot(const Point3D &lhs, const Point3D &rhs);
+double Dot(const Point4D &lhs, const Point4D &rhs);
+Point3D Cross(const Point3D &lhs, const Point3D &rhs);
+double Length(const Point2D &point);
+double Length(const Point3D &point);
+double Length(const Point4D &point);
 } // namespace nurbs
\ No newline at end of file
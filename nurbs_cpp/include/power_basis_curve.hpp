@@ -1,7 +1,16 @@
 #pragma once
 
+#include "bezier_curve.hpp"
+#include "control_net.hpp"
 #include "curve_2d.hpp"
 #include "curve_3d.hpp"
+#include "span_locator.hpp"
+
+// STD
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace nurbs {
 class PowerBasisCurve2D : public Curve2D {
@@ -11,6 +20,9 @@ class PowerBasisCurve2D : public Curve2D {
 
     Point2D EvaluateCurve(double u) const override;
 
+    // Forward differences of the bases over the interval
+    std::vector<Point2D> StepCurvePoints(uint32_t point_count) const override;
+
    private:
     Point2D Horner(double u) const;
 
@@ -24,9 +36,163 @@ class PowerBasisCurve3D : public Curve3D {
 
     Point3D EvaluateCurve(double u) const override;
 
+    // Forward differences of the bases over the interval
+    std::vector<Point3D> StepCurvePoints(uint32_t point_count) const override;
+
    private:
     Point3D Horner(double u) const;
 
     std::vector<Point3D> bases_;
 };
+
+// Piecewise polynomial curves, one power basis polynomial per knot span of
+// the spline they were compiled from. The coefficients of a span are stored
+// together, coefficient k of span s being the degree + 1 coordinates at
+// coefficients()[((s * (degree + 1)) + k) * planes()], in the parameter
+// u - breakpoints()[s]. A rational curve keeps homogeneous coefficients, the
+// weight last. Evaluating is one span lookup and one Horner pass.
+class PiecewisePowerBasisCurve2D : public Curve2D {
+   public:
+    PiecewisePowerBasisCurve2D(uint32_t degree, std::vector<double> breakpoints,
+                               std::vector<double> coefficients, bool rational,
+                               Point2D interval = {0.0, 1.0});
+
+    Point2D EvaluateCurve(double u) const override;
+
+    // Walks the spans forward for ascending parameters
+    void EvaluateCurveBatch(const double *params, size_t count,
+                            Point2D *points) const override;
+
+    std::vector<double> Breakpoints() const override;
+
+    uint32_t degree() const { return degree_; }
+    bool rational() const { return rational_; }
+    uint32_t planes() const { return rational_ ? 3 : 2; }
+    size_t span_count() const {
+        return breakpoints_.empty() ? 0 : breakpoints_.size() - 1;
+    }
+    const std::vector<double> &breakpoints() const { return breakpoints_; }
+    const std::vector<double> &coefficients() const { return coefficients_; }
+
+   private:
+    Point2D Horner(size_t span, double u) const;
+
+    uint32_t degree_;
+    bool rational_;
+    std::vector<double> breakpoints_;
+    std::vector<double> coefficients_;
+    knots::SpanLocator span_locator_;
+};
+
+class PiecewisePowerBasisCurve3D : public Curve3D {
+   public:
+    PiecewisePowerBasisCurve3D(uint32_t degree, std::vector<double> breakpoints,
+                               std::vector<double> coefficients, bool rational,
+                               Point2D interval = {0.0, 1.0});
+
+    Point3D EvaluateCurve(double u) const override;
+
+    // Walks the spans forward for ascending parameters
+    void EvaluateCurveBatch(const double *params, size_t count,
+                            Point3D *points) const override;
+
+    std::vector<double> Breakpoints() const override;
+
+    uint32_t degree() const { return degree_; }
+    bool rational() const { return rational_; }
+    uint32_t planes() const { return rational_ ? 4 : 3; }
+    size_t span_count() const {
+        return breakpoints_.empty() ? 0 : breakpoints_.size() - 1;
+    }
+    const std::vector<double> &breakpoints() const { return breakpoints_; }
+    const std::vector<double> &coefficients() const { return coefficients_; }
+
+   private:
+    Point3D Horner(size_t span, double u) const;
+
+    uint32_t degree_;
+    bool rational_;
+    std::vector<double> breakpoints_;
+    std::vector<double> coefficients_;
+    knots::SpanLocator span_locator_;
+};
+
+// Chapter 5, ALGORITHM A5.6 DecomposeCurve(n, p, U, Pw, nb, Qw) p.173, with
+// every Bezier segment turned into power basis form as it completes, see
+// BezierCurveUtil::PowerBasis. Writes the knots bounding the segments into
+// breakpoints and the coefficients of the segments, laid out like
+// PiecewisePowerBasisCurve3D::coefficients(), into coefficients. Homogeneous
+// control points give homogeneous coefficients.
+template <typename PointT>
+void CompilePowerBasis(uint32_t degree, const std::vector<double> &knots,
+                       const std::vector<PointT> &control_points,
+                       std::vector<double> &breakpoints,
+                       std::vector<double> &coefficients) {
+    using Components = PointComponents<PointT>;
+    breakpoints.clear();
+    coefficients.clear();
+    if (control_points.size() < degree + 1 ||
+        knots.size() != control_points.size() + degree + 1) {
+        return;
+    }
+    const int p = static_cast<int>(degree);
+    const int m = static_cast<int>(knots.size()) - 1;
+    std::vector<PointT> segment(control_points.begin(),
+                                control_points.begin() + p + 1);
+    std::vector<PointT> next(p + 1);
+    std::vector<double> alphas(p + 1, 0.0);
+    auto append = [&](double length) {
+        // Bezier points are over [0, 1], the span is length long
+        const std::vector<PointT> bases = BezierCurveUtil::PowerBasis(segment);
+        double scale = 1.0;
+        for (const PointT &basis : bases) {
+            for (uint32_t c = 0; c < Components::kCount; ++c) {
+                coefficients.push_back((basis.*Components::kMembers[c]) *
+                                       scale);
+            }
+            scale /= length;
+        }
+    };
+
+    int a = p;
+    int b = p + 1;
+    breakpoints.push_back(knots[a]);
+    while (b < m) {
+        int i = b;
+        while (b < m && knots[b + 1] == knots[b]) {
+            ++b;
+        }
+        int mult = b - i + 1;
+        if (mult < p) {
+            double numer = knots[b] - knots[a];
+            for (int j = p; j > mult; --j) {
+                alphas[j - mult - 1] = numer / (knots[a + j] - knots[a]);
+            }
+            int r = p - mult;
+            for (int j = 1; j <= r; ++j) {
+                int save = r - j;
+                int s = mult + j;
+                for (int k = p; k >= s; --k) {
+                    double alpha = alphas[k - s];
+                    segment[k] =
+                        (alpha * segment[k]) + ((1.0 - alpha) * segment[k - 1]);
+                }
+                if (b < m) {
+                    next[save] = segment[p];
+                }
+            }
+        }
+        append(knots[b] - knots[a]);
+        breakpoints.push_back(knots[b]);
+
+        if (b < m) {
+            segment.swap(next);
+            for (i = std::max(p - mult, 0); i <= p; ++i) {
+                segment[i] = control_points[b - p + i];
+            }
+            a = b;
+            b = b + 1;
+        }
+    }
+}
 }  // namespace nurbs
\ No newline at end of file
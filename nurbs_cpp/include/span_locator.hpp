@@ -0,0 +1,87 @@
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+namespace knots {
+// Constant time FindSpanParam for one knot vector. The knot vector is
+// classified when the locator is built: a uniform interior maps a parameter
+// straight to its span, any other knot vector gets a table of the span at the
+// start of equal width buckets. Either guess is then walked to the span the
+// binary search would land on, comparing against the same knot - tolerance
+// values, so the results are identical, repeated knots and both ends
+// included. The walk is a step or two unless the knots cluster far more
+// tightly than the buckets.
+class SpanLocator {
+public:
+  enum class Kind : uint32_t { kUniform, kBucketed };
+
+  SpanLocator() = default;
+  // knots has to hold at least degree + 2 values, like FindSpanParam needs
+  SpanLocator(uint32_t degree, const std::vector<double> &knots,
+              double tolerance) {
+    Reset(degree, knots, tolerance);
+  }
+
+  // Rebuilds the locator for a new knot vector, reusing its tables
+  void Reset(uint32_t degree, const std::vector<double> &knots,
+             double tolerance);
+
+  // Same span as FindSpanParam(degree, knots, u, tolerance)
+  uint32_t Find(double u) const {
+    if (u >= end_) {
+      return last_span_;
+    }
+    if (u <= start_) {
+      return degree_;
+    }
+    uint32_t span = Guess(u);
+    // thresholds_[i] is knots[degree + i] - tolerance
+    while (u < thresholds_[span - degree_]) {
+      --span;
+    }
+    while (u >= thresholds_[span - degree_ + 1]) {
+      ++span;
+    }
+    return span;
+  }
+
+  Kind kind() const { return kind_; }
+
+private:
+  uint32_t Guess(double u) const {
+    double index = (u - origin_) * inverse_width_;
+    // Also sends NaN to the first bucket
+    if (!(index > 0.0)) {
+      index = 0.0;
+    }
+    if (index > last_bucket_) {
+      index = last_bucket_;
+    }
+    const size_t bucket = static_cast<size_t>(index);
+    if (kind_ == Kind::kUniform) {
+      return degree_ + static_cast<uint32_t>(bucket);
+    }
+    return buckets_[bucket];
+  }
+
+  Kind kind_ = Kind::kBucketed;
+  uint32_t degree_ = 0;
+  uint32_t last_span_ = 0;
+  // knots[degree] + tolerance and knots[last_span + 1] - tolerance, the end
+  // conditions of FindSpanParam
+  double start_ = 0.0;
+  double end_ = 0.0;
+  double origin_ = 0.0;
+  double inverse_width_ = 0.0;
+  // Buckets are one span wide on average, the last one is span count - 1
+  double last_bucket_ = 0.0;
+  std::vector<double> thresholds_;
+  // Span at the start of each bucket, empty when uniform
+  std::vector<uint32_t> buckets_;
+};
+} // namespace knots
+} // namespace nurbs
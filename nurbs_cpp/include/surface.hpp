@@ -4,32 +4,170 @@
 #include "include/point_types.hpp"
 
 // STD
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <vector>
 
 namespace nurbs {
+// Output of Surface::EvaluateGridDerivatives. Sample (i, j) of a u_count x
+// v_count grid is at (i * v_count) + j of every buffer.
+struct GridDerivatives {
+  std::vector<Point3D> points;
+  // S_u and S_v
+  std::vector<Point3D> u_partials;
+  std::vector<Point3D> v_partials;
+  // Unit S_u x S_v, see Surface::Normal for degenerate points
+  std::vector<Point3D> normals;
+  // S_uu, S_uv and S_vv, left empty unless second partials are asked for
+  std::vector<Point3D> uu_partials;
+  std::vector<Point3D> uv_partials;
+  std::vector<Point3D> vv_partials;
+
+  void Resize(size_t count, bool second_partials) {
+    const size_t second_count = second_partials ? count : 0;
+    points.resize(count);
+    u_partials.resize(count);
+    v_partials.resize(count);
+    normals.resize(count);
+    uu_partials.resize(second_count);
+    uv_partials.resize(second_count);
+    vv_partials.resize(second_count);
+  }
+};
+
 class Surface {
 public:
   Surface(Point2D u_interval = {0.0, 1.0}, Point2D v_interval = {0.0, 1.0})
       : u_interval_(u_interval), v_interval_(v_interval) {}
 
   virtual Point3D EvaluatePoint(Point2D uv) const { return {0, 0, 0}; }
+  // derivs[k][l] is the derivative k times in u and l times in v at uv, for
+  // k + l <= max_derivative, like SKL in ALGORITHM A3.6. The default only has
+  // EvaluatePoint to work with, so it returns the point and central
+  // difference first partials and leaves higher orders at zero.
+  virtual std::vector<std::vector<Point3D>>
+  Derivatives(Point2D uv, uint32_t max_derivative) const {
+    std::vector<std::vector<Point3D>> derivs(
+        max_derivative + 1, std::vector<Point3D>(max_derivative + 1));
+    derivs[0][0] = EvaluatePoint(uv);
+    if (max_derivative == 0) {
+      return derivs;
+    }
+    const double u_step = (u_interval_.y - u_interval_.x) * 1e-6;
+    const double u_low = std::max(uv.x - u_step, u_interval_.x);
+    const double u_high = std::min(uv.x + u_step, u_interval_.y);
+    derivs[1][0] = (EvaluatePoint({u_high, uv.y}) -
+                    EvaluatePoint({u_low, uv.y})) /
+                   (u_high - u_low);
+    const double v_step = (v_interval_.y - v_interval_.x) * 1e-6;
+    const double v_low = std::max(uv.y - v_step, v_interval_.x);
+    const double v_high = std::min(uv.y + v_step, v_interval_.y);
+    derivs[0][1] = (EvaluatePoint({uv.x, v_high}) -
+                    EvaluatePoint({uv.x, v_low})) /
+                   (v_high - v_low);
+    return derivs;
+  }
+
+  // Evaluates every (u_params[i], v_params[j]) pair into
+  // points[(i * v_count) + j]. Parameters can be in any order, but
+  // implementations may share basis work along a row or walk the knot spans,
+  // so ascending input is the fast path.
+  virtual void EvaluateGrid(const double *u_params, size_t u_count,
+                            const double *v_params, size_t v_count,
+                            Point3D *points) const {
+    for (size_t i = 0; i < u_count; ++i) {
+      Point2D uv = {u_params[i], 0};
+      for (size_t j = 0; j < v_count; ++j) {
+        uv.y = v_params[j];
+        points[(i * v_count) + j] = EvaluatePoint(uv);
+      }
+    }
+  }
+
+  // Positions, first partials and unit normals of every (u_params[i],
+  // v_params[j]) pair, plus the second partials when second_partials is set.
+  // The default goes through Derivatives a sample at a time, surfaces with
+  // basis functions override it to share the basis derivatives of each row
+  // and column across the grid.
+  virtual void EvaluateGridDerivatives(const double *u_params, size_t u_count,
+                                       const double *v_params, size_t v_count,
+                                       bool second_partials,
+                                       GridDerivatives &grid) const {
+    grid.Resize(u_count * v_count, second_partials);
+    const uint32_t max_derivative = second_partials ? 2 : 1;
+    for (size_t i = 0; i < u_count; ++i) {
+      for (size_t j = 0; j < v_count; ++j) {
+        const size_t index = (i * v_count) + j;
+        std::vector<std::vector<Point3D>> derivs =
+            Derivatives({u_params[i], v_params[j]}, max_derivative);
+        grid.points[index] = derivs[0][0];
+        grid.u_partials[index] = derivs[1][0];
+        grid.v_partials[index] = derivs[0][1];
+        if (second_partials) {
+          grid.uu_partials[index] = derivs[2][0];
+          grid.uv_partials[index] = derivs[1][1];
+          grid.vv_partials[index] = derivs[0][2];
+        }
+      }
+    }
+    FillNormals(u_params, u_count, v_params, v_count, grid);
+  }
+
+  // Unit S_u x S_v at uv. Where the partials vanish or are parallel, like at
+  // the pole of a sphere, the normal is taken a small step into the domain,
+  // and it is zero if that is degenerate as well.
+  Point3D Normal(Point2D uv) const {
+    std::vector<std::vector<Point3D>> derivs = Derivatives(uv, 1);
+    Point3D normal;
+    if (UnitNormal(derivs[1][0], derivs[0][1], normal)) {
+      return normal;
+    }
+    return StepNormal(uv);
+  }
+
+  // EvaluateGrid with float output for vertex buffers, the xyz of point
+  // (i, j) starts at positions[3 * ((i * v_count) + j)]
+  virtual void EvaluateGridFloat(const double *u_params, size_t u_count,
+                                 const double *v_params, size_t v_count,
+                                 float *positions) const {
+    std::vector<Point3D> points(u_count * v_count);
+    EvaluateGrid(u_params, u_count, v_params, v_count, points.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+      positions[(3 * i)] = static_cast<float>(points[i].x);
+      positions[(3 * i) + 1] = static_cast<float>(points[i].y);
+      positions[(3 * i) + 2] = static_cast<float>(points[i].z);
+    }
+  }
+
   virtual std::vector<Point3D> EvaluatePoints(uint32_t u_sample_count,
                                               uint32_t v_sample_count) const {
+    std::vector<double> u_params = SampleParams(u_interval_, u_sample_count);
+    std::vector<double> v_params = SampleParams(v_interval_, v_sample_count);
     std::vector<Point3D> points(u_sample_count * v_sample_count);
-    double u_div = (u_interval_.y - u_interval_.x) /
-                   static_cast<double>(u_sample_count - 1);
-    double v_div = (v_interval_.y - v_interval_.x) /
-                   static_cast<double>(v_sample_count - 1);
-    for (uint32_t i = 0; i < u_sample_count; ++i) {
-      Point2D uv = {u_interval_.x + static_cast<double>(i) * u_div, 0};
-      for (uint32_t j = 0; j < v_sample_count; ++j) {
-        uv.y = v_interval_.x + static_cast<double>(j) * v_div;
-        points[(i * v_sample_count) + j] = EvaluatePoint(uv);
-      }
-    }
+    EvaluateGrid(u_params.data(), u_params.size(), v_params.data(),
+                 v_params.size(), points.data());
     return points;
   }
 
+  // The points of EvaluatePoints with every row of constant u stepped along
+  // v by forward differences, see Curve3D::StepCurvePoints. The default just
+  // evaluates.
+  virtual std::vector<Point3D> StepPoints(uint32_t u_sample_count,
+                                          uint32_t v_sample_count) const {
+    return EvaluatePoints(u_sample_count, v_sample_count);
+  }
+
+  // count evenly spaced parameters from interval.x to interval.y
+  static std::vector<double> SampleParams(Point2D interval, uint32_t count) {
+    std::vector<double> params(count);
+    double div = (interval.y - interval.x) / static_cast<double>(count - 1);
+    for (uint32_t i = 0; i < count; ++i) {
+      params[i] = interval.x + static_cast<double>(i) * div;
+    }
+    return params;
+  }
+
   void u_interval(Point2D interval) { u_interval_ = interval; }
   Point2D u_interval() const { return u_interval_; }
 
@@ -37,6 +175,64 @@ public:
   Point2D v_interval() const { return v_interval_; }
 
 protected:
+  // Partials shorter than this relative to the longer one do not span a
+  // tangent plane
+  static constexpr double kDegenerateNormal = 1e-10;
+
+  // Normalized du x dv, false when the partials are degenerate
+  static bool UnitNormal(const Point3D &du, const Point3D &dv,
+                         Point3D &normal) {
+    // Spelled out rather than Cross and Dot, this runs for every grid sample.
+    // Compared squared, so only a normal that is kept needs a square root.
+    normal = {(du.y * dv.z) - (du.z * dv.y), (du.z * dv.x) - (du.x * dv.z),
+              (du.x * dv.y) - (du.y * dv.x)};
+    const double length_squared = (normal.x * normal.x) +
+                                  (normal.y * normal.y) +
+                                  (normal.z * normal.z);
+    const double scale_squared =
+        std::max((du.x * du.x) + (du.y * du.y) + (du.z * du.z),
+                 (dv.x * dv.x) + (dv.y * dv.y) + (dv.z * dv.z));
+    const double limit = kDegenerateNormal * scale_squared;
+    if (!(length_squared > limit * limit) || !std::isfinite(length_squared)) {
+      normal = {0.0, 0.0, 0.0};
+      return false;
+    }
+    const double inverse = 1.0 / std::sqrt(length_squared);
+    normal = {normal.x * inverse, normal.y * inverse, normal.z * inverse};
+    return true;
+  }
+
+  // Normal of the surface a small step from uv towards the middle of the
+  // domain
+  Point3D StepNormal(Point2D uv) const {
+    const double u_step = (u_interval_.y - u_interval_.x) * 1e-4;
+    const double v_step = (v_interval_.y - v_interval_.x) * 1e-4;
+    const Point2D inside = {
+        uv.x < (u_interval_.x + u_interval_.y) * 0.5 ? uv.x + u_step
+                                                     : uv.x - u_step,
+        uv.y < (v_interval_.x + v_interval_.y) * 0.5 ? uv.y + v_step
+                                                     : uv.y - v_step};
+    std::vector<std::vector<Point3D>> derivs = Derivatives(inside, 1);
+    Point3D normal;
+    UnitNormal(derivs[1][0], derivs[0][1], normal);
+    return normal;
+  }
+
+  // Fills grid.normals from the partials, stepping in at degenerate samples
+  void FillNormals(const double *u_params, size_t u_count,
+                   const double *v_params, size_t v_count,
+                   GridDerivatives &grid) const {
+    for (size_t i = 0; i < u_count; ++i) {
+      for (size_t j = 0; j < v_count; ++j) {
+        const size_t index = (i * v_count) + j;
+        if (!UnitNormal(grid.u_partials[index], grid.v_partials[index],
+                        grid.normals[index])) {
+          grid.normals[index] = StepNormal({u_params[i], v_params[j]});
+        }
+      }
+    }
+  }
+
   Point2D u_interval_;
   Point2D v_interval_;
 };
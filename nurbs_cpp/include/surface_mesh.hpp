@@ -0,0 +1,31 @@
+#pragma once
+
+// STD
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+// Triangle mesh of one or more sampled surfaces, laid out for upload
+struct SurfaceMesh {
+  // Where one surface lives in the buffers. u_count and v_count are the grid
+  // size, or zero for an adaptive patch.
+  struct Patch {
+    uint32_t u_count;
+    uint32_t v_count;
+    uint32_t vertex_offset;
+    uint32_t index_offset;
+  };
+
+  std::vector<Patch> patches;
+  // xyz per vertex. On a grid patch, sample (i, j) of patch p is vertex
+  // patches[p].vertex_offset + (i * v_count) + j.
+  std::vector<float> positions;
+  // Unit surface normal per vertex, xyz like positions
+  std::vector<float> normals;
+  // uv per vertex, the parameters scaled to [0, 1] over the surface intervals
+  std::vector<float> uvs;
+  // Triangles wound counter clockwise in (u, v), indexing the whole vertex
+  // buffer. A grid cell is two triangles.
+  std::vector<uint32_t> indices;
+};
+} // namespace nurbs
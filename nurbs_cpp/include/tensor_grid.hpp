@@ -0,0 +1,35 @@
+#pragma once
+
+// NURBS
+#include "include/basis_table.hpp"
+#include "include/control_net.hpp"
+#include "include/surface.hpp"
+
+// STD
+#include <cstddef>
+#include <functional>
+
+namespace nurbs {
+namespace tensor {
+// Grid evaluation of a tensor product surface on a homogeneous ControlNet,
+// from the basis tables of its u and v samples. Sample (i, j) of the grid is
+// sample i of u_table and sample j of v_table. When rational is false the w
+// plane is not read and nothing is divided, so the x, y and z planes have to
+// hold the points themselves.
+
+// emit_row gets each u sample and the x, y and z rows of its points
+void EvaluateRows(
+    const ControlNet<Point4D> &net, bool rational,
+    const knots::BasisTable &u_table, const knots::BasisTable &v_table,
+    const std::function<void(size_t, const double *const *)> &emit_row);
+
+// Points and partials of the grid, ALGORITHM A3.6 on the planes of the net
+// and A4.4 a row at a time. The tables need derivatives up to 1, or 2 for
+// second partials. grid has to be sized already and its normals are left to
+// the caller.
+void EvaluateDerivatives(const ControlNet<Point4D> &net, bool rational,
+                         const knots::BasisTable &u_table,
+                         const knots::BasisTable &v_table,
+                         bool second_partials, GridDerivatives &grid);
+} // namespace tensor
+} // namespace nurbs
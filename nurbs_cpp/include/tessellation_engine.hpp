@@ -0,0 +1,43 @@
+#pragma once
+
+// NURBS
+#include "include/surface.hpp"
+#include "include/surface_mesh.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+// Samples positions and unit normals of surfaces on a regular grid over
+// their intervals, see Surface::EvaluateGridDerivatives, and triangulates the
+// grid. Each surface is cut into tiles of tile_rows u rows. Tiles run on
+// a work stealing pool and write straight into their own slice of the
+// buffers, which is fixed before any tile starts, so the mesh is the same for
+// every thread count and no lock guards the output.
+class TessellationEngine {
+public:
+  static constexpr uint32_t kTileRows = 16;
+
+  // One worker per hardware thread besides the caller
+  static uint32_t DefaultThreadCount();
+
+  // Zero threads tessellates on the calling thread
+  explicit TessellationEngine(uint32_t thread_count = DefaultThreadCount(),
+                              uint32_t tile_rows = kTileRows);
+
+  SurfaceMesh Tessellate(const Surface &surface, uint32_t u_count,
+                         uint32_t v_count);
+  // All surfaces go into one mesh, in order
+  SurfaceMesh Tessellate(const std::vector<const Surface *> &surfaces,
+                         uint32_t u_count, uint32_t v_count);
+
+  uint32_t thread_count() const { return pool_.size(); }
+  uint32_t tile_rows() const { return tile_rows_; }
+
+private:
+  ThreadPool pool_;
+  uint32_t tile_rows_;
+};
+} // namespace nurbs
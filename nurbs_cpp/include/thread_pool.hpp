@@ -0,0 +1,70 @@
+#pragma once
+
+// STD
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nurbs {
+// Work stealing pool. Every worker owns a queue and takes work from its back,
+// an idle worker steals from the front of the other queues, so there is no
+// lock shared by all threads. The thread calling ParallelFor works on its own
+// queue until the batch is done, which also makes nested calls safe.
+class ThreadPool {
+public:
+  // A pool of zero threads runs everything on the calling thread
+  explicit ThreadPool(uint32_t thread_count);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint32_t size() const { return static_cast<uint32_t>(threads_.size()); }
+
+  // Runs task(i) for every i < count and returns once all of them finished.
+  // Indices are handed out in contiguous chunks, one per queue. The first
+  // exception thrown by a task is rethrown here after the batch completes.
+  void ParallelFor(size_t count, const std::function<void(size_t)> &task);
+
+private:
+  struct Batch {
+    const std::function<void(size_t)> *task;
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+  struct Item {
+    Batch *batch;
+    size_t index;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Item> items;
+  };
+
+  bool Pop(size_t queue, Item &item);
+  bool Steal(size_t thief, Item &item);
+  // Runs one queued item, own queue first. False when every queue is empty.
+  bool RunOne(size_t queue);
+  void Run(const Item &item);
+  void WorkerLoop(size_t queue);
+
+  // One queue per worker, the last one is shared by calling threads
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  // Items queued and not started yet, workers sleep while it is zero
+  std::atomic<size_t> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+} // namespace nurbs
@@ -0,0 +1,225 @@
+#pragma once
+
+// NURBS
+#include "include/control_net.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/grid_kernels.hpp"
+#include "include/knot_utility_functions.hpp"
+#include "include/span_locator.hpp"
+
+// STD
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nurbs {
+namespace knots {
+// The cubic basis functions of span i only depend on the knots U[i - 2] to
+// U[i + 3]. When those are equally spaced the four functions are the same
+// cubics of the local parameter t = (u - U[i]) / (U[i + 1] - U[i]) on every
+// such span:
+//   [N[i-3] N[i-2] N[i-1] N[i]] = [1 t t^2 t^3] * kUniformCubicMatrix
+// kUniformCubicMatrix[k][j] is the t^k coefficient of basis j, with the 1/6 of
+// the uniform B-spline folded in.
+constexpr double kUniformCubicMatrix[4][4] = {
+    {1.0 / 6.0, 4.0 / 6.0, 1.0 / 6.0, 0.0},
+    {-3.0 / 6.0, 0.0, 3.0 / 6.0, 0.0},
+    {3.0 / 6.0, -6.0 / 6.0, 3.0 / 6.0, 0.0},
+    {-1.0 / 6.0, 3.0 / 6.0, -3.0 / 6.0, 1.0 / 6.0}};
+
+// The four basis values at local parameter t, each by Horner on its column of
+// kUniformCubicMatrix. simd::UniformCubicBasis gives the same bits.
+inline void UniformCubicBasis(double t, double *bases) {
+  const double(&m)[4][4] = kUniformCubicMatrix;
+  for (uint32_t j = 0; j < 4; ++j) {
+    bases[j] = (((((m[3][j] * t) + m[2][j]) * t) + m[1][j]) * t) + m[0][j];
+  }
+}
+
+// Spans of a knot vector where the cubic basis is the uniform matrix. Clamped
+// or repeated knots make the spans next to them general, those keep going
+// through BasisFuns. Empty for any degree but 3.
+class UniformCubicSpans {
+public:
+  UniformCubicSpans() = default;
+  UniformCubicSpans(uint32_t degree, const std::vector<double> &knots) {
+    Reset(degree, knots);
+  }
+
+  // Reclassifies the spans for a new knot vector, reusing the width table
+  void Reset(uint32_t degree, const std::vector<double> &knots);
+
+  bool empty() const { return count_ == 0; }
+  bool Contains(uint32_t span) const {
+    return span < inverse_widths_.size() && inverse_widths_[span] != 0.0;
+  }
+  // Local parameter of u in a span Contains accepts
+  double Local(uint32_t span, double u,
+               const std::vector<double> &knots) const {
+    return (u - knots[span]) * inverse_widths_[span];
+  }
+
+private:
+  size_t count_ = 0;
+  // 1 / (U[i + 1] - U[i]) for the uniform spans i, 0 for the others
+  std::vector<double> inverse_widths_;
+};
+
+// Sum over i < 4 of bases[i * stride] * controls[i], with the operations
+// and order of the PointT operators but a component at a time, so the sums
+// stay in registers
+template <typename PointT>
+inline PointT UniformCubicSum(const double *bases, size_t stride,
+                              const PointT *controls) {
+  using Components = PointComponents<PointT>;
+  PointT point;
+  Unroll<Components::kCount>([&](auto c_constant) {
+    constexpr uint32_t c = decltype(c_constant)::value;
+    double sum = point.*Components::kMembers[c];
+    Unroll<4>([&](auto i_constant) {
+      constexpr uint32_t i = decltype(i_constant)::value;
+      sum += bases[i * stride] * (controls[i].*Components::kMembers[c]);
+    });
+    point.*Components::kMembers[c] = sum;
+  });
+  return point;
+}
+
+// Chaper 3, ALGORITHM A3.1: CurvePoint p82, through the uniform matrix on the
+// spans of uniform and the general kernels everywhere else. Sums in the same
+// order as CurvePoint(const BasisTable &, ...).
+template <typename PointT>
+inline PointT CurvePoint(const UniformCubicSpans &uniform, uint32_t degree,
+                         uint32_t span, double u,
+                         const std::vector<double> &knots,
+                         const std::vector<PointT> &control_points,
+                         double tolerance) {
+  if (!uniform.Contains(span)) {
+    return CurvePoint(degree, span, u, knots, control_points, tolerance);
+  }
+  double bases[4];
+  UniformCubicBasis(uniform.Local(span, u, knots), bases);
+  return UniformCubicSum(bases, 1, control_points.data() + span - 3);
+}
+
+// Most parameters CurvePoints takes per call, its buffers live on the stack
+constexpr size_t kUniformCubicBlock = 64;
+
+// CurvePoint above at count <= kUniformCubicBlock parameters already clamped
+// to the curve, with the basis of the uniform samples from
+// simd::UniformCubicBasis. Gives the same bits as one CurvePoint per sample
+// without going through a basis table.
+template <typename PointT>
+inline void CurvePoints(const UniformCubicSpans &uniform,
+                        const SpanLocator &locator, uint32_t degree,
+                        const std::vector<double> &knots,
+                        const std::vector<PointT> &control_points,
+                        double tolerance, const double *params, size_t count,
+                        PointT *points) {
+  uint32_t spans[kUniformCubicBlock];
+  double local[kUniformCubicBlock];
+  double bases[4 * kUniformCubicBlock];
+  for (size_t s = 0; s < count; ++s) {
+    spans[s] = locator.Find(params[s]);
+    local[s] = uniform.Contains(spans[s])
+                   ? uniform.Local(spans[s], params[s], knots)
+                   : 0.0;
+  }
+  simd::UniformCubicBasis(local, count, bases, kUniformCubicBlock);
+  for (size_t s = 0; s < count; ++s) {
+    const uint32_t span = spans[s];
+    if (!uniform.Contains(span)) {
+      points[s] = CurvePoint(degree, span, params[s], knots, control_points,
+                             tolerance);
+      continue;
+    }
+    points[s] = UniformCubicSum(bases + s, kUniformCubicBlock,
+                                control_points.data() + span - 3);
+  }
+}
+
+// Fixed degree basis of a span, through the uniform matrix when fast, which
+// Contains only allows for degree 3
+template <uint32_t P>
+inline void SpanBasis(bool fast, const UniformCubicSpans &uniform,
+                      uint32_t span, double u,
+                      const std::vector<double> &knots, double tolerance,
+                      std::array<double, P + 1> &bases) {
+  if constexpr (P == 3) {
+    if (fast) {
+      UniformCubicBasis(uniform.Local(span, u, knots), bases.data());
+      return;
+    }
+  }
+  BasisFuns<P>(span, u, knots, tolerance, bases);
+}
+
+// Chaper 3, ALGORITHM A3.5: SurfacePoint p103, with the uniform matrix in
+// either direction where it applies
+template <typename PointT>
+inline PointT SurfacePoint(const UniformCubicSpans &u_uniform,
+                           uint32_t u_degree, uint32_t u_span, double u,
+                           const std::vector<double> &u_knots,
+                           const UniformCubicSpans &v_uniform,
+                           uint32_t v_degree, uint32_t v_span, double v,
+                           const std::vector<double> &v_knots,
+                           const ControlNet<PointT> &control_net,
+                           double tolerance) {
+  const bool u_fast = u_uniform.Contains(u_span);
+  const bool v_fast = v_uniform.Contains(v_span);
+  if (!u_fast && !v_fast) {
+    return SurfacePoint(u_degree, u_span, u, u_knots, v_degree, v_span, v,
+                        v_knots, control_net, tolerance);
+  }
+  PointT point;
+  bool fixed = false;
+  DispatchDegree(u_degree, [&](auto p) {
+    fixed = DispatchDegree(v_degree, [&](auto q) {
+      constexpr uint32_t P = decltype(p)::value;
+      constexpr uint32_t Q = decltype(q)::value;
+      std::array<double, P + 1> u_bases;
+      std::array<double, Q + 1> v_bases;
+      SpanBasis<P>(u_fast, u_uniform, u_span, u, u_knots, tolerance, u_bases);
+      SpanBasis<Q>(v_fast, v_uniform, v_span, v, v_knots, tolerance, v_bases);
+      point = SurfaceSum<P, Q>(u_bases, u_span, v_bases, v_span, control_net);
+    });
+  });
+  if (fixed) {
+    return point;
+  }
+  BasisScratch &u_scratch = ThreadScratch(0);
+  BasisScratch &v_scratch = ThreadScratch(1);
+  u_scratch.Reserve(u_degree);
+  v_scratch.Reserve(v_degree);
+  double *u_bases = u_scratch.bases.data();
+  double *v_bases = v_scratch.bases.data();
+  if (u_fast) {
+    UniformCubicBasis(u_uniform.Local(u_span, u, u_knots), u_bases);
+  } else {
+    BasisFuns(u_span, u, u_degree, u_knots, tolerance, u_bases, u_scratch);
+  }
+  if (v_fast) {
+    UniformCubicBasis(v_uniform.Local(v_span, v, v_knots), v_bases);
+  } else {
+    BasisFuns(v_span, v, v_degree, v_knots, tolerance, v_bases, v_scratch);
+  }
+  const size_t stride = control_net.stride();
+  const size_t offset =
+      control_net.Index(u_span - u_degree, v_span - v_degree);
+  for (uint32_t c = 0; c < ControlNet<PointT>::kDimension; ++c) {
+    const double *values = control_net.plane(c) + offset;
+    double sum = 0.0;
+    for (uint32_t i = 0; i <= v_degree; ++i) {
+      double temp = 0.0;
+      for (uint32_t j = 0; j <= u_degree; ++j) {
+        temp += u_bases[j] * values[(j * stride) + i];
+      }
+      sum += v_bases[i] * temp;
+    }
+    point.*PointComponents<PointT>::kMembers[c] = sum;
+  }
+  return point;
+}
+} // namespace knots
+} // namespace nurbs
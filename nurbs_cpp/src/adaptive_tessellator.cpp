@@ -0,0 +1,266 @@
+#include "include/adaptive_tessellator.hpp"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace nurbs {
+namespace {
+struct Sample {
+  Point3D point;
+  Point3D normal;
+  bool has_normal;
+};
+
+// Cells live on an integer lattice where a cell of max_depth is two units
+// wide, so the center and edge midpoints of every cell are lattice points
+struct Cell {
+  uint32_t u;
+  uint32_t v;
+  uint32_t size;
+  uint32_t depth;
+};
+
+uint64_t Key(uint32_t u, uint32_t v) {
+  return (static_cast<uint64_t>(u) << 32) | v;
+}
+
+// State of one AdaptiveTessellator::Tessellate call
+class QuadtreeBuilder {
+public:
+  QuadtreeBuilder(const Surface &surface,
+                  const AdaptiveTessellator::Options &options)
+      : surface_(surface), options_(options),
+        root_size_(2u << options.max_depth),
+        extent_(options.base_cells * root_size_),
+        min_cos_(std::cos(options.angle_tolerance)) {}
+
+  SurfaceMesh Build() {
+    for (uint32_t i = 0; i < options_.base_cells; ++i) {
+      for (uint32_t j = 0; j < options_.base_cells; ++j) {
+        Subdivide({i * root_size_, j * root_size_, root_size_, 0});
+      }
+    }
+    // Every leaf corner is a vertex, indexed by the lattice lines it is on
+    for (const Cell &cell : leaves_) {
+      const uint32_t u_end = cell.u + cell.size;
+      const uint32_t v_end = cell.v + cell.size;
+      for (uint32_t u : {cell.u, u_end}) {
+        for (uint32_t v : {cell.v, v_end}) {
+          if (vertices_.count(Key(u, v)) == 0) {
+            AddVertex(u, v);
+            u_lines_[u].push_back(v);
+            v_lines_[v].push_back(u);
+          }
+        }
+      }
+    }
+    for (auto &line : u_lines_) {
+      std::sort(line.second.begin(), line.second.end());
+    }
+    for (auto &line : v_lines_) {
+      std::sort(line.second.begin(), line.second.end());
+    }
+    for (const Cell &cell : leaves_) {
+      EmitCell(cell);
+    }
+    mesh_.patches.push_back({0, 0, 0, 0});
+    return std::move(mesh_);
+  }
+
+private:
+  double UParam(uint32_t u) const {
+    const Point2D interval = surface_.u_interval();
+    if (u == extent_) {
+      return interval.y;
+    }
+    return interval.x + ((interval.y - interval.x) * u) / extent_;
+  }
+  double VParam(uint32_t v) const {
+    const Point2D interval = surface_.v_interval();
+    if (v == extent_) {
+      return interval.y;
+    }
+    return interval.x + ((interval.y - interval.x) * v) / extent_;
+  }
+
+  const Sample &SampleAt(uint32_t u, uint32_t v) {
+    auto found = samples_.find(Key(u, v));
+    if (found != samples_.end()) {
+      return found->second;
+    }
+    std::vector<std::vector<Point3D>> derivs =
+        surface_.Derivatives({UParam(u), VParam(v)}, 1);
+    Sample sample;
+    sample.point = derivs[0][0];
+    sample.normal = Cross(derivs[1][0], derivs[0][1]);
+    const double length = Length(sample.normal);
+    // Degenerate points, like the pole of a sphere, have no normal to test
+    sample.has_normal = length > 0.0 && std::isfinite(length);
+    if (sample.has_normal) {
+      sample.normal /= length;
+    }
+    return samples_.emplace(Key(u, v), sample).first->second;
+  }
+
+  bool Deviates(const Point3D &point, const Point3D &a, const Point3D &b) {
+    return Length(point - ((a + b) * 0.5)) > options_.chordal_tolerance;
+  }
+
+  bool IsFlat(const Cell &cell) {
+    if (cell.depth < options_.min_depth) {
+      return false;
+    }
+    if (cell.depth >= options_.max_depth) {
+      return true;
+    }
+    const uint32_t half = cell.size / 2;
+    const uint32_t u_mid = cell.u + half;
+    const uint32_t v_mid = cell.v + half;
+    const uint32_t u_end = cell.u + cell.size;
+    const uint32_t v_end = cell.v + cell.size;
+    const Sample corners[4] = {SampleAt(cell.u, cell.v),
+                               SampleAt(u_end, cell.v),
+                               SampleAt(cell.u, v_end), SampleAt(u_end, v_end)};
+    const Sample &center = SampleAt(u_mid, v_mid);
+
+    const Point3D bilinear = (corners[0].point + corners[1].point +
+                              corners[2].point + corners[3].point) *
+                             0.25;
+    if (Length(center.point - bilinear) > options_.chordal_tolerance) {
+      return false;
+    }
+    if (Deviates(SampleAt(u_mid, cell.v).point, corners[0].point,
+                 corners[1].point) ||
+        Deviates(SampleAt(u_mid, v_end).point, corners[2].point,
+                 corners[3].point) ||
+        Deviates(SampleAt(cell.u, v_mid).point, corners[0].point,
+                 corners[2].point) ||
+        Deviates(SampleAt(u_end, v_mid).point, corners[1].point,
+                 corners[3].point)) {
+      return false;
+    }
+    if (center.has_normal) {
+      for (const Sample &corner : corners) {
+        if (corner.has_normal && Dot(center.normal, corner.normal) < min_cos_) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void Subdivide(const Cell &cell) {
+    if (IsFlat(cell)) {
+      leaves_.push_back(cell);
+      return;
+    }
+    const uint32_t half = cell.size / 2;
+    const uint32_t depth = cell.depth + 1;
+    Subdivide({cell.u, cell.v, half, depth});
+    Subdivide({cell.u + half, cell.v, half, depth});
+    Subdivide({cell.u, cell.v + half, half, depth});
+    Subdivide({cell.u + half, cell.v + half, half, depth});
+  }
+
+  uint32_t AddVertex(uint32_t u, uint32_t v) {
+    const Sample &sample = SampleAt(u, v);
+    const Point3D &point = sample.point;
+    // Degenerate samples take the normal a step into the surface
+    const Point3D normal = sample.has_normal
+                               ? sample.normal
+                               : surface_.Normal({UParam(u), VParam(v)});
+    const uint32_t index = static_cast<uint32_t>(mesh_.positions.size() / 3);
+    mesh_.positions.push_back(static_cast<float>(point.x));
+    mesh_.positions.push_back(static_cast<float>(point.y));
+    mesh_.positions.push_back(static_cast<float>(point.z));
+    mesh_.normals.push_back(static_cast<float>(normal.x));
+    mesh_.normals.push_back(static_cast<float>(normal.y));
+    mesh_.normals.push_back(static_cast<float>(normal.z));
+    mesh_.uvs.push_back(static_cast<float>(u) / static_cast<float>(extent_));
+    mesh_.uvs.push_back(static_cast<float>(v) / static_cast<float>(extent_));
+    vertices_.emplace(Key(u, v), index);
+    return index;
+  }
+
+  // Appends the vertices of line between from and to, ascending or
+  // descending, without the one at to
+  void AppendLine(const std::vector<uint32_t> &line, uint32_t from,
+                  uint32_t to, bool u_line, uint32_t fixed,
+                  std::vector<uint32_t> &polygon) const {
+    auto begin = std::lower_bound(line.begin(), line.end(), std::min(from, to));
+    auto end = std::upper_bound(line.begin(), line.end(), std::max(from, to));
+    std::vector<uint32_t> points(begin, end);
+    if (from > to) {
+      std::reverse(points.begin(), points.end());
+    }
+    points.pop_back();
+    for (uint32_t point : points) {
+      const uint64_t key = u_line ? Key(fixed, point) : Key(point, fixed);
+      polygon.push_back(vertices_.at(key));
+    }
+  }
+
+  void EmitCell(const Cell &cell) {
+    const uint32_t u_end = cell.u + cell.size;
+    const uint32_t v_end = cell.v + cell.size;
+    // Counter clockwise in (u, v): along v = cell.v, up u = u_end, back
+    // along v = v_end and down u = cell.u
+    std::vector<uint32_t> polygon;
+    AppendLine(v_lines_.at(cell.v), cell.u, u_end, false, cell.v, polygon);
+    AppendLine(u_lines_.at(u_end), cell.v, v_end, true, u_end, polygon);
+    AppendLine(v_lines_.at(v_end), u_end, cell.u, false, v_end, polygon);
+    AppendLine(u_lines_.at(cell.u), v_end, cell.v, true, cell.u, polygon);
+
+    std::vector<uint32_t> &indices = mesh_.indices;
+    if (polygon.size() == 4) {
+      // Same split as a grid cell
+      indices.insert(indices.end(), {polygon[0], polygon[1], polygon[3]});
+      indices.insert(indices.end(), {polygon[3], polygon[1], polygon[2]});
+      return;
+    }
+    const uint32_t half = cell.size / 2;
+    const uint32_t center = AddVertex(cell.u + half, cell.v + half);
+    for (size_t i = 0; i < polygon.size(); ++i) {
+      indices.insert(indices.end(),
+                     {center, polygon[i], polygon[(i + 1) % polygon.size()]});
+    }
+  }
+
+  const Surface &surface_;
+  const AdaptiveTessellator::Options &options_;
+  const uint32_t root_size_;
+  const uint32_t extent_;
+  const double min_cos_;
+
+  std::unordered_map<uint64_t, Sample> samples_;
+  std::vector<Cell> leaves_;
+  std::unordered_map<uint64_t, uint32_t> vertices_;
+  // Lattice u -> sorted v of the vertices on it, and the other way around
+  std::unordered_map<uint32_t, std::vector<uint32_t>> u_lines_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> v_lines_;
+  SurfaceMesh mesh_;
+};
+} // namespace
+
+AdaptiveTessellator::AdaptiveTessellator(const Options &options)
+    : options_(options) {
+  if (options_.base_cells == 0) {
+    throw std::exception("AdaptiveTessellator needs at least one base cell");
+  }
+  if (options_.max_depth > kMaxDepth ||
+      options_.min_depth > options_.max_depth) {
+    throw std::exception("Invalid AdaptiveTessellator depths");
+  }
+  if (static_cast<uint64_t>(options_.base_cells) << (options_.max_depth + 1) >
+      (1ull << 31)) {
+    throw std::exception("AdaptiveTessellator lattice is too fine");
+  }
+}
+
+SurfaceMesh AdaptiveTessellator::Tessellate(const Surface &surface) const {
+  return QuadtreeBuilder(surface, options_).Build();
+}
+} // namespace nurbs
@@ -1,5 +1,8 @@
 #include "include/b_spline_curve.hpp"
 
+#include "include/basis_table.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/forward_difference.hpp"
 #include "include/knot_utility_functions.hpp"
 
 namespace nurbs {
@@ -12,19 +15,50 @@ BSplineCurve2D::BSplineCurve2D(uint32_t degree,
   if (knots.size() != control_points.size() + degree + 1) {
     throw std::exception("Invalid BSplineCruve2D");
   }
+  span_locator_ = knots::SpanLocator(degree_, knots_, kTolerance);
+  uniform_spans_ = knots::UniformCubicSpans(degree_, knots_);
 }
 
 // Chaper 3, ALGORITHM A3.1: CurvePoint p82
 Point2D BSplineCurve2D::EvaluateCurve(double param) const {
   double in_param = ClampInterval(param);
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<double> bases =
-      knots::BasisFuns(span, in_param, degree_, knots_, kTolerance);
-  Point2D point{0.0, 0.0};
-  for (uint32_t i = 0; i <= degree_; i++) {
-    point += bases[i] * control_points_[span - degree_ + i];
+  uint32_t span = span_locator_.Find(in_param);
+  return knots::CurvePoint(uniform_spans_, degree_, span, in_param, knots_,
+                           control_points_, kTolerance);
+}
+
+// Batched A3.1, the basis table comes from the shared cache so repeated
+// parameter lists skip the basis work
+void BSplineCurve2D::EvaluateCurveBatch(const double *params, size_t count,
+                                        Point2D *points) const {
+  if (count == 0) {
+    return;
+  }
+  std::vector<double> clamped(params, params + count);
+  for (double &param : clamped) {
+    param = ClampInterval(param);
+  }
+  std::shared_ptr<const knots::BasisTable> table =
+      knots::BasisTableCache::Shared().Get(degree_, knots_, clamped.data(),
+                                           count, kTolerance);
+  for (size_t i = 0; i < count; ++i) {
+    points[i] = knots::CurvePoint(*table, i, control_points_);
   }
-  return point;
+}
+
+std::vector<Point2D>
+BSplineCurve2D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2 || !forward::SplineStepPlan::Pays(
+                             degree_, knots_, interval_, point_count)) {
+    return EvaluateCurvePoints(point_count);
+  }
+  const forward::SplineStepPlan plan(degree_, knots_, interval_, point_count,
+                                     kTolerance);
+  return forward::StepCurve<Point2D>(plan, control_points_, false);
+}
+
+std::vector<double> BSplineCurve2D::Breakpoints() const {
+  return knots::Breakpoints(knots_, interval_.x, interval_.y, kTolerance);
 }
 
 // Chapter 3, ALGORITHM A3.2: CurveDerivsAlgl p93
@@ -33,14 +67,17 @@ BSplineCurve2D::Derivatives(double param, uint32_t max_derivative) const {
   double in_param = ClampInterval(param);
   uint32_t max_deriv = std::min(degree_, max_derivative);
   std::vector<Point2D> derivs(max_deriv + 1, {0, 0});
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<std::vector<double>> bases = knots::DersBasisFuns(
-      span, in_param, degree_,
-      static_cast<uint32_t>(control_points_.size() - 1), knots_);
+  uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, max_deriv);
+  const double *bases = scratch.ders.data();
+  knots::DersBasisFuns(span, in_param, degree_, max_deriv, knots_,
+                       scratch.ders.data(), scratch);
   for (uint32_t k = 0; k <= max_deriv; ++k) {
     derivs[k] = {0, 0};
     for (uint32_t j = 0; j <= degree_; ++j) {
-      derivs[k] += bases[k][j] * control_points_[span - degree_ + j];
+      derivs[k] += bases[(k * (degree_ + 1)) + j] *
+                   control_points_[span - degree_ + j];
     }
   }
   return derivs;
@@ -52,14 +89,17 @@ BSplineCurve2D::Derivatives2(double param, uint32_t max_derivative) const {
   double in_param = ClampInterval(param);
   uint32_t max_deriv = std::min(degree_, max_derivative);
   std::vector<Point2D> derivs(max_deriv + 1, {0, 0});
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<std::vector<double>> bases =
-      knots::AllBasisFuns(span, in_param, degree_, knots_);
+  uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, degree_);
+  const double *bases = scratch.ders.data();
+  knots::AllBasisFuns(span, in_param, degree_, knots_, scratch.ders.data(),
+                      scratch);
   std::vector<std::vector<Point2D>> points =
       DerivativeControlPoints(max_deriv, span - degree_, span);
   for (uint32_t k = 0; k <= max_deriv; ++k) {
     for (uint32_t j = 0; j <= degree_ - k; ++j) {
-      derivs[k] += bases[j][degree_ - k] * points[k][j];
+      derivs[k] += bases[(j * (degree_ + 1)) + degree_ - k] * points[k][j];
     }
   }
   return derivs;
@@ -101,19 +141,65 @@ BSplineCurve3D::BSplineCurve3D(uint32_t degree,
   if (knots.size() != control_points.size() + degree + 1) {
     throw std::exception("Invalid BSplineCruve3D");
   }
+  span_locator_ = knots::SpanLocator(degree_, knots_, kTolerance);
+  uniform_spans_ = knots::UniformCubicSpans(degree_, knots_);
 }
 
 // Chaper 3, ALGORITHM A3.1: CurvePoint p82
 Point3D BSplineCurve3D::EvaluateCurve(double param) const {
   double in_param = ClampInterval(param);
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<double> bases =
-      knots::BasisFuns(span, in_param, degree_, knots_, kTolerance);
-  Point3D point{0.0, 0.0, 0.0};
-  for (uint32_t i = 0; i <= degree_; i++) {
-    point += bases[i] * control_points_[span - degree_ + i];
+  uint32_t span = span_locator_.Find(in_param);
+  return knots::CurvePoint(uniform_spans_, degree_, span, in_param, knots_,
+                           control_points_, kTolerance);
+}
+
+// Batched A3.1, the basis table comes from the shared cache so repeated
+// parameter lists skip the basis work. Uniform cubic spans are cheaper to
+// evaluate than to look up, those curves skip the table.
+void BSplineCurve3D::EvaluateCurveBatch(const double *params, size_t count,
+                                        Point3D *points) const {
+  if (count == 0) {
+    return;
   }
-  return point;
+  if (!uniform_spans_.empty()) {
+    double clamped[knots::kUniformCubicBlock];
+    for (size_t first = 0; first < count;
+         first += knots::kUniformCubicBlock) {
+      const size_t block = std::min(knots::kUniformCubicBlock, count - first);
+      for (size_t i = 0; i < block; ++i) {
+        clamped[i] = ClampInterval(params[first + i]);
+      }
+      knots::CurvePoints(uniform_spans_, span_locator_, degree_, knots_,
+                         control_points_, kTolerance, clamped, block,
+                         points + first);
+    }
+    return;
+  }
+  std::vector<double> clamped(params, params + count);
+  for (double &param : clamped) {
+    param = ClampInterval(param);
+  }
+  std::shared_ptr<const knots::BasisTable> table =
+      knots::BasisTableCache::Shared().Get(degree_, knots_, clamped.data(),
+                                           count, kTolerance);
+  for (size_t i = 0; i < count; ++i) {
+    points[i] = knots::CurvePoint(*table, i, control_points_);
+  }
+}
+
+std::vector<Point3D>
+BSplineCurve3D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2 || !forward::SplineStepPlan::Pays(
+                             degree_, knots_, interval_, point_count)) {
+    return EvaluateCurvePoints(point_count);
+  }
+  const forward::SplineStepPlan plan(degree_, knots_, interval_, point_count,
+                                     kTolerance);
+  return forward::StepCurve<Point3D>(plan, control_points_, false);
+}
+
+std::vector<double> BSplineCurve3D::Breakpoints() const {
+  return knots::Breakpoints(knots_, interval_.x, interval_.y, kTolerance);
 }
 
 // Chapter 3, ALGORITHM A3.2: CurveDerivsAlgl p93
@@ -122,14 +208,17 @@ BSplineCurve3D::Derivatives(double param, uint32_t max_derivative) const {
   double in_param = ClampInterval(param);
   uint32_t max_deriv = std::min(degree_, max_derivative);
   std::vector<Point3D> derivs(max_deriv + 1, {0, 0, 0});
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<std::vector<double>> bases = knots::DersBasisFuns(
-      span, in_param, degree_,
-      static_cast<uint32_t>(control_points_.size() - 1), knots_);
+  uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, max_deriv);
+  const double *bases = scratch.ders.data();
+  knots::DersBasisFuns(span, in_param, degree_, max_deriv, knots_,
+                       scratch.ders.data(), scratch);
   for (uint32_t k = 0; k <= max_deriv; ++k) {
     derivs[k] = {0, 0, 0};
     for (uint32_t j = 0; j <= degree_; ++j) {
-      derivs[k] += bases[k][j] * control_points_[span - degree_ + j];
+      derivs[k] += bases[(k * (degree_ + 1)) + j] *
+                   control_points_[span - degree_ + j];
     }
   }
   return derivs;
@@ -141,14 +230,17 @@ BSplineCurve3D::Derivatives2(double param, uint32_t max_derivative) const {
   double in_param = ClampInterval(param);
   uint32_t max_deriv = std::min(degree_, max_derivative);
   std::vector<Point3D> derivs(max_deriv + 1, {0, 0, 0});
-  uint32_t span = knots::FindSpanParam(degree_, knots_, in_param, kTolerance);
-  std::vector<std::vector<double>> bases =
-      knots::AllBasisFuns(span, in_param, degree_, knots_);
+  uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, degree_);
+  const double *bases = scratch.ders.data();
+  knots::AllBasisFuns(span, in_param, degree_, knots_, scratch.ders.data(),
+                      scratch);
   std::vector<std::vector<Point3D>> points =
       DerivativeControlPoints(max_deriv, span - degree_, span);
   for (uint32_t k = 0; k <= max_deriv; ++k) {
     for (uint32_t j = 0; j <= degree_ - k; ++j) {
-      derivs[k] += bases[j][degree_ - k] * points[k][j];
+      derivs[k] += bases[(j * (degree_ + 1)) + degree_ - k] * points[k][j];
     }
   }
   return derivs;
@@ -180,4 +272,23 @@ BSplineCurve3D::DerivativeControlPoints(uint32_t max_deriv, uint32_t start,
   }
   return points;
 }
+PiecewisePowerBasisCurve2D BSplineCurve2D::ToPowerBasis() const {
+  std::vector<double> breakpoints;
+  std::vector<double> coefficients;
+  CompilePowerBasis(degree_, knots_, control_points_, breakpoints,
+                    coefficients);
+  return PiecewisePowerBasisCurve2D(degree_, std::move(breakpoints),
+                                    std::move(coefficients), false,
+                                    interval_);
+}
+
+PiecewisePowerBasisCurve3D BSplineCurve3D::ToPowerBasis() const {
+  std::vector<double> breakpoints;
+  std::vector<double> coefficients;
+  CompilePowerBasis(degree_, knots_, control_points_, breakpoints,
+                    coefficients);
+  return PiecewisePowerBasisCurve3D(degree_, std::move(breakpoints),
+                                    std::move(coefficients), false,
+                                    interval_);
+}
 } // namespace nurbs
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "include/b_spline_surface.hpp"
 
 #include "include/b_spline_curve.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/forward_difference.hpp"
+#include "include/grid_kernels.hpp"
 #include "include/knot_utility_functions.hpp"
 
+// STD
+#include <algorithm>
+
 namespace nurbs {
 
 BSplineSurface::BSplineSurface(
@@ -10,70 +16,151 @@ BSplineSurface::BSplineSurface(
     const std::vector<double> &v_knots,
     const std::vector<std::vector<Point3D>> &control_polygon,
     Point2D u_interval, Point2D v_interval)
+    : BSplineSurface(u_degree, v_degree, u_knots, v_knots,
+                     ControlNet<Point3D>(control_polygon), u_interval,
+                     v_interval) {}
+
+BSplineSurface::BSplineSurface(uint32_t u_degree, uint32_t v_degree,
+                               const std::vector<double> &u_knots,
+                               const std::vector<double> &v_knots,
+                               const ControlNet<Point3D> &control_polygon,
+                               Point2D u_interval, Point2D v_interval)
     : Surface(u_interval, v_interval), u_degree_(u_degree), v_degree_(v_degree),
       u_knots_(u_knots), v_knots_(v_knots), control_polygon_(control_polygon) {
-  if (u_knots_.size() != control_polygon_.size() + u_degree_ + 1) {
+  if (u_knots_.size() != control_polygon_.rows() + u_degree_ + 1) {
     throw std::exception("Invalid U Parameters for a BSplineSurface");
   }
   if (!control_polygon_.empty() &&
-      v_knots_.size() != control_polygon_[0].size() + v_degree_ + 1) {
+      v_knots_.size() != control_polygon_.cols() + v_degree_ + 1) {
     throw std::exception("Invalid V Parameters for a BSplineSurface");
   }
+  u_span_locator_ = knots::SpanLocator(u_degree_, u_knots_, kTolerance);
+  v_span_locator_ = knots::SpanLocator(v_degree_, v_knots_, kTolerance);
+  u_uniform_spans_ = knots::UniformCubicSpans(u_degree_, u_knots_);
+  v_uniform_spans_ = knots::UniformCubicSpans(v_degree_, v_knots_);
 }
 
 // Chaper 3, ALGORITHM A3.5: SSurfacePoint(n,p,U,m,q,V,P,u,v,S) p103
 Point3D BSplineSurface::EvaluatePoint(Point2D uv) const {
-  uint32_t u_span = knots::FindSpanParam(u_degree_, u_knots_, uv.x, kTolerance);
-  std::vector<double> u_bases =
-      knots::BasisFuns(u_span, uv.x, u_degree_, u_knots_, kTolerance);
-  uint32_t u_ind = u_span - u_degree_;
-  uint32_t v_span = knots::FindSpanParam(v_degree_, v_knots_, uv.y, kTolerance);
-  std::vector<double> v_bases =
-      knots::BasisFuns(v_span, uv.y, v_degree_, v_knots_, kTolerance);
-  Point3D point{0, 0, 0};
-  for (uint32_t i = 0; i <= v_degree_; ++i) {
-    Point3D temp = {0.0, 0.0, 0.0};
-    uint32_t v_ind = v_span - v_degree_ + i;
+  uint32_t u_span = u_span_locator_.Find(uv.x);
+  uint32_t v_span = v_span_locator_.Find(uv.y);
+  return knots::SurfacePoint(u_uniform_spans_, u_degree_, u_span, uv.x,
+                             u_knots_, v_uniform_spans_, v_degree_, v_span,
+                             uv.y, v_knots_, control_polygon_, kTolerance);
+}
+
+// Same sums as SurfacePoint, regrouped so every piece of basis work is shared.
+// Both basis tables are built once. Each u sample then contracts the
+// u_degree + 1 control rows of its span into one curve per component along v,
+// and the v table contracts that curve at every v sample.
+void BSplineSurface::EvaluateGrid(const double *u_params, size_t u_count,
+                                  const double *v_params, size_t v_count,
+                                  Point3D *points) const {
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  // Cached, so a grid sampled again, or the next tile of a grid, skips the
+  // basis work for the parameter lists it has seen
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table =
+      cache.Get(u_degree_, u_knots_, u_params, u_count, kTolerance);
+  std::shared_ptr<const knots::BasisTable> v_table =
+      cache.Get(v_degree_, v_knots_, v_params, v_count, kTolerance);
+  // Only the columns some v sample reaches are needed
+  const uint32_t *v_spans = v_table->spans();
+  const size_t first_col =
+      *std::min_element(v_spans, v_spans + v_count) - v_degree_;
+  const size_t end_col = *std::max_element(v_spans, v_spans + v_count) + 1;
+  const size_t stride = control_polygon_.stride();
+  std::vector<double> u_bases(u_degree_ + 1);
+  std::vector<double> row(control_polygon_.cols());
+  std::vector<double> sums(3 * v_count);
+  for (size_t u_i = 0; u_i < u_count; ++u_i) {
     for (uint32_t j = 0; j <= u_degree_; ++j) {
-      temp += u_bases[j] * control_polygon_[u_ind + j][v_ind];
+      u_bases[j] = u_table->value(j, u_i);
+    }
+    const size_t offset =
+        control_polygon_.Index(u_table->span(u_i) - u_degree_, first_col);
+    for (uint32_t c = 0; c < 3; ++c) {
+      simd::WeightedRowSum(u_bases.data(), u_degree_ + 1,
+                           control_polygon_.plane(c) + offset, stride,
+                           end_col - first_col, row.data() + first_col);
+      simd::ContractSamples(*v_table, row.data(), sums.data() + (c * v_count));
+    }
+    Point3D *out = points + (u_i * v_count);
+    for (size_t v_i = 0; v_i < v_count; ++v_i) {
+      out[v_i] = {sums[v_i], sums[v_count + v_i], sums[(2 * v_count) + v_i]};
     }
-    point += v_bases[i] * temp;
   }
-  return point;
 }
 
-std::vector<Point3D>
-BSplineSurface::EvaluatePoints(uint32_t u_sample_count,
-                               uint32_t v_sample_count) const {
-  std::vector<Point3D> points(u_sample_count * v_sample_count, {0, 0, 0});
-  double u_div =
-      (u_interval_.y - u_interval_.x) / static_cast<double>(u_sample_count - 1);
-  double v_div =
-      (v_interval_.y - v_interval_.x) / static_cast<double>(v_sample_count - 1);
-  for (uint32_t u_i = 0; u_i < u_sample_count; ++u_i) {
-    Point2D uv = {u_interval_.x + static_cast<double>(u_i) * u_div, 0};
-    uint32_t u_span =
-        knots::FindSpanParam(u_degree_, u_knots_, uv.x, kTolerance);
-    std::vector<double> u_bases =
-        knots::BasisFuns(u_span, uv.x, u_degree_, u_knots_, kTolerance);
-    uint32_t u_ind = u_span - u_degree_;
-    for (uint32_t v_i = 0; v_i < v_sample_count; ++v_i) {
-      uv.y = v_interval_.x + static_cast<double>(v_i) * v_div;
-      uint32_t v_span =
-          knots::FindSpanParam(v_degree_, v_knots_, uv.y, kTolerance);
-      std::vector<double> v_bases =
-          knots::BasisFuns(v_span, uv.y, v_degree_, v_knots_, kTolerance);
-      for (uint32_t i = 0; i <= v_degree_; ++i) {
-        Point3D temp = {0.0, 0.0, 0.0};
-        uint32_t v_ind = v_span - v_degree_ + i;
-        for (uint32_t j = 0; j <= u_degree_; ++j) {
-          temp += u_bases[j] * control_polygon_[u_ind + j][v_ind];
+// ALGORITHM A3.6 over a grid. The basis derivatives of every u and v sample
+// come from cached tables, each u row is summed once per u derivative and
+// then contracted with every v derivative it pairs with.
+void BSplineSurface::EvaluateGridDerivatives(const double *u_params,
+                                             size_t u_count,
+                                             const double *v_params,
+                                             size_t v_count,
+                                             bool second_partials,
+                                             GridDerivatives &grid) const {
+  grid.Resize(u_count * v_count, second_partials);
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const uint32_t d = second_partials ? 2 : 1;
+  const size_t order = static_cast<size_t>(d) + 1;
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table =
+      cache.Get(u_degree_, u_knots_, u_params, u_count, kTolerance, d);
+  std::shared_ptr<const knots::BasisTable> v_table =
+      cache.Get(v_degree_, v_knots_, v_params, v_count, kTolerance, d);
+  const uint32_t *v_spans = v_table->spans();
+  const size_t first_col =
+      *std::min_element(v_spans, v_spans + v_count) - v_degree_;
+  const size_t end_col = *std::max_element(v_spans, v_spans + v_count) + 1;
+  const size_t stride = control_polygon_.stride();
+  std::vector<double> u_bases(u_degree_ + 1);
+  std::vector<double> row(control_polygon_.cols());
+  // Plane c of SKL[k][l] for the current row starts at
+  // sums[(((k * order) + l) * 3 + c) * v_count], orders above the degrees
+  // stay zero
+  std::vector<double> sums(order * order * 3 * v_count, 0.0);
+  auto at = [&](size_t k, size_t l, uint32_t c) {
+    return sums.data() + (((((k * order) + l) * 3) + c) * v_count);
+  };
+  for (size_t u_i = 0; u_i < u_count; ++u_i) {
+    const size_t offset =
+        control_polygon_.Index(u_table->span(u_i) - u_degree_, first_col);
+    for (uint32_t k = 0; k <= u_table->derivatives(); ++k) {
+      for (uint32_t j = 0; j <= u_degree_; ++j) {
+        u_bases[j] = u_table->derivative(k, j, u_i);
+      }
+      const uint32_t v_max = std::min(d - k, v_table->derivatives());
+      for (uint32_t c = 0; c < 3; ++c) {
+        simd::WeightedRowSum(u_bases.data(), u_degree_ + 1,
+                             control_polygon_.plane(c) + offset, stride,
+                             end_col - first_col, row.data() + first_col);
+        for (uint32_t l = 0; l <= v_max; ++l) {
+          simd::ContractSamples(*v_table, row.data(), at(k, l, c), l);
         }
-        points[(u_i * v_sample_count) + v_i] += v_bases[i] * temp;
+      }
+    }
+    auto point = [&](size_t k, size_t l, size_t v_i) {
+      return Point3D{at(k, l, 0)[v_i], at(k, l, 1)[v_i], at(k, l, 2)[v_i]};
+    };
+    for (size_t v_i = 0; v_i < v_count; ++v_i) {
+      const size_t index = (u_i * v_count) + v_i;
+      grid.points[index] = point(0, 0, v_i);
+      grid.u_partials[index] = point(1, 0, v_i);
+      grid.v_partials[index] = point(0, 1, v_i);
+      if (second_partials) {
+        grid.uu_partials[index] = point(2, 0, v_i);
+        grid.uv_partials[index] = point(1, 1, v_i);
+        grid.vv_partials[index] = point(0, 2, v_i);
       }
     }
   }
-  return points;
+  FillNormals(u_params, u_count, v_params, v_count, grid);
 }
 
 // Chaper 3, ALGORITHM A3.6: SurfaceDerivsA1g1(n, p, U, m, q, V, P, u, v, d,
@@ -86,25 +173,32 @@ BSplineSurface::Derivative(Point2D uv, uint32_t max_derivative) const {
   for (auto &vec : derivs) {
     vec = std::vector<Point3D>(max_derivative + 1, {0, 0, 0});
   }
-  uint32_t u_span = knots::FindSpanParam(u_degree_, u_knots_, uv.x, kTolerance);
-  std::vector<std::vector<double>> u_derivs =
-      knots::DersBasisFuns(u_span, uv.x, u_degree_, max_deriv_u, u_knots_);
-  uint32_t v_span = knots::FindSpanParam(v_degree_, v_knots_, uv.y, kTolerance);
-  std::vector<std::vector<double>> v_derivs =
-      knots::DersBasisFuns(v_span, uv.y, v_degree_, max_deriv_v, v_knots_);
+  knots::BasisScratch &u_scratch = knots::ThreadScratch(0);
+  knots::BasisScratch &v_scratch = knots::ThreadScratch(1);
+  u_scratch.Reserve(u_degree_, max_deriv_u);
+  v_scratch.Reserve(v_degree_, max_deriv_v);
+  const double *u_derivs = u_scratch.ders.data();
+  const double *v_derivs = v_scratch.ders.data();
+  uint32_t u_span = u_span_locator_.Find(uv.x);
+  knots::DersBasisFuns(u_span, uv.x, u_degree_, max_deriv_u, u_knots_,
+                       u_scratch.ders.data(), u_scratch);
+  uint32_t v_span = v_span_locator_.Find(uv.y);
+  knots::DersBasisFuns(v_span, uv.y, v_degree_, max_deriv_v, v_knots_,
+                       v_scratch.ders.data(), v_scratch);
   for (uint32_t i = 0; i <= max_deriv_u; ++i) {
     std::vector<Point3D> temp_derivs(v_degree_ + 1, {0, 0, 0});
     for (uint32_t j = 0; j <= v_degree_; ++j) {
       for (uint32_t k = 0; k <= u_degree_; ++k) {
         temp_derivs[j] +=
-            u_derivs[i][k] *
-            control_polygon_[u_span - u_degree_ + k][v_span - v_degree_ + j];
+            u_derivs[(i * (u_degree_ + 1)) + k] *
+            control_polygon_(u_span - u_degree_ + k, v_span - v_degree_ + j);
       }
     }
     uint32_t dd = std::min(max_derivative - i, max_deriv_v);
     for (uint32_t j = 0; j <= dd; ++j) {
       for (uint32_t k = 0; k <= v_degree_; ++k) {
-        derivs[i][j] += v_derivs[j][k] * temp_derivs[k];
+        derivs[i][j] +=
+            v_derivs[(j * (v_degree_ + 1)) + k] * temp_derivs[k];
       }
     }
   }
@@ -123,8 +217,8 @@ BSplineSurface::SurfaceDerivCpts(uint32_t d, uint32_t r_start, uint32_t r_end,
   // Not sure which one is r and s, but one should span the u direction and the
   // other the v direction... I think R is u and s if v, but I will update after
   // I get this working
-  r_end = std::min(static_cast<size_t>(r_end), control_polygon_.size() - 1);
-  s_end = std::min(static_cast<size_t>(s_end), control_polygon_[0].size() - 1);
+  r_end = std::min(static_cast<size_t>(r_end), control_polygon_.rows() - 1);
+  s_end = std::min(static_cast<size_t>(s_end), control_polygon_.cols() - 1);
 
   uint32_t du = std::min(d, u_degree_);
   uint32_t dv = std::min(d, v_degree_);
@@ -147,8 +241,8 @@ BSplineSurface::SurfaceDerivCpts(uint32_t d, uint32_t r_start, uint32_t r_end,
     // Not really sure wtf &P[][j] is... but I assume it is a vector from
     // P[0][j] to P[n][j].
     std::vector<Point3D> control_points;
-    for (size_t u = 0; u < control_polygon_.size(); ++u) {
-      control_points.push_back(control_polygon_[u][j]);
+    for (size_t u = 0; u < control_polygon_.rows(); ++u) {
+      control_points.push_back(control_polygon_(u, j));
     }
     BSplineCurve3D curve(u_degree_, control_points, u_knots_);
     std::vector<std::vector<Point3D>> temp =
@@ -199,12 +293,18 @@ BSplineSurface::Derivatives2(Point2D uv, uint32_t max_derivative) const {
     }
   }
 
-  uint32_t u_span = knots::FindSpanParam(u_degree_, u_knots_, uv.x, kTolerance);
-  std::vector<std::vector<double>> u_basis =
-      knots::AllBasisFuns(u_span, uv.x, u_degree_, u_knots_);
-  uint32_t v_span = knots::FindSpanParam(v_degree_, v_knots_, uv.y, kTolerance);
-  std::vector<std::vector<double>> v_basis =
-      knots::AllBasisFuns(v_span, uv.y, v_degree_, v_knots_);
+  knots::BasisScratch &u_scratch = knots::ThreadScratch(0);
+  knots::BasisScratch &v_scratch = knots::ThreadScratch(1);
+  u_scratch.Reserve(u_degree_, u_degree_);
+  v_scratch.Reserve(v_degree_, v_degree_);
+  const double *u_basis = u_scratch.ders.data();
+  const double *v_basis = v_scratch.ders.data();
+  uint32_t u_span = u_span_locator_.Find(uv.x);
+  knots::AllBasisFuns(u_span, uv.x, u_degree_, u_knots_,
+                      u_scratch.ders.data(), u_scratch);
+  uint32_t v_span = v_span_locator_.Find(uv.y);
+  knots::AllBasisFuns(v_span, uv.y, v_degree_, v_knots_,
+                      v_scratch.ders.data(), v_scratch);
 
   auto surf_ctps = SurfaceDerivCpts(max_derivative, u_span - u_degree_, u_span,
                                     v_span - v_degree_, v_span);
@@ -216,13 +316,36 @@ BSplineSurface::Derivatives2(Point2D uv, uint32_t max_derivative) const {
       for (uint32_t i = 0; i <= v_degree_ - l; ++i) {
         Point3D temp = {0.0, 0.0, 0.0};
         for (uint32_t j = 0; j <= u_degree_ - k; ++j) {
-          temp += u_basis[j][u_degree_ - k] * surf_ctps[k][l][j][i];
+          temp += u_basis[(j * (u_degree_ + 1)) + u_degree_ - k] *
+                  surf_ctps[k][l][j][i];
         }
-        derivatives[k][l] += v_basis[i][v_degree_ - l] * temp;
+        derivatives[k][l] +=
+            v_basis[(i * (v_degree_ + 1)) + v_degree_ - l] * temp;
       }
     }
   }
 
   return derivatives;
 }
+
+std::vector<Point3D>
+BSplineSurface::StepPoints(uint32_t u_sample_count,
+                           uint32_t v_sample_count) const {
+  if (u_sample_count < 2 || v_sample_count < 2 ||
+      !forward::SplineStepPlan::Pays(v_degree_, v_knots_, v_interval_,
+                                     v_sample_count)) {
+    return EvaluatePoints(u_sample_count, v_sample_count);
+  }
+  const std::vector<double> u_params =
+      SampleParams(u_interval_, u_sample_count);
+  std::shared_ptr<const knots::BasisTable> u_table =
+      knots::BasisTableCache::Shared().Get(u_degree_, u_knots_,
+                                           u_params.data(), u_sample_count,
+                                           kTolerance);
+  const forward::SplineStepPlan v_plan(v_degree_, v_knots_, v_interval_,
+                                       v_sample_count, kTolerance);
+  std::vector<Point3D> points(u_sample_count * v_sample_count);
+  forward::StepGrid(control_polygon_, *u_table, v_plan, points.data());
+  return points;
+}
 } // namespace nurbs
\ No newline at end of file
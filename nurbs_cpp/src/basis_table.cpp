@@ -0,0 +1,175 @@
+#include "include/basis_table.hpp"
+
+// NURBS
+#include "include/grid_kernels.hpp"
+#include "include/knot_utility_functions.hpp"
+#include "include/uniform_cubic.hpp"
+
+// STD
+#include <algorithm>
+#include <cstring>
+
+namespace nurbs {
+namespace knots {
+namespace {
+// FNV-1a over the bits of the values
+uint64_t HashValues(const double *values, size_t count, uint64_t hash) {
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t bits;
+    std::memcpy(&bits, values + i, sizeof(bits));
+    hash = (hash ^ bits) * 1099511628211ull;
+  }
+  return hash;
+}
+
+bool SameValues(const std::vector<double> &lhs, const double *rhs,
+                size_t count) {
+  return lhs.size() == count &&
+         (count == 0 ||
+          std::memcmp(lhs.data(), rhs, count * sizeof(double)) == 0);
+}
+} // namespace
+
+BasisTable::BasisTable(uint32_t degree, const std::vector<double> &knots,
+                       const double *params, size_t count, double tolerance,
+                       uint32_t derivatives) {
+  Build(degree, knots, params, count, tolerance, derivatives);
+}
+
+void BasisTable::Build(uint32_t degree, const std::vector<double> &knots,
+                       const double *params, size_t count, double tolerance,
+                       uint32_t derivatives) {
+  degree_ = degree;
+  derivatives_ = std::min(derivatives, degree);
+  count_ = count;
+  spans_.resize(count);
+  values_.resize((derivatives_ + 1) * (degree + 1) * count);
+  BasisScratch &scratch = ThreadScratch(0);
+  scratch.Reserve(degree, derivatives_);
+  double *bases = scratch.bases.data();
+  double *ders = scratch.ders.data();
+  uint32_t span = degree;
+  for (size_t s = 0; s < count; ++s) {
+    span = FindSpanParam(degree, knots, params[s], tolerance, span);
+    spans_[s] = span;
+  }
+  // Uniform cubic spans take the basis matrix, a vector of samples at a time.
+  // The local parameters of the other samples are left at zero and their
+  // values overwritten below.
+  const UniformCubicSpans uniform(degree, knots);
+  if (!uniform.empty()) {
+    std::vector<double> local(count, 0.0);
+    for (size_t s = 0; s < count; ++s) {
+      if (uniform.Contains(spans_[s])) {
+        local[s] = uniform.Local(spans_[s], params[s], knots);
+      }
+    }
+    simd::UniformCubicBasis(local.data(), count, values_.data(), count);
+  }
+  for (size_t s = 0; s < count; ++s) {
+    span = spans_[s];
+    // The values come from the same kernels as the point evaluators, even
+    // with derivatives, so they match bit for bit
+    if (!uniform.Contains(span)) {
+      BasisFuns(span, params[s], degree, knots, tolerance, bases, scratch);
+      for (uint32_t i = 0; i <= degree; ++i) {
+        values_[(i * count) + s] = bases[i];
+      }
+    }
+    if (derivatives_ == 0) {
+      continue;
+    }
+    DersBasisFuns(span, params[s], degree, derivatives_, knots, ders, scratch);
+    for (uint32_t k = 1; k <= derivatives_; ++k) {
+      for (uint32_t i = 0; i <= degree; ++i) {
+        const size_t row = (k * (degree + 1)) + i;
+        values_[(row * count) + s] = ders[row];
+      }
+    }
+  }
+}
+
+BasisTableCache::BasisTableCache(size_t capacity) : capacity_(capacity) {}
+
+BasisTableCache &BasisTableCache::Shared() {
+  static BasisTableCache cache;
+  return cache;
+}
+
+std::shared_ptr<const BasisTable>
+BasisTableCache::Get(uint32_t degree, const std::vector<double> &knots,
+                     const double *params, size_t count, double tolerance,
+                     uint32_t derivatives) {
+  uint64_t hash = 14695981039346656037ull;
+  hash = HashValues(knots.data(), knots.size(), hash);
+  hash = HashValues(params, count, hash);
+  auto matches = [&](const Entry &entry) {
+    return entry.hash == hash && entry.degree == degree &&
+           entry.derivatives == derivatives && entry.tolerance == tolerance &&
+           entry.knots == knots && SameValues(entry.params, params, count);
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = std::find_if(entries_.begin(), entries_.end(), matches);
+    if (found != entries_.end()) {
+      ++hits_;
+      entries_.splice(entries_.begin(), entries_, found);
+      return found->table;
+    }
+    ++misses_;
+  }
+
+  auto table = std::make_shared<const BasisTable>(degree, knots, params, count,
+                                                  tolerance, derivatives);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (capacity_ == 0) {
+    return table;
+  }
+  // Another thread may have built the same table in the meantime
+  auto found = std::find_if(entries_.begin(), entries_.end(), matches);
+  if (found != entries_.end()) {
+    entries_.splice(entries_.begin(), entries_, found);
+    return found->table;
+  }
+  entries_.push_front({hash, degree, derivatives, tolerance, knots,
+                       std::vector<double>(params, params + count), table});
+  if (entries_.size() > capacity_) {
+    entries_.pop_back();
+  }
+  return table;
+}
+
+void BasisTableCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+void BasisTableCache::capacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  while (entries_.size() > capacity_) {
+    entries_.pop_back();
+  }
+}
+
+size_t BasisTableCache::capacity() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return capacity_;
+}
+
+size_t BasisTableCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+uint64_t BasisTableCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t BasisTableCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+} // namespace knots
+} // namespace nurbs
@@ -1,13 +1,97 @@
 #include "include/bezier_curve.hpp"
 
+#include "include/bezier_set.hpp"
+#include "include/forward_difference.hpp"
+#include "include/grid_kernels.hpp"
+
+// STD
+#include <exception>
+
 namespace nurbs {
+namespace {
+// Coordinate c of a point, w is 1 for points that have none
+double Coord(const Point2D &point, uint32_t c) {
+  return c == 0 ? point.x : point.y;
+}
+double Coord(const Point3D &point, uint32_t c) {
+  return c == 0 ? point.x : (c == 1 ? point.y : point.z);
+}
+double Coord(const Point4D &point, uint32_t c) {
+  return c == 0 ? point.x : (c == 1 ? point.y : (c == 2 ? point.z : point.w));
+}
+
+void Store(const double *const *coords, size_t s, Point2D &point) {
+  point = {coords[0][s], coords[1][s]};
+}
+void Store(const double *const *coords, size_t s, Point3D &point) {
+  point = {coords[0][s], coords[1][s], coords[2][s]};
+}
+
+// Each coordinate of a segment is a weighted sum of the degree + 1 Bernstein
+// rows. Rational segments carry the weight as their last coordinate and are
+// divided by it.
+template <uint32_t kPlanes, bool kRational, typename InT, typename OutT>
+void EvaluateSegments(const BernsteinMatrix &matrix,
+                      const InT *control_points, size_t segment_count,
+                      OutT *points) {
+  const uint32_t order = matrix.degree() + 1;
+  const size_t count = matrix.size();
+  std::vector<double> weights(order);
+  std::vector<double> sums(kPlanes * count);
+  const double *coords[kPlanes];
+  for (uint32_t c = 0; c < kPlanes; ++c) {
+    coords[c] = sums.data() + (c * count);
+  }
+  for (size_t k = 0; k < segment_count; ++k) {
+    const InT *segment = control_points + (k * order);
+    for (uint32_t c = 0; c < kPlanes; ++c) {
+      for (uint32_t i = 0; i < order; ++i) {
+        weights[i] = Coord(segment[i], c);
+      }
+      simd::WeightedRowSum(weights.data(), order, matrix.values(0), count,
+                           count, sums.data() + (c * count));
+    }
+    if (kRational) {
+      for (uint32_t c = 0; c + 1 < kPlanes; ++c) {
+        simd::Divide(sums.data() + (c * count), coords[kPlanes - 1], count);
+      }
+    }
+    OutT *out = points + (k * count);
+    for (size_t s = 0; s < count; ++s) {
+      Store(coords, s, out[s]);
+    }
+  }
+}
+
+template <typename PointT, typename CurveT>
+std::vector<PointT> EvaluateCurves(const BernsteinMatrix &matrix,
+                                   const std::vector<CurveT> &segments) {
+  const size_t order = matrix.degree() + 1;
+  std::vector<PointT> control_points;
+  control_points.reserve(segments.size() * order);
+  for (const CurveT &segment : segments) {
+    if (segment.control_points().size() != order) {
+      throw std::exception("Bezier segment degree does not match the matrix");
+    }
+    control_points.insert(control_points.end(),
+                          segment.control_points().begin(),
+                          segment.control_points().end());
+  }
+  std::vector<PointT> points(segments.size() * matrix.size());
+  matrix.Evaluate(control_points.data(), segments.size(), points.data());
+  return points;
+}
+} // namespace
+
 ///
 /// Bezier Curve Utility
 ///
 
 // Chaper 1, Algorithm A1.2 Bernstein, p20
 double BezierCurveUtil::Bernstein(size_t index, size_t n, double u) {
-  std::vector<double> temp(n + 1, 0);
+  // Reused between calls, only the first n + 1 entries are read
+  thread_local std::vector<double> temp;
+  temp.assign(n + 1, 0.0);
   temp[n - index] = 1.0;
   double u_inverse = 1.0 - u;
   for (size_t i = 1; i <= n; ++i) {
@@ -39,6 +123,74 @@ std::vector<double> BezierCurveUtil::AllBernstein(size_t n, double u) {
   return bernstein;
 }
 
+///
+/// Bernstein Matrix
+///
+
+BernsteinMatrix::BernsteinMatrix(uint32_t degree, const double *params,
+                                 size_t count)
+    : degree_(degree), count_(count), values_((degree + 1) * count) {
+  // ALGORITHM A1.3 AllBernstein for every sample, written basis major
+  std::vector<double> bernstein(degree + 1);
+  for (size_t s = 0; s < count; ++s) {
+    const double u = params[s];
+    const double u_inverse = 1.0 - u;
+    bernstein[0] = 1.0;
+    for (uint32_t i = 1; i <= degree; ++i) {
+      double saved = 0.0;
+      for (uint32_t j = 0; j < i; ++j) {
+        const double temp = bernstein[j];
+        bernstein[j] = saved + (u_inverse * temp);
+        saved = u * temp;
+      }
+      bernstein[i] = saved;
+    }
+    for (uint32_t i = 0; i <= degree; ++i) {
+      values_[(i * count) + s] = bernstein[i];
+    }
+  }
+}
+
+BernsteinMatrix::BernsteinMatrix(uint32_t degree,
+                                 const std::vector<double> &params)
+    : BernsteinMatrix(degree, params.data(), params.size()) {}
+
+void BernsteinMatrix::Evaluate(const Point2D *control_points,
+                               size_t segment_count, Point2D *points) const {
+  EvaluateSegments<2, false>(*this, control_points, segment_count, points);
+}
+
+void BernsteinMatrix::Evaluate(const Point3D *control_points,
+                               size_t segment_count, Point3D *points) const {
+  EvaluateSegments<3, false>(*this, control_points, segment_count, points);
+}
+
+void BernsteinMatrix::Evaluate(const Point4D *control_points,
+                               size_t segment_count, Point3D *points) const {
+  EvaluateSegments<4, true>(*this, control_points, segment_count, points);
+}
+
+std::vector<Point2D>
+BernsteinMatrix::Evaluate(const std::vector<BezierCurve2D> &segments) const {
+  return EvaluateCurves<Point2D>(*this, segments);
+}
+
+std::vector<Point3D>
+BernsteinMatrix::Evaluate(const std::vector<BezierCurve3D> &segments) const {
+  return EvaluateCurves<Point3D>(*this, segments);
+}
+
+// The arena already is the layout the kernels take, so nothing is gathered
+std::vector<Point3D>
+BernsteinMatrix::Evaluate(const BezierSegmentSet &segments) const {
+  if (!segments.empty() && segments.degree() != degree_) {
+    throw std::exception("Bezier segment degree does not match the matrix");
+  }
+  std::vector<Point3D> points(segments.size() * count_);
+  Evaluate(segments.points().data(), segments.size(), points.data());
+  return points;
+}
+
 ///
 /// 2D Bezier Curve
 ///
@@ -53,6 +205,16 @@ Point2D BezierCurve2D::EvaluateCurve(double u) const {
   return DeCasteljau(u);
 }
 
+std::vector<Point2D>
+BezierCurve2D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2) {
+    return EvaluateCurvePoints(point_count);
+  }
+  return forward::StepPowerBasis(
+      BezierCurveUtil::PowerBasis(control_points_), 0.0,
+      1.0 / static_cast<double>(point_count - 1), point_count);
+}
+
 // Chaper 1, Equation 1.9 derivative of a Bezier curve, p22
 // This is probably wrong
 Point2D BezierCurve2D::Derivative(double u) const {
@@ -117,6 +279,16 @@ Point3D BezierCurve3D::EvaluateCurve(double u) const {
   return DeCasteljau(u);
 }
 
+std::vector<Point3D>
+BezierCurve3D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2) {
+    return EvaluateCurvePoints(point_count);
+  }
+  return forward::StepPowerBasis(
+      BezierCurveUtil::PowerBasis(control_points_), 0.0,
+      1.0 / static_cast<double>(point_count - 1), point_count);
+}
+
 // Chaper 1, Equation 1.9 derivative of a Bezier curve, p22
 Point3D BezierCurve3D::Derivative(double u) const {
   u = LocalizeClampInterval(u);
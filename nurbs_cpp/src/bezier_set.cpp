@@ -0,0 +1,198 @@
+#include "include/bezier_set.hpp"
+
+// STD
+#include <algorithm>
+
+namespace nurbs {
+namespace {
+// Index of the interval of breaks that holds param, clamped to the first and
+// last interval. breaks needs at least two values.
+size_t FindInterval(const std::vector<double> &breaks, double param) {
+  auto it = std::upper_bound(breaks.begin() + 1, breaks.end() - 1, param);
+  return static_cast<size_t>(it - breaks.begin()) - 1;
+}
+
+// Same mapping as Curve3D::LocalizeClampInterval
+double Localize(double param, Point2D interval) {
+  param = std::clamp(param, interval.x, interval.y);
+  return (param - interval.x) * (1.0 / (interval.y - interval.x));
+}
+
+void Include(ControlHullBounds &bounds, const Point3D &point) {
+  bounds.min = {std::min(bounds.min.x, point.x),
+                std::min(bounds.min.y, point.y),
+                std::min(bounds.min.z, point.z)};
+  bounds.max = {std::max(bounds.max.x, point.x),
+                std::max(bounds.max.y, point.y),
+                std::max(bounds.max.z, point.z)};
+}
+} // namespace
+
+///
+/// Bezier Segment Set
+///
+
+void BezierSegmentSet::Reset(uint32_t degree, std::vector<double> breaks) {
+  degree_ = degree;
+  breaks_ = std::move(breaks);
+  points_.assign(size() * (degree_ + 1), Point4D());
+}
+
+size_t BezierSegmentSet::Find(double param) const {
+  return FindInterval(breaks_, param);
+}
+
+Point3D BezierSegmentSet::EvaluateSegment(size_t k, double t) const {
+  thread_local std::vector<Point4D> scratch;
+  const Point4D *points = control_points(k);
+  scratch.assign(points, points + degree_ + 1);
+  const double t_inverse = 1.0 - t;
+  for (uint32_t r = 1; r <= degree_; ++r) {
+    for (uint32_t i = 0; i <= degree_ - r; ++i) {
+      scratch[i] = (t_inverse * scratch[i]) + (t * scratch[i + 1]);
+    }
+  }
+  const Point4D &point = scratch[0];
+  return Point3D(point.x, point.y, point.z) / point.w;
+}
+
+Point3D BezierSegmentSet::EvaluatePoint(double param) const {
+  if (empty()) {
+    return {0.0, 0.0, 0.0};
+  }
+  const size_t k = Find(param);
+  return EvaluateSegment(k, Localize(param, interval(k)));
+}
+
+ControlHullBounds BezierSegmentSet::Bounds(size_t k) const {
+  const Point4D *points = control_points(k);
+  const Point3D first =
+      Point3D(points[0].x, points[0].y, points[0].z) / points[0].w;
+  ControlHullBounds bounds = {first, first};
+  for (uint32_t i = 1; i <= degree_; ++i) {
+    Include(bounds,
+            Point3D(points[i].x, points[i].y, points[i].z) / points[i].w);
+  }
+  return bounds;
+}
+
+BezierCurve3D BezierSegmentSet::Segment(size_t k) const {
+  const Point4D *points = control_points(k);
+  std::vector<Point3D> projected;
+  projected.reserve(degree_ + 1);
+  for (uint32_t i = 0; i <= degree_; ++i) {
+    projected.emplace_back(Point3D(points[i].x, points[i].y, points[i].z) /
+                           points[i].w);
+  }
+  return BezierCurve3D(std::move(projected));
+}
+
+///
+/// Bezier Patch Set
+///
+
+void BezierPatchSet::Reset(uint32_t u_degree, uint32_t v_degree,
+                           std::vector<double> u_breaks,
+                           std::vector<double> v_breaks) {
+  u_degree_ = u_degree;
+  v_degree_ = v_degree;
+  u_breaks_ = std::move(u_breaks);
+  v_breaks_ = std::move(v_breaks);
+  net_.Resize(u_count() * (u_degree_ + 1), v_count() * (v_degree_ + 1));
+}
+
+// Every column of the patch is reduced along u and the results along v, plane
+// by plane. The weights are skipped when they are all one, like
+// BezierSurface does for nonrational patches.
+Point3D BezierPatchSet::EvaluatePatch(size_t i, size_t j, Point2D uv) const {
+  const size_t rows = u_degree_ + 1;
+  const size_t cols = v_degree_ + 1;
+  const size_t first = Offset(i, j);
+  const size_t stride = net_.stride();
+  bool rational = false;
+  const double *weights = net_.plane(3) + first;
+  for (size_t u = 0; u < rows; ++u) {
+    for (size_t v = 0; v < cols; ++v) {
+      rational = rational || weights[(u * stride) + v] != 1.0;
+    }
+  }
+
+  thread_local std::vector<double> buffer;
+  if (buffer.size() < rows + cols) {
+    buffer.resize(rows + cols);
+  }
+  double *column = buffer.data();
+  double *reduced = buffer.data() + rows;
+  const double u_inverse = 1.0 - uv.x;
+  const double v_inverse = 1.0 - uv.y;
+  double coords[4] = {0.0, 0.0, 0.0, 1.0};
+  const uint32_t planes = rational ? 4 : 3;
+  for (uint32_t c = 0; c < planes; ++c) {
+    const double *plane = net_.plane(c) + first;
+    for (size_t v = 0; v < cols; ++v) {
+      for (size_t u = 0; u < rows; ++u) {
+        column[u] = plane[(u * stride) + v];
+      }
+      for (size_t k = 1; k < rows; ++k) {
+        for (size_t u = 0; u < rows - k; ++u) {
+          column[u] = (u_inverse * column[u]) + (uv.x * column[u + 1]);
+        }
+      }
+      reduced[v] = column[0];
+    }
+    for (size_t k = 1; k < cols; ++k) {
+      for (size_t v = 0; v < cols - k; ++v) {
+        reduced[v] = (v_inverse * reduced[v]) + (uv.y * reduced[v + 1]);
+      }
+    }
+    coords[c] = reduced[0];
+  }
+  if (rational) {
+    return {coords[0] / coords[3], coords[1] / coords[3],
+            coords[2] / coords[3]};
+  }
+  return {coords[0], coords[1], coords[2]};
+}
+
+Point3D BezierPatchSet::EvaluatePoint(Point2D uv) const {
+  if (empty()) {
+    return {0.0, 0.0, 0.0};
+  }
+  const size_t i = FindInterval(u_breaks_, uv.x);
+  const size_t j = FindInterval(v_breaks_, uv.y);
+  return EvaluatePatch(i, j,
+                       {Localize(uv.x, u_interval(i)),
+                        Localize(uv.y, v_interval(j))});
+}
+
+ControlHullBounds BezierPatchSet::Bounds(size_t i, size_t j) const {
+  const size_t row = i * (u_degree_ + 1);
+  const size_t col = j * (v_degree_ + 1);
+  const Point4D corner = net_.Get(row, col);
+  const Point3D first = Point3D(corner.x, corner.y, corner.z) / corner.w;
+  ControlHullBounds bounds = {first, first};
+  for (size_t u = 0; u <= u_degree_; ++u) {
+    for (size_t v = 0; v <= v_degree_; ++v) {
+      const Point4D point = net_.Get(row + u, col + v);
+      Include(bounds, Point3D(point.x, point.y, point.z) / point.w);
+    }
+  }
+  return bounds;
+}
+
+BezierSurface BezierPatchSet::Patch(size_t i, size_t j) const {
+  const size_t rows = u_degree_ + 1;
+  const size_t cols = v_degree_ + 1;
+  const size_t first = Offset(i, j);
+  ControlNet<Point4D> patch(rows, cols);
+  for (uint32_t c = 0; c < ControlNet<Point4D>::kDimension; ++c) {
+    const double *in = net_.plane(c) + first;
+    double *out = patch.plane(c);
+    for (size_t u = 0; u < rows; ++u) {
+      std::copy(in + (u * net_.stride()), in + (u * net_.stride()) + cols,
+                out + patch.Index(u, 0));
+    }
+  }
+  return BezierSurface(std::move(patch));
+}
+} // namespace nurbs
@@ -1,36 +1,269 @@
 #include "include/bezier_surface.hpp"
 
+#include "include/tensor_grid.hpp"
+
+// STD
+#include <algorithm>
+#include <memory>
+
 namespace nurbs {
-    BezierSurface::BezierSurface(std::vector<BezierCurve3D> curves, Point2D u_interval,
-        Point2D v_interval) : Surface(u_interval, v_interval), curves_(curves) {}
+namespace {
+ControlNet<Point4D> NetFromCurves(const std::vector<BezierCurve3D> &curves) {
+  const size_t rows = curves.empty() ? 0 : curves[0].control_points().size();
+  ControlNet<Point4D> net(rows, curves.size());
+  for (size_t v = 0; v < curves.size(); ++v) {
+    const std::vector<Point3D> &points = curves[v].control_points();
+    for (size_t u = 0; u < rows; ++u) {
+      net.Set(u, v, {points[u].x, points[u].y, points[u].z, 1.0});
+    }
+  }
+  return net;
+}
 
+ControlNet<Point4D>
+NetFromPoints(const std::vector<std::vector<Point3D>> &points) {
+  ControlNet<Point4D> net(points.size(), points.empty() ? 0 : points[0].size());
+  for (size_t u = 0; u < net.rows(); ++u) {
+    for (size_t v = 0; v < net.cols(); ++v) {
+      const Point3D &point = points[u][v];
+      net.Set(u, v, {point.x, point.y, point.z, 1.0});
+    }
+  }
+  return net;
+}
 
-    Point3D BezierSurface::EvaluatePoint(Point2D uv) const {
-        std::vector<Point3D> control_points;
-        for (const auto& curve : curves_) {
-            control_points.push_back(curve.EvaluateCurve(uv.x));
-        }
-        const BezierCurve3D curve(control_points, v_interval_);
-        return curve.EvaluateCurve(uv.y);
+std::vector<double> BezierKnots(uint32_t degree) {
+  std::vector<double> knots(degree + 1, 0.0);
+  knots.insert(knots.end(), degree + 1, 1.0);
+  return knots;
+}
+
+// Same mapping as Curve3D::LocalizeClampInterval
+double Localize(double param, Point2D interval) {
+  param = std::clamp(param, interval.x, interval.y);
+  return (param - interval.x) * (1.0 / (interval.y - interval.x));
+}
+} // namespace
+
+BezierSurface::BezierSurface(const std::vector<BezierCurve3D> &curves,
+                             Point2D u_interval, Point2D v_interval)
+    : BezierSurface(NetFromCurves(curves), u_interval, v_interval) {}
+
+BezierSurface::BezierSurface(
+    const std::vector<std::vector<Point3D>> &control_points,
+    Point2D u_interval, Point2D v_interval)
+    : BezierSurface(NetFromPoints(control_points), u_interval, v_interval) {}
+
+BezierSurface::BezierSurface(ControlNet<Point4D> control_net,
+                             Point2D u_interval, Point2D v_interval)
+    : Surface(u_interval, v_interval), control_net_(std::move(control_net)) {
+  if (!control_net_.empty() && control_net_.cols() > 0) {
+    u_degree_ = static_cast<uint32_t>(control_net_.rows() - 1);
+    v_degree_ = static_cast<uint32_t>(control_net_.cols() - 1);
+  }
+  const double *weights = control_net_.plane(3);
+  for (size_t u = 0; u < control_net_.rows(); ++u) {
+    for (size_t v = 0; v < control_net_.cols(); ++v) {
+      rational_ = rational_ || weights[control_net_.Index(u, v)] != 1.0;
+    }
+  }
+  u_knots_ = BezierKnots(u_degree_);
+  v_knots_ = BezierKnots(v_degree_);
+}
+
+// Chapter 1, ALGORITHM A1.7 DeCasteljau2(P, n, m, u0, v0, S) p39
+// Every column is reduced along u and the results along v, plane by plane,
+// with the same operations as BezierCurve3D::DeCasteljau
+Point3D BezierSurface::EvaluatePoint(Point2D uv) const {
+  if (control_net_.empty() || control_net_.cols() == 0) {
+    return {0.0, 0.0, 0.0};
+  }
+  const size_t cols = control_net_.cols();
+  thread_local std::vector<double> buffer;
+  if (buffer.size() < control_net_.rows() + (5 * cols)) {
+    buffer.resize(control_net_.rows() + (5 * cols));
+  }
+  double *reduced = buffer.data();
+  ReduceColumns(Localize(uv.x, u_interval_), buffer.data() + (4 * cols),
+                reduced);
+  return ReduceRow(Localize(uv.y, v_interval_), reduced,
+                   buffer.data() + (4 * cols));
+}
+
+// De Casteljau a u row at a time, so the points match EvaluatePoint exactly
+std::vector<Point3D> BezierSurface::EvaluatePoints(
+    uint32_t u_sample_count, uint32_t v_sample_count) const {
+  std::vector<Point3D> points(u_sample_count * v_sample_count);
+  if (control_net_.empty() || control_net_.cols() == 0) {
+    return points;
+  }
+  const std::vector<double> u_params =
+      SampleParams(u_interval_, u_sample_count);
+  const std::vector<double> v_params =
+      SampleParams(v_interval_, v_sample_count);
+  const size_t cols = control_net_.cols();
+  std::vector<double> buffer(control_net_.rows() + (5 * cols));
+  double *reduced = buffer.data();
+  double *scratch = buffer.data() + (4 * cols);
+  for (uint32_t i = 0; i < u_sample_count; ++i) {
+    ReduceColumns(Localize(u_params[i], u_interval_), scratch, reduced);
+    for (uint32_t j = 0; j < v_sample_count; ++j) {
+      points[(i * v_sample_count) + j] =
+          ReduceRow(Localize(v_params[j], v_interval_), reduced, scratch);
     }
+  }
+  return points;
+}
 
-    std::vector<Point3D> BezierSurface::EvaluatePoints(
-        uint32_t u_sample_count, uint32_t v_sample_count) const {
-        std::vector<Point3D> points(u_sample_count * v_sample_count);
-        double u_div = (u_interval_.y - u_interval_.x) / static_cast<double>(u_sample_count - 1);
-        double v_div = (v_interval_.y - v_interval_.x) / static_cast<double>(v_sample_count - 1);
-        for (uint32_t i = 0; i < u_sample_count; ++i) {
-            double u = u_interval_.x + static_cast<double>(i) * u_div;
-            std::vector<Point3D> control_points;
-            for (const auto& curve : curves_) {
-                control_points.push_back(curve.EvaluateCurve(u));
-            }
-            const BezierCurve3D curve(control_points, v_interval_);
-            for (uint32_t j = 0; j < v_sample_count; ++j) {
-                const double v = v_interval_.x + static_cast<double>(j) * v_div;
-                points[(i * v_sample_count) + j] = curve.EvaluateCurve(v);
-            }
+void BezierSurface::ReduceColumns(double u, double *scratch,
+                                  double *reduced) const {
+  const double u_inverse = 1.0 - u;
+  const size_t rows = control_net_.rows();
+  const size_t cols = control_net_.cols();
+  const uint32_t planes = rational_ ? 4 : 3;
+  for (uint32_t c = 0; c < planes; ++c) {
+    const double *plane = control_net_.plane(c);
+    for (size_t j = 0; j < cols; ++j) {
+      for (size_t i = 0; i < rows; ++i) {
+        scratch[i] = plane[control_net_.Index(i, j)];
+      }
+      for (size_t k = 1; k < rows; ++k) {
+        for (size_t i = 0; i < rows - k; ++i) {
+          scratch[i] = (u_inverse * scratch[i]) + (u * scratch[i + 1]);
         }
-        return points;
+      }
+      reduced[(c * cols) + j] = scratch[0];
+    }
+  }
+}
+
+Point3D BezierSurface::ReduceRow(double v, const double *reduced,
+                                 double *scratch) const {
+  const double v_inverse = 1.0 - v;
+  const size_t cols = control_net_.cols();
+  double coords[4] = {0.0, 0.0, 0.0, 1.0};
+  const uint32_t planes = rational_ ? 4 : 3;
+  for (uint32_t c = 0; c < planes; ++c) {
+    std::copy(reduced + (c * cols), reduced + ((c + 1) * cols), scratch);
+    for (size_t k = 1; k < cols; ++k) {
+      for (size_t j = 0; j < cols - k; ++j) {
+        scratch[j] = (v_inverse * scratch[j]) + (v * scratch[j + 1]);
+      }
+    }
+    coords[c] = scratch[0];
+  }
+  if (rational_) {
+    return {coords[0] / coords[3], coords[1] / coords[3],
+            coords[2] / coords[3]};
+  }
+  return {coords[0], coords[1], coords[2]};
+}
+
+std::vector<double> BezierSurface::LocalParams(const double *params,
+                                               size_t count,
+                                               Point2D interval) const {
+  std::vector<double> local(count);
+  for (size_t i = 0; i < count; ++i) {
+    local[i] = Localize(params[i], interval);
+  }
+  return local;
+}
+
+void BezierSurface::EvaluateGridRows(
+    const double *u_params, size_t u_count, const double *v_params,
+    size_t v_count,
+    const std::function<void(size_t, const double *const *)> &emit_row) const {
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const std::vector<double> u_local = LocalParams(u_params, u_count,
+                                                  u_interval_);
+  const std::vector<double> v_local = LocalParams(v_params, v_count,
+                                                  v_interval_);
+  // The Bernstein matrices of the samples, shared by every patch of the same
+  // degrees sampled at the same parameters
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table =
+      cache.Get(u_degree_, u_knots_, u_local.data(), u_count, kTolerance);
+  std::shared_ptr<const knots::BasisTable> v_table =
+      cache.Get(v_degree_, v_knots_, v_local.data(), v_count, kTolerance);
+  tensor::EvaluateRows(control_net_, rational_, *u_table, *v_table, emit_row);
+}
+
+void BezierSurface::EvaluateGrid(const double *u_params, size_t u_count,
+                                 const double *v_params, size_t v_count,
+                                 Point3D *points) const {
+  if (control_net_.empty() || control_net_.cols() == 0) {
+    std::fill(points, points + (u_count * v_count), Point3D{0.0, 0.0, 0.0});
+    return;
+  }
+  EvaluateGridRows(u_params, u_count, v_params, v_count,
+                   [&](size_t u_i, const double *const *coords) {
+                     Point3D *out = points + (u_i * v_count);
+                     for (size_t v_i = 0; v_i < v_count; ++v_i) {
+                       out[v_i] = {coords[0][v_i], coords[1][v_i],
+                                   coords[2][v_i]};
+                     }
+                   });
+}
+
+void BezierSurface::EvaluateGridFloat(const double *u_params, size_t u_count,
+                                      const double *v_params, size_t v_count,
+                                      float *positions) const {
+  if (control_net_.empty() || control_net_.cols() == 0) {
+    std::fill(positions, positions + (3 * u_count * v_count), 0.0f);
+    return;
+  }
+  EvaluateGridRows(u_params, u_count, v_params, v_count,
+                   [&](size_t u_i, const double *const *coords) {
+                     float *out = positions + (3 * u_i * v_count);
+                     for (size_t v_i = 0; v_i < v_count; ++v_i) {
+                       out[(3 * v_i)] = static_cast<float>(coords[0][v_i]);
+                       out[(3 * v_i) + 1] = static_cast<float>(coords[1][v_i]);
+                       out[(3 * v_i) + 2] = static_cast<float>(coords[2][v_i]);
+                     }
+                   });
+}
+
+void BezierSurface::EvaluateGridDerivatives(const double *u_params,
+                                            size_t u_count,
+                                            const double *v_params,
+                                            size_t v_count,
+                                            bool second_partials,
+                                            GridDerivatives &grid) const {
+  if (control_net_.empty() || control_net_.cols() == 0) {
+    Surface::EvaluateGridDerivatives(u_params, u_count, v_params, v_count,
+                                     second_partials, grid);
+    return;
+  }
+  grid.Resize(u_count * v_count, second_partials);
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const std::vector<double> u_local = LocalParams(u_params, u_count,
+                                                  u_interval_);
+  const std::vector<double> v_local = LocalParams(v_params, v_count,
+                                                  v_interval_);
+  const uint32_t d = second_partials ? 2 : 1;
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table =
+      cache.Get(u_degree_, u_knots_, u_local.data(), u_count, kTolerance, d);
+  std::shared_ptr<const knots::BasisTable> v_table =
+      cache.Get(v_degree_, v_knots_, v_local.data(), v_count, kTolerance, d);
+  tensor::EvaluateDerivatives(control_net_, rational_, *u_table, *v_table,
+                              second_partials, grid);
+  // The tables differentiate by the local parameters
+  const double u_scale = 1.0 / (u_interval_.y - u_interval_.x);
+  const double v_scale = 1.0 / (v_interval_.y - v_interval_.x);
+  for (size_t i = 0; i < grid.points.size(); ++i) {
+    grid.u_partials[i] *= u_scale;
+    grid.v_partials[i] *= v_scale;
+    if (second_partials) {
+      grid.uu_partials[i] *= u_scale * u_scale;
+      grid.uv_partials[i] *= u_scale * v_scale;
+      grid.vv_partials[i] *= v_scale * v_scale;
     }
-}
\ No newline at end of file
+  }
+  FillNormals(u_params, u_count, v_params, v_count, grid);
+}
+} // namespace nurbs
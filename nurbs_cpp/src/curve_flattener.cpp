@@ -0,0 +1,121 @@
+#include "include/curve_flattener.hpp"
+
+// STD
+#include <algorithm>
+#include <cmath>
+
+namespace nurbs {
+namespace {
+double DistanceToChord(const Point2D &point, const Point2D &a,
+                       const Point2D &b) {
+  const Point2D chord = b - a;
+  const double length_sq = Dot(chord, chord);
+  double t = 0.0;
+  if (length_sq > 0.0) {
+    t = std::clamp(Dot(point - a, chord) / length_sq, 0.0, 1.0);
+  }
+  return Length(point - (a + (chord * t)));
+}
+
+double DistanceToChord(const Point3D &point, const Point3D &a,
+                       const Point3D &b) {
+  const Point3D chord = b - a;
+  const double length_sq = Dot(chord, chord);
+  double t = 0.0;
+  if (length_sq > 0.0) {
+    t = std::clamp(Dot(point - a, chord) / length_sq, 0.0, 1.0);
+  }
+  return Length(point - (a + (chord * t)));
+}
+
+// State of one CurveFlattener::Flatten call, Curve is Curve2D or Curve3D
+template <typename Curve, typename Point> class Flattening {
+public:
+  Flattening(const Curve &curve, const CurveFlattener::Options &options,
+             std::vector<double> *params)
+      : curve_(curve), options_(options), params_(params),
+        min_cos_(std::cos(options.angle_tolerance)) {}
+
+  std::vector<Point> Run() {
+    const std::vector<double> breaks = curve_.Breakpoints();
+    std::vector<Point> ends(breaks.size());
+    curve_.EvaluateCurveBatch(breaks.data(), breaks.size(), ends.data());
+    Append(breaks[0], ends[0]);
+    for (size_t i = 0; i + 1 < breaks.size(); ++i) {
+      Subdivide(breaks[i], ends[i], breaks[i + 1], ends[i + 1], 0);
+    }
+    return std::move(points_);
+  }
+
+private:
+  void Append(double param, const Point &point) {
+    points_.push_back(point);
+    if (params_ != nullptr) {
+      params_->push_back(param);
+    }
+  }
+
+  bool IsFlat(const Point &a, const Point &mid, const Point &b) const {
+    if (DistanceToChord(mid, a, b) > options_.chordal_tolerance) {
+      return false;
+    }
+    const Point first = mid - a;
+    const Point second = b - mid;
+    const double lengths = Length(first) * Length(second);
+    return lengths == 0.0 || Dot(first, second) >= min_cos_ * lengths;
+  }
+
+  // Appends the vertices after a up to and including b
+  void Subdivide(double a, const Point &point_a, double b, const Point &point_b,
+                 uint32_t depth) {
+    if (depth >= options_.max_depth) {
+      Append(b, point_b);
+      return;
+    }
+    const double mid = 0.5 * (a + b);
+    const Point point_mid = curve_.EvaluateCurve(mid);
+    if (depth >= options_.min_depth && IsFlat(point_a, point_mid, point_b)) {
+      Append(b, point_b);
+      return;
+    }
+    Subdivide(a, point_a, mid, point_mid, depth + 1);
+    Subdivide(mid, point_mid, b, point_b, depth + 1);
+  }
+
+  const Curve &curve_;
+  const CurveFlattener::Options &options_;
+  std::vector<double> *params_;
+  const double min_cos_;
+  std::vector<Point> points_;
+};
+} // namespace
+
+CurveFlattener::CurveFlattener(const Options &options) : options_(options) {
+  if (!(options_.chordal_tolerance > 0.0) ||
+      !(options_.angle_tolerance > 0.0)) {
+    throw std::exception("CurveFlattener tolerances must be positive");
+  }
+  if (options_.max_depth > kMaxDepth ||
+      options_.min_depth > options_.max_depth) {
+    throw std::exception("Invalid CurveFlattener depths");
+  }
+}
+
+std::vector<Point2D> CurveFlattener::Flatten(const Curve2D &curve,
+                                             std::vector<double> *params)
+    const {
+  if (params != nullptr) {
+    params->clear();
+  }
+  return Flattening<Curve2D, Point2D>(curve, options_, params).Run();
+}
+
+std::vector<Point3D> CurveFlattener::Flatten(const Curve3D &curve,
+                                             std::vector<double> *params)
+    const {
+  if (params != nullptr) {
+    params->clear();
+  }
+  return Flattening<Curve3D, Point3D>(curve, options_, params).Run();
+}
+} // namespace nurbs
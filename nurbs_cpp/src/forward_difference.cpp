@@ -0,0 +1,396 @@
+#include "include/forward_difference.hpp"
+
+#include "include/grid_kernels.hpp"
+#include "include/knot_utility_functions.hpp"
+
+// STD
+#include <algorithm>
+#include <cmath>
+
+namespace nurbs {
+namespace forward {
+namespace {
+// Buffers of StepPolynomial, reused by the calling thread
+struct StepScratch {
+  void Reserve(uint32_t order) {
+    if (surjections.size() < order * order) {
+      surjections.resize(order * order);
+      powers.resize(order);
+      taylor.resize(order * order);
+      shifted.resize(order * order);
+      differences.resize(order);
+    }
+  }
+
+  // [j][k] is k! S(j, k), the kth forward difference of t^j at zero with a
+  // unit step, S being the Stirling numbers of the second kind
+  std::vector<double> surjections;
+  std::vector<double> powers;
+  std::vector<double> taylor;
+  std::vector<double> shifted;
+  std::vector<double> differences;
+};
+
+StepScratch &ThreadStepScratch() {
+  thread_local StepScratch scratch;
+  return scratch;
+}
+
+// table[(j * order) + k] = k! S(j, k), from S(j, k) = k S(j - 1, k) +
+// S(j - 1, k - 1)
+void FillSurjections(uint32_t order, double *table) {
+  std::fill(table, table + (order * order), 0.0);
+  table[0] = 1.0;
+  for (uint32_t j = 1; j < order; ++j) {
+    for (uint32_t k = 1; k <= j; ++k) {
+      table[(j * order) + k] =
+          static_cast<double>(k) *
+          (table[((j - 1) * order) + k] + table[((j - 1) * order) + k - 1]);
+    }
+  }
+}
+
+// Steps count points from the kMaxPlanes interleaved differences of order
+// degree + 1 into values. The common degrees get a copy of the differences
+// with a fixed size, which the compiler keeps in registers, the rest step in
+// place.
+template <uint32_t kDegree>
+void StepChunkFixed(const double *differences, uint32_t count,
+                    double *values) {
+  constexpr uint32_t kPlanes = SplineStepPlan::kMaxPlanes;
+  double running[kDegree + 1][kPlanes];
+  for (uint32_t k = 0; k <= kDegree; ++k) {
+    for (uint32_t c = 0; c < kPlanes; ++c) {
+      running[k][c] = differences[(k * kPlanes) + c];
+    }
+  }
+  for (uint32_t s = 0; s < count; ++s) {
+    double *value = values + (s * kPlanes);
+    for (uint32_t c = 0; c < kPlanes; ++c) {
+      value[c] = running[0][c];
+    }
+    // A statement per plane rather than a loop, which the compilers tend to
+    // vectorize without unrolling the levels, leaving them in memory
+    static_assert(kPlanes == 4, "one addition per plane");
+    for (uint32_t k = 0; k < kDegree; ++k) {
+      running[k][0] += running[k + 1][0];
+      running[k][1] += running[k + 1][1];
+      running[k][2] += running[k + 1][2];
+      running[k][3] += running[k + 1][3];
+    }
+  }
+}
+
+void StepChunk(double *differences, uint32_t degree, uint32_t count,
+               double *values) {
+  constexpr uint32_t kPlanes = SplineStepPlan::kMaxPlanes;
+  switch (degree) {
+  case 1:
+    StepChunkFixed<1>(differences, count, values);
+    return;
+  case 2:
+    StepChunkFixed<2>(differences, count, values);
+    return;
+  case 3:
+    StepChunkFixed<3>(differences, count, values);
+    return;
+  case 4:
+    StepChunkFixed<4>(differences, count, values);
+    return;
+  case 5:
+    StepChunkFixed<5>(differences, count, values);
+    return;
+  default:
+    break;
+  }
+  for (uint32_t s = 0; s < count; ++s) {
+    std::copy(differences, differences + kPlanes, values + (s * kPlanes));
+    for (uint32_t k = 0; k < degree * kPlanes; ++k) {
+      differences[k] += differences[k + kPlanes];
+    }
+  }
+}
+
+template <typename ControlT>
+void StepNetGrid(const ControlNet<ControlT> &net, uint32_t planes,
+                 bool rational, const knots::BasisTable &u_table,
+                 const SplineStepPlan &v_plan, Point3D *points) {
+  const size_t u_count = u_table.size();
+  const size_t v_count = v_plan.size();
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const uint32_t u_degree = u_table.degree();
+  const size_t cols = net.cols();
+  std::vector<double> u_bases(u_degree + 1);
+  std::vector<double> rows(planes * cols);
+  const double *row_starts[SplineStepPlan::kMaxPlanes];
+  for (uint32_t c = 0; c < planes; ++c) {
+    row_starts[c] = rows.data() + (c * cols);
+  }
+  for (size_t u_i = 0; u_i < u_count; ++u_i) {
+    for (uint32_t j = 0; j <= u_degree; ++j) {
+      u_bases[j] = u_table.value(j, u_i);
+    }
+    const size_t offset = net.Index(u_table.span(u_i) - u_degree, 0);
+    for (uint32_t c = 0; c < planes; ++c) {
+      simd::WeightedRowSum(u_bases.data(), u_degree + 1, net.plane(c) + offset,
+                           net.stride(), cols, rows.data() + (c * cols));
+    }
+    Point3D *out = points + (u_i * v_count);
+    v_plan.Step(row_starts, planes, rational,
+                [&](size_t first, uint32_t count, const double *coords) {
+                  for (uint32_t s = 0; s < count; ++s) {
+                    const double *coord =
+                        coords + (s * SplineStepPlan::kMaxPlanes);
+                    out[first + s] = {coord[0], coord[1], coord[2]};
+                  }
+                });
+  }
+}
+} // namespace
+
+void StepPolynomial(const double *coefficients, uint32_t degree, double t0,
+                    double step, size_t count, double *values, size_t stride,
+                    uint32_t anchor_interval) {
+  if (count == 0) {
+    return;
+  }
+  anchor_interval = std::max(anchor_interval, 1u);
+  const uint32_t order = degree + 1;
+  StepScratch &scratch = ThreadStepScratch();
+  scratch.Reserve(order);
+  double *surjections = scratch.surjections.data();
+  double *powers = scratch.powers.data();
+  double *taylor = scratch.taylor.data();
+  double *differences = scratch.differences.data();
+  FillSurjections(order, surjections);
+  powers[0] = 1.0;
+  for (uint32_t j = 1; j <= degree; ++j) {
+    powers[j] = powers[j - 1] * step;
+  }
+
+  for (size_t first = 0; first < count; first += anchor_interval) {
+    // Taylor coefficients at the anchor by repeated synthetic division,
+    // taylor[j] is the jth derivative over j!
+    const double t = t0 + (static_cast<double>(first) * step);
+    std::copy(coefficients, coefficients + order, taylor);
+    for (uint32_t k = 0; k < degree; ++k) {
+      for (uint32_t j = degree - 1; j + 1 > k; --j) {
+        taylor[j] += t * taylor[j + 1];
+      }
+    }
+    for (uint32_t k = 0; k <= degree; ++k) {
+      double difference = 0.0;
+      for (uint32_t j = k; j <= degree; ++j) {
+        difference += taylor[j] * powers[j] * surjections[(j * order) + k];
+      }
+      differences[k] = difference;
+    }
+    const size_t end = std::min(count, first + anchor_interval);
+    for (size_t i = first; i < end; ++i) {
+      values[i * stride] = differences[0];
+      for (uint32_t k = 0; k < degree; ++k) {
+        differences[k] += differences[k + 1];
+      }
+    }
+  }
+}
+
+SplineStepPlan::SplineStepPlan(uint32_t degree,
+                               const std::vector<double> &knots,
+                               Point2D interval, uint32_t point_count,
+                               double tolerance)
+    : degree_(degree), count_(point_count) {
+  if (point_count == 0) {
+    return;
+  }
+  double step = 0.0;
+  if (point_count > 1) {
+    step = (interval.y - interval.x) / static_cast<double>(point_count - 1);
+  }
+  auto param = [&](size_t i) {
+    return interval.x + (static_cast<double>(i) * step);
+  };
+  // Chunks first, so the matrices can be sized once. The samples before the
+  // next knot stay in a span, where that is is guessed from the step and the
+  // guess corrected with the span search, which is monotone in the parameter
+  const uint32_t last_span = static_cast<uint32_t>(knots.size()) - degree - 2;
+  uint32_t span = knots::FindSpanParam(degree, knots, interval.x, tolerance);
+  auto find = [&](size_t i) {
+    return knots::FindSpanParam(degree, knots, param(i), tolerance, span);
+  };
+  size_t i = 0;
+  while (i < point_count) {
+    span = find(i);
+    size_t end = point_count;
+    if (span < last_span && step > 0.0) {
+      const double guess =
+          std::ceil((knots[span + 1] - interval.x) / step);
+      end = static_cast<size_t>(
+          std::clamp(guess, static_cast<double>(i + 1),
+                     static_cast<double>(point_count)));
+      while (end > i + 1 && find(end - 1) != span) {
+        --end;
+      }
+      while (end < point_count && find(end) == span) {
+        ++end;
+      }
+    }
+    for (; i < end; i += kAnchorInterval) {
+      const uint32_t count =
+          static_cast<uint32_t>(std::min<size_t>(end - i, kAnchorInterval));
+      chunks_.push_back({i, count, span, false});
+    }
+    i = end;
+  }
+  const uint32_t order = degree + 1;
+  size_t rows = 0;
+  for (Chunk &chunk : chunks_) {
+    chunk.stepped = chunk.count > order;
+    rows += chunk.stepped ? order : chunk.count;
+  }
+  matrices_.resize(rows * order);
+
+  StepScratch &step_scratch = ThreadStepScratch();
+  step_scratch.Reserve(order);
+  double *surjections = step_scratch.surjections.data();
+  double *powers = step_scratch.powers.data();
+  FillSurjections(order, surjections);
+  powers[0] = 1.0;
+  for (uint32_t j = 1; j <= degree; ++j) {
+    powers[j] = powers[j - 1] * step;
+  }
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree, degree);
+  double *ders = scratch.ders.data();
+  // [j][i] is the jth Taylor coefficient of basis i in the sample index, at
+  // the first stepped sample of the current span
+  double *taylor = step_scratch.taylor.data();
+  double *shifted = step_scratch.shifted.data();
+  bool have_taylor = false;
+  uint32_t taylor_span = 0;
+  size_t taylor_first = 0;
+  double *matrix = matrices_.data();
+  for (const Chunk &chunk : chunks_) {
+    if (!chunk.stepped) {
+      for (uint32_t s = 0; s < chunk.count; ++s) {
+        knots::BasisFuns(chunk.span, param(chunk.first + s), degree, knots,
+                         tolerance, matrix, scratch);
+        matrix += order;
+      }
+      continue;
+    }
+    if (!have_taylor || chunk.span != taylor_span) {
+      // ALGORITHM A2.3 once per span, the jth derivative over j! times
+      // step^j is the jth coefficient in the sample index
+      knots::DersBasisFuns(chunk.span, param(chunk.first), degree, degree,
+                           knots, ders, scratch);
+      double factorial = 1.0;
+      for (uint32_t j = 0; j <= degree; ++j) {
+        if (j > 0) {
+          factorial *= static_cast<double>(j);
+        }
+        const double scale = powers[j] / factorial;
+        for (uint32_t i = 0; i <= degree; ++i) {
+          taylor[(j * order) + i] = ders[(j * order) + i] * scale;
+        }
+      }
+      have_taylor = true;
+      taylor_span = chunk.span;
+      taylor_first = chunk.first;
+    }
+    // Later chunks of the span shift the expansion to their first sample by
+    // repeated synthetic division, rather than stepping to it
+    std::copy(taylor, taylor + (order * order), shifted);
+    const double offset = static_cast<double>(chunk.first - taylor_first);
+    if (offset > 0.0) {
+      for (uint32_t k = 0; k < degree; ++k) {
+        for (uint32_t j = degree - 1; j + 1 > k; --j) {
+          for (uint32_t i = 0; i <= degree; ++i) {
+            shifted[(j * order) + i] += offset * shifted[((j + 1) * order) + i];
+          }
+        }
+      }
+    }
+    // The kth forward difference of a basis function is the sum over j of
+    // its jth coefficient times k! S(j, k)
+    for (uint32_t k = 0; k <= degree; ++k) {
+      for (uint32_t i = 0; i <= degree; ++i) {
+        double difference = 0.0;
+        for (uint32_t j = k; j <= degree; ++j) {
+          difference += shifted[(j * order) + i] * surjections[(j * order) + k];
+        }
+        matrix[(k * order) + i] = difference;
+      }
+    }
+    matrix += order * order;
+  }
+}
+
+bool SplineStepPlan::Pays(uint32_t degree, const std::vector<double> &knots,
+                          Point2D interval, uint32_t point_count) {
+  size_t spans = 0;
+  for (size_t i = degree; i + degree + 1 < knots.size(); ++i) {
+    if (knots[i] < knots[i + 1] && knots[i + 1] > interval.x &&
+        knots[i] < interval.y) {
+      ++spans;
+    }
+  }
+  return point_count >= kAnchorInterval * std::max<size_t>(spans, 1);
+}
+
+void SplineStepPlan::Step(
+    const double *const *planes, uint32_t dimension, bool rational,
+    const std::function<void(size_t, uint32_t, const double *)> &emit) const {
+  const uint32_t order = degree_ + 1;
+  // Values of the current chunk and its differences, interleaved by plane
+  // and padded to kMaxPlanes so every plane steps in the same additions
+  double values[kMaxPlanes * kAnchorInterval] = {};
+  std::vector<double> differences(order * kMaxPlanes, 0.0);
+  const double *matrix = matrices_.data();
+  for (const Chunk &chunk : chunks_) {
+    const uint32_t rows = chunk.stepped ? order : chunk.count;
+    const uint32_t first = chunk.span - degree_;
+    double *sums = chunk.stepped ? differences.data() : values;
+    for (uint32_t c = 0; c < dimension; ++c) {
+      const double *points = planes[c] + first;
+      for (uint32_t k = 0; k < rows; ++k) {
+        const double *row = matrix + (k * order);
+        double sum = 0.0;
+        for (uint32_t i = 0; i <= degree_; ++i) {
+          sum += row[i] * points[i];
+        }
+        sums[(k * kMaxPlanes) + c] = sum;
+      }
+    }
+    if (chunk.stepped) {
+      StepChunk(sums, degree_, chunk.count, values);
+    }
+    if (rational) {
+      for (uint32_t s = 0; s < chunk.count; ++s) {
+        double *value = values + (s * kMaxPlanes);
+        const double inverse = 1.0 / value[dimension - 1];
+        for (uint32_t c = 0; c + 1 < dimension; ++c) {
+          value[c] *= inverse;
+        }
+      }
+    }
+    emit(chunk.first, chunk.count, values);
+    matrix += rows * order;
+  }
+}
+
+void StepGrid(const ControlNet<Point3D> &net, const knots::BasisTable &u_table,
+              const SplineStepPlan &v_plan, Point3D *points) {
+  StepNetGrid(net, 3, false, u_table, v_plan, points);
+}
+
+void StepGrid(const ControlNet<Point4D> &net, bool rational,
+              const knots::BasisTable &u_table, const SplineStepPlan &v_plan,
+              Point3D *points) {
+  // A nonrational net never reads the weights, like tensor::EvaluateRows
+  StepNetGrid(net, rational ? 4 : 3, rational, u_table, v_plan, points);
+}
+} // namespace forward
+} // namespace nurbs
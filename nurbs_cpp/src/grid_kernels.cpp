@@ -0,0 +1,413 @@
+#include "include/grid_kernels.hpp"
+
+// NURBS
+#include "include/uniform_cubic.hpp"
+
+// STD
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define NURBS_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit SSE2/AVX2 instructions inside functions that ask for
+// them, MSVC accepts the intrinsics anywhere.
+#if defined(NURBS_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NURBS_TARGET_SSE2 __attribute__((target("sse2")))
+#define NURBS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define NURBS_TARGET_SSE2
+#define NURBS_TARGET_AVX2
+#endif
+
+namespace nurbs {
+namespace simd {
+namespace {
+Level DetectLevel() {
+#if defined(NURBS_SIMD_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse2 = (info[3] & (1 << 26)) != 0;
+  const bool os_xsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  bool avx2 = false;
+  if (max_leaf >= 7 && os_xsave && avx) {
+    __cpuidex(info, 7, 0);
+    // The OS has to save the ymm registers as well
+    const bool ymm_state = (_xgetbv(0) & 0x6) == 0x6;
+    avx2 = ymm_state && (info[1] & (1 << 5)) != 0;
+  }
+  if (avx2) {
+    return Level::kAVX2;
+  }
+  return sse2 ? Level::kSSE2 : Level::kScalar;
+#elif defined(NURBS_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Level::kAVX2;
+  }
+  return __builtin_cpu_supports("sse2") ? Level::kSSE2 : Level::kScalar;
+#else
+  return Level::kScalar;
+#endif
+}
+
+// -1 until SetActive is called
+std::atomic<int> active_level{-1};
+
+double SampleSum(const knots::BasisTable &table, uint32_t derivative,
+                 const double *row, size_t sample) {
+  const uint32_t degree = table.degree();
+  const double *base = row + (table.span(sample) - degree);
+  double sum = 0.0;
+  for (uint32_t i = 0; i <= degree; ++i) {
+    sum += table.derivative(derivative, i, sample) * base[i];
+  }
+  return sum;
+}
+
+void WeightedRowSumScalar(const double *weights, uint32_t row_count,
+                          const double *rows, size_t stride, size_t begin,
+                          size_t length, double *out) {
+  for (size_t v = begin; v < length; ++v) {
+    double temp = 0.0;
+    for (uint32_t j = 0; j < row_count; ++j) {
+      temp += weights[j] * rows[(j * stride) + v];
+    }
+    out[v] = temp;
+  }
+}
+
+void ContractSamplesScalar(const knots::BasisTable &table, uint32_t derivative,
+                           const double *row, size_t begin, double *out) {
+  for (size_t s = begin; s < table.size(); ++s) {
+    out[s] = SampleSum(table, derivative, row, s);
+  }
+}
+
+void DivideScalar(double *values, const double *divisors, size_t begin,
+                  size_t count) {
+  for (size_t i = begin; i < count; ++i) {
+    values[i] /= divisors[i];
+  }
+}
+
+void UniformCubicBasisScalar(const double *t, size_t begin, size_t count,
+                             double *bases, size_t stride) {
+  double values[4];
+  for (size_t s = begin; s < count; ++s) {
+    knots::UniformCubicBasis(t[s], values);
+    for (uint32_t j = 0; j < 4; ++j) {
+      bases[(j * stride) + s] = values[j];
+    }
+  }
+}
+
+#if defined(NURBS_SIMD_X86)
+NURBS_TARGET_SSE2 void WeightedRowSumSSE2(const double *weights,
+                                          uint32_t row_count,
+                                          const double *rows, size_t stride,
+                                          size_t length, double *out) {
+  size_t v = 0;
+  for (; v + 4 <= length; v += 4) {
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    for (uint32_t j = 0; j < row_count; ++j) {
+      const __m128d weight = _mm_set1_pd(weights[j]);
+      const double *in = rows + (j * stride) + v;
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(weight, _mm_loadu_pd(in)));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(weight, _mm_loadu_pd(in + 2)));
+    }
+    _mm_storeu_pd(out + v, sum0);
+    _mm_storeu_pd(out + v + 2, sum1);
+  }
+  WeightedRowSumScalar(weights, row_count, rows, stride, v, length, out);
+}
+
+NURBS_TARGET_SSE2 void ContractSamplesSSE2(const knots::BasisTable &table,
+                                           uint32_t derivative,
+                                           const double *row, double *out) {
+  const uint32_t degree = table.degree();
+  const uint32_t *spans = table.spans();
+  size_t s = 0;
+  for (; s + 4 <= table.size(); s += 4) {
+    const double *base0 = row + (spans[s] - degree);
+    const double *base1 = row + (spans[s + 1] - degree);
+    const double *base2 = row + (spans[s + 2] - degree);
+    const double *base3 = row + (spans[s + 3] - degree);
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    for (uint32_t i = 0; i <= degree; ++i) {
+      const double *values = table.derivatives(derivative, i) + s;
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(values),
+                                         _mm_set_pd(base1[i], base0[i])));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(values + 2),
+                                         _mm_set_pd(base3[i], base2[i])));
+    }
+    _mm_storeu_pd(out + s, sum0);
+    _mm_storeu_pd(out + s + 2, sum1);
+  }
+  ContractSamplesScalar(table, derivative, row, s, out);
+}
+
+NURBS_TARGET_SSE2 void DivideSSE2(double *values, const double *divisors,
+                                  size_t count) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    _mm_storeu_pd(values + i, _mm_div_pd(_mm_loadu_pd(values + i),
+                                         _mm_loadu_pd(divisors + i)));
+  }
+  DivideScalar(values, divisors, i, count);
+}
+
+// Horner on the columns of the matrix, in the order of the scalar kernel
+NURBS_TARGET_SSE2 void UniformCubicBasisSSE2(const double *t, size_t count,
+                                             double *bases, size_t stride) {
+  const double(&m)[4][4] = knots::kUniformCubicMatrix;
+  size_t s = 0;
+  for (; s + 2 <= count; s += 2) {
+    const __m128d local = _mm_loadu_pd(t + s);
+    for (uint32_t j = 0; j < 4; ++j) {
+      __m128d value = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(m[3][j]), local),
+                                 _mm_set1_pd(m[2][j]));
+      value = _mm_add_pd(_mm_mul_pd(value, local), _mm_set1_pd(m[1][j]));
+      value = _mm_add_pd(_mm_mul_pd(value, local), _mm_set1_pd(m[0][j]));
+      _mm_storeu_pd(bases + (j * stride) + s, value);
+    }
+  }
+  UniformCubicBasisScalar(t, s, count, bases, stride);
+}
+
+NURBS_TARGET_AVX2 void WeightedRowSumAVX2(const double *weights,
+                                          uint32_t row_count,
+                                          const double *rows, size_t stride,
+                                          size_t length, double *out) {
+  size_t v = 0;
+  for (; v + 8 <= length; v += 8) {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    for (uint32_t j = 0; j < row_count; ++j) {
+      const __m256d weight = _mm256_set1_pd(weights[j]);
+      const double *in = rows + (j * stride) + v;
+      sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(weight, _mm256_loadu_pd(in)));
+      sum1 =
+          _mm256_add_pd(sum1, _mm256_mul_pd(weight, _mm256_loadu_pd(in + 4)));
+    }
+    _mm256_storeu_pd(out + v, sum0);
+    _mm256_storeu_pd(out + v + 4, sum1);
+  }
+  for (; v + 4 <= length; v += 4) {
+    __m256d sum = _mm256_setzero_pd();
+    for (uint32_t j = 0; j < row_count; ++j) {
+      const __m256d weight = _mm256_set1_pd(weights[j]);
+      sum = _mm256_add_pd(
+          sum, _mm256_mul_pd(weight, _mm256_loadu_pd(rows + (j * stride) + v)));
+    }
+    _mm256_storeu_pd(out + v, sum);
+  }
+  WeightedRowSumScalar(weights, row_count, rows, stride, v, length, out);
+}
+
+NURBS_TARGET_AVX2 void ContractSamplesAVX2(const knots::BasisTable &table,
+                                           uint32_t derivative,
+                                           const double *row, double *out) {
+  const uint32_t degree = table.degree();
+  const uint32_t *spans = table.spans();
+  const size_t count = table.size();
+  const __m128i first = _mm_set1_epi32(static_cast<int>(degree));
+  size_t s = 0;
+  while (s + 4 <= count) {
+    const uint32_t span = spans[s];
+    size_t end = s + 1;
+    while (end < count && spans[end] == span) {
+      ++end;
+    }
+    if (end - s < 4) {
+      // Sparse samples, gather the control values of four different spans
+      const __m128i index = _mm_sub_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(spans + s)),
+          first);
+      __m256d sum = _mm256_setzero_pd();
+      for (uint32_t i = 0; i <= degree; ++i) {
+        const __m256d values = _mm256_loadu_pd(table.derivatives(derivative, i) + s);
+        const __m256d controls = _mm256_i32gather_pd(row + i, index, 8);
+        sum = _mm256_add_pd(sum, _mm256_mul_pd(values, controls));
+      }
+      _mm256_storeu_pd(out + s, sum);
+      s += 4;
+      continue;
+    }
+    // A run of samples in one span shares its control values. Four
+    // independent sums keep the adds from waiting on each other.
+    const double *base = row + (span - degree);
+    for (; s + 16 <= end; s += 16) {
+      __m256d sum0 = _mm256_setzero_pd();
+      __m256d sum1 = _mm256_setzero_pd();
+      __m256d sum2 = _mm256_setzero_pd();
+      __m256d sum3 = _mm256_setzero_pd();
+      for (uint32_t i = 0; i <= degree; ++i) {
+        const __m256d control = _mm256_set1_pd(base[i]);
+        const double *values = table.derivatives(derivative, i) + s;
+        sum0 = _mm256_add_pd(
+            sum0, _mm256_mul_pd(_mm256_loadu_pd(values), control));
+        sum1 = _mm256_add_pd(
+            sum1, _mm256_mul_pd(_mm256_loadu_pd(values + 4), control));
+        sum2 = _mm256_add_pd(
+            sum2, _mm256_mul_pd(_mm256_loadu_pd(values + 8), control));
+        sum3 = _mm256_add_pd(
+            sum3, _mm256_mul_pd(_mm256_loadu_pd(values + 12), control));
+      }
+      _mm256_storeu_pd(out + s, sum0);
+      _mm256_storeu_pd(out + s + 4, sum1);
+      _mm256_storeu_pd(out + s + 8, sum2);
+      _mm256_storeu_pd(out + s + 12, sum3);
+    }
+    for (; s + 4 <= end; s += 4) {
+      __m256d sum = _mm256_setzero_pd();
+      for (uint32_t i = 0; i <= degree; ++i) {
+        const __m256d values = _mm256_loadu_pd(table.derivatives(derivative, i) + s);
+        sum =
+            _mm256_add_pd(sum, _mm256_mul_pd(values, _mm256_set1_pd(base[i])));
+      }
+      _mm256_storeu_pd(out + s, sum);
+    }
+    // The rest of the run starts the next block
+  }
+  ContractSamplesScalar(table, derivative, row, s, out);
+}
+
+NURBS_TARGET_AVX2 void DivideAVX2(double *values, const double *divisors,
+                                  size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm256_storeu_pd(values + i, _mm256_div_pd(_mm256_loadu_pd(values + i),
+                                               _mm256_loadu_pd(divisors + i)));
+  }
+  DivideScalar(values, divisors, i, count);
+}
+
+NURBS_TARGET_AVX2 void UniformCubicBasisAVX2(const double *t, size_t count,
+                                             double *bases, size_t stride) {
+  const double(&m)[4][4] = knots::kUniformCubicMatrix;
+  size_t s = 0;
+  for (; s + 4 <= count; s += 4) {
+    const __m256d local = _mm256_loadu_pd(t + s);
+    for (uint32_t j = 0; j < 4; ++j) {
+      __m256d value =
+          _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m[3][j]), local),
+                        _mm256_set1_pd(m[2][j]));
+      value =
+          _mm256_add_pd(_mm256_mul_pd(value, local), _mm256_set1_pd(m[1][j]));
+      value =
+          _mm256_add_pd(_mm256_mul_pd(value, local), _mm256_set1_pd(m[0][j]));
+      _mm256_storeu_pd(bases + (j * stride) + s, value);
+    }
+  }
+  UniformCubicBasisScalar(t, s, count, bases, stride);
+}
+#endif
+} // namespace
+
+Level Supported() {
+  static const Level level = DetectLevel();
+  return level;
+}
+
+Level Active() {
+  const int level = active_level.load(std::memory_order_relaxed);
+  return level < 0 ? Supported() : static_cast<Level>(level);
+}
+
+void SetActive(Level level) {
+  const Level clamped = std::min(level, Supported());
+  active_level.store(static_cast<int>(clamped), std::memory_order_relaxed);
+}
+
+const char *Name(Level level) {
+  switch (level) {
+  case Level::kAVX2:
+    return "avx2";
+  case Level::kSSE2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+void WeightedRowSum(const double *weights, uint32_t row_count,
+                    const double *rows, size_t stride, size_t length,
+                    double *out) {
+  switch (Active()) {
+#if defined(NURBS_SIMD_X86)
+  case Level::kAVX2:
+    WeightedRowSumAVX2(weights, row_count, rows, stride, length, out);
+    return;
+  case Level::kSSE2:
+    WeightedRowSumSSE2(weights, row_count, rows, stride, length, out);
+    return;
+#endif
+  default:
+    WeightedRowSumScalar(weights, row_count, rows, stride, 0, length, out);
+    return;
+  }
+}
+
+void ContractSamples(const knots::BasisTable &table, const double *row,
+                     double *out, uint32_t derivative) {
+  switch (Active()) {
+#if defined(NURBS_SIMD_X86)
+  case Level::kAVX2:
+    ContractSamplesAVX2(table, derivative, row, out);
+    return;
+  case Level::kSSE2:
+    ContractSamplesSSE2(table, derivative, row, out);
+    return;
+#endif
+  default:
+    ContractSamplesScalar(table, derivative, row, 0, out);
+    return;
+  }
+}
+
+void Divide(double *values, const double *divisors, size_t count) {
+  switch (Active()) {
+#if defined(NURBS_SIMD_X86)
+  case Level::kAVX2:
+    DivideAVX2(values, divisors, count);
+    return;
+  case Level::kSSE2:
+    DivideSSE2(values, divisors, count);
+    return;
+#endif
+  default:
+    DivideScalar(values, divisors, 0, count);
+    return;
+  }
+}
+
+void UniformCubicBasis(const double *t, size_t count, double *bases,
+                       size_t stride) {
+  switch (Active()) {
+#if defined(NURBS_SIMD_X86)
+  case Level::kAVX2:
+    UniformCubicBasisAVX2(t, count, bases, stride);
+    return;
+  case Level::kSSE2:
+    UniformCubicBasisSSE2(t, count, bases, stride);
+    return;
+#endif
+  default:
+    UniformCubicBasisScalar(t, 0, count, bases, stride);
+    return;
+  }
+}
+} // namespace simd
+} // namespace nurbs
@@ -1,6 +1,7 @@
 #include "include/knot_utility_functions.hpp"
 
 // STD
+#include <algorithm>
 #include <array>
 #include <iostream>
 namespace nurbs {
@@ -59,6 +60,26 @@ uint32_t FindSpanParam(uint32_t degree, const std::vector<double> &knots,
   return mid;
 }
 
+// The spans [U[i] - tol, U[i + 1] - tol) for i in [p, n] do not overlap, so
+// the span found by walking is the same one the binary search lands on.
+uint32_t FindSpanParam(uint32_t degree, const std::vector<double> &knots,
+                       double param, double tolerance, uint32_t span) {
+  uint32_t n = static_cast<uint32_t>(knots.size()) - degree - 2;
+  if (param >= knots[n + 1] - tolerance) {
+    return n;
+  }
+  if (param <= knots[degree] + tolerance) {
+    return degree;
+  }
+  if (span < degree || span > n || param < knots[span] - tolerance) {
+    return FindSpanParam(degree, knots, param, tolerance);
+  }
+  while (param >= knots[span + 1] - tolerance) {
+    ++span;
+  }
+  return span;
+}
+
 uint32_t FindStartKnot(uint32_t degree, const std::vector<uint32_t> &knots,
                        uint32_t knot) {
   uint32_t n = static_cast<uint32_t>(knots.size()) - degree - 1;
@@ -114,6 +135,26 @@ uint32_t FindStartParam(uint32_t degree, const std::vector<double> &knots,
   return mid;
 }
 
+void BasisScratch::Reserve(uint32_t degree, uint32_t n) {
+  const size_t order = static_cast<size_t>(degree) + 1;
+  auto grow = [](std::vector<double> &buffer, size_t size) {
+    if (buffer.size() < size) {
+      buffer.resize(size);
+    }
+  };
+  grow(left, order);
+  grow(right, order);
+  grow(ndu, order * order);
+  grow(a, 2 * order);
+  grow(bases, order);
+  grow(ders, (static_cast<size_t>(n) + 1) * order);
+}
+
+BasisScratch &ThreadScratch(uint32_t slot) {
+  thread_local std::array<BasisScratch, 2> scratch;
+  return scratch[slot];
+}
+
 // ALGORITHM A2.2  BasisFuns(i,u,p,U,N)
 // i - Span index (From find span)
 // u - input value along the curve/knot vector
@@ -123,28 +164,37 @@ uint32_t FindStartParam(uint32_t degree, const std::vector<double> &knots,
 std::vector<double> BasisFuns(uint32_t span, double u, uint32_t degree,
                               const std::vector<double> &knots,
                               double tolerance) {
-  u = std::min(u, knots[knots.size() - 1]);
   std::vector<double> bases(degree + 1, 0);
+  BasisScratch scratch;
+  BasisFuns(span, u, degree, knots, tolerance, bases.data(), scratch);
+  return bases;
+};
+
+void BasisFuns(uint32_t span, double u, uint32_t degree,
+               const std::vector<double> &knots, double tolerance,
+               double *bases, BasisScratch &scratch) {
+  scratch.Reserve(degree);
+  u = std::min(u, knots[knots.size() - 1]);
   if (span >= static_cast<uint32_t>(knots.size()) - degree - 2 ||
       (u >= knots[span] - tolerance && u < knots[span + 1] - tolerance)) {
     bases[0] = 1.0;
   } else {
     bases[0] = 0.0;
   }
-  std::vector<double> left(degree + 1), right(degree + 1);
+  double *left = scratch.left.data();
+  double *right = scratch.right.data();
   for (uint32_t j = 1; j <= degree; ++j) {
     left[j] = u - knots[span + 1 - j];
     right[j] = knots[span + j] - u;
     double saved = 0.0;
-    for (uint8_t r = 0; r < j; ++r) {
+    for (uint32_t r = 0; r < j; ++r) {
       double temp = bases[r] / (right[r + 1] + left[j - r]);
       bases[r] = saved + (right[r + 1] * temp);
       saved = left[j - r] * temp;
     }
     bases[j] = saved;
   }
-  return bases;
-};
+}
 
 // ALGORITHM A2.3  DersBasisFuns(i,u,p,n,U,ders)
 // Same as above
@@ -156,65 +206,73 @@ DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
   if (knots.empty()) {
     return {};
   }
+  BasisScratch scratch;
+  scratch.Reserve(degree, n);
+  DersBasisFuns(i, u, degree, n, knots, scratch.ders.data(), scratch);
+
+  std::vector<std::vector<double>> derivatives(n + 1);
+  for (uint32_t k = 0; k <= n; ++k) {
+    const double *row = scratch.ders.data() + (k * (degree + 1));
+    derivatives[k].assign(row, row + degree + 1);
+  }
+  return derivatives;
+}
+
+void DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
+                   const std::vector<double> &knots, double *ders,
+                   BasisScratch &scratch) {
+  const uint32_t order = degree + 1;
+  if (knots.empty()) {
+    return;
+  }
 
   u = std::min(u, knots[knots.size() - 1]);
 
   if (i + degree == static_cast<uint32_t>(knots.size() - 1)) {
-    std::vector<std::vector<double>> derivatives(n + 1);
-    for (auto &vect : derivatives) {
-      vect.resize(degree + 1);
-      for (double &val : vect) {
-        val = 0.0;
-      }
-    }
-    return derivatives;
+    std::fill(ders, ders + ((n + 1) * order), 0.0);
+    return;
   }
 
-  std::vector<std::vector<double>> ndu(degree + 1);
-  for (auto &vect : ndu) {
-    vect.resize(degree + 1, 0);
-  }
-  ndu[0][0] = 1.0;
-  std::vector<double> left(degree + 1), right(degree + 1);
+  scratch.Reserve(degree);
+  // ndu[j][r] lives at ndu[(j * order) + r]
+  double *ndu = scratch.ndu.data();
+  double *left = scratch.left.data();
+  double *right = scratch.right.data();
+  std::fill(ndu, ndu + (order * order), 0.0);
+  ndu[0] = 1.0;
   for (uint32_t j = 1; j <= degree; ++j) {
     left[j] = u - knots[i + 1 - j];
     right[j] = knots[i + j] - u;
 
     double saved = 0.0;
     for (uint32_t r = 0; r < j; ++r) {
-      ndu[j][r] = right[r + 1] + left[j - r];
-      double temp = ndu[r][j - 1] / ndu[j][r];
+      ndu[(j * order) + r] = right[r + 1] + left[j - r];
+      double temp = ndu[(r * order) + j - 1] / ndu[(j * order) + r];
 
-      ndu[r][j] = saved + (right[r + 1] * temp);
+      ndu[(r * order) + j] = saved + (right[r + 1] * temp);
       saved = left[j - r] * temp;
     }
-    ndu[j][j] = saved;
-  }
-
-  std::vector<std::vector<double>> derivatives(n + 1);
-  for (auto &vect : derivatives) {
-    vect.resize(degree + 1);
+    ndu[(j * order) + j] = saved;
   }
 
   for (uint32_t j = 0; j <= degree; ++j) {
-    derivatives[0][j] = ndu[j][degree];
+    ders[j] = ndu[(j * order) + degree];
   }
 
   /* This section computes the derivatives */
-  std::array<std::vector<double>, 2> a;
-  a[0].resize(static_cast<size_t>(degree) + 1);
-  a[1].resize(static_cast<size_t>(degree) + 1);
+  // a[s][j] lives at a[(s * order) + j]
+  double *a = scratch.a.data();
 
   for (int r = 0; r <= static_cast<int>(degree); ++r) {
-    uint32_t s1 = 0, s2 = 1;
-    a[0][0] = 1.0;
+    uint32_t s1 = 0, s2 = order;
+    a[0] = 1.0;
     for (int k = 1; k <= static_cast<int>(n); ++k) {
       double d = 0.0;
       int rk = r - k;
       int pk = static_cast<int>(degree) - k;
       if (r >= k) {
-        a[s2][0] = a[s1][0] / ndu[pk + 1][rk];
-        d = a[s2][0] * ndu[rk][pk];
+        a[s2] = a[s1] / ndu[((pk + 1) * order) + rk];
+        d = a[s2] * ndu[(rk * order) + pk];
       }
       int j1, j2;
       if (rk >= -1) {
@@ -228,14 +286,15 @@ DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
         j2 = static_cast<int>(degree) - r;
       }
       for (int j = j1; j <= j2; ++j) {
-        a[s2][j] = (a[s1][j] - a[s1][j - 1]) / ndu[pk + 1][rk + j];
-        d += a[s2][j] * ndu[rk + j][pk];
+        a[s2 + j] = (a[s1 + j] - a[s1 + j - 1]) /
+                    ndu[((pk + 1) * order) + rk + j];
+        d += a[s2 + j] * ndu[((rk + j) * order) + pk];
       }
       if (r <= pk) {
-        a[s2][k] = -a[s1][k - 1] / ndu[pk + 1][r];
-        d += a[s2][k] * ndu[r][pk];
+        a[s2 + k] = -a[s1 + k - 1] / ndu[((pk + 1) * order) + r];
+        d += a[s2 + k] * ndu[(r * order) + pk];
       }
-      derivatives[k][r] = d;
+      ders[(k * order) + r] = d;
       std::swap(s1, s2);
     }
   }
@@ -244,12 +303,11 @@ DersBasisFuns(uint32_t i, double u, uint32_t degree, uint32_t n,
   double r = static_cast<double>(degree);
   for (int k = 1; k <= static_cast<int>(n); ++k) {
 
-    for (uint8_t j = 0; j <= degree; ++j) {
-      derivatives[k][j] *= r;
+    for (uint32_t j = 0; j <= degree; ++j) {
+      ders[(k * order) + j] *= r;
     }
     r *= static_cast<double>(static_cast<int>(degree) - k);
   }
-  return derivatives;
 }
 
 // ALGORITHM A2.4  OneBasisFun(p,m,U,i,u,Nip)
@@ -404,42 +462,67 @@ std::vector<double> DersOneBasisFun(uint32_t degree,
 std::vector<std::vector<double>>
 AllBasisFuns(uint32_t span, double u, uint32_t degree,
              const std::vector<double> &knots) {
-  u = std::min(u, knots[knots.size() - 1]);
+  BasisScratch scratch;
+  scratch.Reserve(degree, degree);
+  AllBasisFuns(span, u, degree, knots, scratch.ders.data(), scratch);
+
   std::vector<std::vector<double>> bases(degree + 1);
-  for (auto &vect : bases) {
-    vect.resize(degree + 1, 0);
+  for (uint32_t i = 0; i <= degree; ++i) {
+    const double *row = scratch.ders.data() + (i * (degree + 1));
+    bases[i].assign(row, row + degree + 1);
   }
+  return bases;
+}
+
+void AllBasisFuns(uint32_t span, double u, uint32_t degree,
+                  const std::vector<double> &knots, double *bases,
+                  BasisScratch &scratch) {
+  const uint32_t order = degree + 1;
+  u = std::min(u, knots[knots.size() - 1]);
+  std::fill(bases, bases + (order * order), 0.0);
   // Initalize basis values
   // Initialize zero-degree functs
   for (uint32_t i = 0; i <= degree; ++i) {
     if (u >= knots[span + i] - std::numeric_limits<double>::epsilon() &&
         u < knots[span + i + 1] - std::numeric_limits<double>::epsilon()) {
-      bases[i][0] = 1.0;
+      bases[i * order] = 1.0;
     } else {
-      bases[i][0] = 0.0;
+      bases[i * order] = 0.0;
     }
   }
-  std::vector<double> left(degree * 2), right(degree + 2);
-  for (uint8_t i = 0; i < degree * 2; ++i) {
+  // left needs degree * 2 entries and right degree + 2
+  if (scratch.left.size() < degree * 2 || scratch.right.size() < degree + 2) {
+    scratch.left.resize(std::max<size_t>(scratch.left.size(), degree * 2));
+    scratch.right.resize(std::max<size_t>(scratch.right.size(), degree + 2));
+  }
+  double *left = scratch.left.data();
+  double *right = scratch.right.data();
+  // right is read ahead of being set, so it has to start zeroed
+  std::fill(right, right + degree + 2, 0.0);
+  for (uint32_t i = 0; i < degree * 2; ++i) {
     left[i] = u - knots[span + degree - 1 - i];
   }
-  for (uint8_t j = 1; j <= degree; ++j) {
+  for (uint32_t j = 1; j <= degree; ++j) {
     right[j] = knots[span + j] - u;
-    bases[0][j] = 0.0;
-    for (uint8_t r = 0; r < degree; ++r) {
-      double temp = bases[r][j - 1] / (right[r + 1] + left[j - r + degree - 2]);
-      bases[r][j] = bases[r][j] + (right[r + 1] * temp);
-      bases[r + 1][j] = left[j - r + degree - 2] * temp;
+    bases[j] = 0.0;
+    for (uint32_t r = 0; r < degree; ++r) {
+      double temp = bases[(r * order) + j - 1] /
+                    (right[r + 1] + left[j - r + degree - 2]);
+      bases[(r * order) + j] = bases[(r * order) + j] + (right[r + 1] * temp);
+      bases[((r + 1) * order) + j] = left[j - r + degree - 2] * temp;
     }
   }
-  return bases;
 }
 
 // - https://en.wikipedia.org/wiki/Binomial_coefficient
 // - ->bin(n, k) = (n * (n - 1) * ... * (n - k + 1) / (k * (k - 1) * ...
 // * 1)
 std::vector<std::vector<double>> BinomialCoefficients(uint32_t n, uint32_t k) {
-  std::vector<std::vector<double>> bin(n + 1, std::vector<double>(k + 1, 1));
+  // bin[i][j] is zero for j > i, only the first column starts at one
+  std::vector<std::vector<double>> bin(n + 1, std::vector<double>(k + 1, 0));
+  for (uint32_t i = 0; i <= n; ++i) {
+    bin[i][0] = 1;
+  }
   for (uint32_t i = 1; i <= n; ++i) {
     for (uint32_t j = 1; j <= k; ++j) {
       bin[i][j] = bin[i - 1][j - 1] + bin[i - 1][j];
@@ -448,6 +531,34 @@ std::vector<std::vector<double>> BinomialCoefficients(uint32_t n, uint32_t k) {
   return bin;
 }
 
+double Binomial(uint32_t n, uint32_t k) {
+  using Table = std::array<std::array<double, kMaxBinomial + 1>,
+                           kMaxBinomial + 1>;
+  static const Table table = [] {
+    Table pascal = {};
+    for (uint32_t i = 0; i <= kMaxBinomial; ++i) {
+      pascal[i][0] = 1.0;
+      for (uint32_t j = 1; j <= i; ++j) {
+        pascal[i][j] = pascal[i - 1][j - 1] + pascal[i - 1][j];
+      }
+    }
+    return pascal;
+  }();
+  if (k > n) {
+    return 0.0;
+  }
+  if (n <= kMaxBinomial) {
+    return table[n][k];
+  }
+  // Past the table, n (n - 1) ... (n - k + 1) / k!
+  k = std::min(k, n - k);
+  double value = 1.0;
+  for (uint32_t i = 1; i <= k; ++i) {
+    value = value * static_cast<double>(n - k + i) / static_cast<double>(i);
+  }
+  return value;
+}
+
 int MultiplicityKnotI(int32_t degree, const std::vector<uint32_t> &knots,
                       int knot) {
   if (knot < 0) {
@@ -479,5 +590,37 @@ int MultiplicityParam(int32_t degree, const std::vector<double> &knots,
   }
   return mult;
 }
+
+std::vector<double> Breakpoints(const std::vector<double> &knots, double low,
+                                double high, double tolerance) {
+  std::vector<double> breaks = {low};
+  for (double knot : knots) {
+    if (knot > breaks.back() + tolerance && knot < high - tolerance) {
+      breaks.push_back(knot);
+    }
+  }
+  breaks.push_back(high);
+  return breaks;
+}
+
+std::vector<double> DecomposeBreaks(uint32_t degree,
+                                    const std::vector<double> &knots) {
+  const int p = static_cast<int>(degree);
+  const int m = static_cast<int>(knots.size()) - 1;
+  if (m <= p) {
+    return {};
+  }
+  std::vector<double> breaks = {knots[p]};
+  for (int b = p + 1; b < m; ++b) {
+    while (b < m && knots[b + 1] == knots[b]) {
+      ++b;
+    }
+    breaks.push_back(knots[b]);
+  }
+  if (breaks.size() < 2) {
+    return {};
+  }
+  return breaks;
+}
 } // namespace knots
 } // namespace nurbs
\ No newline at end of file
@@ -1,9 +1,223 @@
 #include "include/nurbs_curve.hpp"
 
 #include "include/b_spline_curve.hpp"
+#include "include/basis_table.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/forward_difference.hpp"
 #include "include/knot_utility_functions.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 
 namespace nurbs {
+namespace {
+// ALGORITHM A5.1 CurveKnotins(np, p, UP, Pw, u, k, s, r, nq, UQ, Qw) p.151,
+// in place on the knots and control points of a curve. The control points
+// from k - s on move up r places first, which leaves Pw[k - p] to Pw[k - s]
+// where they were, and those are the Rw of the book. Each pass writes the
+// new Rw[i] over the old Rw[i + 1], so Rw[0] of pass j already sits at
+// Qw[L] and the points loaded from Rw at the end are already in place. The
+// knots move last, the alphas read the old ones.
+template <typename PointT>
+void InsertKnotsInPlace(uint32_t degree, double u, uint32_t times,
+                        double tolerance, std::vector<double> &knots,
+                        std::vector<PointT> &control_points) {
+  const int p = static_cast<int>(degree);
+  const int k = knots::FindSpanParam(p, knots, u, tolerance);
+  // MultiplicityParam is one less than the number of knots equal to u, -1
+  // for a new knot, where the algorithm needs s = 0
+  const int s = std::max(knots::MultiplicityParam(p, knots, u, tolerance), 0);
+  // Max value of r is p - s, ends already at full multiplicity take none
+  const int r = std::min(static_cast<int>(times), p - s);
+  if (r <= 0) {
+    return;
+  }
+
+  std::vector<PointT> &Qw = control_points;
+  const int np = static_cast<int>(Qw.size());
+  Qw.resize(np + r);
+  for (int i = np - 1; i >= k - s; --i) {
+    Qw[i + r] = Qw[i];
+  }
+  for (int j = 1; j <= r; ++j) {
+    const int L = k - p + j;
+    for (int i = p - j - s; i >= 0; --i) {
+      const double alpha =
+          (u - knots[L + i]) / (knots[i + k + 1] - knots[L + i]);
+      Qw[L + i] = (alpha * Qw[L + i]) + ((1.0 - alpha) * Qw[L + i - 1]);
+    }
+    // Rw[p - j - s] is always at k - s
+    Qw[k + r - j - s] = Qw[k - s];
+  }
+
+  const int m = static_cast<int>(knots.size());
+  knots.resize(m + r);
+  for (int i = m - 1; i > k; --i) {
+    knots[i + r] = knots[i];
+  }
+  for (int i = 1; i <= r; ++i) {
+    knots[k + i] = u;
+  }
+}
+
+// ALGORITHM A5.4 RefineKnotVectCurve(n, p, U, Pw, X, r, Ubar, Qw) p.164, in
+// place on the knots and control points of a curve. Ubar and Qw share the
+// storage of U and Pw: the tails move up first, then the book fills from the
+// back, where every write lands above the U and Pw values still to be read.
+template <typename PointT>
+void RefineInPlace(uint32_t degree, const std::vector<double> &X,
+                   double tolerance, std::vector<double> &knots,
+                   std::vector<PointT> &control_points) {
+  if (X.empty()) {
+    return;
+  }
+  std::vector<double> &U = knots;
+  std::vector<double> &Ubar = knots;
+  std::vector<PointT> &Pw = control_points;
+  std::vector<PointT> &Qw = control_points;
+  const int n = static_cast<int>(Pw.size()) - 1;
+  const int p = static_cast<int>(degree);
+  const int r = static_cast<int>(X.size()) - 1;
+  const int m = n + p + 1;
+  const int a = knots::FindSpanParam(p, U, X[0], tolerance);
+  const int b = knots::FindSpanParam(p, U, X[r], tolerance) + 1;
+
+  Qw.resize(n + r + 2);
+  Ubar.resize(m + r + 2);
+  for (int i = n; i >= b - 1; --i) {
+    Qw[i + r + 1] = Pw[i];
+  }
+  for (int i = m; i >= b + p; --i) {
+    Ubar[i + r + 1] = U[i];
+  }
+  int i = b + p - 1;
+  int k = b + p + r;
+  for (int j = r; j >= 0; --j) {
+    while (X[j] <= U[i] && i > a) {
+      Qw[k - p - 1] = Pw[i - p - 1];
+      Ubar[k] = U[i];
+      k = k - 1;
+      i = i - 1;
+    }
+    Qw[k - p - 1] = Qw[k - p];
+    for (int l = 1; l <= p; ++l) {
+      int ind = k - p + l;
+      double alfa = Ubar[k + l] - X[j];
+      if (std::abs(alfa) < tolerance) {
+        Qw[ind - 1] = Qw[ind];
+      } else {
+        alfa = alfa / (Ubar[k + l] - U[i - p + l]);
+        Qw[ind - 1] = (alfa * Qw[ind - 1]) + ((1.0 - alfa) * Qw[ind]);
+      }
+    }
+    Ubar[k] = X[j];
+    k = k - 1;
+  }
+}
+
+// A5.8 on the knots and control points of a curve, with tolerance in model
+// space
+template <typename PointT>
+uint32_t RemoveKnotsInPlace(uint32_t degree, double u, uint32_t times,
+                            double tolerance, std::vector<double> &knots,
+                            std::vector<PointT> &control_points) {
+  int s = 0;
+  const int r = knots::FindRemovalKnot(degree, knots, control_points.size(),
+                                       u, s);
+  if (r < 0 || times == 0) {
+    return 0;
+  }
+  const double scale =
+      knots::HomogeneousScale(control_points.data(), control_points.size());
+  double error = 0.0;
+  return knots::RemoveKnotInPlace(degree, r, s, static_cast<int>(times),
+                                  tolerance / scale, knots, control_points,
+                                  error);
+}
+
+template <typename PointT>
+knots::RemovalReport SimplifyCurve(uint32_t degree, double tolerance,
+                                   std::vector<double> &knots,
+                                   std::vector<PointT> &control_points) {
+  knots::RemovalReport report;
+  report.control_points_before = control_points.size();
+  const double scale =
+      knots::HomogeneousScale(control_points.data(), control_points.size());
+  double error = 0.0;
+  report.knots_removed = knots::SimplifyInPlace(
+      degree, tolerance / scale, knots, control_points, error);
+  report.control_points_after = control_points.size();
+  report.error_bound = error * scale;
+  return report;
+}
+
+// A5.9 on the knots and control points of a curve, through scratch vectors
+// the curve then swaps with
+template <typename PointT>
+void ElevateCurve(uint32_t &degree, uint32_t t, std::vector<double> &knots,
+                  std::vector<PointT> &control_points) {
+  thread_local std::vector<double> Uh;
+  thread_local std::vector<PointT> Qw;
+  degree::ElevateDegree(degree, t, knots, control_points, Uh, Qw);
+  knots.swap(Uh);
+  control_points.swap(Qw);
+  degree += t;
+}
+
+// A5.11 on the knots and control points of a curve, with tolerance in model
+// space. Both stay as they were when the curve is not reducible.
+template <typename PointT>
+degree::ReductionReport ReduceCurve(uint32_t &degree, double tolerance,
+                                    std::vector<double> &knots,
+                                    std::vector<PointT> &control_points) {
+  degree::ReductionReport report;
+  const double scale =
+      knots::HomogeneousScale(control_points.data(), control_points.size());
+  thread_local std::vector<double> Uh;
+  thread_local std::vector<PointT> Pw;
+  double error = 0.0;
+  if (!degree::ReduceDegree(degree, tolerance / scale, knots, control_points,
+                            Uh, Pw, error)) {
+    return report;
+  }
+  knots.swap(Uh);
+  control_points.swap(Pw);
+  --degree;
+  report.reduced = true;
+  report.error_bound = error * scale;
+  return report;
+}
+
+// Runs task for every curve index, split between the threads of pool when
+// there is one
+void ForEachCurve(size_t count, ThreadPool *pool,
+                  const std::function<void(size_t)> &task) {
+  if (pool == nullptr) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+  pool->ParallelFor(count, task);
+}
+
+// Copies a curve's knots and control points into ones that keep their
+// capacity, reserving room for extra more
+template <typename PointT>
+void CopyInto(const std::vector<double> &knots,
+              const std::vector<PointT> &control_points, size_t extra,
+              std::vector<double> &out_knots,
+              std::vector<PointT> &out_control_points) {
+  out_knots.reserve(knots.size() + extra);
+  out_knots.assign(knots.begin(), knots.end());
+  out_control_points.reserve(control_points.size() + extra);
+  out_control_points.assign(control_points.begin(), control_points.end());
+}
+} // namespace
+
 NURBSCurve2D::NURBSCurve2D(uint32_t degree, std::vector<Point3D> control_points,
                            std::vector<double> knots, Point2D interval)
     : Curve2D(interval),
@@ -13,27 +227,53 @@ NURBSCurve2D::NURBSCurve2D(uint32_t degree, std::vector<Point3D> control_points,
   if (knots.size() != control_points.size() + degree + 1) {
     throw std::exception("Invalid BSplineCruve2D");
   }
+  UpdateSpans();
 }
 
 // ALGORITHM A4.1 p.124
 Point2D NURBSCurve2D::EvaluateCurve(double param) const {
-  double in_param = param;
-  if (in_param < interval_.x) {
-    in_param = interval_.x;
+  double in_param = ClampInterval(param);
+  uint32_t span = span_locator_.Find(in_param);
+  Point3D temp_point =
+      knots::CurvePoint(uniform_spans_, degree_, span, in_param, knots_,
+                        control_points_, kTolerance);
+  Point2D point = {temp_point.x / temp_point.z, temp_point.y / temp_point.z};
+  return point;
+}
+
+// Batched A4.1, the basis table comes from the shared cache so repeated
+// parameter lists skip the basis work
+void NURBSCurve2D::EvaluateCurveBatch(const double *params, size_t count,
+                                      Point2D *points) const {
+  if (count == 0) {
+    return;
   }
-  if (in_param > interval_.y) {
-    in_param = interval_.y;
+  std::vector<double> clamped(params, params + count);
+  for (double &param : clamped) {
+    param = ClampInterval(param);
   }
-  uint32_t span = static_cast<uint32_t>(
-      knots::FindSpanParam(degree_, knots_, in_param, kTolerance));
-  std::vector<double> bases =
-      knots::BasisFuns(span, in_param, degree_, knots_, kTolerance);
-  Point3D temp_point{0.0, 0.0, 0.0};
-  for (uint32_t i = 0; i <= degree_; i++) {
-    temp_point += bases[i] * control_points_[span - degree_ + i];
+  std::shared_ptr<const knots::BasisTable> table =
+      knots::BasisTableCache::Shared().Get(degree_, knots_, clamped.data(),
+                                           count, kTolerance);
+  for (size_t i = 0; i < count; ++i) {
+    Point3D temp_point = knots::CurvePoint(*table, i, control_points_);
+    points[i] = {temp_point.x / temp_point.z, temp_point.y / temp_point.z};
   }
-  Point2D point = {temp_point.x / temp_point.z, temp_point.y / temp_point.z};
-  return point;
+}
+
+std::vector<Point2D>
+NURBSCurve2D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2 || !forward::SplineStepPlan::Pays(
+                             degree_, knots_, interval_, point_count)) {
+    return EvaluateCurvePoints(point_count);
+  }
+  const forward::SplineStepPlan plan(degree_, knots_, interval_, point_count,
+                                     kTolerance);
+  return forward::StepCurve<Point2D>(plan, control_points_, true);
+}
+
+std::vector<double> NURBSCurve2D::Breakpoints() const {
+  return knots::Breakpoints(knots_, interval_.x, interval_.y, kTolerance);
 }
 
 // ALGORITHM A4.2 RatCurveDerivs(Aders,wders,d,CK) p.127
@@ -49,142 +289,72 @@ Point2D NURBSCurve2D::EvaluateCurve(double param) const {
 // wders is weight derivatives, which I will need to calculate for this.
 // - The derivatives A(k)(u) and w^i(u) are obtained using either Eq.(3.3) and
 // Algorithm A3.2 or Eq.(3.8) and Algorithm A3 .4.
-// - I think this literally means use A3.2 to calculate the weight values and
-// then just copy those to the weight vector
-//
-// ADers should be the derivatives of the point, not the control points, so I
-// should just use a b_spline surface to calculate this.
-
-std::vector<double> CurveWeightDerivatives(double param, uint32_t degree,
-                                           const std::vector<double> &knots,
-                                           const std::vector<double> &weights,
-                                           uint32_t max_derivative,
-                                           double tolerance) {
-  std::vector<double> derivs(max_derivative + 1, 0.0);
-  uint32_t span = knots::FindSpanParam(degree, knots, param, tolerance);
-  std::vector<std::vector<double>> c_derivs =
-      knots::DersBasisFuns(span, param, degree, max_derivative, knots);
-  for (uint32_t k = 0; k <= max_derivative; ++k) {
-    for (uint32_t j = 0; j <= degree; ++j) {
-      derivs[k] += c_derivs[k][j] * weights[span - degree + j];
-    }
-  }
+std::vector<Point2D> NURBSCurve2D::EvaluateDerivative(double param,
+                                                      uint32_t d) const {
+  std::vector<Point2D> derivs(std::min(degree_, d) + 1);
+  EvaluateDerivative(param, d, derivs.data());
   return derivs;
 }
 
-std::vector<Point2D> NURBSCurve2D::EvaluateDerivative(double param,
-                                                      uint32_t d) const {
-  double in_param = param;
-  if (in_param < interval_.x) {
-    in_param = interval_.x;
-  }
-  if (in_param > interval_.y) {
-    in_param = interval_.y;
-  }
+// Aders and wders come from A3.2 on the homogeneous control points, which
+// already hold the weighted points and the weights. Aders is built in place
+// in ck and wders in the spare bases buffer of the thread scratch.
+uint32_t NURBSCurve2D::EvaluateDerivative(double param, uint32_t d,
+                                          Point2D *ck) const {
+  const double in_param = ClampInterval(param);
   d = std::min(degree_, d);
+  const uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, d);
+  const double *ders = scratch.ders.data();
+  knots::DersBasisFuns(span, in_param, degree_, d, knots_,
+                       scratch.ders.data(), scratch);
+  // d <= degree_, so bases has room for the d + 1 weight derivatives
+  double *wders = scratch.bases.data();
+  for (uint32_t k = 0; k <= d; ++k) {
+    Point3D a;
+    for (uint32_t j = 0; j <= degree_; ++j) {
+      a += ders[(k * (degree_ + 1)) + j] * control_points_[span - degree_ + j];
+    }
+    ck[k] = {a.x, a.y};
+    wders[k] = a.z;
+  }
 
-  std::vector<Point2D> bspl_cpts;
-  std::vector<double> weights;
-  for (auto &cpt : control_points_) {
-    bspl_cpts.push_back({cpt.x, cpt.y});
-    weights.push_back(cpt.z);
-  }
-  BSplineCurve2D b_spline(degree_, bspl_cpts, knots_, interval_);
-  auto a_derivs = b_spline.Derivatives(param, d);
-
-  std::vector<std::vector<double>> bin = knots::BinomialCoefficients(d, d);
-  // Build the wieght derivatives
-  std::vector<double> weight_divs =
-      CurveWeightDerivatives(in_param, degree_, knots_, weights, d, kTolerance);
-  // Calculate the derivatives
-  std::vector<Point2D> derivs(d + 1);
   for (uint32_t i = 0; i <= d; ++i) {
-    Point2D v = a_derivs[i];
-
+    Point2D v = ck[i];
     for (uint32_t j = 1; j <= i; ++j) {
-      v -= bin[i][j] * weight_divs[j] * derivs[i - j];
+      v -= knots::Binomial(i, j) * wders[j] * ck[i - j];
     }
-    derivs[i] = v / weight_divs[0];
+    ck[i] = v / wders[0];
   }
-
-  return derivs;
+  return d + 1;
 }
 
 // ALGORITHM A5.1 CurveKnotins(np, p, UP, Pw, u, k, s, r, nq, UQ, Qw) p.151
 NURBSCurve2D NURBSCurve2D::KnotInsertion(double knot, uint32_t times) const {
-  // Compute new curve from knot insertion
-  // Input: np,p,UP,Pw,u,k,s,r
-  // np - Number of control points before insertion
-  // p - Degree of the curve
-  // UP - Knot vector before insertion
-  // Pw - Control points before insertion
-  // u - value of knot to insert
-  // k - location of knot in insert
-  // s - inital knot multiplicity
-  // r - times to insert knot
-  int p = degree_;
-  auto UP = knots_;
-  auto Pw = control_points_;
-  auto u = knot;
-  int k = knots::FindSpanParam(p, UP, knot, kTolerance);
-  int s = knots::MultiplicityParam(p, UP, knot, kTolerance);
-  int r = times;
-
-  // Max value of r is p - s
-  r = std::min(r, p - s);
-
-  // Output: nq,UQ,Qw
-  // nq - Number of control points after insertion
-  // UQ - Knot vector after insertion
-  // Qw - Control points after insertion
-  std::vector<double> UQ;
-  std::vector<Point3D> Qw;
-
-  UQ.resize(UP.size() + r);
-  Qw.resize(Pw.size() + r);
-
-  // Load new knot vector
-  for (int i = 0; i <= k; i++) {
-    UQ[i] = UP[i];
-  }
-  for (int i = 1; i <= r; i++) {
-    UQ[k + i] = u;
-  }
-  for (int i = k + 1; i < UP.size(); i++) {
-    UQ[i + r] = UP[i];
-  }
-  std::vector<Point3D> Rw(p + 2);
-
-  // Save unaltered control points
-  for (int i = 0; i <= k - p; i++) {
-    Qw[i] = Pw[i];
-  }
-  for (int i = k - s; i < Pw.size(); i++) {
-    Qw[i + r] = Pw[i];
-  }
-  for (int i = 0; i <= p - s; i++) {
-    Rw[i] = Pw[k - p + i];
-  }
-
-  // Insert the knot r times
-  int L = k - p;
-  for (int j = 1; j <= r; j++) {
-    L = k - p + j;
-    for (int i = 0; i <= p - j - s; i++) {
-      double alpha = (u - UP[L + i]) / (UP[i + k + 1] - UP[L + i]);
-      Rw[i] = (alpha * Rw[i + 1]) + ((1.0 - alpha) * Rw[i]);
-    }
+  NURBSCurve2D curve = *this;
+  curve.InsertKnots(knot, times);
+  return curve;
+}
 
-    Qw[L] = Rw[0];
-    Qw[k + r - j - s] = Rw[p - j - s];
-  }
+void NURBSCurve2D::InsertKnots(double knot, uint32_t times) {
+  InsertKnotsInPlace(degree_, knot, times, kTolerance, knots_,
+                     control_points_);
+  UpdateSpans();
+}
 
-  // Load remaining control points
-  for (int i = L + 1; i < k - s; i++) {
-    Qw[i] = Rw[i - L];
+void NURBSCurve2D::InsertKnotsInto(double knot, uint32_t times,
+                                   NURBSCurve2D &out) const {
+  if (&out == this) {
+    out.InsertKnots(knot, times);
+    return;
   }
-
-  return NURBSCurve2D(p, Qw, UQ, interval_);
+  out.degree_ = degree_;
+  out.interval(interval_);
+  CopyInto(knots_, control_points_, times, out.knots_, out.control_points_);
+  InsertKnotsInPlace(degree_, knot, times, kTolerance, out.knots_,
+                     out.control_points_);
+  out.UpdateSpans();
 }
 
 // ALGORITHM A5.2 CurvePntByCornerCut(n, p, U, Pw, u, C) p.153
@@ -247,73 +417,93 @@ Point2D NURBSCurve2D::PointByCornerCut(double param) const {
 
 // ALGORITHM 5.4 RefineKnotVectCurve(n, p, Um Pwm Xm rm Ubar, Qw) p.164
 NURBSCurve2D NURBSCurve2D::MergeKnotVect(std::vector<double> knots) const {
+  NURBSCurve2D curve = *this;
+  curve.Refine(knots);
+  return curve;
+}
+
+void NURBSCurve2D::Refine(const std::vector<double> &knots) {
   if (knots.empty()) {
-    return NURBSCurve2D(degree_, control_points_, knots_, interval_);
+    return;
   }
+  if (&knots == &knots_) {
+    // The refinement grows knots_ while it reads the new knots
+    Refine(std::vector<double>(knots));
+    return;
+  }
+  RefineInPlace(degree_, knots, kTolerance, knots_, control_points_);
+  UpdateSpans();
+}
 
-  // Input Parameters
-  // n - Size of control points
-  // p - degree of the curve
-  // U - knot vector
-  // Pw - control points
-  // X - Knot vector to merge
-  // r - size of X
-  int n = static_cast<int>(control_points_.size()) - 1;
-  int p = degree_;
-  std::vector<double> U = knots_;
-  std::vector<Point3D> Pw = control_points_;
-  std::vector<double> X = knots;
-  int r = static_cast<int>(X.size()) - 1;
-
-  // Output Parameters
-  // Ubar - resulting knot vector
-  // Qw - resulting control polygon
-  std::vector<Point3D> Qw;
-  Qw.resize(Pw.size() + r + 1);
-  std::vector<double> Ubar;
-  Ubar.resize(U.size() + r + 1);
-
-  int m = n + p + 1;
-  int a = knots::FindSpanParam(p, U, X[0], kTolerance);
-  int b = knots::FindSpanParam(p, U, X[r], kTolerance);
-  b += 1;
-
-  for (int i = 0; i <= a - p; ++i) {
-    Qw[i] = Pw[i];
+void NURBSCurve2D::RefineInto(const std::vector<double> &knots,
+                              NURBSCurve2D &out) const {
+  if (&out == this) {
+    out.Refine(knots);
+    return;
   }
-  for (int i = b - 1; i <= n; ++i) {
-    Qw[i + r + 1] = Pw[i];
+  out.degree_ = degree_;
+  out.interval(interval_);
+  CopyInto(knots_, control_points_, knots.size(), out.knots_,
+           out.control_points_);
+  RefineInPlace(degree_, knots, kTolerance, out.knots_, out.control_points_);
+  out.UpdateSpans();
+}
+
+// ALGORITHM A5.8 RemoveCurveKnot(n, p, U, Pw, u, r, s, num, t) p.185
+uint32_t NURBSCurve2D::RemoveKnots(double knot, uint32_t times,
+                                   double tolerance) {
+  const uint32_t removed = RemoveKnotsInPlace(degree_, knot, times, tolerance,
+                                              knots_, control_points_);
+  if (removed > 0) {
+    UpdateSpans();
   }
-  for (int i = 0; i <= a; ++i) {
-    Ubar[i] = U[i];
+  return removed;
+}
+
+NURBSCurve2D NURBSCurve2D::KnotRemoval(double knot, uint32_t times,
+                                       double tolerance) const {
+  NURBSCurve2D curve = *this;
+  curve.RemoveKnots(knot, times, tolerance);
+  return curve;
+}
+
+knots::RemovalReport NURBSCurve2D::Simplify(double tolerance) {
+  knots::RemovalReport report =
+      SimplifyCurve(degree_, tolerance, knots_, control_points_);
+  if (report.knots_removed > 0) {
+    UpdateSpans();
   }
-  for (int i = b + p; i <= m; ++i) {
-    Ubar[i + r + 1] = U[i];
+  return report;
+}
+
+// ALGORITHM A5.9 DegreeElevateCurve(n, p, U, Pw, t, nh, Uh, Qw) p.206
+void NURBSCurve2D::ElevateDegree(uint32_t t) {
+  if (t == 0 || control_points_.empty()) {
+    return;
   }
-  int i = b + p - 1;
-  int k = b + p + r;
-  for (int j = r; j >= 0; --j) {
-    while (X[j] <= U[i] && i > a) {
-      Qw[k - p - 1] = Pw[i - p - 1];
-      Ubar[k] = U[i];
-      k = k - 1;
-      i = i - 1;
-    }
-    Qw[k - p - 1] = Qw[k - p];
-    for (int l = 1; l <= p; ++l) {
-      int ind = k - p + l;
-      double alfa = Ubar[k + l] - X[j];
-      if (abs(alfa) < kTolerance) {
-        Qw[ind - 1] = Qw[ind];
-      } else {
-        alfa = alfa / (Ubar[k + l] - U[i - p + l]);
-        Qw[ind - 1] = (alfa * Qw[ind - 1]) + ((1.0 - alfa) * Qw[ind]);
-      }
-    }
-    Ubar[k] = X[j];
-    k = k - 1;
+  ElevateCurve(degree_, t, knots_, control_points_);
+  UpdateSpans();
+}
+
+NURBSCurve2D NURBSCurve2D::DegreeElevation(uint32_t t) const {
+  NURBSCurve2D curve = *this;
+  curve.ElevateDegree(t);
+  return curve;
+}
+
+// ALGORITHM A5.11 DegreeReduceCurve(n, p, U, Qw, nh, Uh, Pw) p.223
+degree::ReductionReport NURBSCurve2D::ReduceDegree(double tolerance) {
+  degree::ReductionReport report =
+      ReduceCurve(degree_, tolerance, knots_, control_points_);
+  if (report.reduced) {
+    UpdateSpans();
   }
-  return NURBSCurve2D(p, Qw, Ubar, interval_);
+  return report;
+}
+
+void NURBSCurve2D::UpdateSpans() {
+  span_locator_.Reset(degree_, knots_, kTolerance);
+  uniform_spans_.Reset(degree_, knots_);
 }
 
 // ALGORITHM A5.6 DecomposeCurve(n, p, U, Pw, nb, Qw) p.173
@@ -407,145 +597,145 @@ NURBSCurve3D::NURBSCurve3D(uint32_t degree, std::vector<Point4D> control_points,
   if (knots.size() != control_points.size() + degree + 1) {
     throw std::exception("Invalid BSplineCruve2D");
   }
+  UpdateSpans();
 }
 
 // ALGORITHM A4.1 p.124
 Point3D NURBSCurve3D::EvaluateCurve(double param) const {
-  double in_param = param;
-  if (in_param < interval_.x) {
-    in_param = interval_.x;
-  }
-  if (in_param > interval_.y) {
-    in_param = interval_.y;
-  }
-  uint32_t span = static_cast<uint32_t>(
-      knots::FindSpanParam(degree_, knots_, in_param, kTolerance));
-  std::vector<double> bases =
-      knots::BasisFuns(span, in_param, degree_, knots_, kTolerance);
-  Point4D temp_point{0.0, 0.0, 0.0, 0.0};
-  for (uint32_t i = 0; i <= degree_; i++) {
-    temp_point += bases[i] * control_points_[span - degree_ + i];
-  }
+  double in_param = ClampInterval(param);
+  uint32_t span = span_locator_.Find(in_param);
+  Point4D temp_point =
+      knots::CurvePoint(uniform_spans_, degree_, span, in_param, knots_,
+                        control_points_, kTolerance);
   Point3D point = {temp_point.x / temp_point.w, temp_point.y / temp_point.w,
                    temp_point.z / temp_point.w};
   return point;
 }
 
-std::vector<Point3D> NURBSCurve3D::EvaluateDerivative(double param,
-                                                      uint32_t d) const {
-  double in_param = param;
-  if (in_param < interval_.x) {
-    in_param = interval_.x;
-  }
-  if (in_param > interval_.y) {
-    in_param = interval_.y;
+// Batched A4.1, the basis table comes from the shared cache so repeated
+// parameter lists skip the basis work. Uniform cubic spans are cheaper to
+// evaluate than to look up, those curves skip the table.
+void NURBSCurve3D::EvaluateCurveBatch(const double *params, size_t count,
+                                      Point3D *points) const {
+  if (count == 0) {
+    return;
   }
-  d = std::min(degree_, d);
-
-  std::vector<Point3D> bspl_cpts;
-  std::vector<double> weights;
-  for (auto &cpt : control_points_) {
-    bspl_cpts.push_back({cpt.x, cpt.y, cpt.z});
-    weights.push_back(cpt.w);
-  }
-  BSplineCurve3D b_spline(degree_, bspl_cpts, knots_, interval_);
-  auto a_derivs = b_spline.Derivatives(param, d);
-
-  std::vector<std::vector<double>> bin = knots::BinomialCoefficients(d, d);
-  // Build the wieght derivatives
-  std::vector<double> weight_divs =
-      CurveWeightDerivatives(in_param, degree_, knots_, weights, d, kTolerance);
-  // Calculate the derivatives
-  std::vector<Point3D> derivs(d + 1);
-  for (uint32_t i = 0; i <= d; ++i) {
-    Point3D v = a_derivs[i];
-
-    for (uint32_t j = 1; j <= i; ++j) {
-      v -= bin[i][j] * weight_divs[j] * derivs[i - j];
+  if (!uniform_spans_.empty()) {
+    double clamped[knots::kUniformCubicBlock];
+    Point4D homogeneous[knots::kUniformCubicBlock];
+    for (size_t first = 0; first < count;
+         first += knots::kUniformCubicBlock) {
+      const size_t block = std::min(knots::kUniformCubicBlock, count - first);
+      for (size_t i = 0; i < block; ++i) {
+        clamped[i] = ClampInterval(params[first + i]);
+      }
+      knots::CurvePoints(uniform_spans_, span_locator_, degree_, knots_,
+                         control_points_, kTolerance, clamped, block,
+                         homogeneous);
+      for (size_t i = 0; i < block; ++i) {
+        const Point4D &point = homogeneous[i];
+        points[first + i] = {point.x / point.w, point.y / point.w,
+                             point.z / point.w};
+      }
     }
-    derivs[i] = v / weight_divs[0];
+    return;
+  }
+  std::vector<double> clamped(params, params + count);
+  for (double &param : clamped) {
+    param = ClampInterval(param);
+  }
+  std::shared_ptr<const knots::BasisTable> table =
+      knots::BasisTableCache::Shared().Get(degree_, knots_, clamped.data(),
+                                           count, kTolerance);
+  for (size_t i = 0; i < count; ++i) {
+    Point4D temp_point = knots::CurvePoint(*table, i, control_points_);
+    points[i] = {temp_point.x / temp_point.w, temp_point.y / temp_point.w,
+                 temp_point.z / temp_point.w};
   }
-
-  return derivs;
 }
 
-// ALGORITHM A5.1 CurveKnotins(np, p, UP, Pw, u, k, s, r, nq, UQ, Qw) p.151
-NURBSCurve3D NURBSCurve3D::KnotInsertion(double knot, uint32_t times) const {
-  // Compute new curve from knot insertion
-  // Input: np,p,UP,Pw,u,k,s,r
-  // np - Number of control points before insertion
-  // p - Degree of the curve
-  // UP - Knot vector before insertion
-  // Pw - Control points before insertion
-  // u - value of knot to insert
-  // k - location of knot in insert
-  // s - inital knot multiplicity
-  // r - times to insert knot
-  auto p = degree_;
-  auto UP = knots_;
-  auto Pw = control_points_;
-  auto u = knot;
-  auto k = knots::FindSpanParam(p, UP, knot, kTolerance);
-  auto s = knots::MultiplicityParam(p, UP, knot, kTolerance);
-  auto r = times;
-
-  // Max value of r is (p + 1) - s
-  r = std::min(r, p - s);
+std::vector<Point3D>
+NURBSCurve3D::StepCurvePoints(uint32_t point_count) const {
+  if (point_count < 2 || !forward::SplineStepPlan::Pays(
+                             degree_, knots_, interval_, point_count)) {
+    return EvaluateCurvePoints(point_count);
+  }
+  const forward::SplineStepPlan plan(degree_, knots_, interval_, point_count,
+                                     kTolerance);
+  return forward::StepCurve<Point3D>(plan, control_points_, true);
+}
 
-  // Output: nq,UQ,Qw
-  // nq - Number of control points after insertion
-  // UQ - Knot vector after insertion
-  // Qw - Control points after insertion
-  std::vector<double> UQ;
-  std::vector<Point4D> Qw;
+std::vector<double> NURBSCurve3D::Breakpoints() const {
+  return knots::Breakpoints(knots_, interval_.x, interval_.y, kTolerance);
+}
 
-  UQ.resize(UP.size() + r);
-  Qw.resize(Pw.size() + r);
+// ALGORITHM A4.2 RatCurveDerivs(Aders,wders,d,CK) p.127
+std::vector<Point3D> NURBSCurve3D::EvaluateDerivative(double param,
+                                                      uint32_t d) const {
+  std::vector<Point3D> derivs(std::min(degree_, d) + 1);
+  EvaluateDerivative(param, d, derivs.data());
+  return derivs;
+}
 
-  // Load new knot vector
-  for (uint32_t i = 0; i <= k; i++) {
-    UQ[i] = UP[i];
-  }
-  for (uint32_t i = 1; i <= r; i++) {
-    UQ[k + i] = u;
-  }
-  for (uint32_t i = k + 1; i < UP.size(); i++) {
-    UQ[i + r] = UP[i];
+// Aders and wders come from A3.2 on the homogeneous control points, which
+// already hold the weighted points and the weights. Aders is built in place
+// in ck and wders in the spare bases buffer of the thread scratch.
+uint32_t NURBSCurve3D::EvaluateDerivative(double param, uint32_t d,
+                                          Point3D *ck) const {
+  const double in_param = ClampInterval(param);
+  d = std::min(degree_, d);
+  const uint32_t span = span_locator_.Find(in_param);
+  knots::BasisScratch &scratch = knots::ThreadScratch();
+  scratch.Reserve(degree_, d);
+  const double *ders = scratch.ders.data();
+  knots::DersBasisFuns(span, in_param, degree_, d, knots_,
+                       scratch.ders.data(), scratch);
+  // d <= degree_, so bases has room for the d + 1 weight derivatives
+  double *wders = scratch.bases.data();
+  for (uint32_t k = 0; k <= d; ++k) {
+    Point4D a;
+    for (uint32_t j = 0; j <= degree_; ++j) {
+      a += ders[(k * (degree_ + 1)) + j] * control_points_[span - degree_ + j];
+    }
+    ck[k] = {a.x, a.y, a.z};
+    wders[k] = a.w;
   }
-  std::vector<Point4D> Rw(p + 1);
 
-  // Save unaltered control points
-  for (uint32_t i = 0; i <= k - p; i++) {
-    Qw[i] = Pw[i];
-  }
-  for (uint32_t i = k; i < Pw.size(); i++) {
-    Qw[i + r] = Pw[i];
-  }
-  for (uint32_t i = 0; i <= p; i++) {
-    Rw[i] = Pw[k - p + i];
+  for (uint32_t i = 0; i <= d; ++i) {
+    Point3D v = ck[i];
+    for (uint32_t j = 1; j <= i; ++j) {
+      v -= knots::Binomial(i, j) * wders[j] * ck[i - j];
+    }
+    ck[i] = v / wders[0];
   }
+  return d + 1;
+}
 
-  // Insert the knot r times
-  uint32_t L = k - p;
-  for (uint32_t j = 1; j <= r; j++) {
-    L = k - p + j;
-    for (uint32_t i = 0; i <= p - j - s; i++) {
-      double alpha =
-          (u - static_cast<double>(UP[L + i])) /
-          (static_cast<double>(UP[i + k + 1]) - static_cast<double>(UP[L + i]));
-      Rw[i] = (alpha * Rw[i + 1]) + ((1.0 - alpha) * Rw[i]);
-    }
+// ALGORITHM A5.1 CurveKnotins(np, p, UP, Pw, u, k, s, r, nq, UQ, Qw) p.151
+NURBSCurve3D NURBSCurve3D::KnotInsertion(double knot, uint32_t times) const {
+  NURBSCurve3D curve = *this;
+  curve.InsertKnots(knot, times);
+  return curve;
+}
 
-    Qw[L] = Rw[0];
-    Qw[k + r - j] = Rw[p - j];
-  }
+void NURBSCurve3D::InsertKnots(double knot, uint32_t times) {
+  InsertKnotsInPlace(degree_, knot, times, kTolerance, knots_,
+                     control_points_);
+  UpdateSpans();
+}
 
-  // Load remaining control points
-  for (uint32_t i = L + 1; i < k; i++) {
-    Qw[i] = Rw[i - L];
+void NURBSCurve3D::InsertKnotsInto(double knot, uint32_t times,
+                                   NURBSCurve3D &out) const {
+  if (&out == this) {
+    out.InsertKnots(knot, times);
+    return;
   }
-
-  return NURBSCurve3D(p, Qw, UQ, interval_);
+  out.degree_ = degree_;
+  out.interval(interval_);
+  CopyInto(knots_, control_points_, times, out.knots_, out.control_points_);
+  InsertKnotsInPlace(degree_, knot, times, kTolerance, out.knots_,
+                     out.control_points_);
+  out.UpdateSpans();
 }
 
 // ALGORITHM A5.2 CurvePntByCornerCut(n, p, U, Pw, u, C) p.153
@@ -608,105 +798,136 @@ Point3D NURBSCurve3D::PointByCornerCut(double param) const {
 
 // ALGORITHM 5.4 RefineKnotVectCurve(n, p, Um Pwm Xm rm Ubar, Qw) p.164
 NURBSCurve3D NURBSCurve3D::MergeKnotVect(std::vector<double> knots) const {
+  NURBSCurve3D curve = *this;
+  curve.Refine(knots);
+  return curve;
+}
+
+void NURBSCurve3D::Refine(const std::vector<double> &knots) {
   if (knots.empty()) {
-    return NURBSCurve3D(degree_, control_points_, knots_, interval_);
+    return;
   }
+  if (&knots == &knots_) {
+    // The refinement grows knots_ while it reads the new knots
+    Refine(std::vector<double>(knots));
+    return;
+  }
+  RefineInPlace(degree_, knots, kTolerance, knots_, control_points_);
+  UpdateSpans();
+}
 
-  // Input Parameters
-  // n - Size of control points
-  // p - degree of the curve
-  // U - knot vector
-  // Pw - control points
-  // X - Knot vector to merge
-  // r - size of X
-  int n = static_cast<int>(control_points_.size()) - 1;
-  int p = degree_;
-  std::vector<double> U = knots_;
-  std::vector<Point4D> Pw = control_points_;
-  std::vector<double> X = knots;
-  int r = static_cast<int>(X.size()) - 1;
-
-  // Output Parameters
-  // Ubar - resulting knot vector
-  // Qw - resulting control polygon
-  std::vector<Point4D> Qw;
-  Qw.resize(Pw.size() + r + 1);
-  std::vector<double> Ubar;
-  Ubar.resize(U.size() + r + 1);
-
-  int m = n + p + 1;
-  int a = knots::FindSpanParam(p, U, X[0], kTolerance);
-  int b = knots::FindSpanParam(p, U, X[r], kTolerance);
-  b += 1;
+void NURBSCurve3D::RefineInto(const std::vector<double> &knots,
+                              NURBSCurve3D &out) const {
+  if (&out == this) {
+    out.Refine(knots);
+    return;
+  }
+  out.degree_ = degree_;
+  out.interval(interval_);
+  CopyInto(knots_, control_points_, knots.size(), out.knots_,
+           out.control_points_);
+  RefineInPlace(degree_, knots, kTolerance, out.knots_, out.control_points_);
+  out.UpdateSpans();
+}
 
-  for (int i = 0; i <= a - p; ++i) {
-    Qw[i] = Pw[i];
+// ALGORITHM A5.8 RemoveCurveKnot(n, p, U, Pw, u, r, s, num, t) p.185
+uint32_t NURBSCurve3D::RemoveKnots(double knot, uint32_t times,
+                                   double tolerance) {
+  const uint32_t removed = RemoveKnotsInPlace(degree_, knot, times, tolerance,
+                                              knots_, control_points_);
+  if (removed > 0) {
+    UpdateSpans();
   }
-  for (int i = b - 1; i <= n; ++i) {
-    Qw[i + r + 1] = Pw[i];
+  return removed;
+}
+
+NURBSCurve3D NURBSCurve3D::KnotRemoval(double knot, uint32_t times,
+                                       double tolerance) const {
+  NURBSCurve3D curve = *this;
+  curve.RemoveKnots(knot, times, tolerance);
+  return curve;
+}
+
+knots::RemovalReport NURBSCurve3D::Simplify(double tolerance) {
+  knots::RemovalReport report =
+      SimplifyCurve(degree_, tolerance, knots_, control_points_);
+  if (report.knots_removed > 0) {
+    UpdateSpans();
   }
-  for (int i = 0; i <= a; ++i) {
-    Ubar[i] = U[i];
+  return report;
+}
+
+// ALGORITHM A5.9 DegreeElevateCurve(n, p, U, Pw, t, nh, Uh, Qw) p.206
+void NURBSCurve3D::ElevateDegree(uint32_t t) {
+  if (t == 0 || control_points_.empty()) {
+    return;
   }
-  for (int i = b + p; i <= m; ++i) {
-    Ubar[i + r + 1] = U[i];
+  ElevateCurve(degree_, t, knots_, control_points_);
+  UpdateSpans();
+}
+
+NURBSCurve3D NURBSCurve3D::DegreeElevation(uint32_t t) const {
+  NURBSCurve3D curve = *this;
+  curve.ElevateDegree(t);
+  return curve;
+}
+
+// ALGORITHM A5.11 DegreeReduceCurve(n, p, U, Qw, nh, Uh, Pw) p.223
+degree::ReductionReport NURBSCurve3D::ReduceDegree(double tolerance) {
+  degree::ReductionReport report =
+      ReduceCurve(degree_, tolerance, knots_, control_points_);
+  if (report.reduced) {
+    UpdateSpans();
   }
-  int i = b + p - 1;
-  int k = b + p + r;
-  for (int j = r; j >= 0; --j) {
-    while (X[j] <= U[i] && i > a) {
-      Qw[k - p - 1] = Pw[i - p - 1];
-      Ubar[k] = U[i];
-      k = k - 1;
-      i = i - 1;
-    }
-    Qw[k - p - 1] = Qw[k - p];
-    for (int l = 1; l <= p; ++l) {
-      int ind = k - p + l;
-      double alfa = Ubar[k + l] - X[j];
-      if (abs(alfa) < kTolerance) {
-        Qw[ind - 1] = Qw[ind];
-      } else {
-        alfa = alfa / (Ubar[k + l] - U[i - p + l]);
-        Qw[ind - 1] = (alfa * Qw[ind - 1]) + ((1.0 - alfa) * Qw[ind]);
-      }
-    }
-    Ubar[k] = X[j];
-    k = k - 1;
+  return report;
+}
+
+void NURBSCurve3D::UpdateSpans() {
+  span_locator_.Reset(degree_, knots_, kTolerance);
+  uniform_spans_.Reset(degree_, knots_);
+}
+
+std::vector<BezierCurve3D> NURBSCurve3D::Decompose() const {
+  BezierSegmentSet segments;
+  Decompose(segments);
+  std::vector<BezierCurve3D> bezier_segments;
+  bezier_segments.reserve(segments.size());
+  for (size_t k = 0; k < segments.size(); ++k) {
+    bezier_segments.push_back(segments.Segment(k));
   }
-  return NURBSCurve3D(p, Qw, Ubar, interval_);
+  return bezier_segments;
 }
 
 // ALGORITHM A5.6 DecomposeCurve(n, p, U, Pw, nb, Qw) p.173
-std::vector<BezierCurve3D> NURBSCurve3D::Decompose() const {
+// Qw is the arena of out: segment nb is at nb * (p + 1), so the next segment
+// the book keeps in Qw[nb + 1] already is in place when nb is done
+void NURBSCurve3D::Decompose(BezierSegmentSet &out) const {
   // Input:
   // n - Number of points
   // p - degree
   // U - knot vector
   // Pw - Control points
-  // Output:
-  // nb - number of bezier segments
-  // Qw - a vector of points representing nb bezier curves
-  auto Pw = control_points_;
+  const std::vector<Point4D> &Pw = control_points_;
   int n = static_cast<int>(Pw.size()) - 1;
   int p = degree_;
-  auto U = knots_;
-
-  std::vector<BezierCurve3D> bezier_segments;
+  const std::vector<double> &U = knots_;
 
-  std::vector<std::vector<Point4D>> Qw(2);
-  for (auto &vec : Qw) {
-    vec.resize(p + 1);
+  out.Reset(degree_, knots::DecomposeBreaks(degree_, knots_));
+  if (out.empty()) {
+    return;
   }
 
-  std::vector<double> alphas(p + 1, 0.0);
+  thread_local std::vector<double> alphas;
+  alphas.assign(p + 1, 0.0);
 
   int m = n + p + 1;
   int a = p;
   int b = p + 1;
+  int nb = 0;
 
+  Point4D *Qw = out.control_points(0);
   for (int i = 0; i <= p; ++i) {
-    Qw[0][i] = Pw[i];
+    Qw[i] = Pw[i];
   }
 
   while (b < m) {
@@ -727,36 +948,85 @@ std::vector<BezierCurve3D> NURBSCurve3D::Decompose() const {
         int s = mult + j;  // This many new points
         for (int k = p; k >= s; --k) {
           double alpha = alphas[k - s];
-          Qw[0][k] = (alpha * Qw[0][k]) + ((1.0 - alpha) * Qw[0][k - 1]);
+          Qw[k] = (alpha * Qw[k]) + ((1.0 - alpha) * Qw[k - 1]);
         }
         if (b < m) {
           // Control point of next segment
-          Qw[1][save] = Qw[0][p];
+          Qw[p + 1 + save] = Qw[p];
         }
       }
     }
 
     // Bezier segment complete
-    std::vector<Point3D> bezier_points;
-    bezier_points.reserve(p + 1);
-    for (auto point : Qw[0]) {
-      bezier_points.emplace_back(Point3D(point.x, point.y, point.z) / point.w);
-    }
-    bezier_segments.emplace_back(bezier_points);
+    ++nb;
 
     if (b < m) {
-      Qw[0] = Qw[1];
-      Qw[1].clear();
-      Qw[1].resize(p + 1);
+      Qw = out.control_points(nb);
       // Initialize for next segment
       for (i = std::max(p - mult, 0); i <= p; ++i) {
-        Qw[0][i] = Pw[b - p + i];
+        Qw[i] = Pw[b - p + i];
       }
       a = b;
       b = b + 1;
     }
   }
-  return bezier_segments;
 }
 
+PiecewisePowerBasisCurve2D NURBSCurve2D::ToPowerBasis() const {
+  std::vector<double> breakpoints;
+  std::vector<double> coefficients;
+  CompilePowerBasis(degree_, knots_, control_points_, breakpoints,
+                    coefficients);
+  return PiecewisePowerBasisCurve2D(degree_, std::move(breakpoints),
+                                    std::move(coefficients), true,
+                                    interval_);
+}
+
+PiecewisePowerBasisCurve3D NURBSCurve3D::ToPowerBasis() const {
+  std::vector<double> breakpoints;
+  std::vector<double> coefficients;
+  CompilePowerBasis(degree_, knots_, control_points_, breakpoints,
+                    coefficients);
+  return PiecewisePowerBasisCurve3D(degree_, std::move(breakpoints),
+                                    std::move(coefficients), true,
+                                    interval_);
+}
+
+// The union of sorted knot vectors keeps the larger count of every value, so
+// merged holds each knot with the most copies any curve has, and the
+// difference with a curve's own knots is what that curve is missing
+void MakeCompatible(NURBSCurve3D *curves, size_t count, ThreadPool *pool) {
+  if (count < 2) {
+    return;
+  }
+  uint32_t max_degree = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (curves[i].knots().front() != curves[0].knots().front() ||
+        curves[i].knots().back() != curves[0].knots().back()) {
+      throw std::exception("MakeCompatible needs curves on one knot range");
+    }
+    max_degree = std::max(max_degree, curves[i].degree());
+  }
+  ForEachCurve(count, pool, [&](size_t i) {
+    curves[i].ElevateDegree(max_degree - curves[i].degree());
+  });
+
+  std::vector<double> merged = curves[0].knots();
+  std::vector<double> next;
+  for (size_t i = 1; i < count; ++i) {
+    const std::vector<double> &knots = curves[i].knots();
+    next.clear();
+    std::set_union(merged.begin(), merged.end(), knots.begin(), knots.end(),
+                   std::back_inserter(next));
+    merged.swap(next);
+  }
+  ForEachCurve(count, pool, [&](size_t i) {
+    thread_local std::vector<double> missing;
+    const std::vector<double> &knots = curves[i].knots();
+    missing.clear();
+    std::set_difference(merged.begin(), merged.end(), knots.begin(),
+                        knots.end(), std::back_inserter(missing));
+    curves[i].Refine(missing);
+  });
+}
 }  // namespace nurbs
\ No newline at end of file
@@ -1,752 +1,1007 @@
 #include "include/nurbs_surface.hpp"
 
 #include "include/b_spline_surface.hpp"
+#include "include/fixed_degree_basis.hpp"
+#include "include/forward_difference.hpp"
 #include "include/knot_utility_functions.hpp"
+#include "include/tensor_grid.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cmath>
 
 namespace nurbs {
-namespace {}  // namespace
-NURBSSurface::NURBSSurface(uint32_t u_degree, uint32_t v_degree,
-                           std::vector<double> u_knots,
-                           std::vector<double> v_knots,
-                           std::vector<std::vector<Point4D>> control_polygon,
-                           Point2D u_interval, Point2D v_interval)
-    : Surface(u_interval, v_interval),
-      u_degree_(u_degree),
-      v_degree_(v_degree),
-      u_knots_(u_knots),
-      v_knots_(v_knots),
-      control_polygon_(control_polygon),
-      u_internal_interval_(u_interval),
-      v_internal_interval_(v_interval) {
-  if (u_knots_.size() != control_polygon_.size() + u_degree_ + 1) {
-    throw std::exception("Invalid U Parameters for a NURBS Surface");
+namespace {
+constexpr uint32_t kPlanes = ControlNet<Point4D>::kDimension;
+
+// Rows or columns the knot operations hand to each pool task
+constexpr size_t kLanesPerTask = 32;
+
+// One control point update of a knot algorithm, recorded so it can be
+// replayed on every row or column of a control net. kCopyOld copies count
+// points of the old net, the others update one point of the new net.
+struct RefineStep {
+  enum Kind { kCopyOld, kCopyNew, kBlend };
+  Kind kind;
+  int dst;
+  int src;
+  double alfa;
+  int count = 1;
+};
+
+// The curves of one or more nets that a knot algorithm runs on, all of them
+// side by side: point i of lane l is points[c][i][l * lane_step] in plane c.
+// Curves along u are the columns of a net and its rows are the points, so
+// lanes are contiguous. Curves along v are the rows, lanes are a stride
+// apart.
+template <typename T> struct NetCurves {
+  std::array<std::vector<T *>, kPlanes> points;
+  size_t lane_step = 1;
+};
+
+// Appends the points of the curves of net in direction dir
+template <typename T, typename NetT>
+void AddCurves(NetT &net, NURBSSurface::SurfaceDirection dir,
+               NetCurves<T> &curves) {
+  const bool along_u = dir == NURBSSurface::kUDir;
+  const size_t count = along_u ? net.rows() : net.cols();
+  for (uint32_t c = 0; c < kPlanes; ++c) {
+    for (size_t i = 0; i < count; ++i) {
+      curves.points[c].push_back(net.plane(c) +
+                                 (along_u ? net.Index(i, 0) : i));
+    }
   }
-  if (!control_polygon_.empty() &&
-      v_knots_.size() != control_polygon_[0].size() + v_degree_ + 1) {
-    throw std::exception("Invalid V Parameters for a NURBS Surface");
+  curves.lane_step = along_u ? 1 : net.stride();
+}
+
+// Runs steps on lanes [first, first + lanes) of in and out. kContiguous is
+// lane_step == 1 on both, which lets the lane loops vectorize.
+template <bool kContiguous>
+void ReplaySteps(const std::vector<RefineStep> &steps,
+                 const NetCurves<const double> &in, NetCurves<double> &out,
+                 size_t first, size_t lanes) {
+  const size_t in_step = kContiguous ? 1 : in.lane_step;
+  const size_t out_step = kContiguous ? 1 : out.lane_step;
+  for (uint32_t c = 0; c < kPlanes; ++c) {
+    const double *const *P = in.points[c].data();
+    double *const *Q = out.points[c].data();
+    const size_t in_first = first * in_step;
+    const size_t out_first = first * out_step;
+    for (const RefineStep &step : steps) {
+      switch (step.kind) {
+        case RefineStep::kCopyOld:
+          for (int i = 0; i < step.count; ++i) {
+            const double *src = P[step.src + i] + in_first;
+            double *dst = Q[step.dst + i] + out_first;
+            for (size_t l = 0; l < lanes; ++l) {
+              dst[l * out_step] = src[l * in_step];
+            }
+          }
+          break;
+        case RefineStep::kCopyNew: {
+          const double *src = Q[step.src] + out_first;
+          double *dst = Q[step.dst] + out_first;
+          for (size_t l = 0; l < lanes; ++l) {
+            dst[l * out_step] = src[l * out_step];
+          }
+          break;
+        }
+        case RefineStep::kBlend: {
+          const double alfa = step.alfa;
+          const double beta = 1.0 - alfa;
+          const double *src = Q[step.src] + out_first;
+          double *dst = Q[step.dst] + out_first;
+          for (size_t l = 0; l < lanes; ++l) {
+            dst[l * out_step] =
+                (alfa * dst[l * out_step]) + (beta * src[l * out_step]);
+          }
+          break;
+        }
+      }
+    }
   }
 }
 
-// ALGORITHM A4.3 SurfacePoint(n,p,U,m,q,V,Pw,u,v,S) p134
-// Compute point on rational B-spline surface
-Point3D NURBSSurface::EvaluatePoint(Point2D uv) const {
-  if (uv.x < u_interval_.x) {
-    uv.x = u_interval_.x;
+// Replays steps on all lanes, in blocks of kLanesPerTask on pool when there
+// is one. Every lane gets the same operations in the same order whatever
+// block it is in, and blocks write disjoint lanes, so the points are the
+// same bits for any thread count.
+void ReplayLanes(const std::vector<RefineStep> &steps,
+                 const NetCurves<const double> &in, NetCurves<double> &out,
+                 size_t lanes, ThreadPool *pool) {
+  const bool contiguous = in.lane_step == 1 && out.lane_step == 1;
+  const size_t blocks = (lanes + kLanesPerTask - 1) / kLanesPerTask;
+  auto run_block = [&](size_t block) {
+    const size_t first = block * kLanesPerTask;
+    const size_t count = std::min(kLanesPerTask, lanes - first);
+    if (contiguous) {
+      ReplaySteps<true>(steps, in, out, first, count);
+    } else {
+      ReplaySteps<false>(steps, in, out, first, count);
+    }
+  };
+  if (pool == nullptr || blocks < 2) {
+    for (size_t block = 0; block < blocks; ++block) {
+      run_block(block);
+    }
+    return;
   }
-  if (uv.x > u_interval_.y) {
-    uv.x = u_interval_.y;
+  pool->ParallelFor(blocks, run_block);
+}
+
+// ALGORITHM A5.1 CurveKnotins(np, p, UP, Pw, u, k, s, r, nq, UQ, Qw) p.151
+// for all the curves of a net: fills UQ and records the point updates. Rw
+// lives in the new points like in NURBSCurve2D::InsertKnots, the old points
+// k - p to k - s are loaded where they end up and each pass blends in place.
+// Returns r.
+int InsertKnotSteps(int p, const std::vector<double> &UP, int np, double u,
+                    int times, double tolerance, std::vector<double> &UQ,
+                    std::vector<RefineStep> &steps) {
+  int k = knots::FindSpanParam(p, UP, u, tolerance);
+  // MultiplicityParam is one less than the number of knots equal to u, -1
+  // for a new knot, where the algorithm needs s = 0
+  int s = std::max(knots::MultiplicityParam(p, UP, u, tolerance), 0);
+  // Max value of r is p - s
+  int r = std::max(std::min(times, p - s), 0);
+
+  // Load new knot vector
+  UQ.resize(UP.size() + r);
+  for (int i = 0; i <= k; i++) {
+    UQ[i] = UP[i];
   }
-  if (uv.y < v_interval_.x) {
-    uv.y = v_interval_.x;
+  for (int i = 1; i <= r; i++) {
+    UQ[k + i] = u;
   }
-  if (uv.y > v_interval_.y) {
-    uv.y = v_interval_.y;
+  for (int i = k + 1; i < UP.size(); i++) {
+    UQ[i + r] = UP[i];
   }
-  Point2D in_param = uv;
-  /*Point2D in_param = CorrectParameter(
-      uv, u_internal_interval_, v_internal_interval_, u_interval_,
-     v_interval_);*/
-  uint32_t u_span =
-      knots::FindSpanParam(u_degree_, u_knots_, in_param.x, kTolerance);
-  std::vector<double> u_basis =
-      knots::BasisFuns(u_span, in_param.x, u_degree_, u_knots_, kTolerance);
-  uint32_t v_span =
-      knots::FindSpanParam(v_degree_, v_knots_, in_param.y, kTolerance);
-  std::vector<double> v_basis =
-      knots::BasisFuns(v_span, in_param.y, v_degree_, v_knots_, kTolerance);
-  Point4D point{0.0, 0.0, 0.0, 0.0};
-  for (uint32_t i = 0; i <= v_degree_; ++i) {
-    Point4D temp_point{0.0, 0.0, 0.0, 0.0};
-    for (uint32_t j = 0; j <= u_degree_; ++j) {
-      temp_point +=
-          u_basis[j] *
-          control_polygon_[u_span - u_degree_ + j][v_span - v_degree_ + i];
+
+  if (r == 0) {
+    steps.push_back({RefineStep::kCopyOld, 0, 0, 0.0, np});
+    return r;
+  }
+  // Save unaltered control points, with the auxiliary ones
+  steps.push_back({RefineStep::kCopyOld, 0, 0, 0.0, k - s + 1});
+  steps.push_back({RefineStep::kCopyOld, k - s + r, k - s, 0.0, np - k + s});
+  for (int j = 1; j <= r; ++j) {
+    int L = k - p + j;
+    for (int i = p - j - s; i >= 0; --i) {
+      double alpha = (u - UP[L + i]) / (UP[i + k + 1] - UP[L + i]);
+      steps.push_back({RefineStep::kBlend, L + i, L + i - 1, alpha});
+    }
+    // Rw[p - j - s] is always at k - s
+    if (j < r) {
+      steps.push_back({RefineStep::kCopyNew, k + r - j - s, k - s, 0.0});
     }
-    point += v_basis[i] * temp_point;
   }
-  point /= point.w;
-  return {point.x, point.y, point.z};
+  return r;
 }
 
-/*std::vector<Point3D> NURBSSurface::EvaluatePoints(
-    uint32_t u_sample_count, uint32_t v_sample_count) const {}*/
-
-// ALGORITHM A4.4 RatSurfaceDerivs(Aders,wders,d,SKL) p.137
-std::vector<std::vector<double>> PolygonWeightDerivatives(
-    Point2D uv, uint32_t u_degree, uint32_t v_degree,
-    const std::vector<double>& u_knots, const std::vector<double>& v_knots,
-    const std::vector<std::vector<double>>& weights, uint32_t max_derivative,
-    double tolerance) {
-  // Cap the derivative
-  uint32_t max_deriv_u = std::min(u_degree, max_derivative);
-  uint32_t max_deriv_v = std::min(v_degree, max_derivative);
-
-  // Calculate the derivatives in the U and V directions
-  std::vector<std::vector<double>> derivs(
-      max_derivative + 1, std::vector<double>(max_derivative + 1, 0.0));
-  uint32_t u_span = knots::FindSpanParam(u_degree, u_knots, uv.x, tolerance);
-  std::vector<std::vector<double>> u_derivs =
-      knots::DersBasisFuns(u_span, uv.x, u_degree, max_derivative, u_knots);
-  uint32_t v_span = knots::FindSpanParam(v_degree, v_knots, uv.y, tolerance);
-  std::vector<std::vector<double>> v_derivs =
-      knots::DersBasisFuns(v_span, uv.y, v_degree, max_derivative, v_knots);
-
-  // Calculate the derivative polygon
-  for (uint32_t i = 0; i <= max_deriv_u; ++i) {
-    std::vector<double> temp_derivs(v_degree + 1, 0.0);
-    for (uint32_t j = 0; j <= v_degree; ++j) {
-      for (uint32_t k = 0; k <= u_degree; ++k) {
-        temp_derivs[j] += u_derivs[i][k] *
-                          weights[u_span - u_degree + k][v_span - v_degree + j];
-      }
-    }
-    uint32_t dd = std::min(max_derivative - i, max_deriv_v);
-    for (uint32_t j = 0; j <= dd; ++j) {
-      for (uint32_t k = 0; k <= v_degree; ++k) {
-        derivs[i][j] += v_derivs[j][k] * temp_derivs[k];
-      }
-    }
+// ALGORITHM A5.4 RefineKnotVectCurve(n, p, U, Pw, X, r, Ubar, Qw) p.164 for
+// all the curves of a net: fills Ubar and records the point updates
+void RefineKnotSteps(int p, const std::vector<double> &U, int n,
+                     const std::vector<double> &X, std::vector<double> &Ubar,
+                     std::vector<RefineStep> &steps) {
+  int r = static_cast<int>(X.size()) - 1;
+  // find indexes a and b;
+  int a = knots::FindSpanParam(p, U, X[0], NURBSSurface::kTolerance);
+  int b = knots::FindSpanParam(p, U, X[r], NURBSSurface::kTolerance);
+  b += 1;
+
+  // initialize Ubar;
+  Ubar.resize(U.size() + r + 1);
+  for (int i = 0; i <= a; ++i) {
+    Ubar[i] = U[i];
+  }
+  for (int i = b + p; i < U.size(); ++i) {
+    Ubar[i + r + 1] = U[i];
   }
 
-  return derivs;
-}
+  // Save unaltered ctrl pts
+  steps.push_back({RefineStep::kCopyOld, 0, 0, 0.0, a - p + 1});
+  steps.push_back({RefineStep::kCopyOld, b + r, b - 1, 0.0, n - b + 2});
 
-std::vector<std::vector<Point3D>> NURBSSurface::Derivatives(
-    Point2D uv, uint32_t max_derivative) const {
-  // Split the control polygon into the b_spline and weights control polygons
-  std::vector<std::vector<Point3D>> bspl_cpts;
-  std::vector<std::vector<double>> weights;
-  for (auto& vec : control_polygon_) {
-    bspl_cpts.push_back({});
-    weights.push_back({});
-
-    for (auto& cpt : vec) {
-      bspl_cpts.back().push_back({cpt.x, cpt.y, cpt.z});
-      weights.back().push_back(cpt.w);
+  int i = b + p - 1;
+  int k = b + p + r;
+  for (int j = r; j >= 0; j--) {
+    while (X[j] <= U[i] && i > a) {
+      Ubar[k] = U[i];
+      steps.push_back({RefineStep::kCopyOld, k - p - 1, i - p - 1, 0.0});
+      k = k - 1;
+      i = i - 1;
     }
-  }
 
-  BSplineSurface bspl_surface(u_degree_, v_degree_, u_knots_, v_knots_,
-                              bspl_cpts, u_interval_, v_interval_);
-  // Calculate the point and weight derivatives
-  std::vector<std::vector<Point3D>> a_derivs =
-      bspl_surface.Derivative(uv, max_derivative);
-  std::vector<std::vector<double>> weight_derivs =
-      PolygonWeightDerivatives(uv, u_degree_, v_degree_, u_knots_, v_knots_,
-                               weights, max_derivative, kTolerance);
-  std::vector<std::vector<double>> bin =
-      knots::BinomialCoefficients(max_derivative, max_derivative);
-
-  // Calculate the derivatives
-  std::vector<std::vector<Point3D>> derivs(
-      max_derivative + 1,
-      std::vector<Point3D>(max_derivative + 1, {0.0, 0.0, 0.0}));
-  for (uint32_t k = 0; k <= max_derivative; ++k) {
-    for (uint32_t l = 0; l <= max_derivative - k; ++l) {
-      Point3D v = a_derivs[k][l];
-      for (uint32_t j = 1; j <= l; ++j) {
-        v -= bin[l][j] * weight_derivs[0][j] * derivs[k][l - j];
-      }
-      for (uint32_t i = 1; i <= k; ++i) {
-        v -= bin[k][i] * weight_derivs[i][0] * derivs[k - i][l];
+    steps.push_back({RefineStep::kCopyNew, k - p - 1, k - p, 0.0});
 
-        Point3D v2 = {0.0, 0.0, 0.0};
-        for (uint32_t j = 1; j <= l; ++j) {
-          v2 += bin[l][j] * weight_derivs[i][j] * derivs[k - i][l - j];
-        }
-        v -= bin[k][i] * v2;
+    for (int l = 1; l <= p; l++) {
+      int ind = k - p + l;
+      double alfa = Ubar[k + l] - X[j];
+      if (std::abs(alfa) == 0.0) {
+        steps.push_back({RefineStep::kCopyNew, ind - 1, ind, 0.0});
+      } else {
+        alfa = alfa / (Ubar[k + l] - U[i - p + l]);
+        steps.push_back({RefineStep::kBlend, ind - 1, ind, alfa});
       }
-      derivs[k][l] = v / weight_derivs[0][0];
     }
+    Ubar[k] = X[j];
+    k = k - 1;
   }
-  return derivs;
 }
 
-// Algorithm 5.3 SurfaceKnotIns p.155
-NURBSSurface NURBSSurface::KnotInsert(SurfaceDirection dir, double knot,
-                                      int times) const {
-  // Input: np,p,UP,Pw,u,k,s,r
-  // np - Number of columns in the control polygon
-  // p - U Degree of the surface
-  // UP - U Knot vector before insertion
-  // mp - Number of rows in the control polygon
-  // q - V degree of the surface
-  // Pw - Control points before insertion
-  // dir - Direction to insert the knot (U or V)
-  // uv - value of knot to insert
-  // k - location of knot in insert
-  // s - inital knot multiplicity
-  // r - times to insert knot
-  int p = u_degree_;
-  auto UP = u_knots_;
-  int q = v_degree_;
-  auto VP = v_knots_;
-  auto Pw = control_polygon_;
-  auto uv = knot;
-  int r = times;
-
-  // Output
-  // nq - Number of columns in the control polygon
-  // UQ - U knot vector
-  // mq - Number of rows in the control polygon
-  // VQ - V knot vector
-  // Qw - Control Polygon
-  std::vector<double> UQ;
-  std::vector<double> VQ;
-  std::vector<std::vector<Point4D>> Qw;
-
-  if (dir == SurfaceDirection::kUDir) {
-    // Get the remaining input values
-    int k = knots::FindSpanParam(p, UP, knot, kTolerance);
-    int s = knots::MultiplicityParam(p, UP, knot, kTolerance);
-
-    // Max value of r is p - s
-    r = std::min(r, p - s);
-
-    // Resize the output arrays
-    UQ.resize(UP.size() + r);
-    Qw.resize(Pw.size() + r);
-    for (auto& column : Qw) {
-      column.resize(Pw[0].size());
-    }
-
-    // Load u vector as in A5.1
-    // Load new knot vector
-    for (int i = 0; i <= k; i++) {
-      UQ[i] = UP[i];
-    }
-    for (int i = 1; i <= r; i++) {
-      UQ[k + i] = uv;
-    }
-    for (int i = k + 1; i < UP.size(); i++) {
-      UQ[i + r] = UP[i];
-    }
-
-    // Copy v vector into VQ (return vector)
-    VQ = v_knots_;
-
-    // Save the Alphas
-    std::vector<std::vector<double>> alphas(p + 1);
-    for (auto& alpha : alphas) {
-      alpha.resize(r + 1);
-    }
+// ALGORITHM A5.6 DecomposeCurve(n, p, U, Pw, nb, Qw) p.173 for all the
+// curves of a net. Segment nb is at nb * (p + 1) in the recorded points, so
+// Qw[1] of the book already is the next segment when one is done. Returns
+// the number of segments.
+int DecomposeSteps(int p, const std::vector<double> &U, int np,
+                   std::vector<RefineStep> &steps) {
+  int m = np + p;
+  std::vector<double> alphas(p + 1, 0.0);
 
-    int L = k - p;
-    for (int j = 1; j <= r; ++j) {
-      L = k - p + j;
-      for (int i = 0; i <= p - j - s; i++) {
-        alphas[i][j] = (uv - UP[L + i]) / (UP[i + k + 1] - UP[L + i]);
-      }
+  int a = p;
+  int b = p + 1;
+  int nb = 0;
+  steps.push_back({RefineStep::kCopyOld, 0, 0, 0.0, p + 1});
+  while (b < m) {
+    // Get Mult
+    int i = b;
+    while (b < m && U[b + 1] == U[b]) {
+      ++b;
     }
+    int mult = b - i + 1;
+    const int base = nb * (p + 1);
 
-    std::vector<Point4D> Rw(p + 1);
-
-    for (size_t row = 0; row < Pw[0].size(); row++) {
-      /* Save unaltered control points */
-      for (int i = 0; i <= k - p; ++i) {
-        Qw[i][row] = Pw[i][row];
-      }
-      for (int i = k - s; i < Pw.size(); i++) {
-        Qw[i + r][row] = Pw[i][row];
-      }
-      // Load auxiliary control points
-      for (int i = 0; i <= p - s; ++i) {
-        Rw[i] = Pw[k - p + i][row];
+    if (mult < p) {
+      // Get the numerator and the alfas;
+      double numer = U[b] - U[a];  // Numerator of alpha
+      // Compute and store alphas
+      for (int j = p; j > mult; --j) {
+        alphas[j - mult - 1] = numer / (U[a + j] - U[a]);
       }
+      int r = p - mult;  // Knot insert r times
 
       for (int j = 1; j <= r; ++j) {
-        L = k - p + j;
-        for (int i = 0; i <= p - j - s; ++i) {
-          Rw[i] = (alphas[i][j] * Rw[i + 1]) + ((1.0 - alphas[i][j]) * Rw[i]);
+        int save = r - j;
+        int s = mult + j;  // This many new points
+        for (int k = p; k >= s; --k) {
+          steps.push_back(
+              {RefineStep::kBlend, base + k, base + k - 1, alphas[k - s]});
+        }
+        if (b < m) {
+          steps.push_back(
+              {RefineStep::kCopyNew, base + p + 1 + save, base + p, 0.0});
         }
-        Qw[L][row] = Rw[0];
-        Qw[k + r - j - s][row] = Rw[p - j - s];
-      }
-
-      // Load the remaining control points
-      for (uint32_t i = L + 1; i < k - s; ++i) {
-        Qw[i][row] = Rw[i - L];
       }
     }
-  } else {
-    /* Similar code as above with u and v directional parameters switched */
-
-    // Get the remaining input values
-    int k = knots::FindSpanParam(q, VP, knot, kTolerance);
-    int s = knots::MultiplicityParam(q, VP, knot, kTolerance);
-
-    // Max value of r is q - s
-    r = std::min(r, q - s);
-
-    // Resize the output arrays
-    VQ.resize(VP.size() + r);
-    Qw.resize(Pw.size());
-    for (auto& column : Qw) {
-      column.resize(Pw[0].size() + r);
-    }
+    ++nb;
 
-    // Load v vector as in A5.1
-    // Load new knot vector
-    for (uint32_t i = 0; i <= k; i++) {
-      VQ[i] = VP[i];
-    }
-    for (uint32_t i = 1; i <= r; i++) {
-      VQ[k + i] = uv;
-    }
-    for (uint32_t i = k + 1; i < VP.size(); i++) {
-      VQ[i + r] = VP[i];
+    if (b < m) {
+      // Initialize for next segment
+      const int first = std::max(p - mult, 0);
+      steps.push_back({RefineStep::kCopyOld, base + p + 1 + first,
+                       b - p + first, 0.0, p - first + 1});
+      a = b;
+      b = b + 1;
     }
+  }
+  return nb;
+}
 
-    // Copy u vector into UQ (return vector)
-    UQ = UP;
-
-    // Save the Alphas
-    std::vector<std::vector<double>> alphas(q + 1);
-    for (auto& alpha : alphas) {
-      alpha.resize(r + 1);
+// The curves of the net in direction dir as point lists, for knot removal,
+// which shortens all of them
+std::vector<std::vector<Point4D>> NetLanes(const ControlNet<Point4D> &net,
+                                           NURBSSurface::SurfaceDirection dir) {
+  const bool along_u = dir == NURBSSurface::kUDir;
+  std::vector<std::vector<Point4D>> lanes(along_u ? net.cols() : net.rows());
+  for (size_t l = 0; l < lanes.size(); ++l) {
+    lanes[l].resize(along_u ? net.rows() : net.cols());
+    for (size_t i = 0; i < lanes[l].size(); ++i) {
+      lanes[l][i] = along_u ? net.Get(i, l) : net.Get(l, i);
     }
+  }
+  return lanes;
+}
 
-    int L = k - q;
-    for (int j = 1; j <= r; ++j) {
-      L = k - q + j;
-      for (int i = 0; i <= q - j - s; i++) {
-        alphas[i][j] = (uv - VP[L + i]) / (VP[i + k + 1] - VP[L + i]);
+ControlNet<Point4D> LanesNet(const std::vector<std::vector<Point4D>> &lanes,
+                             NURBSSurface::SurfaceDirection dir) {
+  const bool along_u = dir == NURBSSurface::kUDir;
+  const size_t count = lanes.empty() ? 0 : lanes[0].size();
+  ControlNet<Point4D> net(along_u ? count : lanes.size(),
+                          along_u ? lanes.size() : count);
+  for (size_t l = 0; l < lanes.size(); ++l) {
+    for (size_t i = 0; i < count; ++i) {
+      if (along_u) {
+        net.Set(i, l, lanes[l][i]);
+      } else {
+        net.Set(l, i, lanes[l][i]);
       }
     }
-    std::vector<Point4D> Rw(q + 1);
+  }
+  return net;
+}
 
-    for (int col = 0; col < Pw.size(); col++) {
-      /* Save unaltered control points */
-      for (int i = 0; i <= k - q; ++i) {
-        Qw[col][i] = Pw[col][i];
-      }
-      for (int i = k - s; i < Pw[0].size(); i++) {
-        Qw[col][i + r] = Pw[col][i];
-      }
-      // Load auxiliary control points
-      for (int i = 0; i <= q - s; ++i) {
-        Rw[i] = Pw[col][k - q + i];
-      }
+// One A5.8 removal of the knot U[r] of multiplicity s from every lane, only
+// when all of them pass. The surface moves by no more than its furthest
+// moving lane, so error grows by the largest lane error.
+bool RemoveFromLanes(uint32_t degree, int r, int s, double tolerance,
+                     std::vector<double> &U,
+                     std::vector<std::vector<Point4D>> &lanes, double &error) {
+  if (lanes.empty()) {
+    return false;
+  }
+  std::vector<std::vector<Point4D>> trial = lanes;
+  std::vector<double> lane_knots;
+  double max_error = error;
+  for (std::vector<Point4D> &lane : trial) {
+    lane_knots.assign(U.begin(), U.end());
+    double lane_error = error;
+    if (knots::RemoveKnotInPlace(degree, r, s, 1, tolerance, lane_knots, lane,
+                                 lane_error) == 0) {
+      return false;
+    }
+    max_error = std::max(max_error, lane_error);
+  }
+  lanes.swap(trial);
+  U.swap(lane_knots);
+  error = max_error;
+  return true;
+}
 
-      for (int j = 1; j <= r; ++j) {
-        L = k - q + j;
-        for (int i = 0; i <= q - j - s; ++i) {
-          Rw[i] = (alphas[i][j] * Rw[i + 1]) + ((1.0 - alphas[i][j]) * Rw[i]);
-        }
-        Qw[col][L] = Rw[0];
-        Qw[col][k + r - j - s] = Rw[q - j - s];
+// knots::SimplifyInPlace over all the lanes of one direction
+uint32_t SimplifyLanes(uint32_t degree, double tolerance,
+                       std::vector<double> &U,
+                       std::vector<std::vector<Point4D>> &lanes,
+                       double &error) {
+  if (lanes.empty()) {
+    return 0;
+  }
+  uint32_t removed = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    size_t start = degree + 1;
+    while (start < lanes[0].size()) {
+      size_t r = start;
+      while (r + 1 < lanes[0].size() && U[r + 1] == U[r]) {
+        ++r;
       }
-
-      // Load the remaining control points
-      for (int i = L + 1; i < k - s; ++i) {
-        Qw[col][i] = Rw[i - L];
+      const int s = static_cast<int>(r - start) + 1;
+      if (RemoveFromLanes(degree, static_cast<int>(r), s, tolerance, U, lanes,
+                          error)) {
+        ++removed;
+        changed = true;
+      } else {
+        start = r + 1;
       }
     }
   }
-  return NURBSSurface(u_degree_, v_degree_, UQ, VQ, Qw, u_interval_,
-                      v_interval_);
+  return removed;
 }
 
-// ALGORITHM A5.5 RefineKnotVectSurface(n,p,U,m,q,V,Pw,X,r,dir,Ubar,Vbar,Qw)
-NURBSSurface NURBSSurface::RefineKnotVect(std::vector<double> knots,
-                                          SurfaceDirection dir) const {
-  if (control_polygon_.empty() || knots.empty()) {
-    return NURBSSurface(u_degree_, v_degree_, u_knots_, v_knots_,
-                        control_polygon_, u_interval_, v_interval_);
+// knots::HomogeneousScale of the whole net
+double NetScale(const ControlNet<Point4D> &net) {
+  std::vector<Point4D> points;
+  points.reserve(net.rows() * net.cols());
+  for (size_t u = 0; u < net.rows(); ++u) {
+    for (size_t v = 0; v < net.cols(); ++v) {
+      points.push_back(net.Get(u, v));
+    }
   }
+  return knots::HomogeneousScale(points.data(), points.size());
+}
 
-  // Refine surface knot vector
-  // Input: n,p,U,m,q,V,Pw,X,r,dir
-  // n - number of points in the U direction
-  // p - U degree
-  // U - U knot vector
-  // m - number of points int the V direction
-  // q - V degree
-  // V - V knot vector
-  // Pw - control polygon
-  // X - knot vector to merge in
-  // r - size of X
-  // dir - direction to merge
-  int n = static_cast<int>(control_polygon_.size()) - 1;
-  int p = u_degree_;
-  auto U = u_knots_;
-  int m = static_cast<int>(control_polygon_[0].size()) - 1;
-  int q = v_degree_;
-  auto V = v_knots_;
-  auto Pw = control_polygon_;
-  auto X = knots;
-  int r = static_cast<int>(knots.size()) - 1;
-
-  // Output: Ubar, Vbar, Qw
-  // Ubar - U knot vector
-  // Vbar - V out vector
-  // Qw - control polygon
-  std::vector<double> Ubar;
-  std::vector<double> Vbar;
-  std::vector<std::vector<Point4D>> Qw;
-
-  if (dir == SurfaceDirection::kUDir) {
-    // find indexes a and b;
-    int a = knots::FindSpanParam(p, U, X[0], kTolerance);
-    int b = knots::FindSpanParam(p, U, X[r], kTolerance);
-    b += 1;
-
-    // initialize Ubar;
-    Ubar.resize(U.size() + r + 1);
-    for (int i = 0; i <= a; ++i) {
-      Ubar[i] = U[i];
-    }
-    for (int i = b + p; i < U.size(); ++i) {
-      Ubar[i + r + 1] = U[i];
-    }
+// Runs task for every lane, in blocks of kLanesPerTask on pool when there is
+// one. Lanes are worked on alone, so the results are the same bits for any
+// thread count.
+void ForEachLane(size_t lanes, ThreadPool *pool,
+                 const std::function<void(size_t)> &task) {
+  const size_t blocks = (lanes + kLanesPerTask - 1) / kLanesPerTask;
+  auto run_block = [&](size_t block) {
+    const size_t last = std::min(lanes, (block + 1) * kLanesPerTask);
+    for (size_t l = block * kLanesPerTask; l < last; ++l) {
+      task(l);
+    }
+  };
+  if (pool == nullptr || blocks < 2) {
+    for (size_t block = 0; block < blocks; ++block) {
+      run_block(block);
+    }
+    return;
+  }
+  pool->ParallelFor(blocks, run_block);
+}
 
-    // copy V into Vbar;
-    Vbar = V;
+// ALGORITHM A4.4 RatSurfaceDerivs(Aders,wders,d,SKL) p.137, in place: skl
+// holds Aders on the way in and SKL on the way out. Both are (d + 1) x
+// (d + 1) and row major.
+void RatSurfaceDerivs(uint32_t d, const double *wders, Point3D *skl) {
+  const size_t order = static_cast<size_t>(d) + 1;
+  for (uint32_t k = 0; k <= d; ++k) {
+    for (uint32_t l = 0; l <= d - k; ++l) {
+      Point3D v = skl[(k * order) + l];
+      for (uint32_t j = 1; j <= l; ++j) {
+        v -= knots::Binomial(l, j) * wders[j] * skl[(k * order) + l - j];
+      }
+      for (uint32_t i = 1; i <= k; ++i) {
+        v -= knots::Binomial(k, i) * wders[i * order] *
+             skl[((k - i) * order) + l];
 
-    // Save unaltered ctrl pts
-    Qw.resize(Pw.size() + r + 1);
-    for (int i = 0; i <= a - p; ++i) {
-      Qw[i] = Pw[i];
-    }
-    for (int i = b - 1; i <= n; ++i) {
-      Qw[i + r + 1] = Pw[i];
-    }
-    // Init middle points of Qw
-    for (int i = a - p + 1; i < b + r; ++i) {
-      Qw[i].resize(Pw[0].size());
+        Point3D v2 = {0.0, 0.0, 0.0};
+        for (uint32_t j = 1; j <= l; ++j) {
+          v2 += knots::Binomial(l, j) * wders[(i * order) + j] *
+                skl[((k - i) * order) + l - j];
+        }
+        v -= knots::Binomial(k, i) * v2;
+      }
+      skl[(k * order) + l] = v / wders[0];
     }
+  }
+}
+}  // namespace
+NURBSSurface::NURBSSurface(uint32_t u_degree, uint32_t v_degree,
+                           std::vector<double> u_knots,
+                           std::vector<double> v_knots,
+                           std::vector<std::vector<Point4D>> control_polygon,
+                           Point2D u_interval, Point2D v_interval)
+    : NURBSSurface(u_degree, v_degree, std::move(u_knots), std::move(v_knots),
+                   ControlNet<Point4D>(control_polygon), u_interval,
+                   v_interval) {}
 
-    int i = b + p - 1;
-    int k = b + p + r;
+NURBSSurface::NURBSSurface(uint32_t u_degree, uint32_t v_degree,
+                           std::vector<double> u_knots,
+                           std::vector<double> v_knots,
+                           ControlNet<Point4D> control_polygon,
+                           Point2D u_interval, Point2D v_interval)
+    : Surface(u_interval, v_interval),
+      u_degree_(u_degree),
+      v_degree_(v_degree),
+      u_knots_(std::move(u_knots)),
+      v_knots_(std::move(v_knots)),
+      control_polygon_(std::move(control_polygon)),
+      u_internal_interval_(u_interval),
+      v_internal_interval_(v_interval) {
+  if (u_knots_.size() != control_polygon_.rows() + u_degree_ + 1) {
+    throw std::exception("Invalid U Parameters for a NURBS Surface");
+  }
+  if (!control_polygon_.empty() &&
+      v_knots_.size() != control_polygon_.cols() + v_degree_ + 1) {
+    throw std::exception("Invalid V Parameters for a NURBS Surface");
+  }
+  u_span_locator_ = knots::SpanLocator(u_degree_, u_knots_, kTolerance);
+  v_span_locator_ = knots::SpanLocator(v_degree_, v_knots_, kTolerance);
+  u_uniform_spans_ = knots::UniformCubicSpans(u_degree_, u_knots_);
+  v_uniform_spans_ = knots::UniformCubicSpans(v_degree_, v_knots_);
+}
 
-    for (int j = r; j >= 0; j--) {
-      while (X[j] <= U[i] && i > a) {
-        Ubar[k] = U[i];
-        for (int row = 0; row <= m; row++) {
-          Qw[k - p - 1][row] = Pw[i - p - 1][row];
-        }
-        k = k - 1;
-        i = i - 1;
-      }
+// ALGORITHM A4.3 SurfacePoint(n,p,U,m,q,V,Pw,u,v,S) p134
+// Compute point on rational B-spline surface
+Point3D NURBSSurface::EvaluatePoint(Point2D uv) const {
+  if (uv.x < u_interval_.x) {
+    uv.x = u_interval_.x;
+  }
+  if (uv.x > u_interval_.y) {
+    uv.x = u_interval_.y;
+  }
+  if (uv.y < v_interval_.x) {
+    uv.y = v_interval_.x;
+  }
+  if (uv.y > v_interval_.y) {
+    uv.y = v_interval_.y;
+  }
+  Point2D in_param = uv;
+  /*Point2D in_param = CorrectParameter(
+      uv, u_internal_interval_, v_internal_interval_, u_interval_,
+     v_interval_);*/
+  uint32_t u_span = u_span_locator_.Find(in_param.x);
+  uint32_t v_span = v_span_locator_.Find(in_param.y);
+  Point4D point = knots::SurfacePoint(
+      u_uniform_spans_, u_degree_, u_span, in_param.x, u_knots_,
+      v_uniform_spans_, v_degree_, v_span, in_param.y, v_knots_,
+      control_polygon_, kTolerance);
+  point /= point.w;
+  return {point.x, point.y, point.z};
+}
 
-      for (int row = 0; row <= m; row++) {
-        Qw[k - p - 1][row] = Qw[k - p][row];
-      }
+void NURBSSurface::EvaluateGrid(const double *u_params, size_t u_count,
+                                const double *v_params, size_t v_count,
+                                Point3D *points) const {
+  EvaluateGridRows(u_params, u_count, v_params, v_count,
+                   [&](size_t u_i, const double *const *coords) {
+                     Point3D *out = points + (u_i * v_count);
+                     for (size_t v_i = 0; v_i < v_count; ++v_i) {
+                       out[v_i] = {coords[0][v_i], coords[1][v_i],
+                                   coords[2][v_i]};
+                     }
+                   });
+}
 
-      for (int l = 1; l <= p; l++) {
-        int ind = k - p + l;
-        double alfa = Ubar[k + l] - X[j];
-        if (abs(alfa) == 0.0) {
-          for (int row = 0; row <= m; row++) {
-            Qw[ind - 1][row] = Qw[ind][row];
-          }
-        } else {
-          alfa = alfa / (Ubar[k + l] - U[i - p + l]);
-          for (int row = 0; row <= m; row++) {
-            Qw[ind - 1][row] =
-                (alfa * Qw[ind - 1][row]) + ((1.0 - alfa) * Qw[ind][row]);
-          }
-        }
-      }
-      Ubar[k] = X[j];
-      k = k - 1;
-    }
-  } else if (dir == SurfaceDirection::kVDir) {
-    // Similar code as above with u and v directional parameters switched
-
-    // find indexes a and b;
-    int a = knots::FindSpanParam(q, V, X[0], kTolerance);
-    int b = knots::FindSpanParam(q, V, X[r], kTolerance);
-    b += 1;
-
-    // initialize Vbar;
-    Vbar.resize(V.size() + r + 1);
-    for (int i = 0; i <= a; ++i) {
-      Vbar[i] = V[i];
-    }
-    for (int i = b + q; i < V.size(); ++i) {
-      Vbar[i + r + 1] = V[i];
-    }
+void NURBSSurface::EvaluateGridFloat(const double *u_params, size_t u_count,
+                                     const double *v_params, size_t v_count,
+                                     float *positions) const {
+  EvaluateGridRows(u_params, u_count, v_params, v_count,
+                   [&](size_t u_i, const double *const *coords) {
+                     float *out = positions + (3 * u_i * v_count);
+                     for (size_t v_i = 0; v_i < v_count; ++v_i) {
+                       out[(3 * v_i)] = static_cast<float>(coords[0][v_i]);
+                       out[(3 * v_i) + 1] = static_cast<float>(coords[1][v_i]);
+                       out[(3 * v_i) + 2] = static_cast<float>(coords[2][v_i]);
+                     }
+                   });
+}
 
-    // copy U into Ubar;
-    Ubar = U;
+// BSplineSurface::EvaluateGrid on the homogeneous planes, followed by the
+// divide by w for a whole row at once. Parameters are clamped to the
+// intervals like EvaluatePoint does.
+void NURBSSurface::EvaluateGridRows(
+    const double *u_params, size_t u_count, const double *v_params,
+    size_t v_count,
+    const std::function<void(size_t, const double *const *)> &emit_row) const {
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  std::vector<double> u_clamped(u_params, u_params + u_count);
+  for (double &u : u_clamped) {
+    u = std::clamp(u, u_interval_.x, u_interval_.y);
+  }
+  std::vector<double> v_clamped(v_params, v_params + v_count);
+  for (double &v : v_clamped) {
+    v = std::clamp(v, v_interval_.x, v_interval_.y);
+  }
+  // Cached, so a grid sampled again, or the next tile of a grid, skips the
+  // basis work for the parameter lists it has seen
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table =
+      cache.Get(u_degree_, u_knots_, u_clamped.data(), u_count, kTolerance);
+  std::shared_ptr<const knots::BasisTable> v_table =
+      cache.Get(v_degree_, v_knots_, v_clamped.data(), v_count, kTolerance);
+  tensor::EvaluateRows(control_polygon_, true, *u_table, *v_table, emit_row);
+}
 
-    // Save unaltered ctrl pts
-    Qw.resize(Pw.size());
-    for (int i = 0; i <= n; ++i) {
-      Qw[i].resize(Pw[0].size() + r + 1);
-      for (int j = 0; j <= a - q; ++j) {
-        Qw[i][j] = Pw[i][j];
-      }
-      for (int j = b - 1; j <= m; ++j) {
-        Qw[i][j + r + 1] = Pw[i][j];
-      }
-    }
+std::vector<std::vector<Point3D>> NURBSSurface::Derivatives(
+    Point2D uv, uint32_t max_derivative) const {
+  const size_t order = static_cast<size_t>(max_derivative) + 1;
+  std::vector<Point3D> skl(order * order);
+  Derivatives(uv, max_derivative, skl.data());
+  std::vector<std::vector<Point3D>> derivs(order);
+  for (size_t k = 0; k < order; ++k) {
+    derivs[k].assign(skl.begin() + (k * order),
+                     skl.begin() + ((k + 1) * order));
+  }
+  return derivs;
+}
 
-    int i = b + q - 1;
-    int k = b + q + r;
+// The grid version of Derivatives, A3.6 and A4.4 on the cached basis
+// derivatives of the samples
+void NURBSSurface::EvaluateGridDerivatives(const double *u_params,
+                                           size_t u_count,
+                                           const double *v_params,
+                                           size_t v_count,
+                                           bool second_partials,
+                                           GridDerivatives &grid) const {
+  grid.Resize(u_count * v_count, second_partials);
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  std::vector<double> u_clamped(u_params, u_params + u_count);
+  for (double &u : u_clamped) {
+    u = std::clamp(u, u_interval_.x, u_interval_.y);
+  }
+  std::vector<double> v_clamped(v_params, v_params + v_count);
+  for (double &v : v_clamped) {
+    v = std::clamp(v, v_interval_.x, v_interval_.y);
+  }
+  const uint32_t d = second_partials ? 2 : 1;
+  knots::BasisTableCache &cache = knots::BasisTableCache::Shared();
+  std::shared_ptr<const knots::BasisTable> u_table = cache.Get(
+      u_degree_, u_knots_, u_clamped.data(), u_count, kTolerance, d);
+  std::shared_ptr<const knots::BasisTable> v_table = cache.Get(
+      v_degree_, v_knots_, v_clamped.data(), v_count, kTolerance, d);
+  tensor::EvaluateDerivatives(control_polygon_, true, *u_table, *v_table,
+                              second_partials, grid);
+  FillNormals(u_clamped.data(), u_count, v_clamped.data(), v_count, grid);
+}
 
-    for (int j = r; j >= 0; j--) {
-      while (X[j] <= V[i] && i > a) {
-        Vbar[k] = V[i];
-        for (int col = 0; col <= n; col++) {
-          Qw[col][k - q - 1] = Pw[col][i - q - 1];
+// Aders and wders for ALGORITHM A4.4 come from A3.6 run straight on the
+// planes of the homogeneous net, which already holds the weighted points and
+// the weights apart. Aders is built in place in skl and wders in a per thread
+// buffer.
+void NURBSSurface::Derivatives(Point2D uv, uint32_t max_derivative,
+                               Point3D *skl) const {
+  const uint32_t d = max_derivative;
+  const size_t order = static_cast<size_t>(d) + 1;
+  const uint32_t max_deriv_u = std::min(u_degree_, d);
+  const uint32_t max_deriv_v = std::min(v_degree_, d);
+  knots::BasisScratch &u_scratch = knots::ThreadScratch(0);
+  knots::BasisScratch &v_scratch = knots::ThreadScratch(1);
+  u_scratch.Reserve(u_degree_, max_deriv_u);
+  v_scratch.Reserve(v_degree_, max_deriv_v);
+  const double *u_derivs = u_scratch.ders.data();
+  const double *v_derivs = v_scratch.ders.data();
+  const uint32_t u_span = u_span_locator_.Find(uv.x);
+  knots::DersBasisFuns(u_span, uv.x, u_degree_, max_deriv_u, u_knots_,
+                       u_scratch.ders.data(), u_scratch);
+  const uint32_t v_span = v_span_locator_.Find(uv.y);
+  knots::DersBasisFuns(v_span, uv.y, v_degree_, max_deriv_v, v_knots_,
+                       v_scratch.ders.data(), v_scratch);
+
+  // A3.6 per plane: x, y, z of Aders and then wders
+  thread_local std::vector<double> buffer;
+  const size_t buffer_size = (order * order) + v_degree_ + 1;
+  if (buffer.size() < buffer_size) {
+    buffer.resize(buffer_size);
+  }
+  double *wders = buffer.data();
+  double *temp = buffer.data() + (order * order);
+  std::fill(skl, skl + (order * order), Point3D{0.0, 0.0, 0.0});
+  std::fill(wders, wders + (order * order), 0.0);
+  const size_t stride = control_polygon_.stride();
+  const size_t first =
+      control_polygon_.Index(u_span - u_degree_, v_span - v_degree_);
+  for (uint32_t c = 0; c < 4; ++c) {
+    const double *plane = control_polygon_.plane(c) + first;
+    for (uint32_t i = 0; i <= max_deriv_u; ++i) {
+      const double *u_row = u_derivs + (i * (u_degree_ + 1));
+      for (uint32_t j = 0; j <= v_degree_; ++j) {
+        temp[j] = 0.0;
+        for (uint32_t k = 0; k <= u_degree_; ++k) {
+          temp[j] += u_row[k] * plane[(k * stride) + j];
         }
-        k = k - 1;
-        i = i - 1;
       }
-
-      for (int col = 0; col <= n; col++) {
-        Qw[col][k - q - 1] = Qw[col][k - q];
-      }
-
-      for (int l = 1; l <= q; l++) {
-        int ind = k - q + l;
-        double alfa = Vbar[k + l] - X[j];
-        if (abs(alfa) == 0.0) {
-          for (int col = 0; col <= n; col++) {
-            Qw[col][ind - 1] = Qw[col][ind];
-          }
+      const uint32_t dd = std::min(d - i, max_deriv_v);
+      for (uint32_t j = 0; j <= dd; ++j) {
+        const double *v_row = v_derivs + (j * (v_degree_ + 1));
+        double sum = 0.0;
+        for (uint32_t k = 0; k <= v_degree_; ++k) {
+          sum += v_row[k] * temp[k];
+        }
+        if (c == 3) {
+          wders[(i * order) + j] = sum;
         } else {
-          alfa = alfa / (Vbar[k + l] - V[i - q + l]);
-          for (int col = 0; col <= n; col++) {
-            Qw[col][ind - 1] =
-                (alfa * Qw[col][ind - 1]) + ((1.0 - alfa) * Qw[col][ind]);
-          }
+          skl[(i * order) + j].*PointComponents<Point3D>::kMembers[c] = sum;
         }
       }
-      Vbar[k] = X[j];
-      k = k - 1;
     }
   }
-  return NURBSSurface(u_degree_, v_degree_, Ubar, Vbar, Qw, u_interval_,
-                      v_interval_);
-}
-
-std::vector<NURBSSurface> NURBSSurface::DecomposeU() const {
-  // Decompose surface into Bezier patches
-  // Input: n, p, U, m, q, V, Pw, dir
-  // n - Max index of U knot vector
-  // p - U degree
-  // U - U knot vector
-  // m - # of points in the V direction
-  // q - V degree
-  // V - V knot vector
-  // Pw - control polygon
-  // dir - Direction to split
-  std::vector<std::vector<Point4D>> Pw = control_polygon_;
-  int p = u_degree_;
-  int n = static_cast<int>(Pw.size()) + p;
-  std::vector<double> U = u_knots_;
-  int m = Pw.empty() ? 0 : static_cast<int>(Pw[0].size());
-  // auto dir = SurfaceDirection::kUDir;
 
-  // Output: nb, Qw
-  // nb - # of bezier strips returned
-  // Qw - Bezier strips
-  std::vector<std::vector<std::vector<Point4D>>> Qw = {};
-  std::vector<NURBSSurface> strips = {};
+  RatSurfaceDerivs(d, wders, skl);
+}
 
-  // (dir == SurfaceDirection::kUDir)
+// Algorithm 5.3 SurfaceKnotIns p.155, A5.1 on every row or column of the net
+NURBSSurface NURBSSurface::KnotInsert(SurfaceDirection dir, double knot,
+                                      int times, ThreadPool* pool) const {
+  const ControlNet<Point4D>& Pw = control_polygon_;
+  const bool along_u = dir == SurfaceDirection::kUDir;
+  const std::vector<double>& UP = along_u ? u_knots_ : v_knots_;
+  const int p = static_cast<int>(along_u ? u_degree_ : v_degree_);
+  const int np = static_cast<int>(along_u ? Pw.rows() : Pw.cols());
 
-  std::vector<double> new_knots(p + p + 2, 1.0);
-  for (int index = 0; index <= p; ++index) {
-    new_knots[index] = 0.0;
+  std::vector<double> UQ;
+  std::vector<RefineStep> steps;
+  int r = InsertKnotSteps(p, UP, np, knot, times, kTolerance, UQ, steps);
+
+  ControlNet<Point4D> Qw;
+  Qw.Resize(Pw.rows() + (along_u ? r : 0), Pw.cols() + (along_u ? 0 : r));
+  NetCurves<const double> in;
+  NetCurves<double> out;
+  AddCurves(Pw, dir, in);
+  AddCurves(Qw, dir, out);
+  ReplayLanes(steps, in, out, along_u ? Pw.cols() : Pw.rows(), pool);
+
+  return NURBSSurface(u_degree_, v_degree_, along_u ? std::move(UQ) : u_knots_,
+                      along_u ? v_knots_ : std::move(UQ), std::move(Qw),
+                      u_interval_, v_interval_);
+}
+
+// ALGORITHM A5.5 RefineKnotVectSurface(n,p,U,m,q,V,Pw,X,r,dir,Ubar,Vbar,Qw),
+// A5.4 on every row or column of the net
+NURBSSurface NURBSSurface::RefineKnotVect(std::vector<double> knots,
+                                          SurfaceDirection dir,
+                                          ThreadPool* pool) const {
+  if (control_polygon_.empty() || knots.empty()) {
+    return NURBSSurface(u_degree_, v_degree_, u_knots_, v_knots_,
+                        control_polygon_, u_interval_, v_interval_);
   }
-  Point2D new_interval = {0.0, 1.0};
-  std::vector<double> alphas(p + 1, 0.0);
+  const ControlNet<Point4D>& Pw = control_polygon_;
+  const bool along_u = dir == SurfaceDirection::kUDir;
+  const std::vector<double>& U = along_u ? u_knots_ : v_knots_;
+  const int p = static_cast<int>(along_u ? u_degree_ : v_degree_);
+  const int n = static_cast<int>(along_u ? Pw.rows() : Pw.cols()) - 1;
+  const int r = static_cast<int>(knots.size()) - 1;
 
-  int a = p;
-  int b = p + 1;
+  std::vector<double> Ubar;
+  std::vector<RefineStep> steps;
+  RefineKnotSteps(p, U, n, knots, Ubar, steps);
+
+  ControlNet<Point4D> Qw;
+  Qw.Resize(Pw.rows() + (along_u ? r + 1 : 0),
+            Pw.cols() + (along_u ? 0 : r + 1));
+  NetCurves<const double> in;
+  NetCurves<double> out;
+  AddCurves(Pw, dir, in);
+  AddCurves(Qw, dir, out);
+  ReplayLanes(steps, in, out, along_u ? Pw.cols() : Pw.rows(), pool);
+
+  return NURBSSurface(u_degree_, v_degree_,
+                      along_u ? std::move(Ubar) : u_knots_,
+                      along_u ? v_knots_ : std::move(Ubar), std::move(Qw),
+                      u_interval_, v_interval_);
+}
 
-  Qw.resize(2);
-  for (std::vector<std::vector<Point4D>>& strip : Qw) {
-    strip.resize(p + 1);
-    for (std::vector<Point4D>& points : strip) {
-      points.resize(m);
+// ALGORITHM A5.8 RemoveCurveKnot(n, p, U, Pw, u, r, s, num, t) p.185 on
+// every row or column of the net, one copy of the knot at a time
+NURBSSurface NURBSSurface::KnotRemove(SurfaceDirection dir, double knot,
+                                      int times, double tolerance) const {
+  const bool along_u = dir == SurfaceDirection::kUDir;
+  std::vector<double> U = along_u ? u_knots_ : v_knots_;
+  const uint32_t p = along_u ? u_degree_ : v_degree_;
+  std::vector<std::vector<Point4D>> lanes = NetLanes(control_polygon_, dir);
+  const double scale = NetScale(control_polygon_);
+  double error = 0.0;
+  for (int t = 0; t < times && !lanes.empty(); ++t) {
+    int s = 0;
+    const int r = knots::FindRemovalKnot(p, U, lanes[0].size(), knot, s);
+    if (r < 0 ||
+        !RemoveFromLanes(p, r, s, tolerance / scale, U, lanes, error)) {
+      break;
     }
   }
+  return NURBSSurface(u_degree_, v_degree_, along_u ? std::move(U) : u_knots_,
+                      along_u ? v_knots_ : std::move(U),
+                      LanesNet(lanes, dir), u_interval_, v_interval_);
+}
 
-  for (int i = 0; i <= p; ++i) {
-    for (int row = 0; row < m; ++row) {
-      Qw[0][i][row] = Pw[i][row];
-    }
+// Removal in u and v share the tolerance, the sweeps alternate until neither
+// removes a knot
+NURBSSurface NURBSSurface::Simplify(double tolerance,
+                                    knots::RemovalReport* report) const {
+  const double scale = NetScale(control_polygon_);
+  const double homogeneous_tolerance = tolerance / scale;
+  std::vector<double> U = u_knots_;
+  std::vector<double> V = v_knots_;
+  ControlNet<Point4D> net = control_polygon_;
+  double error = 0.0;
+  uint32_t removed = 0;
+  bool changed = !net.empty();
+  while (changed) {
+    std::vector<std::vector<Point4D>> lanes = NetLanes(net, kUDir);
+    uint32_t pass =
+        SimplifyLanes(u_degree_, homogeneous_tolerance, U, lanes, error);
+    net = LanesNet(lanes, kUDir);
+    lanes = NetLanes(net, kVDir);
+    pass += SimplifyLanes(v_degree_, homogeneous_tolerance, V, lanes, error);
+    net = LanesNet(lanes, kVDir);
+    removed += pass;
+    changed = pass > 0;
   }
+  if (report != nullptr) {
+    report->knots_removed = removed;
+    report->control_points_before =
+        control_polygon_.rows() * control_polygon_.cols();
+    report->control_points_after = net.rows() * net.cols();
+    report->error_bound = error * scale;
+  }
+  return NURBSSurface(u_degree_, v_degree_, std::move(U), std::move(V),
+                      std::move(net), u_interval_, v_interval_);
+}
 
-  while (b < n) {
-    // Get Mult
-    int i = b;
-    while (b < n && U[b + 1] == U[b]) {
-      ++b;
-    }
-    int mult = b - i + 1;
+// ALGORITHM A5.10 DegreeElevateSurface p.209, A5.9 on every row or column
+// of the net. The lanes share the knots, so every lane gets the same new
+// knot vector.
+NURBSSurface NURBSSurface::DegreeElevate(SurfaceDirection dir, uint32_t t,
+                                         ThreadPool* pool) const {
+  if (t == 0 || control_polygon_.empty()) {
+    return NURBSSurface(u_degree_, v_degree_, u_knots_, v_knots_,
+                        control_polygon_, u_interval_, v_interval_);
+  }
+  const bool along_u = dir == SurfaceDirection::kUDir;
+  const std::vector<double>& U = along_u ? u_knots_ : v_knots_;
+  const uint32_t p = along_u ? u_degree_ : v_degree_;
+  const std::vector<std::vector<Point4D>> lanes =
+      NetLanes(control_polygon_, dir);
+  std::vector<std::vector<Point4D>> elevated(lanes.size());
+  std::vector<double> Uh;
+  ForEachLane(lanes.size(), pool, [&](size_t l) {
+    thread_local std::vector<double> lane_knots;
+    degree::ElevateDegree(p, t, U, lanes[l], lane_knots, elevated[l]);
+    if (l == 0) {
+      Uh = lane_knots;
+    }
+  });
+  return NURBSSurface(along_u ? u_degree_ + t : u_degree_,
+                      along_u ? v_degree_ : v_degree_ + t,
+                      along_u ? std::move(Uh) : u_knots_,
+                      along_u ? v_knots_ : std::move(Uh),
+                      LanesNet(elevated, dir), u_interval_, v_interval_);
+}
 
-    if (mult < p) {
-      // Get the numerator and the alfas;
-      double numer = U[b] - U[a];  // Numerator of alpha
-      // Compute and store alphas
-      for (int j = p; j > mult; --j) {
-        alphas[j - mult - 1] = numer / (U[a + j] - U[a]);
-      }
-      int r = p - mult;  // Knot insert r times
+// A5.11 on every row or column of the net. The surface moves by no more than
+// its furthest moving lane, so the bound is the largest lane error.
+NURBSSurface NURBSSurface::DegreeReduce(SurfaceDirection dir,
+                                        double tolerance,
+                                        degree::ReductionReport* report,
+                                        ThreadPool* pool) const {
+  const bool along_u = dir == SurfaceDirection::kUDir;
+  const std::vector<double>& U = along_u ? u_knots_ : v_knots_;
+  const uint32_t p = along_u ? u_degree_ : v_degree_;
+  const std::vector<std::vector<Point4D>> lanes =
+      NetLanes(control_polygon_, dir);
+  const double scale = NetScale(control_polygon_);
+  std::vector<std::vector<Point4D>> reduced(lanes.size());
+  std::vector<double> errors(lanes.size(), 0.0);
+  std::vector<char> passed(lanes.size(), 0);
+  std::vector<double> Uh;
+  ForEachLane(lanes.size(), pool, [&](size_t l) {
+    thread_local std::vector<double> lane_knots;
+    passed[l] = degree::ReduceDegree(p, tolerance / scale, U, lanes[l],
+                                     lane_knots, reduced[l], errors[l]);
+    if (l == 0) {
+      Uh = lane_knots;
+    }
+  });
+
+  degree::ReductionReport result;
+  result.reduced =
+      !lanes.empty() &&
+      std::all_of(passed.begin(), passed.end(), [](char ok) { return ok; });
+  if (result.reduced) {
+    result.error_bound =
+        *std::max_element(errors.begin(), errors.end()) * scale;
+  }
+  if (report != nullptr) {
+    *report = result;
+  }
+  if (!result.reduced) {
+    return NURBSSurface(u_degree_, v_degree_, u_knots_, v_knots_,
+                        control_polygon_, u_interval_, v_interval_);
+  }
+  return NURBSSurface(along_u ? u_degree_ - 1 : u_degree_,
+                      along_u ? v_degree_ : v_degree_ - 1,
+                      along_u ? std::move(Uh) : u_knots_,
+                      along_u ? v_knots_ : std::move(Uh),
+                      LanesNet(reduced, dir), u_interval_, v_interval_);
+}
 
-      for (int j = 1; j <= r; ++j) {
-        int save = r - j;
-        int s = mult + j;  // This many new points
-        for (int k = p; k >= s; --k) {
-          double alpha = alphas[k - s];
-          for (int row = 0; row < m; ++row) {
-            Qw[0][k][row] =
-                (alpha * Qw[0][k][row]) + ((1.0 - alpha) * Qw[0][k - 1][row]);
-          }
-        }
-        if (b < n) {
-          for (int row = 0; row < m; ++row) {
-            Qw[1][save][row] = Qw[0][p][row];
-          }
-        }
-      }
-    }
+// A5.6 on every column of the net, the strips are Bezier in u
+std::vector<NURBSSurface> NURBSSurface::DecomposeU(ThreadPool* pool) const {
+  const ControlNet<Point4D>& Pw = control_polygon_;
+  const int p = static_cast<int>(u_degree_);
+  std::vector<RefineStep> steps;
+  const int nb =
+      DecomposeSteps(p, u_knots_, static_cast<int>(Pw.rows()), steps);
+  if (nb == 0) {
+    return {};
+  }
 
-    strips.emplace_back(p, v_degree_, new_knots, v_knots_, Qw[0], new_interval,
-                        v_interval_);
+  // Every strip is allocated up front, the replay writes them all
+  std::vector<ControlNet<Point4D>> Qw(nb);
+  NetCurves<const double> in;
+  NetCurves<double> out;
+  AddCurves(Pw, kUDir, in);
+  for (ControlNet<Point4D>& strip : Qw) {
+    strip.Resize(p + 1, Pw.cols());
+    AddCurves(strip, kUDir, out);
+  }
+  ReplayLanes(steps, in, out, Pw.cols(), pool);
 
-    if (b < n) {
-      Qw[0] = Qw[1];
-      for (i = std::max(p - mult, 0); i <= p; ++i) {
-        for (int row = 0; row < m; ++row) {
-          Qw[0][i][row] = Pw[b - p + i][row];
-        }
-      }
-      a = b;
-      b = b + 1;
-    }
+  std::vector<double> new_knots(p + p + 2, 1.0);
+  for (int index = 0; index <= p; ++index) {
+    new_knots[index] = 0.0;
+  }
+  Point2D new_interval = {0.0, 1.0};
+  std::vector<NURBSSurface> strips;
+  strips.reserve(nb);
+  for (ControlNet<Point4D>& strip : Qw) {
+    strips.emplace_back(p, v_degree_, new_knots, v_knots_, std::move(strip),
+                        new_interval, v_interval_);
   }
   return strips;
 }
 
-std::vector<BezierSurface> NURBSSurface::DecomposeV() const {
+// A5.6 on every row of a net that is already Bezier in u
+std::vector<BezierSurface> NURBSSurface::DecomposeV(ThreadPool* pool) const {
   // Fail quick if the U direction is not already decomposed
-  if (control_polygon_.size() != u_degree_ + 1) {
+  if (control_polygon_.rows() != u_degree_ + 1) {
     return {};
   }
-  // Decompose surface into Bezier patches
-  // Input: n, p, U, m, q, V, Pw, dir
-  // n - # of points in the U dir
-  // p - U degree
-  // U - U knot vector
-  // m - Max index of V knot vector
-  // q - V degree
-  // V - V knot vector
-  // Pw - control polygon
-  // dir - Direction to split
-  std::vector<std::vector<Point4D>> Pw = control_polygon_;
-  int p = u_degree_;
-  int q = v_degree_;
-  int m = Pw.empty() ? -1 : static_cast<int>(Pw[0].size()) + q;
-  std::vector<double> V = v_knots_;
-  // auto dir = SurfaceDirection::kUDir;
-
-  // Output: nb, Qw
-  // nb - # of bezier strips returned
-  // Qw - Bezier strips
-  std::vector<std::vector<std::vector<Point4D>>> Qw = {};
-  std::vector<BezierSurface> patches = {};
-  std::vector<BezierCurve3D> curves = {};
-  std::vector<Point3D> curve_points = {};
-  curves.reserve(q + 1);
-  curve_points.reserve(p + 1);
-
-  // (dir == SurfaceDirection::kVDir)
-
-  std::vector<double> alphas(q + 1, 0.0);
-
-  int a = q;
-  int b = q + 1;
-
-  Qw.resize(2);
-  for (std::vector<std::vector<Point4D>>& patch : Qw) {
-    patch.resize(p + 1);
-    for (std::vector<Point4D>& points : patch) {
-      points.resize(q + 1);
-    }
+  const ControlNet<Point4D>& Pw = control_polygon_;
+  const int p = static_cast<int>(u_degree_);
+  const int q = static_cast<int>(v_degree_);
+  std::vector<RefineStep> steps;
+  const int nb =
+      DecomposeSteps(q, v_knots_, static_cast<int>(Pw.cols()), steps);
+  if (nb == 0) {
+    return {};
   }
 
-  for (int i = 0; i <= p; ++i) {
-    for (int j = 0; j <= q; ++j) {
-      Qw[0][i][j] = Pw[i][j];
-    }
+  std::vector<ControlNet<Point4D>> Qw(nb);
+  NetCurves<const double> in;
+  NetCurves<double> out;
+  AddCurves(Pw, kVDir, in);
+  for (ControlNet<Point4D>& patch : Qw) {
+    patch.Resize(p + 1, q + 1);
+    AddCurves(patch, kVDir, out);
   }
+  ReplayLanes(steps, in, out, Pw.rows(), pool);
+
+  // The patch keeps the homogeneous points, so rational surfaces stay
+  // rational
+  std::vector<BezierSurface> patches;
+  patches.reserve(nb);
+  for (ControlNet<Point4D>& patch : Qw) {
+    patches.emplace_back(std::move(patch));
+  }
+  return patches;
+}
 
-  while (b < m) {
-    // Get Mult
-    int i = b;
-    while (b < m && V[b + 1] == V[b]) {
-      ++b;
-    }
-    int mult = b - i + 1;
-
-    if (mult < q) {
-      // Get the numerator and the alfas;
-      double numer = V[b] - V[a];  // Numerator of alpha
-      // Compute and store alphas
-      for (int j = q; j > mult; --j) {
-        alphas[j - mult - 1] = numer / (V[a + j] - V[a]);
-      }
-      int r = q - mult;  // Knot insert r times
-
-      for (int j = 1; j <= r; ++j) {
-        int save = r - j;
-        int s = mult + j;  // This many new points
-        for (int k = q; k >= s; --k) {
-          double alpha = alphas[k - s];
-          for (int col = 0; col <= p; ++col) {
-            Qw[0][col][k] =
-                (alpha * Qw[0][col][k]) + ((1.0 - alpha) * Qw[0][col][k - 1]);
-          }
-        }
-        if (b < m) {
-          for (int col = 0; col <= p; ++col) {
-            Qw[1][col][save] = Qw[0][col][q];
-          }
-        }
-      }
-    }
-
-    for (size_t row = 0; row < Qw[0][0].size(); ++row) {
-      for (size_t col = 0; col < Qw[0].size(); ++col) {
-        const Point4D& point = Qw[0][col][row];
-        curve_points.push_back(Point3D(point.x, point.y, point.z) / point.w);
-      }
-      curves.emplace_back(curve_points);
-      curve_points.clear();
+std::vector<std::vector<BezierSurface>> NURBSSurface::Decompose(
+    ThreadPool* pool) const {
+  BezierPatchSet patches;
+  Decompose(patches, pool);
+  std::vector<std::vector<BezierSurface>> bezier_surfaces(patches.u_count());
+  for (size_t i = 0; i < patches.u_count(); ++i) {
+    bezier_surfaces[i].reserve(patches.v_count());
+    for (size_t j = 0; j < patches.v_count(); ++j) {
+      bezier_surfaces[i].push_back(patches.Patch(i, j));
     }
+  }
+  return bezier_surfaces;
+}
 
-    patches.emplace_back(curves);
-    curves.clear();
-
-    if (b < m) {
-      Qw[0] = Qw[1];
-      for (int col = 0; col <= p; ++col) {
-        for (i = std::max(q - mult, 0); i <= q; ++i) {
-          Qw[0][col][i] = Pw[col][b - q + i];
-        }
-      }
-      a = b;
-      b = b + 1;
-    }
+// ALGORITHM A5.7 DecomposeSurface(n, p, U, m, q, V, Pw, dir, nb, Qw), as A5.6
+// on every column of the net into u strips and then on every row of the
+// strips. Segment nb of a run is at nb * (degree + 1), which is where the
+// patch grid of out keeps it, so the second pass writes out directly.
+void NURBSSurface::Decompose(BezierPatchSet& out, ThreadPool* pool) const {
+  const ControlNet<Point4D>& Pw = control_polygon_;
+  out.Reset(u_degree_, v_degree_, knots::DecomposeBreaks(u_degree_, u_knots_),
+            Pw.empty() ? std::vector<double>()
+                       : knots::DecomposeBreaks(v_degree_, v_knots_));
+  if (out.empty()) {
+    return;
   }
-  return patches;
+  const int p = static_cast<int>(u_degree_);
+  const int q = static_cast<int>(v_degree_);
+
+  std::vector<RefineStep> steps;
+  DecomposeSteps(p, u_knots_, static_cast<int>(Pw.rows()), steps);
+  // Kept per thread, so repeated decompositions reuse the strip storage
+  thread_local ControlNet<Point4D> strips;
+  strips.Resize(out.u_count() * (p + 1), Pw.cols());
+  {
+    NetCurves<const double> in;
+    NetCurves<double> curves;
+    AddCurves(Pw, kUDir, in);
+    AddCurves(strips, kUDir, curves);
+    ReplayLanes(steps, in, curves, Pw.cols(), pool);
+  }
+
+  steps.clear();
+  DecomposeSteps(q, v_knots_, static_cast<int>(Pw.cols()), steps);
+  NetCurves<const double> in;
+  NetCurves<double> curves;
+  AddCurves(strips, kVDir, in);
+  AddCurves(out.net(), kVDir, curves);
+  ReplayLanes(steps, in, curves, strips.rows(), pool);
 }
 
-// ALGORITHM A5.7 DecomposeSurface(n, p, U, m, q, V, Pw, dir, nb, Qw)
-std::vector<std::vector<BezierSurface>> NURBSSurface::Decompose() const {
-  std::vector<NURBSSurface> nurbs_surfaces = DecomposeU();
-  std::vector<std::vector<BezierSurface>> bezier_surfaces;
-  bezier_surfaces.reserve(nurbs_surfaces.size());
-  for (const NURBSSurface& surface : nurbs_surfaces) {
-    bezier_surfaces.push_back(surface.DecomposeV());
+std::vector<Point3D> NURBSSurface::StepPoints(uint32_t u_sample_count,
+                                              uint32_t v_sample_count) const {
+  if (u_sample_count < 2 || v_sample_count < 2 ||
+      !forward::SplineStepPlan::Pays(v_degree_, v_knots_, v_interval_,
+                                     v_sample_count)) {
+    return EvaluatePoints(u_sample_count, v_sample_count);
   }
-  return bezier_surfaces;
+  const std::vector<double> u_params =
+      SampleParams(u_interval_, u_sample_count);
+  std::shared_ptr<const knots::BasisTable> u_table =
+      knots::BasisTableCache::Shared().Get(u_degree_, u_knots_,
+                                           u_params.data(), u_sample_count,
+                                           kTolerance);
+  const forward::SplineStepPlan v_plan(v_degree_, v_knots_, v_interval_,
+                                       v_sample_count, kTolerance);
+  std::vector<Point3D> points(u_sample_count * v_sample_count);
+  forward::StepGrid(control_polygon_, true, *u_table, v_plan, points.data());
+  return points;
 }
 }  // namespace nurbs
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "include/point_projection.hpp"
+
+#include "include/thread_pool.hpp"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace nurbs {
+namespace {
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// Halvings of one Newton step before it counts as stalled. Each halving
+// halves the step, so this is far past any point tolerance.
+constexpr uint32_t kMaxHalvings = 60;
+
+// Squared distance from point to the box, zero inside it
+double BoxDistanceSquared(const ControlHullBounds &bounds,
+                          const Point3D &point) {
+  const double dx =
+      std::max({bounds.min.x - point.x, 0.0, point.x - bounds.max.x});
+  const double dy =
+      std::max({bounds.min.y - point.y, 0.0, point.y - bounds.max.y});
+  const double dz =
+      std::max({bounds.min.z - point.z, 0.0, point.z - bounds.max.z});
+  return (dx * dx) + (dy * dy) + (dz * dz);
+}
+
+// The control hull only holds a segment or patch when every weight is
+// positive. Otherwise the boxes become unbounded and prune nothing.
+bool PositiveWeights(const std::vector<double> &weights) {
+  return std::all_of(weights.begin(), weights.end(),
+                     [](double w) { return w > 0.0; });
+}
+
+void Unbound(std::vector<ControlHullBounds> &bounds) {
+  for (ControlHullBounds &box : bounds) {
+    box.min = {-kInfinity, -kInfinity, -kInfinity};
+    box.max = {kInfinity, kInfinity, kInfinity};
+  }
+}
+
+// samples pieces of every interval between breaks, ending on the last break
+std::vector<double> SampleBreaks(const std::vector<double> &breaks,
+                                 uint32_t samples) {
+  std::vector<double> params;
+  params.reserve(((breaks.size() - 1) * samples) + 1);
+  for (size_t k = 0; k + 1 < breaks.size(); ++k) {
+    const double step = (breaks[k + 1] - breaks[k]) / samples;
+    for (uint32_t i = 0; i < samples; ++i) {
+      params.push_back(breaks[k] + (step * i));
+    }
+  }
+  params.push_back(breaks.back());
+  return params;
+}
+
+// Box distances of all segments or patches to point, and the index of the
+// nearest, which is scanned first so the others mostly prune
+size_t NearestBox(const std::vector<ControlHullBounds> &bounds,
+                  const Point3D &point, std::vector<double> &distances) {
+  distances.resize(bounds.size());
+  size_t nearest = 0;
+  for (size_t k = 0; k < bounds.size(); ++k) {
+    distances[k] = BoxDistanceSquared(bounds[k], point);
+    if (distances[k] < distances[nearest]) {
+      nearest = k;
+    }
+  }
+  return nearest;
+}
+
+// Runs task on every point index, in blocks of block_size on pool when there
+// is one
+void ForEachPoint(size_t count, size_t block_size, ThreadPool *pool,
+                  const std::function<void(size_t)> &task) {
+  const size_t blocks = (count + block_size - 1) / block_size;
+  auto run_block = [&](size_t block) {
+    const size_t last = std::min(count, (block + 1) * block_size);
+    for (size_t i = block * block_size; i < last; ++i) {
+      task(i);
+    }
+  };
+  if (pool == nullptr || blocks < 2) {
+    for (size_t block = 0; block < blocks; ++block) {
+      run_block(block);
+    }
+    return;
+  }
+  pool->ParallelFor(blocks, run_block);
+}
+
+Point2D ClampUV(Point2D uv, Point2D u_interval, Point2D v_interval) {
+  return {std::clamp(uv.x, u_interval.x, u_interval.y),
+          std::clamp(uv.y, v_interval.x, v_interval.y)};
+}
+} // namespace
+
+///
+/// Curve Projector
+///
+
+CurveProjector::CurveProjector(const NURBSCurve3D &curve,
+                               const ProjectionOptions &options)
+    : curve_(curve), options_(options) {
+  options_.samples_per_segment = std::max(options_.samples_per_segment, 1u);
+  BezierSegmentSet segments;
+  curve_.Decompose(segments);
+  bounds_.resize(segments.size());
+  for (size_t k = 0; k < segments.size(); ++k) {
+    bounds_[k] = segments.Bounds(k);
+  }
+  std::vector<double> weights;
+  for (const Point4D &point : curve_.control_points()) {
+    weights.push_back(point.w);
+  }
+  if (!PositiveWeights(weights)) {
+    Unbound(bounds_);
+  }
+  sample_params_ = SampleBreaks(segments.breaks(),
+                                options_.samples_per_segment);
+  sample_points_.resize(sample_params_.size());
+  curve_.EvaluateCurveBatch(sample_params_.data(), sample_params_.size(),
+                            sample_points_.data());
+}
+
+double CurveProjector::Seed(const Point3D &point) const {
+  const size_t samples = options_.samples_per_segment;
+  double best = kInfinity;
+  size_t best_sample = 0;
+  auto scan = [&](size_t k) {
+    for (size_t i = k * samples; i <= (k + 1) * samples; ++i) {
+      const Point3D diff = sample_points_[i] - point;
+      const double distance = Dot(diff, diff);
+      if (distance < best) {
+        best = distance;
+        best_sample = i;
+      }
+    }
+  };
+  thread_local std::vector<double> box_distances;
+  const size_t nearest = NearestBox(bounds_, point, box_distances);
+  scan(nearest);
+  for (size_t k = 0; k < bounds_.size(); ++k) {
+    if (k != nearest && box_distances[k] < best) {
+      scan(k);
+    }
+  }
+  return sample_params_[best_sample];
+}
+
+CurveProjection CurveProjector::Project(const Point3D &point) const {
+  return Project(point, Seed(point));
+}
+
+// f(u) = C'(u) . (C(u) - P) of Eq. (6.2), stepped by Eq. (6.3). Where f' is
+// not positive the step would head for a maximum, so it falls back to the
+// Gauss-Newton f' = |C'|^2.
+CurveProjection CurveProjector::Project(const Point3D &point,
+                                        double parameter) const {
+  const Point2D interval = curve_.interval();
+  const double eps1 = options_.point_tolerance;
+  const double eps2 = options_.cosine_tolerance;
+  double u = std::clamp(parameter, interval.x, interval.y);
+  Point3D ck[3];
+  Point3D next_ck[3];
+  if (curve_.EvaluateDerivative(u, 2, ck) < 3) {
+    ck[2] = {0.0, 0.0, 0.0};
+  }
+
+  CurveProjection result;
+  for (uint32_t iteration = 0;; ++iteration) {
+    const Point3D diff = ck[0] - point;
+    const double distance = Length(diff);
+    result.parameter = u;
+    result.point = ck[0];
+    result.distance = distance;
+    result.iterations = iteration;
+    if (distance <= eps1) {
+      result.status = ProjectionStatus::kCoincident;
+      return result;
+    }
+    const double speed = Length(ck[1]);
+    const double f = Dot(ck[1], diff);
+    if (std::abs(f) <= eps2 * speed * distance) {
+      result.status = ProjectionStatus::kConverged;
+      return result;
+    }
+    if (iteration == options_.max_iterations) {
+      result.status = ProjectionStatus::kMaxIterations;
+      return result;
+    }
+    double df = Dot(ck[2], diff) + (speed * speed);
+    if (!(df > 0.0)) {
+      df = speed * speed;
+    }
+    double next = std::clamp(u - (f / df), interval.x, interval.y);
+    // Damp the step until the curve gets closer
+    for (uint32_t halving = 0;; ++halving) {
+      if (std::abs(next - u) * speed <= eps1 || halving == kMaxHalvings) {
+        result.status = ProjectionStatus::kConverged;
+        return result;
+      }
+      if (curve_.EvaluateDerivative(next, 2, next_ck) < 3) {
+        next_ck[2] = {0.0, 0.0, 0.0};
+      }
+      if (Length(next_ck[0] - point) < distance) {
+        break;
+      }
+      next = 0.5 * (u + next);
+    }
+    u = next;
+    std::copy(next_ck, next_ck + 3, ck);
+  }
+}
+
+void CurveProjector::Project(const Point3D *points, size_t count,
+                             CurveProjection *results,
+                             ThreadPool *pool) const {
+  ForEachPoint(count, kPointsPerTask, pool,
+               [&](size_t i) { results[i] = Project(points[i]); });
+}
+
+///
+/// Surface Projector
+///
+
+SurfaceProjector::SurfaceProjector(const NURBSSurface &surface,
+                                   const ProjectionOptions &options)
+    : surface_(surface), options_(options) {
+  options_.samples_per_segment = std::max(options_.samples_per_segment, 1u);
+  BezierPatchSet patches;
+  surface_.Decompose(patches);
+  u_count_ = patches.u_count();
+  v_count_ = patches.v_count();
+  bounds_.resize(patches.size());
+  for (size_t i = 0; i < u_count_; ++i) {
+    for (size_t j = 0; j < v_count_; ++j) {
+      bounds_[(i * v_count_) + j] = patches.Bounds(i, j);
+    }
+  }
+  const ControlNet<Point4D> &net = surface_.control_polygon();
+  std::vector<double> weights;
+  for (size_t u = 0; u < net.rows(); ++u) {
+    for (size_t v = 0; v < net.cols(); ++v) {
+      weights.push_back(net.Get(u, v).w);
+    }
+  }
+  if (!PositiveWeights(weights)) {
+    Unbound(bounds_);
+  }
+  u_params_ = SampleBreaks(patches.u_breaks(), options_.samples_per_segment);
+  v_params_ = SampleBreaks(patches.v_breaks(), options_.samples_per_segment);
+  grid_.resize(u_params_.size() * v_params_.size());
+  surface_.EvaluateGrid(u_params_.data(), u_params_.size(), v_params_.data(),
+                        v_params_.size(), grid_.data());
+}
+
+Point2D SurfaceProjector::Seed(const Point3D &point) const {
+  const size_t samples = options_.samples_per_segment;
+  const size_t cols = v_params_.size();
+  double best = kInfinity;
+  size_t best_row = 0;
+  size_t best_col = 0;
+  auto scan = [&](size_t patch) {
+    const size_t i = patch / v_count_;
+    const size_t j = patch % v_count_;
+    for (size_t row = i * samples; row <= (i + 1) * samples; ++row) {
+      for (size_t col = j * samples; col <= (j + 1) * samples; ++col) {
+        const Point3D diff = grid_[(row * cols) + col] - point;
+        const double distance = Dot(diff, diff);
+        if (distance < best) {
+          best = distance;
+          best_row = row;
+          best_col = col;
+        }
+      }
+    }
+  };
+  thread_local std::vector<double> box_distances;
+  const size_t nearest = NearestBox(bounds_, point, box_distances);
+  scan(nearest);
+  for (size_t k = 0; k < bounds_.size(); ++k) {
+    if (k != nearest && box_distances[k] < best) {
+      scan(k);
+    }
+  }
+  return {u_params_[best_row], v_params_[best_col]};
+}
+
+SurfaceProjection SurfaceProjector::Project(const Point3D &point) const {
+  return Project(point, Seed(point));
+}
+
+// f = r . Su and g = r . Sv with r = S - P, Eq. (6.6), solved by the 2 x 2
+// system of Eq. (6.7). Where its Jacobian is not positive definite the step
+// would head for a saddle or a maximum, so it falls back to the Gauss-Newton
+// one without the second partials.
+SurfaceProjection SurfaceProjector::Project(const Point3D &point,
+                                            Point2D uv) const {
+  const Point2D u_interval = surface_.u_interval();
+  const Point2D v_interval = surface_.v_interval();
+  const double eps1 = options_.point_tolerance;
+  const double eps2 = options_.cosine_tolerance;
+  // skl[(k * 3) + l] is the derivative k times in u and l times in v
+  Point3D skl[9];
+  Point3D next_skl[9];
+  uv = ClampUV(uv, u_interval, v_interval);
+  surface_.Derivatives(uv, 2, skl);
+
+  SurfaceProjection result;
+  for (uint32_t iteration = 0;; ++iteration) {
+    const Point3D r = skl[0] - point;
+    const double distance = Length(r);
+    result.uv = uv;
+    result.point = skl[0];
+    result.distance = distance;
+    result.iterations = iteration;
+    if (distance <= eps1) {
+      result.status = ProjectionStatus::kCoincident;
+      return result;
+    }
+    const Point3D &su = skl[3];
+    const Point3D &sv = skl[1];
+    const double su_length = Length(su);
+    const double sv_length = Length(sv);
+    const double f = Dot(r, su);
+    const double g = Dot(r, sv);
+    if (std::abs(f) <= eps2 * su_length * distance &&
+        std::abs(g) <= eps2 * sv_length * distance) {
+      result.status = ProjectionStatus::kConverged;
+      return result;
+    }
+    if (iteration == options_.max_iterations) {
+      result.status = ProjectionStatus::kMaxIterations;
+      return result;
+    }
+    const double su_sv = Dot(su, sv);
+    double a = (su_length * su_length) + Dot(r, skl[6]);
+    double b = su_sv + Dot(r, skl[4]);
+    double c = (sv_length * sv_length) + Dot(r, skl[2]);
+    if (!(a > 0.0 && (a * c) - (b * b) > 0.0)) {
+      a = su_length * su_length;
+      b = su_sv;
+      c = sv_length * sv_length;
+    }
+    const double det = (a * c) - (b * b);
+    Point2D delta;
+    if (det > 0.0) {
+      delta = {((b * g) - (c * f)) / det, ((b * f) - (a * g)) / det};
+    } else {
+      // Degenerate partials, as at a pole: step along the ones there are
+      delta = {a > 0.0 ? -f / a : 0.0, c > 0.0 ? -g / c : 0.0};
+    }
+    Point2D next = ClampUV(uv + delta, u_interval, v_interval);
+    // Damp the step until the surface gets closer
+    for (uint32_t halving = 0;; ++halving) {
+      const Point2D step = next - uv;
+      if (Length((step.x * su) + (step.y * sv)) <= eps1 ||
+          halving == kMaxHalvings) {
+        result.status = ProjectionStatus::kConverged;
+        return result;
+      }
+      surface_.Derivatives(next, 2, next_skl);
+      if (Length(next_skl[0] - point) < distance) {
+        break;
+      }
+      next = 0.5 * (uv + next);
+    }
+    uv = next;
+    std::copy(next_skl, next_skl + 9, skl);
+  }
+}
+
+void SurfaceProjector::Project(const Point3D *points, size_t count,
+                               SurfaceProjection *results,
+                               ThreadPool *pool) const {
+  ForEachPoint(count, kPointsPerTask, pool,
+               [&](size_t i) { results[i] = Project(points[i]); });
+}
+} // namespace nurbs
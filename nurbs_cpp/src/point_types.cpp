@@ -1,5 +1,8 @@
 #include "include/point_types.hpp"
 
+// STD
+#include <cmath>
+
 namespace nurbs {
 // Point 2D Operators
 
@@ -178,4 +181,28 @@ void Point4D::operator/=(double rhs) {
   z /= rhs;
   w /= rhs;
 }
-} // namespace nurbs
\ No newline at end of file
+
+// Vector helpers
+double Dot(const Point2D &lhs, const Point2D &rhs) {
+  return (lhs.x * rhs.x) + (lhs.y * rhs.y);
+}
+
+double Dot(const Point3D &lhs, const Point3D &rhs) {
+  return (lhs.x * rhs.x) + (lhs.y * rhs.y) + (lhs.z * rhs.z);
+}
+
+double Dot(const Point4D &lhs, const Point4D &rhs) {
+  return (lhs.x * rhs.x) + (lhs.y * rhs.y) + (lhs.z * rhs.z) + (lhs.w * rhs.w);
+}
+
+Point3D Cross(const Point3D &lhs, const Point3D &rhs) {
+  return {(lhs.y * rhs.z) - (lhs.z * rhs.y), (lhs.z * rhs.x) - (lhs.x * rhs.z),
+          (lhs.x * rhs.y) - (lhs.y * rhs.x)};
+}
+
+double Length(const Point2D &point) { return std::sqrt(Dot(point, point)); }
+
+double Length(const Point3D &point) { return std::sqrt(Dot(point, point)); }
+
+double Length(const Point4D &point) { return std::sqrt(Dot(point, point)); }
+} // namespace nurbs
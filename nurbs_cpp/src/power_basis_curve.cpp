@@ -1,5 +1,13 @@
 #include "include/power_basis_curve.hpp"
 
+#include "include/forward_difference.hpp"
+#include "include/knot_utility_functions.hpp"
+
+// STD
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 namespace nurbs {
 PowerBasisCurve2D::PowerBasisCurve2D(std::vector<Point2D> bases,
                                      Point2D interval)
@@ -9,6 +17,16 @@ Point2D PowerBasisCurve2D::EvaluateCurve(double u) const {
     return Horner(u);
 }
 
+std::vector<Point2D> PowerBasisCurve2D::StepCurvePoints(
+    uint32_t point_count) const {
+    if (point_count < 2) {
+        return EvaluateCurvePoints(point_count);
+    }
+    const double step = (interval_.y - interval_.x) /
+                        static_cast<double>(point_count - 1);
+    return forward::StepPowerBasis(bases_, interval_.x, step, point_count);
+}
+
 // Chaper 1, Algorithm 1.1 Horner 1, p7
 Point2D PowerBasisCurve2D::Horner(double u) const {
     Point2D point = {0.0, 0.0};
@@ -29,6 +47,16 @@ Point3D PowerBasisCurve3D::EvaluateCurve(double u) const {
     return Horner(u);
 }
 
+std::vector<Point3D> PowerBasisCurve3D::StepCurvePoints(
+    uint32_t point_count) const {
+    if (point_count < 2) {
+        return EvaluateCurvePoints(point_count);
+    }
+    const double step = (interval_.y - interval_.x) /
+                        static_cast<double>(point_count - 1);
+    return forward::StepPowerBasis(bases_, interval_.x, step, point_count);
+}
+
 // Chaper 1, Algorithm 1.1 Horner 1, p7
 Point3D PowerBasisCurve3D::Horner(double u) const {
     Point3D point = {0.0, 0.0, 0.0};
@@ -40,4 +68,131 @@ Point3D PowerBasisCurve3D::Horner(double u) const {
     }
     return point;
 }
+
+PiecewisePowerBasisCurve2D::PiecewisePowerBasisCurve2D(
+    uint32_t degree, std::vector<double> breakpoints,
+    std::vector<double> coefficients, bool rational, Point2D interval)
+    : Curve2D(interval),
+      degree_(degree),
+      rational_(rational),
+      breakpoints_(std::move(breakpoints)),
+      coefficients_(std::move(coefficients)) {
+    if (coefficients_.size() != span_count() * (degree_ + 1) * planes()) {
+        throw std::exception(
+            "Coefficient count does not match the spans and degree");
+    }
+    // Degree 0 spans on the breakpoints without tolerance, so a parameter on
+    // an interior breakpoint goes to the span to its right
+    span_locator_ = knots::SpanLocator(0, breakpoints_, 0.0);
+}
+
+Point2D PiecewisePowerBasisCurve2D::EvaluateCurve(double u) const {
+    if (span_count() == 0) {
+        return {0.0, 0.0};
+    }
+    u = ClampInterval(u);
+    return Horner(span_locator_.Find(u), u);
+}
+
+void PiecewisePowerBasisCurve2D::EvaluateCurveBatch(const double *params,
+                                                    size_t count,
+                                                    Point2D *points) const {
+    if (span_count() == 0) {
+        std::fill(points, points + count, Point2D{0.0, 0.0});
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const double u = ClampInterval(params[i]);
+        points[i] = Horner(span_locator_.Find(u), u);
+    }
+}
+
+std::vector<double> PiecewisePowerBasisCurve2D::Breakpoints() const {
+    return knots::Breakpoints(breakpoints_, interval_.x, interval_.y,
+                              std::numeric_limits<double>::epsilon());
+}
+
+// Chaper 1, Algorithm 1.1 Horner 1, p7, on the coefficients of the span
+Point2D PiecewisePowerBasisCurve2D::Horner(size_t span, double u) const {
+    const uint32_t planes = this->planes();
+    const double t = u - breakpoints_[span];
+    const double *coefficient =
+        coefficients_.data() + ((span * (degree_ + 1)) + degree_) * planes;
+    double coords[3] = {coefficient[0], coefficient[1],
+                        rational_ ? coefficient[2] : 1.0};
+    for (uint32_t k = degree_; k-- > 0;) {
+        coefficient -= planes;
+        for (uint32_t c = 0; c < planes; ++c) {
+            coords[c] = (t * coords[c]) + coefficient[c];
+        }
+    }
+    if (rational_) {
+        return {coords[0] / coords[2], coords[1] / coords[2]};
+    }
+    return {coords[0], coords[1]};
+}
+
+PiecewisePowerBasisCurve3D::PiecewisePowerBasisCurve3D(
+    uint32_t degree, std::vector<double> breakpoints,
+    std::vector<double> coefficients, bool rational, Point2D interval)
+    : Curve3D(interval),
+      degree_(degree),
+      rational_(rational),
+      breakpoints_(std::move(breakpoints)),
+      coefficients_(std::move(coefficients)) {
+    if (coefficients_.size() != span_count() * (degree_ + 1) * planes()) {
+        throw std::exception(
+            "Coefficient count does not match the spans and degree");
+    }
+    // Degree 0 spans on the breakpoints without tolerance, so a parameter on
+    // an interior breakpoint goes to the span to its right
+    span_locator_ = knots::SpanLocator(0, breakpoints_, 0.0);
+}
+
+Point3D PiecewisePowerBasisCurve3D::EvaluateCurve(double u) const {
+    if (span_count() == 0) {
+        return {0.0, 0.0, 0.0};
+    }
+    u = ClampInterval(u);
+    return Horner(span_locator_.Find(u), u);
+}
+
+void PiecewisePowerBasisCurve3D::EvaluateCurveBatch(const double *params,
+                                                    size_t count,
+                                                    Point3D *points) const {
+    if (span_count() == 0) {
+        std::fill(points, points + count, Point3D{0.0, 0.0, 0.0});
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const double u = ClampInterval(params[i]);
+        points[i] = Horner(span_locator_.Find(u), u);
+    }
+}
+
+std::vector<double> PiecewisePowerBasisCurve3D::Breakpoints() const {
+    return knots::Breakpoints(breakpoints_, interval_.x, interval_.y,
+                              std::numeric_limits<double>::epsilon());
+}
+
+// Chaper 1, Algorithm 1.1 Horner 1, p7, on the coefficients of the span
+Point3D PiecewisePowerBasisCurve3D::Horner(size_t span, double u) const {
+    const uint32_t planes = this->planes();
+    const double t = u - breakpoints_[span];
+    const double *coefficient =
+        coefficients_.data() + ((span * (degree_ + 1)) + degree_) * planes;
+    double coords[4] = {coefficient[0], coefficient[1], coefficient[2],
+                        rational_ ? coefficient[3] : 1.0};
+    for (uint32_t k = degree_; k-- > 0;) {
+        coefficient -= planes;
+        for (uint32_t c = 0; c < planes; ++c) {
+            coords[c] = (t * coords[c]) + coefficient[c];
+        }
+    }
+    if (rational_) {
+        return {coords[0] / coords[3], coords[1] / coords[3],
+                coords[2] / coords[3]};
+    }
+    return {coords[0], coords[1], coords[2]};
+}
 }  // namespace nurbs
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "include/span_locator.hpp"
+
+// NURBS
+#include "include/knot_utility_functions.hpp"
+
+// STD
+#include <cmath>
+
+namespace nurbs {
+namespace knots {
+namespace {
+// Interior knots this close to the even spacing still count as uniform, the
+// walk in Find absorbs the rounding of the guess either way
+constexpr double kUniformTolerance = 1e-9;
+} // namespace
+
+void SpanLocator::Reset(uint32_t degree, const std::vector<double> &knots,
+                        double tolerance) {
+  kind_ = Kind::kBucketed;
+  degree_ = degree;
+  last_span_ = 0;
+  start_ = 0.0;
+  end_ = 0.0;
+  origin_ = 0.0;
+  inverse_width_ = 0.0;
+  last_bucket_ = 0.0;
+  thresholds_.clear();
+  buckets_.clear();
+  if (knots.size() < degree + 2) {
+    return;
+  }
+  last_span_ = static_cast<uint32_t>(knots.size()) - degree - 2;
+  start_ = knots[degree] + tolerance;
+  end_ = knots[last_span_ + 1] - tolerance;
+  thresholds_.resize(last_span_ - degree + 2);
+  for (size_t i = 0; i < thresholds_.size(); ++i) {
+    thresholds_[i] = knots[degree + i] - tolerance;
+  }
+  const uint32_t span_count = last_span_ - degree + 1;
+  origin_ = knots[degree];
+  const double length = knots[last_span_ + 1] - origin_;
+  if (!(length > 0.0)) {
+    // Every parameter hits one of the end conditions
+    return;
+  }
+  const double width = length / span_count;
+  inverse_width_ = span_count / length;
+  last_bucket_ = span_count - 1;
+
+  bool uniform = true;
+  for (uint32_t i = 1; i < span_count && uniform; ++i) {
+    const double expected = origin_ + (i * width);
+    uniform =
+        std::abs(knots[degree + i] - expected) <= kUniformTolerance * width;
+  }
+  if (uniform) {
+    kind_ = Kind::kUniform;
+    return;
+  }
+  // One bucket per span, each starting at the span its first parameter is in
+  kind_ = Kind::kBucketed;
+  buckets_.resize(span_count);
+  uint32_t span = degree;
+  for (uint32_t b = 0; b < span_count; ++b) {
+    span = FindSpanParam(degree, knots, origin_ + (b * width), tolerance, span);
+    buckets_[b] = span;
+  }
+}
+} // namespace knots
+} // namespace nurbs
@@ -0,0 +1,159 @@
+#include "include/tensor_grid.hpp"
+
+#include "include/grid_kernels.hpp"
+
+// STD
+#include <algorithm>
+#include <vector>
+
+namespace nurbs {
+namespace tensor {
+namespace {
+// Columns [first, end) of the net that some v sample reaches
+void ColumnRange(const knots::BasisTable &v_table, size_t &first,
+                 size_t &end) {
+  const uint32_t *v_spans = v_table.spans();
+  first = *std::min_element(v_spans, v_spans + v_table.size()) -
+          v_table.degree();
+  end = *std::max_element(v_spans, v_spans + v_table.size()) + 1;
+}
+} // namespace
+
+void EvaluateRows(
+    const ControlNet<Point4D> &net, bool rational,
+    const knots::BasisTable &u_table, const knots::BasisTable &v_table,
+    const std::function<void(size_t, const double *const *)> &emit_row) {
+  const size_t u_count = u_table.size();
+  const size_t v_count = v_table.size();
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const uint32_t u_degree = u_table.degree();
+  const uint32_t planes = rational ? 4 : 3;
+  size_t first_col = 0;
+  size_t end_col = 0;
+  ColumnRange(v_table, first_col, end_col);
+  const size_t stride = net.stride();
+  std::vector<double> u_bases(u_degree + 1);
+  std::vector<double> row(net.cols());
+  // x, y, z and w of the current row of samples
+  std::vector<double> sums(planes * v_count);
+  double *coords[3] = {sums.data(), sums.data() + v_count,
+                       sums.data() + (2 * v_count)};
+  const double *weights = sums.data() + (3 * v_count);
+  for (size_t u_i = 0; u_i < u_count; ++u_i) {
+    for (uint32_t j = 0; j <= u_degree; ++j) {
+      u_bases[j] = u_table.value(j, u_i);
+    }
+    const size_t offset = net.Index(u_table.span(u_i) - u_degree, first_col);
+    for (uint32_t c = 0; c < planes; ++c) {
+      simd::WeightedRowSum(u_bases.data(), u_degree + 1,
+                           net.plane(c) + offset, stride, end_col - first_col,
+                           row.data() + first_col);
+      simd::ContractSamples(v_table, row.data(), sums.data() + (c * v_count));
+    }
+    if (rational) {
+      for (uint32_t c = 0; c < 3; ++c) {
+        simd::Divide(coords[c], weights, v_count);
+      }
+    }
+    emit_row(u_i, coords);
+  }
+}
+
+void EvaluateDerivatives(const ControlNet<Point4D> &net, bool rational,
+                         const knots::BasisTable &u_table,
+                         const knots::BasisTable &v_table,
+                         bool second_partials, GridDerivatives &grid) {
+  const size_t u_count = u_table.size();
+  const size_t v_count = v_table.size();
+  if (u_count == 0 || v_count == 0) {
+    return;
+  }
+  const uint32_t u_degree = u_table.degree();
+  const uint32_t planes = rational ? 4 : 3;
+  const uint32_t d = second_partials ? 2 : 1;
+  const size_t order = static_cast<size_t>(d) + 1;
+  size_t first_col = 0;
+  size_t end_col = 0;
+  ColumnRange(v_table, first_col, end_col);
+  const size_t stride = net.stride();
+  std::vector<double> u_bases(u_degree + 1);
+  std::vector<double> row(net.cols());
+  // Plane c of the homogeneous SKL[k][l] for the current row starts at
+  // sums[(((k * order) + l) * 4 + c) * v_count], orders above the degrees
+  // stay zero
+  std::vector<double> sums(order * order * 4 * v_count, 0.0);
+  auto at = [&](size_t k, size_t l, uint32_t c) {
+    return sums.data() + (((((k * order) + l) * 4) + c) * v_count);
+  };
+  for (size_t u_i = 0; u_i < u_count; ++u_i) {
+    const size_t offset = net.Index(u_table.span(u_i) - u_degree, first_col);
+    for (uint32_t k = 0; k <= u_table.derivatives(); ++k) {
+      for (uint32_t j = 0; j <= u_degree; ++j) {
+        u_bases[j] = u_table.derivative(k, j, u_i);
+      }
+      const uint32_t v_max = std::min(d - k, v_table.derivatives());
+      for (uint32_t c = 0; c < planes; ++c) {
+        simd::WeightedRowSum(u_bases.data(), u_degree + 1,
+                             net.plane(c) + offset, stride,
+                             end_col - first_col, row.data() + first_col);
+        for (uint32_t l = 0; l <= v_max; ++l) {
+          simd::ContractSamples(v_table, row.data(), at(k, l, c), l);
+        }
+      }
+    }
+    if (rational) {
+      // A4.4 on whole rows, each term in the order RatSurfaceDerivs sums it
+      const double *w = at(0, 0, 3);
+      const double *w01 = at(0, 1, 3);
+      const double *w10 = at(1, 0, 3);
+      for (uint32_t c = 0; c < 3; ++c) {
+        double *s00 = at(0, 0, c);
+        double *s01 = at(0, 1, c);
+        double *s10 = at(1, 0, c);
+        for (size_t v_i = 0; v_i < v_count; ++v_i) {
+          s00[v_i] /= w[v_i];
+          s01[v_i] = (s01[v_i] - (w01[v_i] * s00[v_i])) / w[v_i];
+          s10[v_i] = (s10[v_i] - (w10[v_i] * s00[v_i])) / w[v_i];
+        }
+        if (!second_partials) {
+          continue;
+        }
+        const double *w02 = at(0, 2, 3);
+        const double *w11 = at(1, 1, 3);
+        const double *w20 = at(2, 0, 3);
+        double *s02 = at(0, 2, c);
+        double *s11 = at(1, 1, c);
+        double *s20 = at(2, 0, c);
+        for (size_t v_i = 0; v_i < v_count; ++v_i) {
+          s02[v_i] = (s02[v_i] - ((2.0 * w01[v_i]) * s01[v_i]) -
+                      (w02[v_i] * s00[v_i])) /
+                     w[v_i];
+          s11[v_i] = (s11[v_i] - (w01[v_i] * s10[v_i]) -
+                      (w10[v_i] * s01[v_i]) - (w11[v_i] * s00[v_i])) /
+                     w[v_i];
+          s20[v_i] = (s20[v_i] - ((2.0 * w10[v_i]) * s10[v_i]) -
+                      (w20[v_i] * s00[v_i])) /
+                     w[v_i];
+        }
+      }
+    }
+    auto point = [&](size_t k, size_t l, size_t v_i) {
+      return Point3D{at(k, l, 0)[v_i], at(k, l, 1)[v_i], at(k, l, 2)[v_i]};
+    };
+    for (size_t v_i = 0; v_i < v_count; ++v_i) {
+      const size_t index = (u_i * v_count) + v_i;
+      grid.points[index] = point(0, 0, v_i);
+      grid.u_partials[index] = point(1, 0, v_i);
+      grid.v_partials[index] = point(0, 1, v_i);
+      if (second_partials) {
+        grid.uu_partials[index] = point(2, 0, v_i);
+        grid.uv_partials[index] = point(1, 1, v_i);
+        grid.vv_partials[index] = point(0, 2, v_i);
+      }
+    }
+  }
+}
+} // namespace tensor
+} // namespace nurbs
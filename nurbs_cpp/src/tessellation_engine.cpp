@@ -0,0 +1,122 @@
+#include "include/tessellation_engine.hpp"
+
+// STD
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace nurbs {
+namespace {
+// u rows [row_begin, row_end) of one surface
+struct Tile {
+  size_t patch;
+  uint32_t row_begin;
+  uint32_t row_end;
+};
+} // namespace
+
+uint32_t TessellationEngine::DefaultThreadCount() {
+  const uint32_t hardware = std::thread::hardware_concurrency();
+  return hardware > 1 ? hardware - 1 : 0;
+}
+
+TessellationEngine::TessellationEngine(uint32_t thread_count,
+                                       uint32_t tile_rows)
+    : pool_(thread_count), tile_rows_(std::max(tile_rows, 1u)) {}
+
+SurfaceMesh TessellationEngine::Tessellate(const Surface &surface,
+                                           uint32_t u_count,
+                                           uint32_t v_count) {
+  return Tessellate(std::vector<const Surface *>{&surface}, u_count, v_count);
+}
+
+SurfaceMesh
+TessellationEngine::Tessellate(const std::vector<const Surface *> &surfaces,
+                               uint32_t u_count, uint32_t v_count) {
+  if (u_count < 2 || v_count < 2) {
+    throw std::exception("Tessellation needs two samples in each direction");
+  }
+  SurfaceMesh mesh;
+  mesh.patches.reserve(surfaces.size());
+  std::vector<Tile> tiles;
+  // The whole layout is known up front, so every tile owns a disjoint part
+  // of the buffers
+  const size_t patch_vertices = static_cast<size_t>(u_count) * v_count;
+  const size_t patch_indices =
+      static_cast<size_t>(u_count - 1) * (v_count - 1) * 6;
+  // Every grid has more indices than vertices
+  if (patch_indices * surfaces.size() >
+      std::numeric_limits<uint32_t>::max()) {
+    throw std::exception("Tessellation does not fit 32 bit indices");
+  }
+  std::vector<std::vector<double>> u_params_of(surfaces.size());
+  std::vector<std::vector<double>> v_params_of(surfaces.size());
+  for (size_t p = 0; p < surfaces.size(); ++p) {
+    u_params_of[p] = Surface::SampleParams(surfaces[p]->u_interval(), u_count);
+    v_params_of[p] = Surface::SampleParams(surfaces[p]->v_interval(), v_count);
+    mesh.patches.push_back({u_count, v_count,
+                            static_cast<uint32_t>(p * patch_vertices),
+                            static_cast<uint32_t>(p * patch_indices)});
+    for (uint32_t row = 0; row < u_count; row += tile_rows_) {
+      tiles.push_back({p, row, std::min(row + tile_rows_, u_count)});
+    }
+  }
+  mesh.positions.resize(3 * patch_vertices * surfaces.size());
+  mesh.normals.resize(3 * patch_vertices * surfaces.size());
+  mesh.uvs.resize(2 * patch_vertices * surfaces.size());
+  mesh.indices.resize(patch_indices * surfaces.size());
+
+  pool_.ParallelFor(tiles.size(), [&](size_t t) {
+    const Tile &tile = tiles[t];
+    const Surface &surface = *surfaces[tile.patch];
+    const SurfaceMesh::Patch &patch = mesh.patches[tile.patch];
+    const std::vector<double> &u_params = u_params_of[tile.patch];
+    const std::vector<double> &v_params = v_params_of[tile.patch];
+    const uint32_t rows = tile.row_end - tile.row_begin;
+    const size_t first_vertex =
+        patch.vertex_offset + (static_cast<size_t>(tile.row_begin) * v_count);
+    // Partials and normals come from one pass over the tile's basis tables.
+    // Kept per thread, tiles are the same size so the buffers are reused.
+    thread_local GridDerivatives grid;
+    surface.EvaluateGridDerivatives(u_params.data() + tile.row_begin, rows,
+                                    v_params.data(), v_count, false, grid);
+    float *position = mesh.positions.data() + (3 * first_vertex);
+    float *normal = mesh.normals.data() + (3 * first_vertex);
+    for (size_t index = 0; index < grid.points.size(); ++index) {
+      *position++ = static_cast<float>(grid.points[index].x);
+      *position++ = static_cast<float>(grid.points[index].y);
+      *position++ = static_cast<float>(grid.points[index].z);
+      *normal++ = static_cast<float>(grid.normals[index].x);
+      *normal++ = static_cast<float>(grid.normals[index].y);
+      *normal++ = static_cast<float>(grid.normals[index].z);
+    }
+    float *uv = mesh.uvs.data() + (2 * first_vertex);
+    const float u_div = 1.0f / static_cast<float>(u_count - 1);
+    const float v_div = 1.0f / static_cast<float>(v_count - 1);
+    for (uint32_t i = tile.row_begin; i < tile.row_end; ++i) {
+      for (uint32_t j = 0; j < v_count; ++j) {
+        *uv++ = static_cast<float>(i) * u_div;
+        *uv++ = static_cast<float>(j) * v_div;
+      }
+    }
+
+    // The cells below the tile's rows, the last row of the surface has none
+    uint32_t *out = mesh.indices.data() + patch.index_offset +
+                    (static_cast<size_t>(tile.row_begin) * (v_count - 1) * 6);
+    const uint32_t cell_end = std::min(tile.row_end, u_count - 1);
+    for (uint32_t i = tile.row_begin; i < cell_end; ++i) {
+      for (uint32_t j = 0; j < v_count - 1; ++j) {
+        const uint32_t index = patch.vertex_offset + (i * v_count) + j;
+        *out++ = index;
+        *out++ = index + v_count;
+        *out++ = index + 1;
+
+        *out++ = index + 1;
+        *out++ = index + v_count;
+        *out++ = index + v_count + 1;
+      }
+    }
+  });
+  return mesh;
+}
+} // namespace nurbs
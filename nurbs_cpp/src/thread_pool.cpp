@@ -0,0 +1,144 @@
+#include "include/thread_pool.hpp"
+
+namespace nurbs {
+ThreadPool::ThreadPool(uint32_t thread_count) {
+  queues_.reserve(thread_count + 1);
+  for (uint32_t i = 0; i <= thread_count; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  threads_.reserve(thread_count);
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+  if (threads_.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+  Batch batch;
+  batch.task = &task;
+  batch.remaining = count;
+  // Counted before the items are visible, so a worker popping one early
+  // never sees pending_ below zero
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    pending_ += count;
+  }
+  // Contiguous chunks keep neighbouring tiles on one thread until someone
+  // runs out of work and steals
+  const size_t queue_count = queues_.size();
+  for (size_t q = 0; q < queue_count; ++q) {
+    const size_t begin = (q * count) / queue_count;
+    const size_t end = ((q + 1) * count) / queue_count;
+    if (begin == end) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    for (size_t i = begin; i < end; ++i) {
+      queues_[q]->items.push_back({&batch, i});
+    }
+  }
+  wake_.notify_all();
+
+  const size_t own = queue_count - 1;
+  while (batch.remaining.load() != 0) {
+    if (RunOne(own)) {
+      continue;
+    }
+    // Everything is taken, wait for the workers to finish their items
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&] { return batch.remaining.load() == 0; });
+  }
+  // The last worker may still hold the batch lock after the count reached
+  // zero, wait for it before the batch goes out of scope
+  std::lock_guard<std::mutex> lock(batch.mutex);
+  if (batch.error) {
+    std::rethrow_exception(batch.error);
+  }
+}
+
+bool ThreadPool::Pop(size_t queue, Item &item) {
+  std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+  std::deque<Item> &items = queues_[queue]->items;
+  if (items.empty()) {
+    return false;
+  }
+  item = items.back();
+  items.pop_back();
+  return true;
+}
+
+bool ThreadPool::Steal(size_t thief, Item &item) {
+  const size_t queue_count = queues_.size();
+  for (size_t offset = 1; offset < queue_count; ++offset) {
+    Queue &queue = *queues_[(thief + offset) % queue_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.items.empty()) {
+      item = queue.items.front();
+      queue.items.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::RunOne(size_t queue) {
+  Item item;
+  if (!Pop(queue, item) && !Steal(queue, item)) {
+    return false;
+  }
+  pending_.fetch_sub(1);
+  Run(item);
+  return true;
+}
+
+void ThreadPool::Run(const Item &item) {
+  Batch &batch = *item.batch;
+  try {
+    (*batch.task)(item.index);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if (!batch.error) {
+      batch.error = std::current_exception();
+    }
+  }
+  // The caller may return and destroy the batch as soon as remaining hits
+  // zero, so the notify happens under the batch lock
+  std::lock_guard<std::mutex> lock(batch.mutex);
+  if (batch.remaining.fetch_sub(1) == 1) {
+    batch.done.notify_all();
+  }
+}
+
+void ThreadPool::WorkerLoop(size_t queue) {
+  while (true) {
+    if (RunOne(queue)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [&] { return stop_ || pending_.load() != 0; });
+    if (stop_ && pending_.load() == 0) {
+      return;
+    }
+  }
+}
+} // namespace nurbs
@@ -0,0 +1,45 @@
+#include "include/uniform_cubic.hpp"
+
+// STD
+#include <cmath>
+#include <limits>
+
+namespace nurbs {
+namespace knots {
+namespace {
+// Knot gaps this close to the span width count as equal, which only lets the
+// rounding of knots like i * 0.1 through
+constexpr double kUniformTolerance =
+    16.0 * std::numeric_limits<double>::epsilon();
+} // namespace
+
+void UniformCubicSpans::Reset(uint32_t degree,
+                              const std::vector<double> &knots) {
+  count_ = 0;
+  inverse_widths_.clear();
+  if (degree != 3 || knots.size() < 8) {
+    return;
+  }
+  const uint32_t last_span = static_cast<uint32_t>(knots.size()) - 5;
+  inverse_widths_.assign(last_span + 1, 0.0);
+  for (uint32_t span = 3; span <= last_span; ++span) {
+    const double width = knots[span + 1] - knots[span];
+    if (!(width > 0.0)) {
+      continue;
+    }
+    bool uniform = true;
+    for (uint32_t k = span - 2; k < span + 3 && uniform; ++k) {
+      uniform = std::abs((knots[k + 1] - knots[k]) - width) <=
+                kUniformTolerance * width;
+    }
+    if (uniform) {
+      inverse_widths_[span] = 1.0 / width;
+      ++count_;
+    }
+  }
+  if (count_ == 0) {
+    inverse_widths_.clear();
+  }
+}
+} // namespace knots
+} // namespace nurbs
@@ -3,8 +3,10 @@
 // NURBS_CPP
 #include "include/bezier_curve.hpp"
 #include "include/bezier_surface.hpp"
+#include "include/nurbs_surface.hpp"
 
 // STD
+#include <cmath>
 #include <numeric>
 
 namespace nurbs {
@@ -730,4 +732,212 @@ TEST(NURBS_Chapter1, BezierSurfacePointsInterval) {
     }
   }
 }
+// The flat net evaluates like the curves it came from, and grids like points
+TEST(NURBS_Chapter1, BezierSurfaceFlatNet) {
+  const std::vector<std::vector<Point3D>> control_points = {
+      {{0, -1, 0}, {1, 0, 0}, {2, 2, 0}, {3, 3, 0}},
+      {{0, 2, 1}, {1, 4, 1}, {2, 1, 1}, {3, -2, 1}},
+      {{0, 2, 2}, {1, 3, 2}, {2, 0, 2}, {3, -4, 2}}};
+  std::vector<BezierCurve3D> curves;
+  for (size_t v = 0; v < 4; ++v) {
+    curves.emplace_back(std::vector<Point3D>{
+        control_points[0][v], control_points[1][v], control_points[2][v]});
+  }
+  const Point2D u_interval = {-1.0, 3.0};
+  const Point2D v_interval = {2.0, 2.5};
+  const BezierSurface from_curves(curves, u_interval, v_interval);
+  const BezierSurface surface(control_points, u_interval, v_interval);
+  EXPECT_EQ(surface.u_degree(), 2);
+  EXPECT_EQ(surface.v_degree(), 3);
+  EXPECT_FALSE(surface.rational());
+
+  const std::vector<double> u_params =
+      Surface::SampleParams(u_interval, 17);
+  const std::vector<double> v_params =
+      Surface::SampleParams(v_interval, 13);
+  std::vector<Point3D> grid(u_params.size() * v_params.size());
+  surface.EvaluateGrid(u_params.data(), u_params.size(), v_params.data(),
+                       v_params.size(), grid.data());
+  for (size_t i = 0; i < u_params.size(); ++i) {
+    for (size_t j = 0; j < v_params.size(); ++j) {
+      const Point2D uv = {u_params[i], v_params[j]};
+      const Point3D point = surface.EvaluatePoint(uv);
+      const Point3D expected = from_curves.EvaluatePoint(uv);
+      EXPECT_EQ(point.x, expected.x);
+      EXPECT_EQ(point.y, expected.y);
+      EXPECT_EQ(point.z, expected.z);
+      const Point3D &grid_point = grid[(i * v_params.size()) + j];
+      EXPECT_NEAR(grid_point.x, point.x, 1e-14);
+      EXPECT_NEAR(grid_point.y, point.y, 1e-14);
+      EXPECT_NEAR(grid_point.z, point.z, 1e-14);
+    }
+  }
+}
+
+// A quarter cylinder of radius 2 around the z axis
+TEST(NURBS_Chapter1, BezierSurfaceRational) {
+  const double w = std::sqrt(0.5);
+  ControlNet<Point4D> net(std::vector<std::vector<Point4D>>{
+      {{2, 0, 0, 1}, {2, 0, 3, 1}},
+      {{2 * w, 2 * w, 0, w}, {2 * w, 2 * w, 3 * w, w}},
+      {{0, 2, 0, 1}, {0, 2, 3, 1}}});
+  const Point2D u_interval = {0.0, 2.0};
+  const BezierSurface surface(net, u_interval);
+  EXPECT_TRUE(surface.rational());
+  // The same patch as a NURBS surface
+  const NURBSSurface nurbs_surface(2, 1, {0, 0, 0, 2, 2, 2}, {0, 0, 1, 1},
+                                   net, u_interval);
+
+  const std::vector<double> u_params = Surface::SampleParams(u_interval, 9);
+  const std::vector<double> v_params = Surface::SampleParams({0, 1}, 5);
+  GridDerivatives grid;
+  surface.EvaluateGridDerivatives(u_params.data(), u_params.size(),
+                                  v_params.data(), v_params.size(), true,
+                                  grid);
+  GridDerivatives expected;
+  nurbs_surface.EvaluateGridDerivatives(u_params.data(), u_params.size(),
+                                        v_params.data(), v_params.size(),
+                                        true, expected);
+  for (size_t i = 0; i < u_params.size(); ++i) {
+    for (size_t j = 0; j < v_params.size(); ++j) {
+      const size_t index = (i * v_params.size()) + j;
+      const Point3D point = surface.EvaluatePoint({u_params[i], v_params[j]});
+      EXPECT_NEAR((point.x * point.x) + (point.y * point.y), 4.0, 1e-12);
+      EXPECT_NEAR(point.z, 3.0 * v_params[j], 1e-12);
+      EXPECT_NEAR(grid.points[index].x, point.x, 1e-12);
+      EXPECT_NEAR(grid.points[index].y, point.y, 1e-12);
+      EXPECT_NEAR(grid.points[index].z, point.z, 1e-12);
+      const std::vector<Point3D> *buffers[6] = {
+          &grid.points,      &grid.u_partials,  &grid.v_partials,
+          &grid.uu_partials, &grid.uv_partials, &grid.vv_partials};
+      const std::vector<Point3D> *expected_buffers[6] = {
+          &expected.points,      &expected.u_partials,
+          &expected.v_partials,  &expected.uu_partials,
+          &expected.uv_partials, &expected.vv_partials};
+      for (size_t b = 0; b < 6; ++b) {
+        const Point3D &value = (*buffers[b])[index];
+        const Point3D &other = (*expected_buffers[b])[index];
+        EXPECT_NEAR(value.x, other.x, 1e-12) << b;
+        EXPECT_NEAR(value.y, other.y, 1e-12) << b;
+        EXPECT_NEAR(value.z, other.z, 1e-12) << b;
+      }
+      // Outward from the axis
+      const Point3D &normal = grid.normals[index];
+      EXPECT_NEAR(normal.x, point.x * 0.5, 1e-12);
+      EXPECT_NEAR(normal.y, point.y * 0.5, 1e-12);
+      EXPECT_NEAR(normal.z, 0.0, 1e-12);
+    }
+  }
+}
+TEST(NURBS_Chapter1, BernsteinMatrixSegments) {
+  const std::vector<BezierCurve3D> segments = {
+      BezierCurve3D({{0, 0, 0}, {0, 1, 1}, {1, 1, 2}, {1, 0, 1}}),
+      BezierCurve3D({{1, 0, 1}, {1, -1, 0}, {2, -1, 3}, {2, 0, 1}}),
+      BezierCurve3D({{2, 0, 1}, {3, 2, -1}, {3, 1, 0}, {4, 0, 0}})};
+  std::vector<double> params(37);
+  for (size_t s = 0; s < params.size(); ++s) {
+    params[s] = static_cast<double>(s) / static_cast<double>(37 - 1);
+  }
+  const BernsteinMatrix matrix(3, params);
+  ASSERT_EQ(matrix.size(), params.size());
+
+  // Same A1.3 values and summation order as PointOnBezierCurve
+  const std::vector<Point3D> points = matrix.Evaluate(segments);
+  ASSERT_EQ(points.size(), segments.size() * params.size());
+  for (size_t k = 0; k < segments.size(); ++k) {
+    for (size_t s = 0; s < params.size(); ++s) {
+      const Point3D expected = segments[k].PointOnBezierCurve(params[s]);
+      const Point3D &point = points[(k * params.size()) + s];
+      EXPECT_DOUBLE_EQ(point.x, expected.x);
+      EXPECT_DOUBLE_EQ(point.y, expected.y);
+      EXPECT_DOUBLE_EQ(point.z, expected.z);
+    }
+  }
+
+  const std::vector<BezierCurve2D> segments_2d = {
+      BezierCurve2D({{0, 0}, {0, 1}, {1, 1}, {1, 0}}),
+      BezierCurve2D({{1, 0}, {1, -1}, {2, -1}, {2, 0}})};
+  const std::vector<Point2D> points_2d = matrix.Evaluate(segments_2d);
+  for (size_t k = 0; k < segments_2d.size(); ++k) {
+    for (size_t s = 0; s < params.size(); ++s) {
+      const Point2D expected = segments_2d[k].PointOnBezierCurve(params[s]);
+      const Point2D &point = points_2d[(k * params.size()) + s];
+      EXPECT_DOUBLE_EQ(point.x, expected.x);
+      EXPECT_DOUBLE_EQ(point.y, expected.y);
+    }
+  }
+
+  // Every segment has to match the degree of the matrix
+  const std::vector<BezierCurve3D> quadratic = {
+      BezierCurve3D({{0, 0, 0}, {1, 1, 1}, {2, 0, 0}})};
+  EXPECT_ANY_THROW(matrix.Evaluate(quadratic));
+}
+
+TEST(NURBS_Chapter1, BernsteinMatrixRational) {
+  // Unit circle as four rational quadratic quarters, (wx, wy, wz, w)
+  const double w = std::sqrt(0.5);
+  const std::vector<Point4D> control_points = {
+      {1, 0, 0, 1},  {w, w, 0, w},   {0, 1, 0, 1},  {0, 1, 0, 1},
+      {-w, w, 0, w}, {-1, 0, 0, 1},  {-1, 0, 0, 1}, {-w, -w, 0, w},
+      {0, -1, 0, 1}, {0, -1, 0, 1},  {w, -w, 0, w}, {1, 0, 0, 1}};
+  std::vector<double> params(33);
+  for (size_t s = 0; s < params.size(); ++s) {
+    params[s] = static_cast<double>(s) / static_cast<double>(33 - 1);
+  }
+  const BernsteinMatrix matrix(2, params);
+  std::vector<Point3D> points(4 * params.size());
+  matrix.Evaluate(control_points.data(), 4, points.data());
+  for (size_t k = 0; k < 4; ++k) {
+    for (size_t s = 0; s < params.size(); ++s) {
+      const Point3D &point = points[(k * params.size()) + s];
+      EXPECT_NEAR(std::hypot(point.x, point.y), 1.0, 1e-14);
+      EXPECT_DOUBLE_EQ(point.z, 0.0);
+    }
+    // The ends of the quarters are on the axes
+    const Point3D &start = points[k * params.size()];
+    EXPECT_NEAR(std::abs(start.x) + std::abs(start.y), 1.0, 1e-15);
+  }
+}
+TEST(NURBS_Chapter1, BezierPowerBasis) {
+  const std::vector<Point3D> control_points = {
+      {0, 0, 0}, {0, 1, 1}, {1, 1, 2}, {1, 0, 1}, {2, 0.5, 0}};
+  const BezierCurve3D bezier(control_points);
+  const std::vector<Point3D> coefficients =
+      BezierCurveUtil::PowerBasis(control_points);
+  ASSERT_EQ(coefficients.size(), control_points.size());
+  constexpr double div = 1.0 / 99.0;
+  for (uint32_t i = 0; i < 100; ++i) {
+    const double u = static_cast<double>(i) * div;
+    // Horner on the coefficients
+    Point3D point = coefficients.back();
+    for (size_t k = coefficients.size() - 1; k-- > 0;) {
+      point = (u * point) + coefficients[k];
+    }
+    const Point3D cast = bezier.DeCasteljau(u);
+    EXPECT_NEAR(point.x, cast.x, 1e-14);
+    EXPECT_NEAR(point.y, cast.y, 1e-14);
+    EXPECT_NEAR(point.z, cast.z, 1e-14);
+  }
+}
+
+TEST(NURBS_Chapter1, BezierStepCurvePoints) {
+  const BezierCurve3D bezier({{0, 0, 0}, {0, 1, 1}, {1, 1, 2}, {1, 0, 1}},
+                             {2.0, 5.0});
+  const BezierCurve2D bezier_2d({{0, 0}, {0, 1}, {1, 1}, {1, 0}});
+  constexpr uint32_t count = 5000;
+  const std::vector<Point3D> points = bezier.StepCurvePoints(count);
+  const std::vector<Point3D> expected = bezier.EvaluateCurvePoints(count);
+  const std::vector<Point2D> points_2d = bezier_2d.StepCurvePoints(count);
+  const std::vector<Point2D> expected_2d =
+      bezier_2d.EvaluateCurvePoints(count);
+  ASSERT_EQ(points.size(), count);
+  ASSERT_EQ(points_2d.size(), count);
+  for (uint32_t i = 0; i < count; ++i) {
+    EXPECT_NEAR(points[i].x, expected[i].x, 1e-14);
+    EXPECT_NEAR(points[i].y, expected[i].y, 1e-14);
+    EXPECT_NEAR(points[i].z, expected[i].z, 1e-14);
+    EXPECT_NEAR(points_2d[i].x, expected_2d[i].x, 1e-14);
+    EXPECT_NEAR(points_2d[i].y, expected_2d[i].y, 1e-14);
+  }
+}
 } // namespace nurbs
\ No newline at end of file
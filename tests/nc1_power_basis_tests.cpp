@@ -1,8 +1,15 @@
 #include <gtest/gtest.h>
 
 // NURBS_CPP
+#include "include/b_spline_curve.hpp"
+#include "include/forward_difference.hpp"
+#include "include/nurbs_curve.hpp"
 #include "include/power_basis_curve.hpp"
 
+// STD
+#include <algorithm>
+#include <cmath>
+
 namespace nurbs {
     TEST(NURBS_Chapter1, PowerBasis2DConstruct) {
         const std::vector<Point2D> bases;
@@ -83,4 +90,150 @@ namespace nurbs {
             EXPECT_DOUBLE_EQ(points[i].z, test_point.z);
         }
     }
+
+    TEST(NURBS_Chapter1, PowerBasis3DStepPoints) {
+        std::vector<Point3D> bases;
+        bases.push_back({ 1, -2, 0.5 });
+        bases.push_back({ 0.5, 2, -1 });
+        bases.push_back({ -3, 0.25, 2 });
+        bases.push_back({ 1, -1, 0.75 });
+        bases.push_back({ 0.5, 0.5, -0.25 });
+        const PowerBasisCurve3D power_basis(bases, { -1.0, 2.0 });
+
+        constexpr uint32_t count = 10001;
+        const std::vector<Point3D> points = power_basis.StepCurvePoints(count);
+        ASSERT_EQ(points.size(), count);
+        const double div = 3.0 / static_cast<double>(count - 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            const double u = -1.0 + (static_cast<double>(i) * div);
+            const Point3D test_point = power_basis.EvaluateCurve(u);
+
+            EXPECT_NEAR(points[i].x, test_point.x, 1e-12);
+            EXPECT_NEAR(points[i].y, test_point.y, 1e-12);
+            EXPECT_NEAR(points[i].z, test_point.z, 1e-12);
+        }
+    }
+
+    TEST(NURBS_Chapter1, ForwardDifferenceAnchoring) {
+        // A cubic stepped a million times, the error has to stay at the
+        // level of a few anchors rather than grow with the count
+        const double coefficients[] = { 0.3, -1.7, 2.9, -0.6 };
+        constexpr size_t count = 1000000;
+        const double step = 1.0 / static_cast<double>(count - 1);
+        std::vector<double> values(count);
+        forward::StepPolynomial(coefficients, 3, 0.0, step, count,
+                                values.data());
+        double max_error = 0.0;
+        for (size_t i = 0; i < count; i += 997) {
+            const double t = static_cast<double>(i) * step;
+            const double expected =
+                ((((coefficients[3] * t) + coefficients[2]) * t) +
+                 coefficients[1]) * t + coefficients[0];
+            max_error = std::max(max_error, std::abs(values[i] - expected));
+        }
+        EXPECT_LT(max_error, 1e-13);
+
+        // Every value is the polynomial exactly at the anchors
+        forward::StepPolynomial(coefficients, 3, 0.0, step, count,
+                                values.data(), 1, 1);
+        EXPECT_NEAR(values[count - 1], 0.3 - 1.7 + 2.9 - 0.6, 1e-15);
+    }
+
+    TEST(NURBS_Chapter1, PiecewisePowerBasisBSpline) {
+        // Repeated interior knots, so A5.6 inserts a different number of
+        // knots at each breakpoint
+        const uint32_t degree = 3;
+        const std::vector<double> knots = { 0, 0, 0, 0, 0.5, 1, 1, 2,
+                                            3, 3, 3, 4, 4, 4, 4 };
+        std::vector<Point3D> control_points;
+        for (size_t i = 0; i + degree + 1 < knots.size(); ++i) {
+            const double x = static_cast<double>(i);
+            control_points.push_back({ x, std::sin(x), std::cos(x) * x });
+        }
+        const BSplineCurve3D curve(degree, control_points, knots, { 0.0, 4.0 });
+        const PiecewisePowerBasisCurve3D compiled = curve.ToPowerBasis();
+        EXPECT_FALSE(compiled.rational());
+        EXPECT_EQ(compiled.degree(), degree);
+        ASSERT_EQ(compiled.span_count(), 5);
+        EXPECT_EQ(compiled.coefficients().size(), 5 * (degree + 1) * 3);
+        EXPECT_EQ(compiled.Breakpoints(), curve.Breakpoints());
+
+        constexpr uint32_t count = 1001;
+        std::vector<double> params(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            params[i] = 4.0 * static_cast<double>(i) /
+                        static_cast<double>(count - 1);
+        }
+        std::vector<Point3D> batch(count);
+        compiled.EvaluateCurveBatch(params.data(), count, batch.data());
+        for (uint32_t i = 0; i < count; ++i) {
+            const Point3D expected = curve.EvaluateCurve(params[i]);
+            const Point3D point = compiled.EvaluateCurve(params[i]);
+            EXPECT_NEAR(point.x, expected.x, 1e-12);
+            EXPECT_NEAR(point.y, expected.y, 1e-12);
+            EXPECT_NEAR(point.z, expected.z, 1e-12);
+            EXPECT_EQ(batch[i].x, point.x);
+            EXPECT_EQ(batch[i].y, point.y);
+            EXPECT_EQ(batch[i].z, point.z);
+        }
+
+        std::vector<Point2D> control_points_2d;
+        for (const Point3D &point : control_points) {
+            control_points_2d.push_back({ point.x, point.y });
+        }
+        const BSplineCurve2D curve_2d(degree, control_points_2d, knots,
+                                      { 0.0, 4.0 });
+        const PiecewisePowerBasisCurve2D compiled_2d = curve_2d.ToPowerBasis();
+        for (double u : params) {
+            const Point2D expected = curve_2d.EvaluateCurve(u);
+            const Point2D point = compiled_2d.EvaluateCurve(u);
+            EXPECT_NEAR(point.x, expected.x, 1e-12);
+            EXPECT_NEAR(point.y, expected.y, 1e-12);
+        }
+    }
+
+    TEST(NURBS_Chapter1, PiecewisePowerBasisNURBS) {
+        // Unit circle from nine homogeneous points
+        const double w = std::sqrt(0.5);
+        const std::vector<Point4D> control_points = {
+            { 1, 0, 0, 1 },   { w, w, 0, w },   { 0, 1, 0, 1 },
+            { -w, w, 0, w },  { -1, 0, 0, 1 },  { -w, -w, 0, w },
+            { 0, -1, 0, 1 },  { w, -w, 0, w },  { 1, 0, 0, 1 } };
+        const std::vector<double> knots = { 0, 0, 0, 1, 1, 2,
+                                            2, 3, 3, 4, 4, 4 };
+        const NURBSCurve3D circle(2, control_points, knots, { 0.0, 4.0 });
+        const PiecewisePowerBasisCurve3D compiled = circle.ToPowerBasis();
+        EXPECT_TRUE(compiled.rational());
+        ASSERT_EQ(compiled.span_count(), 4);
+        EXPECT_EQ(compiled.coefficients().size(), 4 * 3 * 4);
+        for (uint32_t i = 0; i <= 400; ++i) {
+            const double u = static_cast<double>(i) / 100.0;
+            const Point3D expected = circle.EvaluateCurve(u);
+            const Point3D point = compiled.EvaluateCurve(u);
+            EXPECT_NEAR(std::hypot(point.x, point.y), 1.0, 1e-14);
+            EXPECT_NEAR(point.x, expected.x, 1e-14);
+            EXPECT_NEAR(point.y, expected.y, 1e-14);
+            EXPECT_EQ(point.z, 0.0);
+        }
+        // Outside the interval clamps like the spline
+        const Point3D before = compiled.EvaluateCurve(-1.0);
+        EXPECT_NEAR(before.x, 1.0, 1e-15);
+        EXPECT_NEAR(before.y, 0.0, 1e-15);
+
+        std::vector<Point3D> control_points_2d;
+        for (const Point4D &point : control_points) {
+            control_points_2d.push_back({ point.x, point.y, point.w });
+        }
+        const NURBSCurve2D circle_2d(2, control_points_2d, knots,
+                                     { 0.0, 4.0 });
+        const PiecewisePowerBasisCurve2D compiled_2d = circle_2d.ToPowerBasis();
+        for (uint32_t i = 0; i <= 400; ++i) {
+            const double u = static_cast<double>(i) / 100.0;
+            const Point2D point = compiled_2d.EvaluateCurve(u);
+            EXPECT_NEAR(std::hypot(point.x, point.y), 1.0, 1e-14);
+        }
+
+        EXPECT_ANY_THROW(PiecewisePowerBasisCurve3D(2, { 0.0, 1.0 },
+                                                    { 1.0, 2.0 }, false));
+    }
 }
\ No newline at end of file
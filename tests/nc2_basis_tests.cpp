@@ -1,8 +1,14 @@
 #include <gtest/gtest.h>
 
 // NURBS_CPP
+#include "include/basis_table.hpp"
 #include "include/derived_knot_funcs.hpp"
+#include "include/fixed_degree_basis.hpp"
 #include "include/knot_utility_functions.hpp"
+#include "include/span_locator.hpp"
+
+// STD
+#include <cmath>
 
 constexpr bool PRINT_DEBUG_INFO = false;
 constexpr double kTolerance = std::numeric_limits<double>::epsilon();
@@ -62,6 +68,78 @@ TEST(NURBS_Chapter2, FindSpanParamMax) {
   EXPECT_EQ(ret, 3);
 }
 
+// Every knot, the values a tolerance either side of it, the midpoints and
+// parameters outside the knot vector
+void ExpectLocatorMatchesSearch(uint32_t degree,
+                                const std::vector<double> &knots,
+                                double tolerance) {
+  const SpanLocator locator(degree, knots, tolerance);
+  std::vector<double> params = {knots.front() - 1.0, knots.back() + 1.0};
+  for (size_t i = 0; i < knots.size(); ++i) {
+    params.push_back(knots[i]);
+    params.push_back(knots[i] - tolerance);
+    params.push_back(knots[i] + tolerance);
+    params.push_back(std::nextafter(knots[i] - tolerance, -1e300));
+    params.push_back(std::nextafter(knots[i] - tolerance, 1e300));
+    if (i + 1 < knots.size()) {
+      params.push_back(0.5 * (knots[i] + knots[i + 1]));
+    }
+  }
+  for (int i = 0; i <= 1000; ++i) {
+    params.push_back(knots.front() +
+                     ((knots.back() - knots.front()) * i / 1000.0));
+  }
+  for (double u : params) {
+    EXPECT_EQ(locator.Find(u), FindSpanParam(degree, knots, u, tolerance))
+        << "u = " << u;
+  }
+}
+
+TEST(NURBS_Chapter2, SpanLocatorUniform) {
+  const std::vector<double> knots = {0, 0, 0, 0,   0.2, 0.4,
+                                     0.6, 0.8, 1, 1, 1,   1};
+  EXPECT_EQ(SpanLocator(3, knots, kTolerance).kind(),
+            SpanLocator::Kind::kUniform);
+  ExpectLocatorMatchesSearch(3, knots, kTolerance);
+  ExpectLocatorMatchesSearch(3, knots, 1e-3);
+
+  std::vector<double> long_knots(3, -5.0);
+  for (int i = 0; i <= 1000; ++i) {
+    long_knots.push_back(-5.0 + (i * 0.01));
+  }
+  long_knots.insert(long_knots.end(), 3, long_knots.back());
+  EXPECT_EQ(SpanLocator(3, long_knots, kTolerance).kind(),
+            SpanLocator::Kind::kUniform);
+  ExpectLocatorMatchesSearch(3, long_knots, kTolerance);
+}
+
+TEST(NURBS_Chapter2, SpanLocatorRepeatedKnots) {
+  const std::vector<double> knots = {0, 0, 0, 1, 2, 2, 2};
+  ExpectLocatorMatchesSearch(2, knots, kTolerance);
+  const std::vector<double> repeated = {0, 0, 0, 0.25, 0.25, 0.5,
+                                        0.5, 0.5, 0.75, 1, 1, 1};
+  EXPECT_EQ(SpanLocator(2, repeated, kTolerance).kind(),
+            SpanLocator::Kind::kBucketed);
+  ExpectLocatorMatchesSearch(2, repeated, kTolerance);
+  ExpectLocatorMatchesSearch(2, repeated, 0.01);
+  // Unclamped, the end conditions use knots[degree] and knots[n + 1]
+  const std::vector<double> unclamped = {0, 1, 2, 3, 3, 4, 5, 6, 7};
+  ExpectLocatorMatchesSearch(3, unclamped, kTolerance);
+}
+
+TEST(NURBS_Chapter2, SpanLocatorClusteredKnots) {
+  std::vector<double> knots(4, 0.0);
+  for (int i = 1; i < 200; ++i) {
+    knots.push_back(std::pow(i / 200.0, 6.0));
+  }
+  knots.insert(knots.end(), 4, 1.0);
+  EXPECT_EQ(SpanLocator(3, knots, kTolerance).kind(),
+            SpanLocator::Kind::kBucketed);
+  ExpectLocatorMatchesSearch(3, knots, kTolerance);
+  ExpectLocatorMatchesSearch(0, {0, 0.1, 0.11, 0.5, 1}, 0.0);
+  ExpectLocatorMatchesSearch(1, {2, 2, 2, 2}, kTolerance);
+}
+
 TEST(NURBS_Chapter2, FindStartKnot) {
   constexpr uint32_t degree = 3;
   const std::vector<uint32_t> knots = {0, 0, 0, 0, 1, 2, 2,
@@ -303,6 +381,124 @@ TEST(NURBS_Chapter2, BasisMaxCompare) {
   EXPECT_DOUBLE_EQ(bases_0[2], bases_1[2]);
 }
 
+TEST(NURBS_Chapter2, BasisScratchCompare) {
+  const std::vector<double> knots = {0, 0, 0, 0, 1, 2, 3, 3, 4, 4, 4, 4};
+  constexpr uint32_t degree = 3;
+  BasisScratch scratch;
+  std::vector<double> bases(degree + 1);
+  for (int32_t i = 0; i <= 40; ++i) {
+    const double u_value = static_cast<double>(i) * 0.1;
+    uint32_t span_index = FindSpanParam(degree, knots, u_value, kTolerance);
+    std::vector<double> expected =
+        BasisFuns(span_index, u_value, degree, knots, kTolerance);
+    BasisFuns(span_index, u_value, degree, knots, kTolerance, bases.data(),
+              scratch);
+    for (uint32_t j = 0; j <= degree; ++j) {
+      EXPECT_EQ(expected[j], bases[j]);
+    }
+  }
+}
+
+TEST(NURBS_Chapter2, BasisScratchReuseAcrossDegrees) {
+  // A scratch sized for a high degree must still give the same values when
+  // reused for a lower degree, and vice versa
+  const std::vector<double> knots_2 = {0, 0, 0, 1, 2, 3, 4, 4, 5, 5, 5};
+  const std::vector<double> knots_4 = {0, 0, 0, 0, 0, 1, 2, 3,
+                                       3, 4, 4, 4, 4, 4};
+  BasisScratch scratch;
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t degree : {4u, 2u}) {
+      const std::vector<double> &knots = degree == 2 ? knots_2 : knots_4;
+      const double u_value = 2.5;
+      uint32_t span_index = FindSpanParam(degree, knots, u_value, kTolerance);
+      scratch.Reserve(degree, 2);
+      DersBasisFuns(span_index, u_value, degree, 2, knots,
+                    scratch.ders.data(), scratch);
+      std::vector<std::vector<double>> expected =
+          DersBasisFuns(span_index, u_value, degree, 2, knots);
+      for (uint32_t k = 0; k <= 2; ++k) {
+        for (uint32_t j = 0; j <= degree; ++j) {
+          EXPECT_EQ(expected[k][j], scratch.ders[(k * (degree + 1)) + j]);
+        }
+      }
+    }
+  }
+}
+
+TEST(NURBS_Chapter2, AllBasisScratchCompare) {
+  const std::vector<double> knots = {0, 0, 0, 0, 1, 2, 3, 3, 4, 4, 4, 4};
+  constexpr uint32_t degree = 3;
+  // Dirty the scratch with a larger degree first
+  BasisScratch scratch;
+  std::vector<double> dirty(36);
+  AllBasisFuns(5, 1.5, 5, {0, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2}, dirty.data(),
+               scratch);
+  std::vector<double> bases((degree + 1) * (degree + 1));
+  for (int32_t i = 0; i <= 40; ++i) {
+    const double u_value = static_cast<double>(i) * 0.1;
+    uint32_t span_index = FindSpanParam(degree, knots, u_value, kTolerance);
+    std::vector<std::vector<double>> expected =
+        AllBasisFuns(span_index, u_value, degree, knots);
+    AllBasisFuns(span_index, u_value, degree, knots, bases.data(), scratch);
+    for (uint32_t j = 0; j <= degree; ++j) {
+      for (uint32_t k = 0; k <= degree; ++k) {
+        // AllBasisFuns divides by zero width spans at the ends, the
+        // scratch version has to match it there as well
+        const double value = bases[(j * (degree + 1)) + k];
+        if (std::isnan(expected[j][k])) {
+          EXPECT_TRUE(std::isnan(value));
+        } else {
+          EXPECT_EQ(expected[j][k], value);
+        }
+      }
+    }
+  }
+}
+
+template <uint32_t P> void CompareFixedDegreeBasis() {
+  // Clamped knot vector with a repeated interior knot
+  std::vector<double> knots(P + 1, 0.0);
+  for (double knot : {1.0, 2.0, 2.0, 3.0, 4.0}) {
+    knots.push_back(knot);
+  }
+  knots.insert(knots.end(), P + 1, 5.0);
+  BasisScratch scratch;
+  std::vector<double> expected(P + 1);
+  std::array<double, P + 1> bases;
+  for (int32_t i = 0; i <= 50; ++i) {
+    const double u_value = static_cast<double>(i) * 0.1;
+    uint32_t span_index = FindSpanParam(P, knots, u_value, kTolerance);
+    BasisFuns(span_index, u_value, P, knots, kTolerance, expected.data(),
+              scratch);
+    BasisFuns<P>(span_index, u_value, knots, kTolerance, bases);
+    for (uint32_t j = 0; j <= P; ++j) {
+      EXPECT_EQ(expected[j], bases[j]) << "degree " << P << " u " << u_value;
+    }
+  }
+}
+
+TEST(NURBS_Chapter2, FixedDegreeBasisCompare) {
+  CompareFixedDegreeBasis<1>();
+  CompareFixedDegreeBasis<2>();
+  CompareFixedDegreeBasis<3>();
+  CompareFixedDegreeBasis<4>();
+  CompareFixedDegreeBasis<5>();
+}
+
+TEST(NURBS_Chapter2, FixedDegreeDispatch) {
+  for (uint32_t degree = 0; degree <= kMaxFixedDegree + 2; ++degree) {
+    uint32_t dispatched = 0;
+    bool fixed = DispatchDegree(
+        degree, [&](auto p) { dispatched = decltype(p)::value; });
+    if (degree >= 1 && degree <= kMaxFixedDegree) {
+      EXPECT_TRUE(fixed);
+      EXPECT_EQ(dispatched, degree);
+    } else {
+      EXPECT_FALSE(fixed);
+    }
+  }
+}
+
 // Basis derivative tests
 TEST(NURBS_Chapter2, BasisEx2_4) {
   
@@ -1247,5 +1443,71 @@ TEST(NURBS_Chapter2, SingleBasisDerivativeMaxCompare) {
   EXPECT_DOUBLE_EQ(bases_0[1], bases_1[1]);
   EXPECT_DOUBLE_EQ(bases_0[2], bases_1[2]);
 }
+
+TEST(NURBS_Chapter2, BasisTableDerivatives) {
+  const std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4};
+  constexpr uint32_t degree = 3;
+  // Unsorted, with the ends and a repeated knot
+  const std::vector<double> params = {0.0, 2.0, 0.3, 3.9, 4.0, 1.5, 2.0};
+  BasisTable table(degree, knots, params.data(), params.size(), kTolerance,
+                   2);
+  ASSERT_EQ(table.derivatives(), 2);
+  for (size_t s = 0; s < params.size(); ++s) {
+    const uint32_t span = FindSpanParam(degree, knots, params[s], kTolerance);
+    EXPECT_EQ(table.span(s), span);
+    std::vector<double> bases =
+        BasisFuns(span, params[s], degree, knots, kTolerance);
+    std::vector<std::vector<double>> ders =
+        DersBasisFuns(span, params[s], degree, 2, knots);
+    for (uint32_t i = 0; i <= degree; ++i) {
+      EXPECT_EQ(table.value(i, s), bases[i]);
+      EXPECT_EQ(table.derivative(0, i, s), bases[i]);
+      EXPECT_EQ(table.derivatives(1, i)[s], ders[1][i]);
+      EXPECT_EQ(table.derivative(2, i, s), ders[2][i]);
+    }
+  }
+  // Orders above the degree are zero and are not stored
+  table.Build(1, {0, 0, 1, 1}, params.data(), 2, kTolerance, 3);
+  EXPECT_EQ(table.derivatives(), 1);
+  EXPECT_EQ(table.derivative(1, 0, 0), -1.0);
+}
+
+TEST(NURBS_Chapter2, BasisTableCache) {
+  const std::vector<double> knots = {0, 0, 0, 1, 2, 3, 3, 3};
+  const std::vector<double> params = {0.5, 1.5, 2.5};
+  const std::vector<double> other_params = {0.5, 1.5, 2.6};
+  BasisTableCache cache(2);
+  auto first = cache.Get(2, knots, params.data(), params.size(), kTolerance);
+  auto again = cache.Get(2, knots, params.data(), params.size(), kTolerance);
+  EXPECT_EQ(first, again);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+  EXPECT_EQ(first->span(2), 4);
+
+  // Anything that changes the table is a different entry
+  auto other = cache.Get(2, knots, other_params.data(), other_params.size(),
+                         kTolerance);
+  EXPECT_NE(other, first);
+  auto derivs =
+      cache.Get(2, knots, params.data(), params.size(), kTolerance, 1);
+  EXPECT_NE(derivs, first);
+  EXPECT_EQ(derivs->derivatives(), 1);
+  EXPECT_EQ(cache.misses(), 3);
+  EXPECT_EQ(cache.size(), 2);
+
+  // first was the least recently used, it was evicted but is still usable
+  auto rebuilt = cache.Get(2, knots, params.data(), params.size(), kTolerance);
+  EXPECT_NE(rebuilt, first);
+  EXPECT_EQ(rebuilt->value(1, 0), first->value(1, 0));
+  EXPECT_EQ(cache.misses(), 4);
+  // other was evicted by rebuilt, derivs is still there
+  cache.Get(2, knots, params.data(), params.size(), kTolerance, 1);
+  EXPECT_EQ(cache.hits(), 2);
+
+  cache.capacity(0);
+  EXPECT_EQ(cache.size(), 0);
+  cache.Get(2, knots, params.data(), params.size(), kTolerance);
+  EXPECT_EQ(cache.size(), 0);
+}
 } // namespace knots
-} // namespace nurbs
\ No newline at end of file
+} // namespace nurbs
@@ -3,11 +3,18 @@
 // NURBS_CPP
 #include "include/b_spline_curve.hpp"
 #include "include/b_spline_surface.hpp"
+#include "include/basis_table.hpp"
 #include "include/bezier_curve.hpp"
 #include "include/bezier_surface.hpp"
+#include "include/control_net.hpp"
+#include "include/forward_difference.hpp"
+#include "include/grid_kernels.hpp"
 #include "include/knot_utility_functions.hpp"
+#include "include/uniform_cubic.hpp"
 
 // STD
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 constexpr double kTolerance = std::numeric_limits<double>::epsilon();
@@ -381,6 +388,132 @@ TEST(NURBS_Chapter3, BSplineCurveDerivCompare3D) {
 
 // TODO - Add more tests for B-Spline Curve Derivatives
 
+// Degrees 1-5 take the fixed degree path, 6 and 7 the generic one. Both must
+// match the runtime kernels exactly.
+TEST(NURBS_Chapter3, BSplineCurveFixedDegreeCompare) {
+  for (uint32_t degree = 1; degree <= 7; ++degree) {
+    std::vector<double> knots(degree + 1, 0.0);
+    for (double knot : {0.5, 1.0, 1.0, 1.5}) {
+      knots.push_back(knot);
+    }
+    knots.insert(knots.end(), degree + 1, 2.0);
+    std::vector<Point3D> control_points;
+    for (size_t i = 0; i < knots.size() - degree - 1; ++i) {
+      double x = static_cast<double>(i);
+      control_points.push_back({x, std::sin(x), std::cos(x) * 0.5});
+    }
+    BSplineCurve3D b_spline(degree, control_points, knots, {0, 2});
+    std::vector<double> bases(degree + 1);
+    double div = 2.0 / 99.0;
+    for (int32_t i = 0; i < 100; ++i) {
+      double location = static_cast<double>(i) * div;
+      uint32_t span =
+          knots::FindSpanParam(degree, knots, location, kTolerance);
+      knots::BasisFuns(span, location, degree, knots, kTolerance,
+                       bases.data(), knots::ThreadScratch());
+      Point3D expected;
+      for (uint32_t j = 0; j <= degree; ++j) {
+        expected += bases[j] * control_points[span - degree + j];
+      }
+      Point3D point = b_spline.EvaluateCurve(location);
+      EXPECT_EQ(expected.x, point.x) << "degree " << degree;
+      EXPECT_EQ(expected.y, point.y) << "degree " << degree;
+      EXPECT_EQ(expected.z, point.z) << "degree " << degree;
+    }
+  }
+}
+
+// Degree 2 takes the fixed degree path and 6 the generic one
+TEST(NURBS_Chapter3, BSplineCurveBatch2D) {
+  for (uint32_t degree : {2u, 6u}) {
+    std::vector<double> knots(degree + 1, 0.0);
+    for (double knot : {0.5, 1.0, 1.0, 1.5, 1.75}) {
+      knots.push_back(knot);
+    }
+    knots.insert(knots.end(), degree + 1, 2.0);
+    std::vector<Point2D> control_points;
+    for (size_t i = 0; i < knots.size() - degree - 1; ++i) {
+      double x = static_cast<double>(i);
+      control_points.push_back({x, std::sin(x)});
+    }
+    BSplineCurve2D b_spline(degree, control_points, knots, {0, 2});
+    std::vector<double> params;
+    for (int32_t i = -2; i <= 42; ++i) {
+      params.push_back(static_cast<double>(i) * 0.05);
+    }
+    for (double param : {1.0, 0.25, 1.75, 1.75, 0.0, 2.0, 0.5}) {
+      params.push_back(param);
+    }
+    std::vector<Point2D> points(params.size());
+    b_spline.EvaluateCurveBatch(params.data(), params.size(), points.data());
+    for (size_t i = 0; i < params.size(); ++i) {
+      Point2D expected = b_spline.EvaluateCurve(params[i]);
+      EXPECT_EQ(expected.x, points[i].x) << "degree " << degree;
+      EXPECT_EQ(expected.y, points[i].y) << "degree " << degree;
+    }
+    std::vector<Point2D> sampled = b_spline.EvaluateCurvePoints(100);
+    for (size_t i = 0; i < sampled.size(); ++i) {
+      Point2D expected =
+          b_spline.EvaluateCurve(static_cast<double>(i) * (2.0 / 99.0));
+      EXPECT_EQ(expected.x, sampled[i].x) << "degree " << degree;
+      EXPECT_EQ(expected.y, sampled[i].y) << "degree " << degree;
+    }
+  }
+}
+
+TEST(NURBS_Chapter3, ControlNetLayout) {
+  std::vector<std::vector<Point4D>> points(5, std::vector<Point4D>(7));
+  for (size_t u = 0; u < points.size(); ++u) {
+    for (size_t v = 0; v < points[u].size(); ++v) {
+      double x = static_cast<double>(u * 10 + v);
+      points[u][v] = {x, -x, x * 0.5, 1.0 + x};
+    }
+  }
+  ControlNet<Point4D> net(points);
+  ASSERT_EQ(net.rows(), 5);
+  ASSERT_EQ(net.cols(), 7);
+  ASSERT_EQ(net.size(), 5);
+  EXPECT_EQ(net.stride() % ControlNet<Point4D>::kRowAlignment, 0);
+  for (uint32_t c = 0; c < ControlNet<Point4D>::kDimension; ++c) {
+    for (size_t u = 0; u < net.rows(); ++u) {
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(net.plane(c) + net.Index(u, 0)) %
+                    32,
+                0);
+    }
+  }
+  const ControlNet<Point4D> &const_net = net;
+  for (size_t u = 0; u < net.rows(); ++u) {
+    ASSERT_EQ(net[u].size(), 7);
+    for (size_t v = 0; v < net.cols(); ++v) {
+      EXPECT_EQ(const_net[u][v].x, points[u][v].x);
+      EXPECT_EQ(const_net.row(u)[v].y, points[u][v].y);
+      EXPECT_EQ(const_net.column(v)[u].z, points[u][v].z);
+      EXPECT_EQ(net(u, v).w, points[u][v].w);
+      EXPECT_EQ(net.plane(3)[net.Index(u, v)], points[u][v].w);
+    }
+  }
+
+  // Writes through the views and the row and column helpers
+  net[1][2] = Point4D(1, 2, 3, 4);
+  net.column(3)[4] = net[1][2];
+  EXPECT_EQ(net(4, 3).z, 3);
+  double alpha = 0.3;
+  Point4D expected = (alpha * points[2][5]) + ((1.0 - alpha) * points[3][5]);
+  net.BlendRows(0, alpha, 2, 3);
+  EXPECT_EQ(net(0, 5).x, expected.x);
+  EXPECT_EQ(net(0, 5).w, expected.w);
+  expected = (alpha * points[4][6]) + ((1.0 - alpha) * points[4][1]);
+  net.BlendColumns(0, alpha, 6, 1);
+  EXPECT_EQ(net(4, 0).y, expected.y);
+  EXPECT_EQ(net(4, 0).z, expected.z);
+  net.CopyRow(0, ControlNet<Point4D>(points), 2);
+  net.CopyColumn(6, ControlNet<Point4D>(points), 0);
+  std::vector<std::vector<Point4D>> round_trip = net.ToVector();
+  EXPECT_EQ(round_trip[0][4].x, points[2][4].x);
+  EXPECT_EQ(round_trip[3][6].w, points[3][0].w);
+  EXPECT_EQ(round_trip[2][2].y, points[2][2].y);
+}
+
 TEST(NURBS_Chapter3, BSplineSurfaceConstruct) {
   uint32_t degree = 3;
   std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 2, 2, 2};
@@ -461,6 +594,43 @@ TEST(NURBS_Chapter3, BSplineSurfaceBezierCompare) {
   }
 }
 
+// Surface::Derivatives falls back to central differences on EvaluatePoint
+TEST(NURBS_Chapter3, SurfaceDefaultDerivatives) {
+  std::vector<std::vector<Point3D>> control_points = {
+      {{-0.87, 0, -0.87}, {-0.33, 0.1, -1.33}, {0.33, 0.1, -1.33}},
+      {{-1.33, -0.25, -0.33}, {-0.33, 0, -0.33}, {0.33, 0.0, -0.33}},
+      {{-1.33, -0.75, 0.33}, {-0.33, 0.0, 0.33}, {0.33, 0.0, 0.33}},
+      {{-0.87, -2, 0.87}, {-0.33, 0.0, 1.33}, {0.33, 0.0, 1.33}},
+  };
+  BSplineSurface bspl_surface(3, 2, {0, 0, 0, 0, 1, 1, 1, 1},
+                              {0, 0, 0, 1, 1, 1}, control_points);
+  // BezierSurface runs its curves along u
+  std::vector<BezierCurve3D> columns;
+  for (size_t v = 0; v < 3; ++v) {
+    columns.emplace_back(std::vector<Point3D>{
+        control_points[0][v], control_points[1][v], control_points[2][v],
+        control_points[3][v]});
+  }
+  BezierSurface bez_surface(columns);
+  for (Point2D uv : {Point2D{0.0, 0.0}, Point2D{0.3, 0.7}, Point2D{1.0, 0.5},
+                     Point2D{0.5, 1.0}}) {
+    std::vector<std::vector<Point3D>> expected =
+        bspl_surface.Derivatives(uv, 1);
+    std::vector<std::vector<Point3D>> derivs = bez_surface.Derivatives(uv, 1);
+    EXPECT_NEAR(derivs[0][0].x, expected[0][0].x, 1e-12);
+    EXPECT_NEAR(derivs[0][0].y, expected[0][0].y, 1e-12);
+    EXPECT_NEAR(derivs[0][0].z, expected[0][0].z, 1e-12);
+    for (Point2D kl : {Point2D{1, 0}, Point2D{0, 1}}) {
+      const Point3D &d = derivs[kl.x][kl.y];
+      const Point3D &e = expected[kl.x][kl.y];
+      // One sided at the ends of the intervals
+      EXPECT_NEAR(d.x, e.x, 1e-5);
+      EXPECT_NEAR(d.y, e.y, 1e-5);
+      EXPECT_NEAR(d.z, e.z, 1e-5);
+    }
+  }
+}
+
 TEST(NURBS_Chapter3, BSplineSurfacePoints) {
   Point2D interval = {0, 4};
   uint32_t u_degree = 4;
@@ -515,6 +685,72 @@ TEST(NURBS_Chapter3, BSplineSurfacePoints) {
   }
 }
 
+TEST(NURBS_Chapter3, BSplineSurfaceGrid) {
+  Point2D interval = {0, 4};
+  uint32_t u_degree = 4;
+  uint32_t v_degree = 3;
+  std::vector<double> u_knots = {0, 0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 1, 2, 3, 3, 4, 4, 4, 4};
+  size_t u_points = u_knots.size() - u_degree - 1;
+  size_t v_points = v_knots.size() - v_degree - 1;
+  std::vector<std::vector<Point3D>> control_points(u_points);
+  for (size_t u_index = 0; u_index < u_points; ++u_index) {
+    for (size_t v_index = 0; v_index < v_points; ++v_index) {
+      double u_val = static_cast<double>(u_index);
+      double v_val = static_cast<double>(v_index);
+      control_points[u_index].push_back(
+          {u_val, v_val, std::sin(u_val) * std::cos(v_val)});
+    }
+  }
+  BSplineSurface b_spline_surface(u_degree, v_degree, u_knots, v_knots,
+                                  control_points, interval, interval);
+
+  // Sample counts that leave a remainder for every vector width
+  const uint32_t u_count = 37;
+  const uint32_t v_count = 53;
+  const double u_div = 4.0 / static_cast<double>(u_count - 1);
+  const double v_div = 4.0 / static_cast<double>(v_count - 1);
+  // Every kernel has to give the same bits as EvaluatePoint
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    std::vector<Point3D> points =
+        b_spline_surface.EvaluatePoints(u_count, v_count);
+    ASSERT_EQ(points.size(), u_count * v_count);
+    for (uint32_t i = 0; i < u_count; ++i) {
+      Point2D location = {static_cast<double>(i) * u_div, 0};
+      for (uint32_t j = 0; j < v_count; ++j) {
+        location.y = static_cast<double>(j) * v_div;
+        Point3D expected = b_spline_surface.EvaluatePoint(location);
+        Point3D point = points[(i * v_count) + j];
+        EXPECT_EQ(point.x, expected.x) << simd::Name(simd::Active());
+        EXPECT_EQ(point.y, expected.y) << simd::Name(simd::Active());
+        EXPECT_EQ(point.z, expected.z) << simd::Name(simd::Active());
+      }
+    }
+
+    // Unsorted parameters take the gather paths
+    std::vector<double> u_params = {3.5, 0.25, 4.0, 1.0, 2.0};
+    std::vector<double> v_params = {0.1, 3.9, 1.0, 2.5, 0.0, 4.0, 1.7,
+                                    0.6, 3.0, 2.2, 1.1, 0.9, 3.3};
+    std::vector<Point3D> grid(u_params.size() * v_params.size());
+    b_spline_surface.EvaluateGrid(u_params.data(), u_params.size(),
+                                  v_params.data(), v_params.size(),
+                                  grid.data());
+    for (size_t i = 0; i < u_params.size(); ++i) {
+      for (size_t j = 0; j < v_params.size(); ++j) {
+        Point3D expected =
+            b_spline_surface.EvaluatePoint({u_params[i], v_params[j]});
+        Point3D point = grid[(i * v_params.size()) + j];
+        EXPECT_EQ(point.x, expected.x) << simd::Name(simd::Active());
+        EXPECT_EQ(point.y, expected.y) << simd::Name(simd::Active());
+        EXPECT_EQ(point.z, expected.z) << simd::Name(simd::Active());
+      }
+    }
+  }
+  simd::SetActive(simd::Supported());
+}
+
 // TODO - Add more tests for B-Spline Curve Derivatives
 TEST(NURBS_Chapter3, DISABLED_BSplineSurfaceDerivCompare) {
   std::vector<std::vector<Point3D>> control_polygon = {
@@ -569,4 +805,257 @@ TEST(NURBS_Chapter3, DISABLED_BSplineSurfaceDerivCompare) {
   }
   EXPECT_EQ(errors, 0);
 }
+TEST(NURBS_Chapter3, BSplineStepCurvePoints) {
+  // Repeated interior knots, samples land on and next to them
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 0.5, 1, 1, 2, 3, 3, 3, 4, 4, 4, 4};
+  std::vector<Point3D> control_points;
+  for (size_t i = 0; i + degree + 1 < knots.size(); ++i) {
+    double x = static_cast<double>(i);
+    control_points.push_back({x, std::sin(x), std::cos(x) * x});
+  }
+  BSplineCurve3D curve(degree, control_points, knots, {0.0, 4.0});
+  for (uint32_t count : {2u, 9u, 97u, 4001u}) {
+    std::vector<Point3D> points = curve.StepCurvePoints(count);
+    std::vector<Point3D> expected = curve.EvaluateCurvePoints(count);
+    ASSERT_EQ(points.size(), count);
+    for (uint32_t i = 0; i < count; ++i) {
+      EXPECT_NEAR(points[i].x, expected[i].x, 1e-12);
+      EXPECT_NEAR(points[i].y, expected[i].y, 1e-12);
+      EXPECT_NEAR(points[i].z, expected[i].z, 1e-12);
+    }
+  }
+
+  // The plan on its own, with short chunks that are summed directly next to
+  // stepped ones
+  for (uint32_t count : {9u, 61u}) {
+    forward::SplineStepPlan plan(degree, knots, {0.0, 4.0}, count,
+                                 BSplineCurve3D::kTolerance);
+    std::vector<Point3D> points =
+        forward::StepCurve<Point3D>(plan, control_points, false);
+    std::vector<Point3D> expected = curve.EvaluateCurvePoints(count);
+    ASSERT_EQ(points.size(), count);
+    for (uint32_t i = 0; i < count; ++i) {
+      EXPECT_NEAR(points[i].x, expected[i].x, 1e-12);
+      EXPECT_NEAR(points[i].y, expected[i].y, 1e-12);
+      EXPECT_NEAR(points[i].z, expected[i].z, 1e-12);
+    }
+  }
+
+  std::vector<Point2D> control_points_2d;
+  for (const Point3D &point : control_points) {
+    control_points_2d.push_back({point.x, point.y});
+  }
+  BSplineCurve2D curve_2d(degree, control_points_2d, knots, {0.0, 4.0});
+  std::vector<Point2D> points_2d = curve_2d.StepCurvePoints(513);
+  std::vector<Point2D> expected_2d = curve_2d.EvaluateCurvePoints(513);
+  for (size_t i = 0; i < points_2d.size(); ++i) {
+    EXPECT_NEAR(points_2d[i].x, expected_2d[i].x, 1e-12);
+    EXPECT_NEAR(points_2d[i].y, expected_2d[i].y, 1e-12);
+  }
+}
+
+TEST(NURBS_Chapter3, BSplineSurfaceStepPoints) {
+  Point2D interval = {0, 4};
+  uint32_t u_degree = 4;
+  uint32_t v_degree = 3;
+  std::vector<double> u_knots = {0, 0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 1, 2, 3, 3, 4, 4, 4, 4};
+  std::vector<std::vector<Point3D>> control_points(9);
+  for (size_t i = 0; i < 9; ++i) {
+    for (size_t j = 0; j < 9; ++j) {
+      double x = static_cast<double>(i);
+      double y = static_cast<double>(j);
+      control_points[i].push_back({x, y, std::sin(x) * std::cos(y)});
+    }
+  }
+  BSplineSurface surface(u_degree, v_degree, u_knots, v_knots, control_points,
+                         interval, interval);
+  std::vector<Point3D> points = surface.StepPoints(31, 257);
+  std::vector<Point3D> expected = surface.EvaluatePoints(31, 257);
+  ASSERT_EQ(points.size(), expected.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_NEAR(points[i].x, expected[i].x, 1e-12);
+    EXPECT_NEAR(points[i].y, expected[i].y, 1e-12);
+    EXPECT_NEAR(points[i].z, expected[i].z, 1e-12);
+  }
+}
+
+// Clamped cubic with a uniform interior, the two spans at each end are not
+// uniform and keep the general basis
+TEST(NURBS_Chapter3, UniformCubicSpans) {
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 8, 8};
+  knots::UniformCubicSpans uniform(3, knots);
+  ASSERT_FALSE(uniform.empty());
+  for (uint32_t span = 0; span < 14; ++span) {
+    EXPECT_EQ(uniform.Contains(span), span >= 5 && span <= 8) << span;
+  }
+  EXPECT_TRUE(knots::UniformCubicSpans(2, knots).empty());
+  // A double knot breaks the spans that reach it
+  std::vector<double> doubled = {0, 0, 0, 0, 1, 2, 3, 4, 4, 5,
+                                 6, 7, 8, 9, 9, 9, 9};
+  knots::UniformCubicSpans split(3, doubled);
+  for (uint32_t span = 0; span < 16; ++span) {
+    EXPECT_EQ(split.Contains(span), span == 10) << span;
+  }
+
+  std::vector<double> t;
+  for (int32_t i = 0; i <= 40; ++i) {
+    t.push_back(static_cast<double>(i) / 40.0);
+  }
+  std::vector<double> bases(4 * t.size());
+  double expected[4];
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    simd::UniformCubicBasis(t.data(), t.size(), bases.data(), t.size());
+    for (size_t s = 0; s < t.size(); ++s) {
+      knots::UniformCubicBasis(t[s], expected);
+      for (uint32_t j = 0; j < 4; ++j) {
+        EXPECT_EQ(bases[(j * t.size()) + s], expected[j])
+            << simd::Name(simd::Active());
+      }
+    }
+  }
+  simd::SetActive(simd::Supported());
+
+  // Against Cox-de Boor on every uniform span
+  std::vector<double> general(4);
+  for (uint32_t span = 5; span <= 8; ++span) {
+    for (double local : t) {
+      const double u = knots[span] + local;
+      const uint32_t found = knots::FindSpanParam(3, knots, u, kTolerance);
+      if (found != span) {
+        continue;
+      }
+      knots::BasisFuns(span, u, 3, knots, kTolerance, general.data(),
+                       knots::ThreadScratch());
+      knots::UniformCubicBasis(uniform.Local(span, u, knots), expected);
+      for (uint32_t j = 0; j < 4; ++j) {
+        EXPECT_NEAR(expected[j], general[j], 1e-15);
+      }
+    }
+  }
+}
+
+TEST(NURBS_Chapter3, BSplineCurveUniformCubic) {
+  const uint32_t degree = 3;
+  std::vector<double> knots(4, 0.0);
+  for (int32_t i = 1; i < 20; ++i) {
+    knots.push_back(static_cast<double>(i) * 0.1);
+  }
+  knots.insert(knots.end(), 4, 2.0);
+  std::vector<Point3D> control_points;
+  for (size_t i = 0; i + degree + 1 < knots.size(); ++i) {
+    double x = static_cast<double>(i);
+    control_points.push_back({x, std::sin(x), std::cos(x) * 0.5});
+  }
+  BSplineCurve3D curve(degree, control_points, knots, {0, 2});
+  knots::UniformCubicSpans uniform(degree, knots);
+  ASSERT_FALSE(uniform.empty());
+  std::vector<double> bases(degree + 1);
+  std::vector<double> params;
+  for (int32_t i = -1; i <= 401; ++i) {
+    params.push_back(static_cast<double>(i) * 0.005);
+  }
+  for (double param : params) {
+    const double location = std::clamp(param, 0.0, 2.0);
+    uint32_t span = knots::FindSpanParam(degree, knots, location, kTolerance);
+    knots::BasisFuns(span, location, degree, knots, kTolerance, bases.data(),
+                     knots::ThreadScratch());
+    Point3D expected;
+    for (uint32_t j = 0; j <= degree; ++j) {
+      expected += bases[j] * control_points[span - degree + j];
+    }
+    Point3D point = curve.EvaluateCurve(param);
+    if (uniform.Contains(span)) {
+      EXPECT_NEAR(expected.x, point.x, 1e-13) << location;
+      EXPECT_NEAR(expected.y, point.y, 1e-13) << location;
+      EXPECT_NEAR(expected.z, point.z, 1e-13) << location;
+    } else {
+      // The clamped end spans are the general kernel, to the bit
+      EXPECT_EQ(expected.x, point.x) << location;
+      EXPECT_EQ(expected.y, point.y) << location;
+      EXPECT_EQ(expected.z, point.z) << location;
+    }
+  }
+  // The batch takes the vector basis kernel, with the same bits
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    knots::BasisTableCache::Shared().Clear();
+    std::vector<Point3D> points(params.size());
+    curve.EvaluateCurveBatch(params.data(), params.size(), points.data());
+    for (size_t i = 0; i < params.size(); ++i) {
+      Point3D expected = curve.EvaluateCurve(params[i]);
+      EXPECT_EQ(expected.x, points[i].x) << simd::Name(simd::Active());
+      EXPECT_EQ(expected.y, points[i].y) << simd::Name(simd::Active());
+      EXPECT_EQ(expected.z, points[i].z) << simd::Name(simd::Active());
+    }
+  }
+  simd::SetActive(simd::Supported());
+}
+
+TEST(NURBS_Chapter3, BSplineSurfaceUniformCubic) {
+  Point2D interval = {0, 9};
+  std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 3, 4, 5,
+                                 6, 7, 8, 9, 9, 9, 9};
+  // Cubic in v as well, but with a double knot in the middle
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 2, 3, 4, 4, 5,
+                                 6, 7, 8, 9, 9, 9, 9};
+  std::vector<std::vector<Point3D>> control_points(u_knots.size() - 4);
+  for (size_t i = 0; i < control_points.size(); ++i) {
+    for (size_t j = 0; j + 4 < v_knots.size(); ++j) {
+      double x = static_cast<double>(i);
+      double y = static_cast<double>(j);
+      control_points[i].push_back({x, y, std::sin(x) * std::cos(y)});
+    }
+  }
+  BSplineSurface surface(3, 3, u_knots, v_knots, control_points, interval,
+                         interval);
+  const uint32_t u_count = 37;
+  const uint32_t v_count = 53;
+  const double u_div = 9.0 / static_cast<double>(u_count - 1);
+  const double v_div = 9.0 / static_cast<double>(v_count - 1);
+  std::vector<double> u_bases(4);
+  std::vector<double> v_bases(4);
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    knots::BasisTableCache::Shared().Clear();
+    std::vector<Point3D> points = surface.EvaluatePoints(u_count, v_count);
+    for (uint32_t i = 0; i < u_count; ++i) {
+      for (uint32_t j = 0; j < v_count; ++j) {
+        Point2D location = {static_cast<double>(i) * u_div,
+                            static_cast<double>(j) * v_div};
+        Point3D expected = surface.EvaluatePoint(location);
+        Point3D point = points[(i * v_count) + j];
+        EXPECT_EQ(point.x, expected.x) << simd::Name(simd::Active());
+        EXPECT_EQ(point.y, expected.y) << simd::Name(simd::Active());
+        EXPECT_EQ(point.z, expected.z) << simd::Name(simd::Active());
+
+        // Close to the general basis everywhere
+        uint32_t u_span =
+            knots::FindSpanParam(3, u_knots, location.x, kTolerance);
+        uint32_t v_span =
+            knots::FindSpanParam(3, v_knots, location.y, kTolerance);
+        knots::BasisFuns(u_span, location.x, 3, u_knots, kTolerance,
+                         u_bases.data(), knots::ThreadScratch(0));
+        knots::BasisFuns(v_span, location.y, 3, v_knots, kTolerance,
+                         v_bases.data(), knots::ThreadScratch(1));
+        Point3D general;
+        for (uint32_t k = 0; k <= 3; ++k) {
+          for (uint32_t l = 0; l <= 3; ++l) {
+            general += (u_bases[k] * v_bases[l]) *
+                       control_points[u_span - 3 + k][v_span - 3 + l];
+          }
+        }
+        EXPECT_NEAR(point.x, general.x, 1e-12);
+        EXPECT_NEAR(point.y, general.y, 1e-12);
+        EXPECT_NEAR(point.z, general.z, 1e-12);
+      }
+    }
+  }
+  simd::SetActive(simd::Supported());
+}
 } // namespace nurbs
\ No newline at end of file
@@ -3,9 +3,17 @@
 // NURBS_CPP
 #include "include/b_spline_curve.hpp"
 #include "include/b_spline_surface.hpp"
+#include "include/basis_table.hpp"
+#include "include/grid_kernels.hpp"
+#include "include/knot_utility_functions.hpp"
 #include "include/nurbs_curve.hpp"
 #include "include/nurbs_surface.hpp"
 
+// STD
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 namespace nurbs {
 TEST(NURBS_Chapter4, NURBS_BSpline_Curve2D) {
   uint32_t degree = 3;
@@ -62,6 +70,84 @@ TEST(NURBS_Chapter4, NURBS_BSpline_Curve3D) {
   }
 }
 
+TEST(NURBS_Chapter4, NURBS_CurveBatch3D) {
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point4D> nurbs_pts = {
+      {0, 0, 0, 1}, {0, 2, 4, 2},  {1, 1, 3, 1}, {0.5, 0, 1, 0.5},
+      {2, 0, 3, 1}, {4, 2, 10, 2}, {3, 1, 5, 1}, {3, 0, 7, 1},
+      {2.5, -0.5, 4, 0.5}, {7, 2, 9, 1}};
+  NURBSCurve3D nurbs_curve(degree, nurbs_pts, knots, interval);
+  // Ascending with every knot hit exactly, then out of order and out of range
+  std::vector<double> params;
+  for (int32_t i = -1; i <= 50; ++i) {
+    params.push_back(static_cast<double>(i) * 0.1);
+  }
+  for (double param : {5.0, 6.0, 4.0, 0.5, 0.5, 2.0, 1.99, -1.0, 3.0, 0.0}) {
+    params.push_back(param);
+  }
+  std::vector<Point3D> points(params.size());
+  nurbs_curve.EvaluateCurveBatch(params.data(), params.size(), points.data());
+  for (size_t i = 0; i < params.size(); ++i) {
+    Point3D expected = nurbs_curve.EvaluateCurve(params[i]);
+    EXPECT_EQ(expected.x, points[i].x) << "param " << params[i];
+    EXPECT_EQ(expected.y, points[i].y) << "param " << params[i];
+    EXPECT_EQ(expected.z, points[i].z) << "param " << params[i];
+  }
+}
+
+// Uniform cubic interior with clamped ends. The uniform spans go through the
+// basis matrix, close to the general rational curve, and the batch matches
+// EvaluateCurve to the bit on every kernel.
+TEST(NURBS_Chapter4, NURBS_UniformCubicCurve) {
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 7, 7};
+  Point2D interval = {0.0, 7.0};
+  std::vector<Point4D> nurbs_pts;
+  for (size_t i = 0; i + degree + 1 < knots.size(); ++i) {
+    double x = static_cast<double>(i);
+    double w = 1.0 + (0.5 * std::sin(x));
+    nurbs_pts.push_back({x * w, std::cos(x) * w, x * x * w, w});
+  }
+  NURBSCurve3D nurbs_curve(degree, nurbs_pts, knots, interval);
+  std::vector<double> params;
+  for (int32_t i = -1; i <= 141; ++i) {
+    params.push_back(static_cast<double>(i) * 0.05);
+  }
+  std::vector<double> bases(degree + 1);
+  for (double param : params) {
+    double location = std::min(std::max(param, 0.0), 7.0);
+    uint32_t span = knots::FindSpanParam(degree, knots, location,
+                                         NURBSCurve3D::kTolerance);
+    knots::BasisFuns(span, location, degree, knots, NURBSCurve3D::kTolerance,
+                     bases.data(), knots::ThreadScratch());
+    Point4D general;
+    for (uint32_t j = 0; j <= degree; ++j) {
+      general += bases[j] * nurbs_pts[span - degree + j];
+    }
+    Point3D point = nurbs_curve.EvaluateCurve(param);
+    EXPECT_NEAR(point.x, general.x / general.w, 1e-12) << location;
+    EXPECT_NEAR(point.y, general.y / general.w, 1e-12) << location;
+    EXPECT_NEAR(point.z, general.z / general.w, 1e-12) << location;
+  }
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    knots::BasisTableCache::Shared().Clear();
+    std::vector<Point3D> points(params.size());
+    nurbs_curve.EvaluateCurveBatch(params.data(), params.size(),
+                                   points.data());
+    for (size_t i = 0; i < params.size(); ++i) {
+      Point3D expected = nurbs_curve.EvaluateCurve(params[i]);
+      EXPECT_EQ(expected.x, points[i].x) << simd::Name(simd::Active());
+      EXPECT_EQ(expected.y, points[i].y) << simd::Name(simd::Active());
+      EXPECT_EQ(expected.z, points[i].z) << simd::Name(simd::Active());
+    }
+  }
+  simd::SetActive(simd::Supported());
+}
+
 TEST(NURBS_Chapter4, NURBS_BSplineDerivCompare2D) {
   constexpr double tolerance = std::numeric_limits<double>::epsilon() * 100.0;
   uint32_t degree = 3;
@@ -180,6 +266,76 @@ TEST(NURBS_Chapter4, NURBS_BSplineSurfaceCompare) {
   }
 }
 
+TEST(NURBS_Chapter4, NURBS_SurfaceGrid) {
+  Point2D interval = {0, 4};
+  uint32_t u_degree = 4;
+  uint32_t v_degree = 3;
+  std::vector<double> u_knots = {0, 0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 1, 2, 3, 3, 4, 4, 4, 4};
+  std::vector<std::vector<Point4D>> nurbs_pts(9);
+  for (size_t i = 0; i < 9; ++i) {
+    double i_val = static_cast<double>(i + 1);
+    for (size_t j = 0; j < 9; ++j) {
+      double j_val = static_cast<double>(j);
+      double w = 1.0 + (0.5 * std::sin(i_val + j_val));
+      nurbs_pts[i].push_back(
+          {j_val * w, (i_val - j_val) * w, i_val * w, w});
+    }
+  }
+  NURBSSurface nurbs_surface(u_degree, v_degree, u_knots, v_knots, nurbs_pts,
+                             interval, interval);
+
+  const uint32_t u_count = 29;
+  const uint32_t v_count = 43;
+  const double u_div = 4.0 / static_cast<double>(u_count - 1);
+  const double v_div = 4.0 / static_cast<double>(v_count - 1);
+  // Outside the intervals and unsorted, EvaluateGrid clamps like EvaluatePoint
+  std::vector<double> u_params = {-1.0, 3.5, 0.25, 5.0, 1.0};
+  std::vector<double> v_params = {0.1, 3.9, 1.0, 2.5, -0.5, 4.0, 1.7,
+                                  0.6, 4.5, 2.2, 1.1, 0.9, 3.3};
+  // Every kernel has to give the same bits as EvaluatePoint
+  for (uint32_t level = 0;
+       level <= static_cast<uint32_t>(simd::Supported()); ++level) {
+    simd::SetActive(static_cast<simd::Level>(level));
+    std::vector<Point3D> points =
+        nurbs_surface.EvaluatePoints(u_count, v_count);
+    ASSERT_EQ(points.size(), u_count * v_count);
+    for (uint32_t i = 0; i < u_count; ++i) {
+      Point2D location = {static_cast<double>(i) * u_div, 0};
+      for (uint32_t j = 0; j < v_count; ++j) {
+        location.y = static_cast<double>(j) * v_div;
+        Point3D expected = nurbs_surface.EvaluatePoint(location);
+        Point3D point = points[(i * v_count) + j];
+        EXPECT_EQ(point.x, expected.x) << simd::Name(simd::Active());
+        EXPECT_EQ(point.y, expected.y) << simd::Name(simd::Active());
+        EXPECT_EQ(point.z, expected.z) << simd::Name(simd::Active());
+      }
+    }
+
+    std::vector<Point3D> grid(u_params.size() * v_params.size());
+    nurbs_surface.EvaluateGrid(u_params.data(), u_params.size(),
+                               v_params.data(), v_params.size(), grid.data());
+    std::vector<float> positions(3 * grid.size());
+    nurbs_surface.EvaluateGridFloat(u_params.data(), u_params.size(),
+                                    v_params.data(), v_params.size(),
+                                    positions.data());
+    for (size_t i = 0; i < u_params.size(); ++i) {
+      for (size_t j = 0; j < v_params.size(); ++j) {
+        Point3D expected =
+            nurbs_surface.EvaluatePoint({u_params[i], v_params[j]});
+        size_t index = (i * v_params.size()) + j;
+        EXPECT_EQ(grid[index].x, expected.x) << simd::Name(simd::Active());
+        EXPECT_EQ(grid[index].y, expected.y) << simd::Name(simd::Active());
+        EXPECT_EQ(grid[index].z, expected.z) << simd::Name(simd::Active());
+        EXPECT_EQ(positions[(3 * index)], static_cast<float>(expected.x));
+        EXPECT_EQ(positions[(3 * index) + 1], static_cast<float>(expected.y));
+        EXPECT_EQ(positions[(3 * index) + 2], static_cast<float>(expected.z));
+      }
+    }
+  }
+  simd::SetActive(simd::Supported());
+}
+
 TEST(NURBS_Chapter4, NURBS_BSplineSurfaceDerivCompare) {
   constexpr double tolerance = std::numeric_limits<double>::epsilon() * 1000.0;
   Point2D interval = {0, 4};
@@ -240,4 +396,152 @@ TEST(NURBS_Chapter4, NURBS_BSplineSurfaceDerivCompare) {
   }
 }
 
+TEST(NURBS_Chapter4, NURBS_Binomial) {
+  std::vector<std::vector<double>> bin = knots::BinomialCoefficients(5, 5);
+  for (uint32_t n = 0; n <= 5; ++n) {
+    for (uint32_t k = 0; k <= 5; ++k) {
+      EXPECT_EQ(bin[n][k], knots::Binomial(n, k));
+    }
+  }
+  EXPECT_EQ(knots::Binomial(2, 1), 2.0);
+  EXPECT_EQ(knots::Binomial(4, 2), 6.0);
+  EXPECT_EQ(knots::Binomial(3, 4), 0.0);
+  EXPECT_EQ(knots::Binomial(40, 3), 9880.0);
+}
+
+// The second derivatives of weighted curves and surfaces against central
+// differences of their first derivatives
+TEST(NURBS_Chapter4, NURBS_RationalDerivatives) {
+  constexpr double step = 1e-5;
+  constexpr double tolerance = 1e-5;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 3, 3, 3};
+  Point2D interval = {0.0, 3.0};
+  std::vector<Point4D> curve_pts = {{0, 0, 0, 1},   {1, 2, 1, 0.5},
+                                    {3, 3, 0, 2},   {4, 1, 2, 0.7},
+                                    {6, 0, 1, 1.5}, {7, 2, 3, 1},
+                                    {9, 3, 1, 0.8}};
+  NURBSCurve3D curve(3, curve_pts, knots, interval);
+  for (double u : {0.3, 1.1, 1.9, 2.5}) {
+    std::vector<Point3D> derivs = curve.EvaluateDerivative(u, 3);
+    ASSERT_EQ(derivs.size(), 4u);
+    Point3D ck[4];
+    ASSERT_EQ(curve.EvaluateDerivative(u, 3, ck), 4u);
+    const Point3D high = curve.EvaluateDerivative(u + step, 1)[1];
+    const Point3D low = curve.EvaluateDerivative(u - step, 1)[1];
+    const Point3D difference = (high - low) / (2.0 * step);
+    EXPECT_NEAR(derivs[2].x, difference.x, tolerance * Length(derivs[2]));
+    EXPECT_NEAR(derivs[2].y, difference.y, tolerance * Length(derivs[2]));
+    EXPECT_NEAR(derivs[2].z, difference.z, tolerance * Length(derivs[2]));
+    for (size_t k = 0; k < derivs.size(); ++k) {
+      EXPECT_EQ(derivs[k].x, ck[k].x);
+      EXPECT_EQ(derivs[k].y, ck[k].y);
+      EXPECT_EQ(derivs[k].z, ck[k].z);
+    }
+  }
+
+  std::vector<double> u_knots = {0, 0, 0, 1, 2, 2, 2};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 2, 2, 2, 2};
+  Point2D u_interval = {0.0, 2.0};
+  std::vector<std::vector<Point4D>> surface_pts(4);
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      const double x = static_cast<double>(i);
+      const double y = static_cast<double>(j);
+      const double w = 0.5 + static_cast<double>((i * 3 + j * 2) % 5) * 0.4;
+      surface_pts[i].push_back({x, y, std::sin(x + y), w});
+    }
+  }
+  NURBSSurface surface(2, 3, u_knots, v_knots, surface_pts, u_interval,
+                       u_interval);
+  for (Point2D uv : {Point2D{0.4, 0.7}, Point2D{1.3, 1.6}, Point2D{1.7, 0.2}}) {
+    std::vector<std::vector<Point3D>> derivs = surface.Derivatives(uv, 2);
+    Point3D skl[9];
+    surface.Derivatives(uv, 2, skl);
+    for (size_t k = 0; k <= 2; ++k) {
+      for (size_t l = 0; l <= 2; ++l) {
+        EXPECT_EQ(derivs[k][l].x, skl[(k * 3) + l].x);
+        EXPECT_EQ(derivs[k][l].y, skl[(k * 3) + l].y);
+        EXPECT_EQ(derivs[k][l].z, skl[(k * 3) + l].z);
+      }
+    }
+    auto u_first = [&](double u) { return surface.Derivatives({u, uv.y}, 1); };
+    auto v_first = [&](double v) { return surface.Derivatives({uv.x, v}, 1); };
+    const Point3D uu =
+        (u_first(uv.x + step)[1][0] - u_first(uv.x - step)[1][0]) /
+        (2.0 * step);
+    const Point3D uv_mixed =
+        (u_first(uv.x + step)[0][1] - u_first(uv.x - step)[0][1]) /
+        (2.0 * step);
+    const Point3D vv =
+        (v_first(uv.y + step)[0][1] - v_first(uv.y - step)[0][1]) /
+        (2.0 * step);
+    const std::pair<Point3D, Point3D> checks[3] = {
+        {derivs[2][0], uu}, {derivs[1][1], uv_mixed}, {derivs[0][2], vv}};
+    for (const auto &check : checks) {
+      const double scale = tolerance * (Length(check.first) + 1.0);
+      EXPECT_NEAR(check.first.x, check.second.x, scale);
+      EXPECT_NEAR(check.first.y, check.second.y, scale);
+      EXPECT_NEAR(check.first.z, check.second.z, scale);
+    }
+  }
+}
+
+TEST(NURBS_Chapter4, NURBS_StepCurvePoints) {
+  // Unit circle from nine homogeneous points, the stepped points have to
+  // stay on it
+  const double w = std::sqrt(0.5);
+  std::vector<Point4D> control_points = {
+      {1, 0, 0, 1},  {w, w, 0, w},   {0, 1, 0, 1},  {-w, w, 0, w},
+      {-1, 0, 0, 1}, {-w, -w, 0, w}, {0, -1, 0, 1}, {w, -w, 0, w},
+      {1, 0, 0, 1}};
+  std::vector<double> knots = {0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4};
+  NURBSCurve3D circle(2, control_points, knots, {0.0, 4.0});
+  std::vector<Point3D> points = circle.StepCurvePoints(10001);
+  std::vector<Point3D> expected = circle.EvaluateCurvePoints(10001);
+  ASSERT_EQ(points.size(), expected.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_NEAR(std::hypot(points[i].x, points[i].y), 1.0, 1e-13);
+    EXPECT_NEAR(points[i].x, expected[i].x, 1e-13);
+    EXPECT_NEAR(points[i].y, expected[i].y, 1e-13);
+    EXPECT_EQ(points[i].z, 0.0);
+  }
+
+  std::vector<Point3D> control_points_2d;
+  for (const Point4D &point : control_points) {
+    control_points_2d.push_back({point.x, point.y, point.w});
+  }
+  NURBSCurve2D circle_2d(2, control_points_2d, knots, {0.0, 4.0});
+  std::vector<Point2D> points_2d = circle_2d.StepCurvePoints(777);
+  for (const Point2D &point : points_2d) {
+    EXPECT_NEAR(std::hypot(point.x, point.y), 1.0, 1e-13);
+  }
+}
+
+TEST(NURBS_Chapter4, NURBS_SurfaceStepPoints) {
+  Point2D interval = {0, 4};
+  uint32_t u_degree = 4;
+  uint32_t v_degree = 3;
+  std::vector<double> u_knots = {0, 0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 1, 2, 3, 3, 4, 4, 4, 4};
+  std::vector<std::vector<Point4D>> nurbs_pts(9);
+  for (size_t i = 0; i < 9; ++i) {
+    double i_val = static_cast<double>(i + 1);
+    for (size_t j = 0; j < 9; ++j) {
+      double j_val = static_cast<double>(j);
+      double w = 1.0 + (0.5 * std::sin(i_val + j_val));
+      nurbs_pts[i].push_back(
+          {j_val * w, (i_val - j_val) * w, i_val * w, w});
+    }
+  }
+  NURBSSurface nurbs_surface(u_degree, v_degree, u_knots, v_knots, nurbs_pts,
+                             interval, interval);
+  std::vector<Point3D> points = nurbs_surface.StepPoints(29, 301);
+  std::vector<Point3D> expected = nurbs_surface.EvaluatePoints(29, 301);
+  ASSERT_EQ(points.size(), expected.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_NEAR(points[i].x, expected[i].x, 1e-12);
+    EXPECT_NEAR(points[i].y, expected[i].y, 1e-12);
+    EXPECT_NEAR(points[i].z, expected[i].z, 1e-12);
+  }
+}
 } // namespace nurbs
\ No newline at end of file
@@ -1,8 +1,13 @@
 #include <gtest/gtest.h>
 
+#include "include/bezier_set.hpp"
 #include "include/knot_utility_functions.hpp"
 #include "include/nurbs_curve.hpp"
 #include "include/nurbs_surface.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cmath>
 
 namespace nurbs {
 TEST(NURBS_Chapter5, InsertKnotNone2D) {
@@ -1161,6 +1166,174 @@ TEST(NURBS_Chapter5, MergeKnotFull3D) {
   }
 }
 
+// Same knots and homogeneous control points, bit for bit
+void ExpectSameCurve(const NURBSCurve3D &a, const NURBSCurve3D &b) {
+  ASSERT_EQ(a.knots().size(), b.knots().size());
+  for (size_t i = 0; i < a.knots().size(); ++i) {
+    EXPECT_EQ(a.knots()[i], b.knots()[i]);
+  }
+  ASSERT_EQ(a.control_points().size(), b.control_points().size());
+  for (size_t i = 0; i < a.control_points().size(); ++i) {
+    EXPECT_EQ(a.control_points()[i].x, b.control_points()[i].x);
+    EXPECT_EQ(a.control_points()[i].y, b.control_points()[i].y);
+    EXPECT_EQ(a.control_points()[i].z, b.control_points()[i].z);
+    EXPECT_EQ(a.control_points()[i].w, b.control_points()[i].w);
+  }
+}
+
+TEST(NURBS_Chapter5, InsertKnotsInPlace3D) {
+  constexpr double kTestEpsilon = 1e-12;
+  // NURBS Curves
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2}, {1, 1, 3, 1}, {1, 0, 1, 1}, {4, 0, 6, 2},
+      {2, 1, 3, 1}, {3, 1, 5, 1}, {6, 0, 4, 2}, {4, 0, 3, 1}, {4, 1, 1, 1}};
+  const NURBSCurve3D nurbs_curve(degree, control_points, knots, interval);
+
+  // New knots, single and double knots, each up to past full multiplicity
+  NURBSCurve3D into_curve = nurbs_curve;
+  for (double knot : {0.5, 1.0, 2.0, 3.5}) {
+    for (uint32_t times = 1; times <= degree + 1; ++times) {
+      NURBSCurve3D insert_curve = nurbs_curve;
+      insert_curve.InsertKnots(knot, times);
+      ExpectSameCurve(insert_curve, nurbs_curve.KnotInsertion(knot, times));
+      nurbs_curve.InsertKnotsInto(knot, times, into_curve);
+      ExpectSameCurve(insert_curve, into_curve);
+
+      EXPECT_LE(insert_curve.knots().size(), knots.size() + times);
+      double div = (1.0 / 99.0) * (interval.y - interval.x);
+      for (int32_t i = -1; i < 101; ++i) {
+        double location = (static_cast<double>(i) * div) + interval.x;
+        Point3D point_nurbs = nurbs_curve.EvaluateCurve(location);
+        Point3D point_isrt = insert_curve.EvaluateCurve(location);
+        EXPECT_NEAR(point_nurbs.x, point_isrt.x, kTestEpsilon);
+        EXPECT_NEAR(point_nurbs.y, point_isrt.y, kTestEpsilon);
+        EXPECT_NEAR(point_nurbs.z, point_isrt.z, kTestEpsilon);
+      }
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, InsertNewKnot2D) {
+  constexpr double kTestEpsilon = std::numeric_limits<double>::epsilon();
+  // NURBS Curves
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point3D> control_points = {
+      {0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1}, {2, 0, 1},
+      {2, 1, 1}, {3, 1, 1}, {3, 0, 1}, {4, 0, 1}, {4, 1, 1}};
+  const NURBSCurve2D nurbs_curve(degree, control_points, knots, interval);
+
+  // Knot insert in the last span, where the points past it have to move
+  NURBSCurve2D insert_curve = nurbs_curve;
+  insert_curve.InsertKnots(4.5, 2);
+
+  // Check knot multiplicity
+  int knot_count =
+      knots::MultiplicityParam(degree, insert_curve.knots(), 4.5, kTestEpsilon);
+  EXPECT_EQ(knot_count, 1);
+  EXPECT_EQ(insert_curve.control_points().size(), control_points.size() + 2);
+
+  // Compare
+  double div = (1.0 / 99.0) * (interval.y - interval.x);
+  for (int32_t i = -1; i < 101; ++i) {
+    double location = (static_cast<double>(i) * div) + interval.x;
+    Point2D point_nurbs = nurbs_curve.EvaluateCurve(location);
+    Point2D point_isrt = insert_curve.EvaluateCurve(location);
+    EXPECT_NEAR(point_nurbs.x, point_isrt.x, 1e-12);
+    EXPECT_NEAR(point_nurbs.y, point_isrt.y, 1e-12);
+  }
+}
+
+TEST(NURBS_Chapter5, RefineInPlace3D) {
+  constexpr double kTestEpsilon = 1e-12;
+  // NURBS Curves
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2}, {1, 1, 3, 1}, {1, 0, 1, 1}, {4, 0, 6, 2},
+      {2, 1, 3, 1}, {3, 1, 5, 1}, {6, 0, 4, 2}, {4, 0, 3, 1}, {4, 1, 1, 1}};
+  const NURBSCurve3D nurbs_curve(degree, control_points, knots, interval);
+
+  // One destination reused across refinements that grow and shrink it
+  NURBSCurve3D into_curve = nurbs_curve;
+  std::vector<std::vector<double>> merges = {
+      {1, 1, 1, 2, 2, 3, 3, 3, 4, 4}, {2.5}, {0.25, 0.5, 4.5, 4.75}, {}};
+  for (const std::vector<double> &merge : merges) {
+    NURBSCurve3D refine_curve = nurbs_curve;
+    refine_curve.Refine(merge);
+    ExpectSameCurve(refine_curve, nurbs_curve.MergeKnotVect(merge));
+    nurbs_curve.RefineInto(merge, into_curve);
+    ExpectSameCurve(refine_curve, into_curve);
+
+    double div = (1.0 / 99.0) * (interval.y - interval.x);
+    for (int32_t i = -1; i < 101; ++i) {
+      double location = (static_cast<double>(i) * div) + interval.x;
+      Point3D point_nurbs = nurbs_curve.EvaluateCurve(location);
+      Point3D point_refine = into_curve.EvaluateCurve(location);
+      EXPECT_NEAR(point_nurbs.x, point_refine.x, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.y, point_refine.y, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.z, point_refine.z, kTestEpsilon);
+    }
+  }
+
+  // Refining by the curve's own knot vector reads it from a copy
+  NURBSCurve3D doubled_curve = nurbs_curve;
+  doubled_curve.Refine(doubled_curve.knots());
+  NURBSCurve3D interior_curve = nurbs_curve;
+  interior_curve.Refine(knots);
+  ExpectSameCurve(doubled_curve, interior_curve);
+}
+
+// A uniform cubic refined at its span midpoints is uniform again away from
+// the ends, the rebuilt span lookups have to follow the new knots
+TEST(NURBS_Chapter5, RefineUniformCubic3D) {
+  constexpr double kTestEpsilon = 1e-12;
+  uint32_t degree = 3;
+  std::vector<double> knots;
+  for (int32_t i = -3; i <= 11; ++i) {
+    knots.push_back(static_cast<double>(i));
+  }
+  Point2D interval = {0.0, 8.0};
+  std::vector<Point4D> control_points;
+  for (size_t i = 0; i + degree + 1 < knots.size(); ++i) {
+    const double w = 1.0 + (0.25 * static_cast<double>(i % 3));
+    control_points.push_back({static_cast<double>(i) * w,
+                              static_cast<double>(i % 2) * w,
+                              static_cast<double>(i * i) * 0.1 * w, w});
+  }
+  const NURBSCurve3D nurbs_curve(degree, control_points, knots, interval);
+
+  std::vector<double> mid_knots;
+  for (size_t i = degree; i + degree + 1 < knots.size(); ++i) {
+    mid_knots.push_back(0.5 * (knots[i] + knots[i + 1]));
+  }
+  NURBSCurve3D refine_curve = nurbs_curve;
+  refine_curve.Refine(mid_knots);
+  EXPECT_EQ(refine_curve.knots().size(), knots.size() + mid_knots.size());
+
+  std::vector<double> params;
+  for (int32_t i = 0; i <= 200; ++i) {
+    params.push_back(static_cast<double>(i) * 0.04);
+  }
+  std::vector<Point3D> batch(params.size());
+  refine_curve.EvaluateCurveBatch(params.data(), params.size(), batch.data());
+  for (size_t i = 0; i < params.size(); ++i) {
+    Point3D point_nurbs = nurbs_curve.EvaluateCurve(params[i]);
+    Point3D point_refine = refine_curve.EvaluateCurve(params[i]);
+    EXPECT_NEAR(point_nurbs.x, point_refine.x, kTestEpsilon);
+    EXPECT_NEAR(point_nurbs.y, point_refine.y, kTestEpsilon);
+    EXPECT_NEAR(point_nurbs.z, point_refine.z, kTestEpsilon);
+    EXPECT_EQ(point_refine.x, batch[i].x);
+    EXPECT_EQ(point_refine.y, batch[i].y);
+    EXPECT_EQ(point_refine.z, batch[i].z);
+  }
+}
+
 TEST(NURBS_Chapter5, MergeKnotNoneSurfaceU) {
   constexpr double kTestEpsilon =
       std::numeric_limits<double>::epsilon() * 100.0;
@@ -2170,4 +2343,621 @@ TEST(NURBS_Chapter5, DecomposeSurface) {
     }
   }
 }
-}  // namespace nurbs
\ No newline at end of file
+TEST(NURBS_Chapter5, DecomposeRationalSurface) {
+  constexpr double kTestEpsilon =
+      std::numeric_limits<double>::epsilon() * 100.0;
+  // Weighted NURBS surface, the patches have to keep the weights
+  uint32_t u_degree = 3;
+  uint32_t v_degree = 2;
+  std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 2, 3, 3, 3, 3};
+  std::vector<double> v_knots = {0, 0, 0, 1, 1, 2, 2, 2, 3, 4, 4, 4};
+  std::vector<std::vector<Point4D>> control_points;
+  uint32_t u_points = static_cast<uint32_t>(u_knots.size()) - u_degree - 1;
+  uint32_t v_points = static_cast<uint32_t>(v_knots.size()) - v_degree - 1;
+  control_points.resize(u_points);
+  for (uint32_t u_index = 0; u_index < u_points; ++u_index) {
+    control_points[u_index].resize(v_points);
+    for (uint32_t v_index = 0; v_index < v_points; ++v_index) {
+      double u_val =
+          static_cast<double>(u_index) - (static_cast<double>(u_points) * 0.5);
+      double v_val =
+          static_cast<double>(v_index) - (static_cast<double>(v_points) * 0.5);
+      double weight =
+          1.0 + (0.5 * static_cast<double>((u_index + v_index) % 3));
+      control_points[u_index][v_index] = {u_val, v_val, u_val * v_val, weight};
+    }
+  }
+
+  NURBSSurface surface(u_degree, v_degree, u_knots, v_knots, control_points,
+                       {0.0, 3.0}, {0.0, 4.0});
+
+  std::vector<std::vector<BezierSurface>> surfaces = surface.Decompose();
+  ASSERT_EQ(surfaces.size(), 3);
+  ASSERT_EQ(surfaces[0].size(), 4);
+
+  for (int32_t i = 0; i < 30; ++i) {
+    Point2D uv = {static_cast<double>(i) * 0.1, 0.0};
+    size_t u_index = static_cast<size_t>(i / 10);
+    for (int32_t j = 0; j < 40; ++j) {
+      uv.y = static_cast<double>(j) * 0.1;
+      size_t v_index = static_cast<size_t>(j / 10);
+      Point2D d_uv = {uv.x - static_cast<double>(u_index),
+                      uv.y - static_cast<double>(v_index)};
+      Point3D point_nurbs = surface.EvaluatePoint(uv);
+      Point3D point_patch = surfaces[u_index][v_index].EvaluatePoint(d_uv);
+      EXPECT_NEAR(point_nurbs.x, point_patch.x, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.y, point_patch.y, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.z, point_patch.z, kTestEpsilon);
+    }
+  }
+}
+
+namespace {
+// Rational surface with enough rows and columns for several pool tasks and a
+// partial one
+NURBSSurface MakeDenseSurface() {
+  constexpr uint32_t kDegree = 3;
+  constexpr uint32_t kPoints = 70;
+  std::vector<double> knots(kDegree, 0.0);
+  for (uint32_t i = 0; i <= kPoints - kDegree; ++i) {
+    knots.push_back(static_cast<double>(i));
+  }
+  knots.insert(knots.end(), kDegree, static_cast<double>(kPoints - kDegree));
+  std::vector<std::vector<Point4D>> control_points(kPoints);
+  for (uint32_t u = 0; u < kPoints; ++u) {
+    for (uint32_t v = 0; v < kPoints; ++v) {
+      double x = static_cast<double>(u);
+      double y = static_cast<double>(v);
+      double w = 1.0 + (0.25 * std::sin(x + y));
+      control_points[u].push_back(
+          {x * w, y * w, std::sin(x) * std::cos(y) * w, w});
+    }
+  }
+  Point2D interval = {0.0, static_cast<double>(kPoints - kDegree)};
+  return NURBSSurface(kDegree, kDegree, knots, knots, control_points,
+                      interval, interval);
+}
+
+void ExpectSameNet(const ControlNet<Point4D> &a, const ControlNet<Point4D> &b) {
+  ASSERT_EQ(a.rows(), b.rows());
+  ASSERT_EQ(a.cols(), b.cols());
+  for (size_t u = 0; u < a.rows(); ++u) {
+    for (size_t v = 0; v < a.cols(); ++v) {
+      Point4D pa = a(u, v);
+      Point4D pb = b(u, v);
+      EXPECT_EQ(pa.x, pb.x);
+      EXPECT_EQ(pa.y, pb.y);
+      EXPECT_EQ(pa.z, pb.z);
+      EXPECT_EQ(pa.w, pb.w);
+    }
+  }
+}
+}  // namespace
+
+TEST(NURBS_Chapter5, KnotInsertSurfacePool) {
+  NURBSSurface surface = MakeDenseSurface();
+  ThreadPool pool(4);
+  for (auto dir : {NURBSSurface::kUDir, NURBSSurface::kVDir}) {
+    NURBSSurface serial = surface.KnotInsert(dir, 10.5, 2);
+    NURBSSurface pooled = surface.KnotInsert(dir, 10.5, 2, &pool);
+    EXPECT_EQ(serial.u_knots(), pooled.u_knots());
+    EXPECT_EQ(serial.v_knots(), pooled.v_knots());
+    ExpectSameNet(serial.control_polygon(), pooled.control_polygon());
+    for (double t = 0.0; t < 67.0; t += 3.3) {
+      Point3D a = surface.EvaluatePoint({t, 67.0 - t});
+      Point3D b = pooled.EvaluatePoint({t, 67.0 - t});
+      EXPECT_NEAR(a.x, b.x, 1e-9);
+      EXPECT_NEAR(a.y, b.y, 1e-9);
+      EXPECT_NEAR(a.z, b.z, 1e-9);
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, RefineKnotVectSurfacePool) {
+  NURBSSurface surface = MakeDenseSurface();
+  std::vector<double> knots;
+  for (double knot = 0.5; knot < 67.0; knot += 1.0) {
+    knots.push_back(knot);
+  }
+  ThreadPool pool(4);
+  for (auto dir : {NURBSSurface::kUDir, NURBSSurface::kVDir}) {
+    NURBSSurface serial = surface.RefineKnotVect(knots, dir);
+    NURBSSurface pooled = surface.RefineKnotVect(knots, dir, &pool);
+    EXPECT_EQ(serial.u_knots(), pooled.u_knots());
+    EXPECT_EQ(serial.v_knots(), pooled.v_knots());
+    ExpectSameNet(serial.control_polygon(), pooled.control_polygon());
+    for (double t = 0.0; t < 67.0; t += 3.3) {
+      Point3D a = surface.EvaluatePoint({t, 67.0 - t});
+      Point3D b = pooled.EvaluatePoint({t, 67.0 - t});
+      EXPECT_NEAR(a.x, b.x, 1e-9);
+      EXPECT_NEAR(a.y, b.y, 1e-9);
+      EXPECT_NEAR(a.z, b.z, 1e-9);
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, DecomposeSurfacePool) {
+  NURBSSurface surface = MakeDenseSurface();
+  ThreadPool pool(4);
+  std::vector<std::vector<BezierSurface>> serial = surface.Decompose();
+  std::vector<std::vector<BezierSurface>> pooled = surface.Decompose(&pool);
+  ASSERT_EQ(serial.size(), 67);
+  ASSERT_EQ(pooled.size(), serial.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    ASSERT_EQ(serial[i].size(), 67);
+    ASSERT_EQ(pooled[i].size(), serial[i].size());
+    for (size_t j = 0; j < serial[i].size(); ++j) {
+      ExpectSameNet(serial[i][j].control_net(), pooled[i][j].control_net());
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, DecomposeSegmentSet3D) {
+  constexpr double kTestEpsilon =
+      std::numeric_limits<double>::epsilon() * 100.0;
+  // Weighted curve, the arena keeps the homogeneous points
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2},     {1, 1, 4, 1}, {2, 0, 6, 2},
+      {2, 0, 2, 1}, {3, 1.5, 0, 1.5}, {3, 1, 3, 1}, {6, 0, 10, 2},
+      {4, 0, 5, 1}, {4, 1, 3, 1}};
+  NURBSCurve3D nurbs_curve(degree, control_points, knots, interval);
+
+  BezierSegmentSet segments;
+  nurbs_curve.Decompose(segments);
+  ASSERT_EQ(segments.size(), 5);
+  EXPECT_EQ(segments.degree(), degree);
+  EXPECT_EQ(segments.points().size(), 5 * (degree + 1));
+  EXPECT_EQ(segments.breaks(), (std::vector<double>{0, 1, 2, 3, 4, 5}));
+
+  for (int32_t i = -1; i < 101; ++i) {
+    double location = (static_cast<double>(i) / 99.0) * 5.0;
+    Point3D point_nurbs = nurbs_curve.EvaluateCurve(location);
+    Point3D point_set = segments.EvaluatePoint(location);
+    EXPECT_NEAR(point_nurbs.x, point_set.x, kTestEpsilon);
+    EXPECT_NEAR(point_nurbs.y, point_set.y, kTestEpsilon);
+    EXPECT_NEAR(point_nurbs.z, point_set.z, kTestEpsilon);
+
+    size_t k = segments.Find(location);
+    ControlHullBounds bounds = segments.Bounds(k);
+    EXPECT_LE(bounds.min.x, point_set.x + kTestEpsilon);
+    EXPECT_GE(bounds.max.x, point_set.x - kTestEpsilon);
+    EXPECT_LE(bounds.min.z, point_set.z + kTestEpsilon);
+    EXPECT_GE(bounds.max.z, point_set.z - kTestEpsilon);
+  }
+
+  // The matrix runs on the arena as is
+  std::vector<double> params = {0.0, 0.25, 0.5, 1.0};
+  BernsteinMatrix matrix(degree, params);
+  std::vector<Point3D> points = matrix.Evaluate(segments);
+  ASSERT_EQ(points.size(), segments.size() * params.size());
+  for (size_t k = 0; k < segments.size(); ++k) {
+    for (size_t s = 0; s < params.size(); ++s) {
+      Point3D point = nurbs_curve.EvaluateCurve(static_cast<double>(k) +
+                                                params[s]);
+      EXPECT_NEAR(points[(k * params.size()) + s].x, point.x, kTestEpsilon);
+      EXPECT_NEAR(points[(k * params.size()) + s].y, point.y, kTestEpsilon);
+      EXPECT_NEAR(points[(k * params.size()) + s].z, point.z, kTestEpsilon);
+    }
+  }
+
+  // Reusing the set for a curve with fewer segments
+  std::vector<Point4D> single_points(control_points.begin(),
+                                     control_points.begin() + 4);
+  NURBSCurve3D single(degree, single_points, {0, 0, 0, 0, 1, 1, 1, 1});
+  single.Decompose(segments);
+  ASSERT_EQ(segments.size(), 1);
+  for (uint32_t i = 0; i <= degree; ++i) {
+    EXPECT_EQ(segments.control_points(0)[i].w, control_points[i].w);
+  }
+}
+
+TEST(NURBS_Chapter5, DecomposeSurfacePatchSet) {
+  constexpr double kTestEpsilon =
+      std::numeric_limits<double>::epsilon() * 100.0;
+  uint32_t u_degree = 3;
+  uint32_t v_degree = 2;
+  std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 2, 3, 3, 3, 3};
+  std::vector<double> v_knots = {0, 0, 0, 1, 1, 2, 2, 2, 3, 4, 4, 4};
+  std::vector<std::vector<Point4D>> control_points;
+  uint32_t u_points = static_cast<uint32_t>(u_knots.size()) - u_degree - 1;
+  uint32_t v_points = static_cast<uint32_t>(v_knots.size()) - v_degree - 1;
+  control_points.resize(u_points);
+  for (uint32_t u_index = 0; u_index < u_points; ++u_index) {
+    for (uint32_t v_index = 0; v_index < v_points; ++v_index) {
+      double u_val = static_cast<double>(u_index);
+      double v_val = static_cast<double>(v_index);
+      double weight =
+          1.0 + (0.5 * static_cast<double>((u_index + v_index) % 3));
+      control_points[u_index].push_back(
+          {u_val * weight, v_val * weight, u_val * v_val, weight});
+    }
+  }
+  NURBSSurface surface(u_degree, v_degree, u_knots, v_knots, control_points,
+                       {0.0, 3.0}, {0.0, 4.0});
+
+  BezierPatchSet patches;
+  surface.Decompose(patches);
+  ASSERT_EQ(patches.u_count(), 3);
+  ASSERT_EQ(patches.v_count(), 4);
+  EXPECT_EQ(patches.net().rows(), 3 * (u_degree + 1));
+  EXPECT_EQ(patches.net().cols(), 4 * (v_degree + 1));
+  EXPECT_EQ(patches.u_breaks(), (std::vector<double>{0, 1, 2, 3}));
+  EXPECT_EQ(patches.v_breaks(), (std::vector<double>{0, 1, 2, 3, 4}));
+
+  // Same patches as the vector decomposition, to the bit
+  std::vector<std::vector<BezierSurface>> surfaces = surface.Decompose();
+  for (size_t i = 0; i < patches.u_count(); ++i) {
+    for (size_t j = 0; j < patches.v_count(); ++j) {
+      const ControlNet<Point4D> &net = surfaces[i][j].control_net();
+      for (size_t u = 0; u <= u_degree; ++u) {
+        for (size_t v = 0; v <= v_degree; ++v) {
+          Point4D a = net(u, v);
+          Point4D b = patches.net()((i * (u_degree + 1)) + u,
+                                    (j * (v_degree + 1)) + v);
+          EXPECT_EQ(a.x, b.x);
+          EXPECT_EQ(a.y, b.y);
+          EXPECT_EQ(a.z, b.z);
+          EXPECT_EQ(a.w, b.w);
+        }
+      }
+    }
+  }
+
+  for (int32_t i = 0; i <= 30; ++i) {
+    for (int32_t j = 0; j <= 40; ++j) {
+      Point2D uv = {static_cast<double>(i) * 0.1,
+                    static_cast<double>(j) * 0.1};
+      Point3D point_nurbs = surface.EvaluatePoint(uv);
+      Point3D point_set = patches.EvaluatePoint(uv);
+      EXPECT_NEAR(point_nurbs.x, point_set.x, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.y, point_set.y, kTestEpsilon);
+      EXPECT_NEAR(point_nurbs.z, point_set.z, kTestEpsilon);
+
+      ControlHullBounds bounds =
+          patches.Bounds(std::min(i / 10, 2), std::min(j / 10, 3));
+      EXPECT_LE(bounds.min.y, point_set.y + kTestEpsilon);
+      EXPECT_GE(bounds.max.y, point_set.y - kTestEpsilon);
+    }
+  }
+
+  // A pool writes the same arena
+  ThreadPool pool(3);
+  BezierPatchSet pooled;
+  surface.Decompose(pooled, &pool);
+  for (uint32_t c = 0; c < ControlNet<Point4D>::kDimension; ++c) {
+    for (size_t u = 0; u < pooled.net().rows(); ++u) {
+      for (size_t v = 0; v < pooled.net().cols(); ++v) {
+        size_t index = pooled.net().Index(u, v);
+        EXPECT_EQ(pooled.net().plane(c)[index],
+                  patches.net().plane(c)[index]);
+      }
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, RemoveKnotsInverse3D) {
+  constexpr double kTestEpsilon = 1e-12;
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2},     {1, 1, 4, 1}, {2, 0, 6, 2},
+      {2, 0, 2, 1}, {3, 1.5, 0, 1.5}, {3, 1, 3, 1}, {6, 0, 10, 2},
+      {4, 0, 5, 1}, {4, 1, 3, 1}};
+  NURBSCurve3D nurbs_curve(degree, control_points, knots, {0.0, 5.0});
+
+  // Removing what an insertion added gives the curve back
+  NURBSCurve3D curve = nurbs_curve.KnotInsertion(2.5, 2);
+  EXPECT_EQ(curve.RemoveKnots(2.5, 3, 1e-9), 2);
+  ASSERT_EQ(curve.knots(), knots);
+  ASSERT_EQ(curve.control_points().size(), control_points.size());
+  for (size_t i = 0; i < control_points.size(); ++i) {
+    EXPECT_NEAR(curve.control_points()[i].x, control_points[i].x,
+                kTestEpsilon);
+    EXPECT_NEAR(curve.control_points()[i].y, control_points[i].y,
+                kTestEpsilon);
+    EXPECT_NEAR(curve.control_points()[i].z, control_points[i].z,
+                kTestEpsilon);
+    EXPECT_NEAR(curve.control_points()[i].w, control_points[i].w,
+                kTestEpsilon);
+  }
+
+  // The original knots change the shape, a tight tolerance keeps them
+  NURBSCurve3D kept = nurbs_curve.KnotRemoval(1.0, 1, 1e-9);
+  EXPECT_EQ(kept.knots(), knots);
+  EXPECT_EQ(nurbs_curve.KnotRemoval(2.0, 2, 1e-9).knots(), knots);
+  // Not a knot at all
+  EXPECT_EQ(nurbs_curve.KnotRemoval(1.5, 1, 1.0).knots(), knots);
+
+  // A loose one lets it go, and the curve stays within the tolerance
+  NURBSCurve3D loose = nurbs_curve.KnotRemoval(3.0, 1, 50.0);
+  ASSERT_EQ(loose.knots().size(), knots.size() - 1);
+  for (int32_t i = 0; i <= 100; ++i) {
+    double location = static_cast<double>(i) * 0.05;
+    Point3D a = nurbs_curve.EvaluateCurve(location);
+    Point3D b = loose.EvaluateCurve(location);
+    EXPECT_LE(Length(a - b), 50.0);
+  }
+}
+
+TEST(NURBS_Chapter5, SimplifyCurve2D) {
+  constexpr double kTestEpsilon = 1e-9;
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  Point2D interval = {0.0, 5.0};
+  std::vector<Point3D> control_points = {
+      {0, 0, 1}, {0, 2, 2}, {1, 1, 1}, {2, 0, 2}, {2, 0, 1},
+      {3, 1.5, 1.5}, {3, 1, 1}, {6, 0, 2}, {4, 0, 1}, {4, 1, 1}};
+  NURBSCurve2D nurbs_curve(degree, control_points, knots, interval);
+
+  // An exporter that split every span in four
+  NURBSCurve2D refined =
+      nurbs_curve.MergeKnotVect({0.25, 0.5, 0.75, 1.25, 1.5, 1.75, 2.25, 2.5,
+                                 2.75, 3.25, 3.5, 3.75, 4.25, 4.5, 4.75});
+  ASSERT_EQ(refined.control_points().size(), 25);
+
+  knots::RemovalReport report = refined.Simplify(kTestEpsilon);
+  EXPECT_EQ(report.knots_removed, 15);
+  EXPECT_EQ(report.control_points_before, 25);
+  EXPECT_EQ(report.control_points_after, 10);
+  EXPECT_DOUBLE_EQ(report.ReductionRatio(), 0.6);
+  EXPECT_LE(report.error_bound, kTestEpsilon);
+  EXPECT_EQ(refined.knots(), knots);
+
+  for (int32_t i = 0; i <= 100; ++i) {
+    double location = static_cast<double>(i) * 0.05;
+    Point2D a = nurbs_curve.EvaluateCurve(location);
+    Point2D b = refined.EvaluateCurve(location);
+    EXPECT_NEAR(a.x, b.x, kTestEpsilon);
+    EXPECT_NEAR(a.y, b.y, kTestEpsilon);
+  }
+}
+
+TEST(NURBS_Chapter5, SimplifySurface) {
+  constexpr double kTestEpsilon = 1e-9;
+  uint32_t u_degree = 3;
+  uint32_t v_degree = 2;
+  std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 2, 3, 3, 3, 3};
+  std::vector<double> v_knots = {0, 0, 0, 1, 1, 2, 2, 2, 3, 4, 4, 4};
+  std::vector<std::vector<Point4D>> control_points;
+  uint32_t u_points = static_cast<uint32_t>(u_knots.size()) - u_degree - 1;
+  uint32_t v_points = static_cast<uint32_t>(v_knots.size()) - v_degree - 1;
+  control_points.resize(u_points);
+  for (uint32_t u_index = 0; u_index < u_points; ++u_index) {
+    for (uint32_t v_index = 0; v_index < v_points; ++v_index) {
+      double u_val = static_cast<double>(u_index);
+      double v_val = static_cast<double>(v_index);
+      double weight =
+          1.0 + (0.5 * static_cast<double>((u_index + v_index) % 3));
+      control_points[u_index].push_back(
+          {u_val * weight, v_val * weight, u_val * v_val, weight});
+    }
+  }
+  NURBSSurface surface(u_degree, v_degree, u_knots, v_knots, control_points,
+                       {0.0, 3.0}, {0.0, 4.0});
+  NURBSSurface refined =
+      surface.RefineKnotVect({0.5, 1.5, 2.5}, NURBSSurface::kUDir)
+          .RefineKnotVect({0.5, 1.5, 2.5, 3.5}, NURBSSurface::kVDir);
+
+  // One knot back out of every column
+  NURBSSurface removed =
+      refined.KnotRemove(NURBSSurface::kUDir, 1.5, 2, kTestEpsilon);
+  EXPECT_EQ(removed.u_knots().size(), refined.u_knots().size() - 1);
+  EXPECT_EQ(removed.control_polygon().rows(),
+            refined.control_polygon().rows() - 1);
+
+  knots::RemovalReport report;
+  NURBSSurface simplified = refined.Simplify(kTestEpsilon, &report);
+  EXPECT_EQ(report.knots_removed, 7);
+  EXPECT_EQ(report.control_points_before, 10 * 13);
+  EXPECT_EQ(report.control_points_after, u_points * v_points);
+  EXPECT_LE(report.error_bound, kTestEpsilon);
+  EXPECT_EQ(simplified.u_knots(), u_knots);
+  EXPECT_EQ(simplified.v_knots(), v_knots);
+
+  for (int32_t i = 0; i <= 30; ++i) {
+    for (int32_t j = 0; j <= 40; ++j) {
+      Point2D uv = {static_cast<double>(i) * 0.1,
+                    static_cast<double>(j) * 0.1};
+      Point3D a = surface.EvaluatePoint(uv);
+      Point3D b = simplified.EvaluatePoint(uv);
+      EXPECT_NEAR(a.x, b.x, kTestEpsilon);
+      EXPECT_NEAR(a.y, b.y, kTestEpsilon);
+      EXPECT_NEAR(a.z, b.z, kTestEpsilon);
+    }
+  }
+}
+TEST(NURBS_Chapter5, DegreeElevateReduce3D) {
+  constexpr double kTestEpsilon = 1e-9;
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2},     {1, 1, 4, 1}, {2, 0, 6, 2},
+      {2, 0, 2, 1}, {3, 1.5, 0, 1.5}, {3, 1, 3, 1}, {6, 0, 10, 2},
+      {4, 0, 5, 1}, {4, 1, 3, 1}};
+  NURBSCurve3D nurbs_curve(degree, control_points, knots, {0.0, 5.0});
+
+  // Every distinct knot gets two more copies, the shape stays
+  NURBSCurve3D elevated = nurbs_curve.DegreeElevation(2);
+  std::vector<double> elevated_knots = {0, 0, 0, 0, 0, 0, 1, 1, 1, 2, 2, 2,
+                                        2, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5,
+                                        5, 5};
+  EXPECT_EQ(elevated.degree(), 5);
+  EXPECT_EQ(elevated.knots(), elevated_knots);
+  EXPECT_EQ(elevated.control_points().size(), 20);
+  for (int32_t i = 0; i <= 100; ++i) {
+    double location = static_cast<double>(i) * 0.05;
+    Point3D a = nurbs_curve.EvaluateCurve(location);
+    Point3D b = elevated.EvaluateCurve(location);
+    EXPECT_NEAR(a.x, b.x, kTestEpsilon);
+    EXPECT_NEAR(a.y, b.y, kTestEpsilon);
+    EXPECT_NEAR(a.z, b.z, kTestEpsilon);
+  }
+
+  // Reducing what an elevation added gives the curve back
+  degree::ReductionReport report = elevated.ReduceDegree(kTestEpsilon);
+  EXPECT_TRUE(report.reduced);
+  EXPECT_LE(report.error_bound, kTestEpsilon);
+  report = elevated.ReduceDegree(kTestEpsilon);
+  EXPECT_TRUE(report.reduced);
+  EXPECT_EQ(elevated.degree(), degree);
+  ASSERT_EQ(elevated.knots(), knots);
+  ASSERT_EQ(elevated.control_points().size(), control_points.size());
+  for (size_t i = 0; i < control_points.size(); ++i) {
+    EXPECT_NEAR(elevated.control_points()[i].x, control_points[i].x,
+                kTestEpsilon);
+    EXPECT_NEAR(elevated.control_points()[i].y, control_points[i].y,
+                kTestEpsilon);
+    EXPECT_NEAR(elevated.control_points()[i].z, control_points[i].z,
+                kTestEpsilon);
+    EXPECT_NEAR(elevated.control_points()[i].w, control_points[i].w,
+                kTestEpsilon);
+  }
+
+  // A true cubic does not reduce under a tight tolerance, and stays as it was
+  NURBSCurve3D kept = nurbs_curve;
+  report = kept.ReduceDegree(kTestEpsilon);
+  EXPECT_FALSE(report.reduced);
+  EXPECT_EQ(kept.degree(), degree);
+  EXPECT_EQ(kept.knots(), knots);
+}
+
+TEST(NURBS_Chapter5, DegreeReduceBound2D) {
+  std::vector<double> knots = {0, 0, 0, 1, 2, 2, 2};
+  std::vector<Point3D> control_points = {
+      {0, 0, 1}, {1, 2, 1}, {3, 2, 1}, {4, 0, 1}};
+  NURBSCurve2D quadratic(2, control_points, knots, {0.0, 2.0});
+
+  // A cubic a little off a quadratic goes down to degree two, and stays
+  // within the bound it reports
+  std::vector<Point3D> cubic_points =
+      quadratic.DegreeElevation(1).control_points();
+  cubic_points[2].y += 0.01;
+  NURBSCurve2D cubic(3, cubic_points, {0, 0, 0, 0, 1, 1, 2, 2, 2, 2},
+                     {0.0, 2.0});
+  NURBSCurve2D reduced = cubic;
+  degree::ReductionReport report = reduced.ReduceDegree(0.1);
+  ASSERT_TRUE(report.reduced);
+  EXPECT_EQ(reduced.degree(), 2);
+  EXPECT_EQ(reduced.knots(), knots);
+  EXPECT_GT(report.error_bound, 0.0);
+  EXPECT_LE(report.error_bound, 0.1);
+  for (int32_t i = 0; i <= 40; ++i) {
+    double location = static_cast<double>(i) * 0.05;
+    Point2D a = cubic.EvaluateCurve(location);
+    Point2D b = reduced.EvaluateCurve(location);
+    EXPECT_LE(Length(a - b), report.error_bound + 1e-12);
+  }
+
+  // Below the bound it does not go through, and the curve stays as it was
+  NURBSCurve2D kept = cubic;
+  EXPECT_FALSE(kept.ReduceDegree(report.error_bound * 0.5).reduced);
+  EXPECT_EQ(kept.degree(), 3);
+  EXPECT_EQ(kept.control_points().size(), cubic_points.size());
+}
+
+TEST(NURBS_Chapter5, MakeCompatibleCurves) {
+  constexpr double kTestEpsilon = 1e-9;
+  std::vector<NURBSCurve3D> curves = {
+      NURBSCurve3D(2,
+                   {{0, 0, 0, 1}, {1, 2, 0, 1}, {2, 0, 0, 1}, {3, 1, 0, 1}},
+                   {0, 0, 0, 0.5, 1, 1, 1}),
+      NURBSCurve3D(3,
+                   {{0, 0, 1, 1},
+                    {2, 2, 2, 2},
+                    {2, 1, 1, 1},
+                    {3, 0, 1, 1},
+                    {4, 1, 1, 1}},
+                   {0, 0, 0, 0, 0.25, 1, 1, 1, 1}),
+      NURBSCurve3D(1, {{0, 0, 2, 1}, {1, 1, 2, 1}, {2, 0, 2, 1}},
+                   {0, 0, 0.5, 1, 1})};
+  std::vector<NURBSCurve3D> serial = curves;
+  MakeCompatible(serial.data(), serial.size());
+
+  std::vector<double> knots = {0, 0, 0, 0, 0.25, 0.5, 0.5, 0.5, 1, 1, 1, 1};
+  for (size_t c = 0; c < curves.size(); ++c) {
+    EXPECT_EQ(serial[c].degree(), 3);
+    EXPECT_EQ(serial[c].knots(), knots);
+    EXPECT_EQ(serial[c].control_points().size(), 8);
+    for (int32_t i = 0; i <= 40; ++i) {
+      double location = static_cast<double>(i) * 0.025;
+      Point3D a = curves[c].EvaluateCurve(location);
+      Point3D b = serial[c].EvaluateCurve(location);
+      EXPECT_NEAR(a.x, b.x, kTestEpsilon);
+      EXPECT_NEAR(a.y, b.y, kTestEpsilon);
+      EXPECT_NEAR(a.z, b.z, kTestEpsilon);
+    }
+  }
+
+  // Split between threads, the curves come out the same
+  ThreadPool pool(3);
+  std::vector<NURBSCurve3D> pooled = curves;
+  MakeCompatible(pooled.data(), pooled.size(), &pool);
+  for (size_t c = 0; c < curves.size(); ++c) {
+    EXPECT_EQ(pooled[c].knots(), serial[c].knots());
+    ASSERT_EQ(pooled[c].control_points().size(),
+              serial[c].control_points().size());
+    for (size_t i = 0; i < serial[c].control_points().size(); ++i) {
+      EXPECT_EQ(pooled[c].control_points()[i].x,
+                serial[c].control_points()[i].x);
+      EXPECT_EQ(pooled[c].control_points()[i].y,
+                serial[c].control_points()[i].y);
+      EXPECT_EQ(pooled[c].control_points()[i].z,
+                serial[c].control_points()[i].z);
+      EXPECT_EQ(pooled[c].control_points()[i].w,
+                serial[c].control_points()[i].w);
+    }
+  }
+}
+
+TEST(NURBS_Chapter5, DegreeElevateReduceSurface) {
+  NURBSSurface surface = MakeDenseSurface();
+  ThreadPool pool(4);
+  for (auto dir : {NURBSSurface::kUDir, NURBSSurface::kVDir}) {
+    NURBSSurface serial = surface.DegreeElevate(dir, 1);
+    NURBSSurface pooled = surface.DegreeElevate(dir, 1, &pool);
+    EXPECT_EQ(pooled.u_degree(), dir == NURBSSurface::kUDir ? 4 : 3);
+    EXPECT_EQ(pooled.v_degree(), dir == NURBSSurface::kUDir ? 3 : 4);
+    EXPECT_EQ(serial.u_knots(), pooled.u_knots());
+    EXPECT_EQ(serial.v_knots(), pooled.v_knots());
+    ExpectSameNet(serial.control_polygon(), pooled.control_polygon());
+    for (double t = 0.0; t < 67.0; t += 3.3) {
+      Point3D a = surface.EvaluatePoint({t, 67.0 - t});
+      Point3D b = pooled.EvaluatePoint({t, 67.0 - t});
+      EXPECT_NEAR(a.x, b.x, 1e-9);
+      EXPECT_NEAR(a.y, b.y, 1e-9);
+      EXPECT_NEAR(a.z, b.z, 1e-9);
+    }
+
+    // And back down, to the net it started from
+    degree::ReductionReport report;
+    NURBSSurface reduced = pooled.DegreeReduce(dir, 1e-9, &report, &pool);
+    EXPECT_TRUE(report.reduced);
+    EXPECT_LE(report.error_bound, 1e-9);
+    EXPECT_EQ(reduced.u_knots(), surface.u_knots());
+    EXPECT_EQ(reduced.v_knots(), surface.v_knots());
+    ASSERT_EQ(reduced.control_polygon().rows(),
+              surface.control_polygon().rows());
+    ASSERT_EQ(reduced.control_polygon().cols(),
+              surface.control_polygon().cols());
+    for (size_t u = 0; u < surface.control_polygon().rows(); u += 7) {
+      for (size_t v = 0; v < surface.control_polygon().cols(); v += 7) {
+        Point4D a = surface.control_polygon()(u, v);
+        Point4D b = reduced.control_polygon()(u, v);
+        EXPECT_NEAR(a.x, b.x, 1e-6);
+        EXPECT_NEAR(a.y, b.y, 1e-6);
+        EXPECT_NEAR(a.z, b.z, 1e-6);
+        EXPECT_NEAR(a.w, b.w, 1e-6);
+      }
+    }
+
+    // The cubic net does not reduce, the copy keeps its degrees
+    NURBSSurface kept = surface.DegreeReduce(dir, 1e-9, &report);
+    EXPECT_FALSE(report.reduced);
+    EXPECT_EQ(kept.u_degree(), 3);
+    EXPECT_EQ(kept.v_degree(), 3);
+  }
+}
+}  // namespace nurbs
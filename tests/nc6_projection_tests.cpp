@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include "include/nurbs_curve.hpp"
+#include "include/nurbs_surface.hpp"
+#include "include/point_projection.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <cmath>
+
+namespace nurbs {
+namespace {
+NURBSCurve3D MakeCurve() {
+  uint32_t degree = 3;
+  std::vector<double> knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 5, 5, 5, 5};
+  std::vector<Point4D> control_points = {
+      {0, 0, 1, 1}, {0, 2, 4, 2},     {1, 1, 4, 1}, {2, 0, 6, 2},
+      {2, 0, 2, 1}, {3, 1.5, 0, 1.5}, {3, 1, 3, 1}, {6, 0, 10, 2},
+      {4, 0, 5, 1}, {4, 1, 3, 1}};
+  return NURBSCurve3D(degree, control_points, knots, {0.0, 5.0});
+}
+
+NURBSSurface MakeSurface() {
+  std::vector<double> u_knots = {0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 1, 2, 3, 4, 4, 4};
+  std::vector<std::vector<Point4D>> control_points(8);
+  for (size_t i = 0; i < 8; ++i) {
+    for (size_t j = 0; j < 6; ++j) {
+      double u_val = static_cast<double>(i);
+      double v_val = static_cast<double>(j);
+      double w = 1.0 + (0.25 * static_cast<double>((i + j) % 3));
+      control_points[i].push_back({u_val * w, v_val * w,
+                                   std::sin(u_val) * std::cos(v_val) * w, w});
+    }
+  }
+  return NURBSSurface(3, 2, u_knots, v_knots, control_points, {0, 4},
+                      {0, 4});
+}
+
+// Closest of a dense sample of the curve, the brute force answer
+double SampledDistance(const NURBSCurve3D &curve, const Point3D &point) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int32_t i = 0; i <= 20000; ++i) {
+    double location = static_cast<double>(i) * 0.00025;
+    best = std::min(best, Length(curve.EvaluateCurve(location) - point));
+  }
+  return best;
+}
+} // namespace
+
+TEST(NURBS_Chapter6, InvertCurvePoints) {
+  NURBSCurve3D curve = MakeCurve();
+  CurveProjector projector(curve);
+  for (int32_t i = 0; i <= 50; ++i) {
+    double location = static_cast<double>(i) * 0.1;
+    CurveProjection projection =
+        projector.Project(curve.EvaluateCurve(location));
+    EXPECT_EQ(projection.status, ProjectionStatus::kCoincident);
+    EXPECT_LE(projection.distance, 1e-9);
+    EXPECT_NEAR(projection.parameter, location, 1e-7);
+  }
+}
+
+TEST(NURBS_Chapter6, ProjectCurveMatchesSampling) {
+  NURBSCurve3D curve = MakeCurve();
+  CurveProjector projector(curve);
+  for (int32_t i = 0; i < 40; ++i) {
+    double t = static_cast<double>(i);
+    Point3D point = {4.0 * std::sin(t), 2.0 * std::cos(1.3 * t),
+                     5.0 + (4.0 * std::sin(0.7 * t))};
+    CurveProjection projection = projector.Project(point);
+    EXPECT_NE(projection.status, ProjectionStatus::kMaxIterations);
+    Point3D on_curve = curve.EvaluateCurve(projection.parameter);
+    EXPECT_NEAR(Length(on_curve - point), projection.distance, 1e-12);
+    // Never worse than the dense sample, and the sample is near the answer
+    double sampled = SampledDistance(curve, point);
+    EXPECT_LE(projection.distance, sampled + 1e-12);
+    EXPECT_GE(projection.distance, sampled - 1e-3);
+    // Inside the interval the offset is perpendicular to the curve
+    if (projection.parameter > 0.0 && projection.parameter < 5.0) {
+      std::vector<Point3D> ders = curve.EvaluateDerivative(
+          projection.parameter, 1);
+      EXPECT_LE(std::abs(Dot(ders[1], on_curve - point)),
+                1e-6 * Length(ders[1]) * projection.distance);
+    }
+  }
+}
+
+TEST(NURBS_Chapter6, ProjectCurveClampsToEnds) {
+  NURBSCurve3D curve = MakeCurve();
+  CurveProjector projector(curve);
+  Point3D start = curve.EvaluateCurve(0.0);
+  Point3D end = curve.EvaluateCurve(5.0);
+  CurveProjection before = projector.Project(start + Point3D(-3, -3, -3));
+  EXPECT_EQ(before.status, ProjectionStatus::kConverged);
+  EXPECT_EQ(before.parameter, 0.0);
+  CurveProjection after = projector.Project(end + Point3D(3, 0, 0));
+  EXPECT_EQ(after.status, ProjectionStatus::kConverged);
+  EXPECT_EQ(after.parameter, 5.0);
+
+  // Started next to the answer, Newton does not need the seed search
+  CurveProjection near = projector.Project(curve.EvaluateCurve(2.5), 2.4);
+  EXPECT_EQ(near.status, ProjectionStatus::kCoincident);
+  EXPECT_NEAR(near.parameter, 2.5, 1e-7);
+}
+
+TEST(NURBS_Chapter6, ProjectCurveBatchPool) {
+  NURBSCurve3D curve = MakeCurve();
+  CurveProjector projector(curve);
+  std::vector<Point3D> points;
+  for (int32_t i = 0; i < 1000; ++i) {
+    double t = static_cast<double>(i) * 0.01;
+    points.push_back({4.0 * std::sin(t), std::cos(3.0 * t), 0.5 * t});
+  }
+  std::vector<CurveProjection> serial(points.size());
+  std::vector<CurveProjection> pooled(points.size());
+  ThreadPool pool(3);
+  projector.Project(points.data(), points.size(), serial.data());
+  projector.Project(points.data(), points.size(), pooled.data(), &pool);
+  for (size_t i = 0; i < points.size(); ++i) {
+    CurveProjection single = projector.Project(points[i]);
+    EXPECT_EQ(serial[i].parameter, single.parameter);
+    EXPECT_EQ(pooled[i].parameter, single.parameter);
+    EXPECT_EQ(pooled[i].distance, single.distance);
+    EXPECT_EQ(pooled[i].status, single.status);
+  }
+}
+
+TEST(NURBS_Chapter6, InvertSurfacePoints) {
+  NURBSSurface surface = MakeSurface();
+  SurfaceProjector projector(surface);
+  for (int32_t i = 0; i <= 20; ++i) {
+    for (int32_t j = 0; j <= 20; ++j) {
+      Point2D uv = {static_cast<double>(i) * 0.2,
+                    static_cast<double>(j) * 0.2};
+      SurfaceProjection projection =
+          projector.Project(surface.EvaluatePoint(uv));
+      EXPECT_EQ(projection.status, ProjectionStatus::kCoincident);
+      EXPECT_LE(projection.distance, 1e-9);
+      EXPECT_NEAR(projection.uv.x, uv.x, 1e-7);
+      EXPECT_NEAR(projection.uv.y, uv.y, 1e-7);
+    }
+  }
+}
+
+TEST(NURBS_Chapter6, ProjectSurfaceAlongNormal) {
+  NURBSSurface surface = MakeSurface();
+  SurfaceProjector projector(surface);
+  constexpr double kOffset = 0.05;
+  for (int32_t i = 1; i < 10; ++i) {
+    for (int32_t j = 1; j < 10; ++j) {
+      Point2D uv = {static_cast<double>(i) * 0.4,
+                    static_cast<double>(j) * 0.4};
+      Point3D normal = surface.Normal(uv);
+      Point3D point = surface.EvaluatePoint(uv) + (kOffset * normal);
+      SurfaceProjection projection = projector.Project(point);
+      EXPECT_EQ(projection.status, ProjectionStatus::kConverged);
+      EXPECT_NEAR(projection.distance, kOffset, 1e-9);
+      EXPECT_NEAR(projection.uv.x, uv.x, 1e-7);
+      EXPECT_NEAR(projection.uv.y, uv.y, 1e-7);
+    }
+  }
+
+  // Off the side of the surface the answer is on its boundary
+  SurfaceProjection side =
+      projector.Project(surface.EvaluatePoint({4.0, 2.0}) + Point3D(5, 0, 0));
+  EXPECT_NE(side.status, ProjectionStatus::kMaxIterations);
+  EXPECT_EQ(side.uv.x, 4.0);
+}
+
+TEST(NURBS_Chapter6, ProjectSurfaceBatchPool) {
+  NURBSSurface surface = MakeSurface();
+  SurfaceProjector projector(surface);
+  std::vector<Point3D> points;
+  for (int32_t i = 0; i < 600; ++i) {
+    double t = static_cast<double>(i) * 0.01;
+    points.push_back({(4.0 * t) / 3.0, 3.0 + (2.0 * std::sin(t)),
+                      std::cos(2.0 * t)});
+  }
+  std::vector<SurfaceProjection> serial(points.size());
+  std::vector<SurfaceProjection> pooled(points.size());
+  ThreadPool pool(3);
+  projector.Project(points.data(), points.size(), serial.data());
+  projector.Project(points.data(), points.size(), pooled.data(), &pool);
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(serial[i].uv.x, pooled[i].uv.x);
+    EXPECT_EQ(serial[i].uv.y, pooled[i].uv.y);
+    EXPECT_EQ(serial[i].distance, pooled[i].distance);
+    EXPECT_EQ(serial[i].status, pooled[i].status);
+    EXPECT_NE(serial[i].status, ProjectionStatus::kMaxIterations);
+  }
+}
+} // namespace nurbs
@@ -0,0 +1,370 @@
+#include <gtest/gtest.h>
+
+// NURBS_CPP
+#include "include/adaptive_tessellator.hpp"
+#include "include/b_spline_curve.hpp"
+#include "include/b_spline_surface.hpp"
+#include "include/bezier_curve.hpp"
+#include "include/curve_flattener.hpp"
+#include "include/nurbs_curve.hpp"
+#include "include/nurbs_surface.hpp"
+#include "include/tessellation_engine.hpp"
+#include "include/thread_pool.hpp"
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <stdexcept>
+
+namespace nurbs {
+namespace {
+BSplineSurface MakeBSplineSurface(double offset) {
+  std::vector<double> u_knots = {0, 0, 0, 0, 0, 1, 2, 2, 3, 4, 4, 4, 4, 4};
+  std::vector<double> v_knots = {0, 0, 0, 0, 1, 1, 2, 3, 3, 4, 4, 4, 4};
+  std::vector<std::vector<Point3D>> control_points(9);
+  for (size_t i = 0; i < 9; ++i) {
+    for (size_t j = 0; j < 9; ++j) {
+      double u_val = static_cast<double>(i);
+      double v_val = static_cast<double>(j);
+      control_points[i].push_back(
+          {u_val, v_val, std::sin(u_val + offset) * std::cos(v_val)});
+    }
+  }
+  return BSplineSurface(4, 3, u_knots, v_knots, control_points, {0, 4},
+                        {0, 4});
+}
+
+// Every edge has to be shared by two triangles with opposite directions,
+// unless it lies on the border of the parameter domain
+void ExpectCrackFree(const SurfaceMesh &mesh) {
+  std::map<std::pair<uint32_t, uint32_t>, int> edges;
+  for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+    for (size_t k = 0; k < 3; ++k) {
+      uint32_t a = mesh.indices[t + k];
+      uint32_t b = mesh.indices[t + ((k + 1) % 3)];
+      int &uses = edges[std::make_pair(a, b)];
+      EXPECT_EQ(uses++, 0) << "edge used twice in one direction";
+    }
+  }
+  auto on_border = [&](uint32_t a, uint32_t b) {
+    for (size_t c = 0; c < 2; ++c) {
+      float ua = mesh.uvs[(2 * a) + c];
+      float ub = mesh.uvs[(2 * b) + c];
+      if (ua == ub && (ua == 0.0f || ua == 1.0f)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (const auto &edge : edges) {
+    if (edges.count(std::make_pair(edge.first.second, edge.first.first)) ==
+        0) {
+      EXPECT_TRUE(on_border(edge.first.first, edge.first.second))
+          << edge.first.first << " " << edge.first.second;
+    }
+  }
+}
+
+NURBSSurface MakeNURBSSurface() {
+  std::vector<double> knots = {0, 0, 0, 0, 0.5, 1, 1, 1, 1};
+  std::vector<std::vector<Point4D>> control_points(5);
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      double w = 1.0 + (0.25 * static_cast<double>((i + j) % 3));
+      control_points[i].push_back({static_cast<double>(i) * w,
+                                   static_cast<double>(j) * w, w, w});
+    }
+  }
+  return NURBSSurface(3, 3, knots, knots, control_points);
+}
+} // namespace
+
+TEST(Tessellation, ThreadPoolRunsEveryIndexOnce) {
+  for (uint32_t threads : {0u, 1u, 3u}) {
+    ThreadPool pool(threads);
+    std::vector<std::atomic<int>> counts(1000);
+    pool.ParallelFor(counts.size(), [&](size_t i) { counts[i]++; });
+    for (auto &count : counts) {
+      EXPECT_EQ(count.load(), 1);
+    }
+    // Nested batches run on the same pool
+    std::atomic<int> total{0};
+    pool.ParallelFor(8, [&](size_t) {
+      pool.ParallelFor(16, [&](size_t) { total++; });
+    });
+    EXPECT_EQ(total.load(), 8 * 16);
+  }
+}
+
+TEST(Tessellation, ThreadPoolRethrows) {
+  ThreadPool pool(2);
+  std::atomic<int> ran{0};
+  EXPECT_THROW(pool.ParallelFor(64,
+                                [&](size_t i) {
+                                  ran++;
+                                  if (i == 17) {
+                                    throw std::runtime_error("tile failed");
+                                  }
+                                }),
+               std::runtime_error);
+  // The rest of the batch still ran
+  EXPECT_EQ(ran.load(), 64);
+}
+
+TEST(Tessellation, MatchesGridEvaluation) {
+  BSplineSurface b_spline = MakeBSplineSurface(0.0);
+  NURBSSurface nurbs_surface = MakeNURBSSurface();
+  const uint32_t u_count = 37;
+  const uint32_t v_count = 21;
+  // Tiles that do not divide the rows evenly
+  TessellationEngine engine(2, 5);
+  SurfaceMesh mesh = engine.Tessellate({&b_spline, &nurbs_surface}, u_count,
+                                       v_count);
+  ASSERT_EQ(mesh.patches.size(), 2);
+  ASSERT_EQ(mesh.positions.size(), 3 * 2 * u_count * v_count);
+  ASSERT_EQ(mesh.indices.size(), 2 * (u_count - 1) * (v_count - 1) * 6);
+
+  const Surface *surfaces[2] = {&b_spline, &nurbs_surface};
+  for (size_t p = 0; p < 2; ++p) {
+    const SurfaceMesh::Patch &patch = mesh.patches[p];
+    EXPECT_EQ(patch.vertex_offset, p * u_count * v_count);
+    std::vector<Point3D> points = surfaces[p]->EvaluatePoints(u_count, v_count);
+    for (size_t i = 0; i < points.size(); ++i) {
+      const float *position =
+          mesh.positions.data() + (3 * (patch.vertex_offset + i));
+      EXPECT_EQ(position[0], static_cast<float>(points[i].x));
+      EXPECT_EQ(position[1], static_cast<float>(points[i].y));
+      EXPECT_EQ(position[2], static_cast<float>(points[i].z));
+    }
+    // First and last cell of the patch
+    const uint32_t *first = mesh.indices.data() + patch.index_offset;
+    EXPECT_EQ(first[0], patch.vertex_offset);
+    EXPECT_EQ(first[1], patch.vertex_offset + v_count);
+    EXPECT_EQ(first[2], patch.vertex_offset + 1);
+    const uint32_t *last = first + ((u_count - 1) * (v_count - 1) * 6) - 6;
+    EXPECT_EQ(last[5], patch.vertex_offset + (u_count * v_count) - 1);
+  }
+}
+
+TEST(Tessellation, DeterministicAcrossThreadCounts) {
+  std::vector<BSplineSurface> patches;
+  for (uint32_t i = 0; i < 12; ++i) {
+    patches.push_back(MakeBSplineSurface(static_cast<double>(i)));
+  }
+  std::vector<const Surface *> surfaces;
+  for (const BSplineSurface &patch : patches) {
+    surfaces.push_back(&patch);
+  }
+  TessellationEngine serial(0);
+  SurfaceMesh expected = serial.Tessellate(surfaces, 40, 33);
+  for (uint32_t threads : {1u, 2u, 5u}) {
+    TessellationEngine engine(threads, 3);
+    SurfaceMesh mesh = engine.Tessellate(surfaces, 40, 33);
+    EXPECT_EQ(mesh.positions, expected.positions) << threads;
+    EXPECT_EQ(mesh.indices, expected.indices) << threads;
+  }
+}
+
+TEST(Tessellation, AdaptiveFlatSurface) {
+  // A plane only needs the base cells
+  BSplineSurface plane(1, 1, {0, 0, 1, 1}, {0, 0, 1, 1},
+                       {{{0, 0, 0}, {0, 2, 0}}, {{3, 0, 0}, {3, 2, 0}}});
+  AdaptiveTessellator::Options options;
+  options.base_cells = 4;
+  SurfaceMesh mesh = AdaptiveTessellator(options).Tessellate(plane);
+  EXPECT_EQ(mesh.positions.size(), 3 * 25);
+  EXPECT_EQ(mesh.indices.size(), 3 * 32);
+  ASSERT_EQ(mesh.normals.size(), mesh.positions.size());
+  for (size_t i = 0; i < mesh.normals.size(); i += 3) {
+    EXPECT_EQ(mesh.normals[i], 0.0f);
+    EXPECT_EQ(mesh.normals[i + 1], 0.0f);
+    EXPECT_EQ(mesh.normals[i + 2], 1.0f);
+  }
+  ExpectCrackFree(mesh);
+}
+
+TEST(Tessellation, AdaptiveCurvedSurface) {
+  BSplineSurface b_spline = MakeBSplineSurface(0.0);
+  NURBSSurface nurbs_surface = MakeNURBSSurface();
+  const Surface *surfaces[2] = {&b_spline, &nurbs_surface};
+  for (const Surface *surface : surfaces) {
+    AdaptiveTessellator::Options options;
+    options.chordal_tolerance = 1e-2;
+    SurfaceMesh coarse = AdaptiveTessellator(options).Tessellate(*surface);
+    options.chordal_tolerance = 1e-4;
+    options.angle_tolerance = 0.05;
+    SurfaceMesh fine = AdaptiveTessellator(options).Tessellate(*surface);
+    EXPECT_LT(coarse.indices.size(), fine.indices.size());
+    ExpectCrackFree(coarse);
+    ExpectCrackFree(fine);
+
+    // Vertices sit on the surface
+    const Point2D u_interval = surface->u_interval();
+    const Point2D v_interval = surface->v_interval();
+    for (size_t i = 0; i < fine.positions.size() / 3; ++i) {
+      Point2D uv = {
+          u_interval.x + (u_interval.y - u_interval.x) * fine.uvs[2 * i],
+          v_interval.x + (v_interval.y - v_interval.x) * fine.uvs[(2 * i) + 1]};
+      Point3D point = surface->EvaluatePoint(uv);
+      EXPECT_NEAR(fine.positions[3 * i], point.x, 1e-5);
+      EXPECT_NEAR(fine.positions[(3 * i) + 1], point.y, 1e-5);
+      EXPECT_NEAR(fine.positions[(3 * i) + 2], point.z, 1e-5);
+    }
+  }
+}
+
+TEST(Tessellation, GridDerivativesMatchPoints) {
+  BSplineSurface b_spline = MakeBSplineSurface(0.5);
+  NURBSSurface nurbs_surface = MakeNURBSSurface();
+  for (const Surface *surface :
+       {static_cast<const Surface *>(&b_spline),
+        static_cast<const Surface *>(&nurbs_surface)}) {
+    std::vector<double> u_params =
+        Surface::SampleParams(surface->u_interval(), 23);
+    std::vector<double> v_params =
+        Surface::SampleParams(surface->v_interval(), 17);
+    GridDerivatives grid;
+    surface->EvaluateGridDerivatives(u_params.data(), u_params.size(),
+                                     v_params.data(), v_params.size(), true,
+                                     grid);
+    ASSERT_EQ(grid.normals.size(), u_params.size() * v_params.size());
+    ASSERT_EQ(grid.vv_partials.size(), grid.normals.size());
+    for (size_t i = 0; i < u_params.size(); ++i) {
+      for (size_t j = 0; j < v_params.size(); ++j) {
+        const size_t index = (i * v_params.size()) + j;
+        std::vector<std::vector<Point3D>> derivs =
+            surface->Derivatives({u_params[i], v_params[j]}, 2);
+        const std::pair<Point3D, Point3D> checks[6] = {
+            {grid.points[index], derivs[0][0]},
+            {grid.u_partials[index], derivs[1][0]},
+            {grid.v_partials[index], derivs[0][1]},
+            {grid.uu_partials[index], derivs[2][0]},
+            {grid.uv_partials[index], derivs[1][1]},
+            {grid.vv_partials[index], derivs[0][2]}};
+        for (const auto &check : checks) {
+          const double tolerance = 1e-12 * (Length(check.second) + 1.0);
+          EXPECT_NEAR(check.first.x, check.second.x, tolerance);
+          EXPECT_NEAR(check.first.y, check.second.y, tolerance);
+          EXPECT_NEAR(check.first.z, check.second.z, tolerance);
+        }
+        Point3D normal = Cross(derivs[1][0], derivs[0][1]);
+        normal /= Length(normal);
+        EXPECT_NEAR(Dot(grid.normals[index], normal), 1.0, 1e-12);
+      }
+    }
+    // Without second partials those buffers stay empty
+    surface->EvaluateGridDerivatives(u_params.data(), u_params.size(),
+                                     v_params.data(), v_params.size(), false,
+                                     grid);
+    EXPECT_TRUE(grid.uu_partials.empty());
+    EXPECT_EQ(grid.points.size(), u_params.size() * v_params.size());
+  }
+}
+
+TEST(Tessellation, NormalsAtDegeneratePoints) {
+  // A dome with every control point of the u = 0 row at the apex, so S_v
+  // vanishes along that row
+  std::vector<std::vector<Point3D>> control_points = {
+      {{0, 0, 1}, {0, 0, 1}, {0, 0, 1}},
+      {{1, -1, 0.5}, {1, 0, 0.5}, {1, 1, 0.5}},
+      {{2, -2, 0}, {2, 0, 0}, {2, 2, 0}}};
+  BSplineSurface dome(2, 2, {0, 0, 0, 1, 1, 1}, {0, 0, 0, 1, 1, 1},
+                      control_points);
+  Point3D apex = dome.Normal({0.0, 0.5});
+  EXPECT_NEAR(Length(apex), 1.0, 1e-12);
+  EXPECT_NEAR(Dot(apex, dome.Normal({1e-3, 0.5})), 1.0, 1e-3);
+
+  TessellationEngine engine(0);
+  SurfaceMesh mesh = engine.Tessellate(dome, 9, 7);
+  ASSERT_EQ(mesh.normals.size(), mesh.positions.size());
+  for (size_t i = 0; i < mesh.normals.size(); i += 3) {
+    const Point3D normal = {mesh.normals[i], mesh.normals[i + 1],
+                            mesh.normals[i + 2]};
+    EXPECT_NEAR(Length(normal), 1.0, 1e-6) << i / 3;
+  }
+}
+
+TEST(Tessellation, AdaptiveOptionsChecked) {
+  AdaptiveTessellator::Options options;
+  options.max_depth = AdaptiveTessellator::kMaxDepth + 1;
+  EXPECT_ANY_THROW(AdaptiveTessellator{options});
+  options.max_depth = 2;
+  options.min_depth = 3;
+  EXPECT_ANY_THROW(AdaptiveTessellator{options});
+}
+
+TEST(Tessellation, FlattenStraightCurve) {
+  // Collinear control points, every span is flat after min_depth
+  BSplineCurve2D line(2, {{0, 0}, {1, 1}, {2, 2}, {3, 3}},
+                      {0, 0, 0, 0.5, 1, 1, 1});
+  std::vector<double> params;
+  std::vector<Point2D> points = CurveFlattener().Flatten(line, &params);
+  EXPECT_EQ(points.size(), 5);
+  EXPECT_EQ(params, std::vector<double>({0, 0.25, 0.5, 0.75, 1}));
+}
+
+TEST(Tessellation, FlattenFollowsTolerance) {
+  // Quarter circle of radius 1
+  const double w = std::sqrt(0.5);
+  NURBSCurve2D arc(2, {{1, 0, 1}, {w, w, w}, {0, 1, 1}}, {0, 0, 0, 1, 1, 1});
+  size_t last_count = 0;
+  for (double tolerance : {1e-2, 1e-3, 1e-4, 1e-5}) {
+    CurveFlattener::Options options;
+    options.chordal_tolerance = tolerance;
+    options.angle_tolerance = 1.0;
+    std::vector<double> params;
+    std::vector<Point2D> points =
+        CurveFlattener(options).Flatten(arc, &params);
+    ASSERT_EQ(points.size(), params.size());
+    EXPECT_GT(points.size(), last_count);
+    last_count = points.size();
+    EXPECT_EQ(params.front(), 0.0);
+    EXPECT_EQ(params.back(), 1.0);
+    for (size_t i = 0; i < points.size(); ++i) {
+      EXPECT_NEAR(Length(points[i]), 1.0, 1e-12);
+    }
+    // Chords stay within the tolerance of the arc
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+      Point2D mid = arc.EvaluateCurve(0.5 * (params[i] + params[i + 1]));
+      Point2D chord_mid = (points[i] + points[i + 1]) * 0.5;
+      EXPECT_LE(Length(mid - chord_mid), tolerance);
+    }
+  }
+}
+
+TEST(Tessellation, FlattenKeepsBreakpoints) {
+  // The double knot at 1 is a corner
+  BSplineCurve3D corner(
+      2, {{0, 0, 0}, {0.5, 0, 0}, {1, 0, 0}, {1, 0.5, 0.5}, {1, 1, 1}},
+      {0, 0, 0, 1, 1, 2, 2, 2}, {0, 2});
+  std::vector<double> params;
+  std::vector<Point3D> points = CurveFlattener().Flatten(corner, &params);
+  ASSERT_EQ(points.size(), params.size());
+  EXPECT_EQ(std::count(params.begin(), params.end(), 1.0), 1);
+  EXPECT_EQ(params.back(), 2.0);
+
+  // A Bezier curve has no interior breakpoints, only its tight end is split
+  BezierCurve3D bezier({{0, 0, 0}, {4, 0, 0}, {4, 0.1, 0}, {4, 0.2, 0}},
+                       {-1, 1});
+  params.clear();
+  points = CurveFlattener().Flatten(bezier, &params);
+  EXPECT_EQ(params.front(), -1.0);
+  EXPECT_EQ(params.back(), 1.0);
+  size_t first_half =
+      std::count_if(params.begin(), params.end(),
+                    [](double param) { return param < 0.0; });
+  EXPECT_LT(first_half, params.size() - first_half);
+}
+
+TEST(Tessellation, FlattenOptionsChecked) {
+  CurveFlattener::Options options;
+  options.chordal_tolerance = 0.0;
+  EXPECT_ANY_THROW(CurveFlattener{options});
+  options.chordal_tolerance = 1e-3;
+  options.max_depth = CurveFlattener::kMaxDepth + 1;
+  EXPECT_ANY_THROW(CurveFlattener{options});
+}
+} // namespace nurbs
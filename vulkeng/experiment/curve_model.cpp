@@ -8,7 +8,13 @@ CurveModel::CurveModel(VulkanDevice* device,
 
 std::shared_ptr<CurveModel> CurveModel::ModelFromCurve2D(
     VulkanDevice* device, const nurbs::Curve2D& curve) {
-    const std::vector<nurbs::Point2D> points = curve.EvaluateCurvePoints(POINT_COUNT);
+    return ModelFromCurve2D(device, curve, nurbs::CurveFlattener());
+}
+
+std::shared_ptr<CurveModel> CurveModel::ModelFromCurve2D(
+    VulkanDevice* device, const nurbs::Curve2D& curve,
+    const nurbs::CurveFlattener& flattener) {
+    const std::vector<nurbs::Point2D> points = flattener.Flatten(curve);
 
     std::vector<LineModel::Vertex> vertices = {};
     vertices.reserve(points.size());
@@ -23,16 +29,23 @@ std::shared_ptr<CurveModel> CurveModel::ModelFromCurve2D(
 
 std::shared_ptr<CurveModel> CurveModel::ModelFromCurve3D(
     VulkanDevice* device, const nurbs::Curve3D& curve) {
-    const std::vector<nurbs::Point3D> points = curve.EvaluateCurvePoints(POINT_COUNT);
+    return ModelFromCurve3D(device, curve, nurbs::CurveFlattener());
+}
+
+std::shared_ptr<CurveModel> CurveModel::ModelFromCurve3D(
+    VulkanDevice* device, const nurbs::Curve3D& curve,
+    const nurbs::CurveFlattener& flattener) {
+    const std::vector<nurbs::Point3D> points = flattener.Flatten(curve);
 
     std::vector<LineModel::Vertex> vertices = {};
     vertices.reserve(points.size());
     for (const auto& point : points) {
         LineModel::Vertex v;
-        v.pos = {point.x, point.y, point.y};
-        v.color = {1.0, 0.0, 0.0};
+        v.pos = {static_cast<float>(point.x), static_cast<float>(point.y),
+                 static_cast<float>(point.z)};
+        v.color = {1.0f, 0.0f, 0.0f};
         vertices.push_back(v);
     }
     return std::make_shared<CurveModel>(device, vertices);
 }
-}  // namespace vulkeng
\ No newline at end of file
+}  // namespace vulkeng
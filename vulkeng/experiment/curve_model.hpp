@@ -2,23 +2,29 @@
 
 #include "nurbs_cpp/include/curve_2d.hpp"
 #include "nurbs_cpp/include/curve_3d.hpp"
+#include "nurbs_cpp/include/curve_flattener.hpp"
 
 #include "vulkeng/include/line_model.hpp"
 
 namespace vulkeng {
 class CurveModel : public LineModel {
-  static const uint32_t POINT_COUNT = 100;
-
  public:
   CurveModel(VulkanDevice* device, const std::vector<Vertex>& vertices);
 
   CurveModel(const CurveModel&) = delete;
   CurveModel& operator=(const CurveModel&) = delete;
 
+  // Flattened with the default nurbs::CurveFlattener options
   static std::shared_ptr<CurveModel> ModelFromCurve2D(
       VulkanDevice* device, const nurbs::Curve2D& curve);
+  static std::shared_ptr<CurveModel> ModelFromCurve2D(
+      VulkanDevice* device, const nurbs::Curve2D& curve,
+      const nurbs::CurveFlattener& flattener);
 
   static std::shared_ptr<CurveModel> ModelFromCurve3D(
       VulkanDevice* device, const nurbs::Curve3D& curve);
+  static std::shared_ptr<CurveModel> ModelFromCurve3D(
+      VulkanDevice* device, const nurbs::Curve3D& curve,
+      const nurbs::CurveFlattener& flattener);
 };
-}  // namespace vulkeng
\ No newline at end of file
+}  // namespace vulkeng
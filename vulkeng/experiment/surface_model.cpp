@@ -9,39 +9,50 @@ SurfaceModel::SurfaceModel(VulkanDevice *device,
 std::shared_ptr<SurfaceModel>
 SurfaceModel::ModelFromSurface(VulkanDevice *device,
                                const nurbs::Surface &surface) {
-  const std::vector<nurbs::Point3D> points =
-      surface.EvaluatePoints(POINT_COUNT, POINT_COUNT);
+  // Shared by every model, the workers sleep between loads
+  static nurbs::TessellationEngine engine;
+  return ModelFromSurface(device, surface, engine);
+}
 
-  TriangleModel::Builder builder;
-  builder.vertices.reserve(points.size());
-  double u_div = 1 / static_cast<double>(POINT_COUNT - 1);
-  double v_div = 1 / static_cast<double>(POINT_COUNT - 1);
+std::shared_ptr<SurfaceModel>
+SurfaceModel::ModelFromSurface(VulkanDevice *device,
+                               const nurbs::Surface &surface,
+                               nurbs::TessellationEngine &engine) {
+  return std::make_shared<SurfaceModel>(
+      device,
+      BuilderFromMesh(engine.Tessellate(surface, POINT_COUNT, POINT_COUNT)));
+}
 
-  for (size_t index = 0; index < points.size(); ++index) {
-    auto const &point = points[index];
-    size_t i = index / POINT_COUNT;
-    size_t j = index % POINT_COUNT;
-    TriangleModel::Vertex v;
-    v.pos = {static_cast<float>(point.x), static_cast<float>(point.y),
-             static_cast<float>(point.z)};
-    v.color = {1.0f, 1.0f, 1.0f};
-    v.uv = {static_cast<double>(i) * u_div, static_cast<double>(j) * v_div};
-    builder.vertices.push_back(v);
-  }
+std::shared_ptr<SurfaceModel> SurfaceModel::ModelFromSurfaces(
+    VulkanDevice *device, const std::vector<const nurbs::Surface *> &surfaces,
+    nurbs::TessellationEngine &engine) {
+  return std::make_shared<SurfaceModel>(
+      device,
+      BuilderFromMesh(engine.Tessellate(surfaces, POINT_COUNT, POINT_COUNT)));
+}
 
-  // Indicies
-  for (uint32_t i = 0; i < POINT_COUNT - 1; ++i) {   // y
-    for (uint32_t j = 0; j < POINT_COUNT - 1; ++j) { // x
-      uint32_t index = i * POINT_COUNT + j;
-      builder.indices.push_back(index);
-      builder.indices.push_back(index + POINT_COUNT);
-      builder.indices.push_back(index + 1);
+std::shared_ptr<SurfaceModel> SurfaceModel::ModelFromSurfaceAdaptive(
+    VulkanDevice *device, const nurbs::Surface &surface,
+    const nurbs::AdaptiveTessellator &tessellator) {
+  return std::make_shared<SurfaceModel>(
+      device, BuilderFromMesh(tessellator.Tessellate(surface)));
+}
 
-      builder.indices.push_back(index + 1);
-      builder.indices.push_back(index + POINT_COUNT);
-      builder.indices.push_back(index + POINT_COUNT + 1);
-    }
+TriangleModel::Builder
+SurfaceModel::BuilderFromMesh(const nurbs::SurfaceMesh &mesh) {
+  TriangleModel::Builder builder;
+  builder.vertices.resize(mesh.positions.size() / 3);
+  for (size_t index = 0; index < builder.vertices.size(); ++index) {
+    const float *position = mesh.positions.data() + (3 * index);
+    const float *normal = mesh.normals.data() + (3 * index);
+    const float *uv = mesh.uvs.data() + (2 * index);
+    TriangleModel::Vertex &v = builder.vertices[index];
+    v.pos = {position[0], position[1], position[2]};
+    v.color = {1.0f, 1.0f, 1.0f};
+    v.normal = {normal[0], normal[1], normal[2]};
+    v.uv = {uv[0], uv[1]};
   }
-  return std::make_shared<SurfaceModel>(device, builder);
+  builder.indices = mesh.indices;
+  return builder;
 }
-} // namespace vulkeng
\ No newline at end of file
+} // namespace vulkeng
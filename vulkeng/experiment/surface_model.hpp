@@ -1,6 +1,8 @@
 #pragma once
 
+#include "nurbs_cpp/include/adaptive_tessellator.hpp"
 #include "nurbs_cpp/include/surface.hpp"
+#include "nurbs_cpp/include/tessellation_engine.hpp"
 
 #include "vulkeng/include/triangle_model.hpp"
 
@@ -16,5 +18,19 @@ class SurfaceModel : public TriangleModel {
 
   static std::shared_ptr<SurfaceModel> ModelFromSurface(
       VulkanDevice* device, const nurbs::Surface& surface);
+  static std::shared_ptr<SurfaceModel> ModelFromSurface(
+      VulkanDevice* device, const nurbs::Surface& surface,
+      nurbs::TessellationEngine& engine);
+  // One model for a whole set of patches, tessellated in parallel
+  static std::shared_ptr<SurfaceModel> ModelFromSurfaces(
+      VulkanDevice* device, const std::vector<const nurbs::Surface*>& surfaces,
+      nurbs::TessellationEngine& engine);
+  // Fewer triangles where the surface is flat, see nurbs::AdaptiveTessellator
+  static std::shared_ptr<SurfaceModel> ModelFromSurfaceAdaptive(
+      VulkanDevice* device, const nurbs::Surface& surface,
+      const nurbs::AdaptiveTessellator& tessellator);
+
+ private:
+  static TriangleModel::Builder BuilderFromMesh(const nurbs::SurfaceMesh& mesh);
 };
 }  // namespace vulkeng
\ No newline at end of file